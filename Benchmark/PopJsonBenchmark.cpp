@@ -0,0 +1,1247 @@
+/*
+	PopJson benchmark suite
+
+	Generates corpora (see PopJsonBenchmarkCorpus.hpp), runs each benchmark for a minimum
+	time per batch, keeps the best batch, and writes machine-readable json results so runs
+	can be compared across commits (and against json11 when built with POPJSON_JSON11_DIR).
+
+	PopJsonBenchmark [--scale 1.0] [--seed 1234] [--min-time 0.2] [--repeats 3]
+					 [--filter substring] [--label name] [--out results.json]
+*/
+#include "PopJson.hpp"
+#include "PopJsonColumns.hpp"
+#include "PopJsonSidecar.hpp"
+#include "PopJsonTranscode.hpp"
+#include "PopJsonReformat.hpp"
+#include "PopJsonPatch.hpp"
+#include "PopJsonPath.hpp"
+#include "PopJsonShape.hpp"
+#include "PopJsonStream.hpp"
+#include "PopJsonScan.hpp"
+#include "PopJsonBenchmarkCorpus.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#if defined(POPJSON_ZLIB)
+#include <zlib.h>
+#endif
+
+#if defined(POPJSON_BENCHMARK_JSON11)
+#include "json11.hpp"
+#endif
+
+#if !defined(POPJSON_GIT_COMMIT)
+#define POPJSON_GIT_COMMIT	""
+#endif
+
+
+//	count every heap allocation so each benchmark can report allocations per operation
+namespace
+{
+	std::atomic<uint64_t>	gAllocationCount(0);
+
+	//	operator new/delete only call these, so the compiler doesn't see malloc & free paired with new & delete
+	void*	CountedAlloc(std::size_t Size)
+	{
+		gAllocationCount.fetch_add( 1, std::memory_order_relaxed );
+		if ( auto* Pointer = std::malloc( Size ? Size : 1 ) )
+			return Pointer;
+		throw std::bad_alloc();
+	}
+
+	void	CountedFree(void* Pointer)
+	{
+		std::free( Pointer );
+	}
+}
+
+void* operator new(std::size_t Size)
+{
+	return CountedAlloc( Size );
+}
+
+void operator delete(void* Pointer) noexcept
+{
+	CountedFree( Pointer );
+}
+
+void operator delete(void* Pointer,std::size_t) noexcept
+{
+	CountedFree( Pointer );
+}
+
+
+namespace
+{
+	class Params_t
+	{
+	public:
+		double		mScale = 1.0;		//	1.0 = 4mb per corpus
+		uint64_t	mSeed = 1234;
+		double		mMinBatchSeconds = 0.2;
+		int			mRepeats = 3;
+		std::string	mFilter;
+		std::string	mLabel;
+		std::string	mOutputFilename;
+	};
+
+	class Result_t
+	{
+	public:
+		std::string	mLibrary;
+		std::string	mBenchmark;
+		std::string	mCorpus;
+		size_t		mBytesPerOp = 0;		//	0 if throughput in bytes isn't meaningful
+		size_t		mItemsPerOp = 1;		//	eg. number of values extracted per op
+		uint64_t	mIterations = 0;
+		double		mSeconds = 0;			//	best batch
+		double		mAllocationsPerOp = 0;
+
+		double		GetNanosecondsPerOp() const	{	return (mSeconds * 1e9) / mIterations;	}
+		double		GetOpsPerSecond() const		{	return mIterations / mSeconds;	}
+		double		GetGigabytesPerSecond() const	{	return (mBytesPerOp * mIterations) / mSeconds / 1e9;	}
+	};
+
+	//	sink values so the optimiser can't remove benchmarked work
+	std::atomic<size_t>	gSink(0);
+	template<typename TYPE>
+	void	Consume(const TYPE& Value)	{	gSink.fetch_add( static_cast<size_t>(Value), std::memory_order_relaxed );	}
+
+
+	class Runner_t
+	{
+	public:
+		Runner_t(const Params_t& Params) :
+			mParams	( Params )
+		{
+		}
+
+		bool		IsEnabled(std::string_view Library,std::string_view Benchmark,std::string_view Corpus)
+		{
+			if ( mParams.mFilter.empty() )
+				return true;
+			std::string Name = std::string(Library) + "/" + std::string(Benchmark) + "/" + std::string(Corpus);
+			return Name.find( mParams.mFilter ) != std::string::npos;
+		}
+
+		template<typename FUNC>
+		void		Run(std::string Library,std::string Benchmark,std::string Corpus,size_t BytesPerOp,size_t ItemsPerOp,FUNC Function)
+		{
+			if ( !IsEnabled( Library, Benchmark, Corpus ) )
+				return;
+
+			using Clock = std::chrono::steady_clock;
+			Result_t Result;
+			Result.mLibrary = Library;
+			Result.mBenchmark = Benchmark;
+			Result.mCorpus = Corpus;
+			Result.mBytesPerOp = BytesPerOp;
+			Result.mItemsPerOp = ItemsPerOp;
+
+			try
+			{
+				//	warm up
+				Function();
+
+				uint64_t TotalIterations = 0;
+				uint64_t TotalAllocations = 0;
+				double BestSecondsPerOp = -1;
+				for ( int r=0;	r<mParams.mRepeats;	r++ )
+				{
+					uint64_t Iterations = 0;
+					auto AllocationsBefore = gAllocationCount.load();
+					auto Start = Clock::now();
+					double Elapsed = 0;
+					do
+					{
+						Function();
+						Iterations++;
+						Elapsed = std::chrono::duration<double>( Clock::now() - Start ).count();
+					}
+					while ( Elapsed < mParams.mMinBatchSeconds );
+					TotalAllocations += gAllocationCount.load() - AllocationsBefore;
+					TotalIterations += Iterations;
+
+					auto SecondsPerOp = Elapsed / Iterations;
+					if ( BestSecondsPerOp < 0 || SecondsPerOp < BestSecondsPerOp )
+					{
+						BestSecondsPerOp = SecondsPerOp;
+						Result.mIterations = Iterations;
+						Result.mSeconds = Elapsed;
+					}
+				}
+				Result.mAllocationsPerOp = static_cast<double>(TotalAllocations) / TotalIterations;
+			}
+			catch(std::exception& e)
+			{
+				std::cerr << Library << "/" << Benchmark << "/" << Corpus << " failed; " << e.what() << std::endl;
+				return;
+			}
+
+			std::cerr << Library << "/" << Benchmark << "/" << Corpus << ": " << Result.GetNanosecondsPerOp() << "ns/op";
+			if ( Result.mBytesPerOp )
+				std::cerr << ", " << Result.GetGigabytesPerSecond() << "GB/s";
+			std::cerr << ", " << Result.mAllocationsPerOp << " allocs/op" << std::endl;
+			mResults.push_back( Result );
+		}
+
+	public:
+		const Params_t&			mParams;
+		std::vector<Result_t>	mResults;
+	};
+
+
+	void WriteJsonString(std::ostream& Json,std::string_view String)
+	{
+		Json << '"';
+		for ( auto Char : String )
+		{
+			if ( Char == '"' || Char == '\\' )
+				Json << '\\' << Char;
+			else if ( static_cast<uint8_t>(Char) < 0x20 )
+				Json << ' ';
+			else
+				Json << Char;
+		}
+		Json << '"';
+	}
+
+	void WriteResults(std::ostream& Json,const Params_t& Params,const std::vector<PopJsonBenchmark::Corpus_t>& Corpora,const std::vector<Result_t>& Results)
+	{
+		Json.precision(6);
+		Json << "{\n";
+		Json << "\t\"commit\":";	WriteJsonString( Json, POPJSON_GIT_COMMIT );	Json << ",\n";
+		Json << "\t\"label\":";		WriteJsonString( Json, Params.mLabel );	Json << ",\n";
+		Json << "\t\"compiler\":";	WriteJsonString( Json, __VERSION__ );	Json << ",\n";
+		Json << "\t\"scale\":" << Params.mScale << ",\n";
+		Json << "\t\"seed\":" << Params.mSeed << ",\n";
+		Json << "\t\"corpora\":[\n";
+		for ( size_t c=0;	c<Corpora.size();	c++ )
+		{
+			Json << "\t\t{\"name\":";
+			WriteJsonString( Json, Corpora[c].mName );
+			Json << ",\"bytes\":" << Corpora[c].mJson.size() << "}" << (c+1<Corpora.size() ? "," : "") << "\n";
+		}
+		Json << "\t],\n";
+		Json << "\t\"results\":[\n";
+		for ( size_t r=0;	r<Results.size();	r++ )
+		{
+			auto& Result = Results[r];
+			Json << "\t\t{\"library\":";	WriteJsonString( Json, Result.mLibrary );
+			Json << ",\"benchmark\":";		WriteJsonString( Json, Result.mBenchmark );
+			Json << ",\"corpus\":";			WriteJsonString( Json, Result.mCorpus );
+			Json << ",\"iterations\":" << Result.mIterations;
+			Json << ",\"seconds\":" << Result.mSeconds;
+			Json << ",\"ns_per_op\":" << Result.GetNanosecondsPerOp();
+			Json << ",\"ops_per_sec\":" << Result.GetOpsPerSecond();
+			Json << ",\"items_per_sec\":" << Result.GetOpsPerSecond() * Result.mItemsPerOp;
+			if ( Result.mBytesPerOp )
+			{
+				Json << ",\"bytes_per_op\":" << Result.mBytesPerOp;
+				Json << ",\"gb_per_sec\":" << Result.GetGigabytesPerSecond();
+			}
+			Json << ",\"allocs_per_op\":" << Result.mAllocationsPerOp;
+			Json << "}" << (r+1<Results.size() ? "," : "") << "\n";
+		}
+		Json << "\t]\n";
+		Json << "}\n";
+	}
+
+	const PopJsonBenchmark::Corpus_t& GetCorpus(const std::vector<PopJsonBenchmark::Corpus_t>& Corpora,std::string_view Name)
+	{
+		for ( auto& Corpus : Corpora )
+			if ( Corpus.mName == Name )
+				return Corpus;
+		throw std::runtime_error("Missing corpus " + std::string(Name));
+	}
+
+
+	void RunPopJson(Runner_t& Runner,const std::vector<PopJsonBenchmark::Corpus_t>& Corpora)
+	{
+		using namespace PopJson;
+		const std::string Library = "PopJson";
+
+		//	parse
+		for ( auto& Corpus : Corpora )
+		{
+			std::string_view Json = Corpus.mJson;
+			if ( Corpus.mLines.empty() )
+			{
+				Runner.Run( Library, "parse", Corpus.mName, Json.size(), 1, [&]()
+				{
+					Value_t Root( Json );
+					Consume( Root.GetChildCount() );
+				});
+			}
+			else
+			{
+				Runner.Run( Library, "parse", Corpus.mName, Json.size(), Corpus.mLines.size(), [&]()
+				{
+					for ( auto& Line : Corpus.mLines )
+					{
+						Value_t Record( Json.substr( Line.first, Line.second ) );
+						Consume( Record.GetChildCount() );
+					}
+				});
+			}
+		}
+
+		//	record-at-a-time from a reader; only a record and a block are held at once
+		{
+			auto GetStringReader = [](std::string_view Json)
+			{
+				return [=](std::span<char> Buffer) mutable
+				{
+					auto Read = std::min( Buffer.size(), Json.size() );
+					std::memcpy( Buffer.data(), Json.data(), Read );
+					Json.remove_prefix( Read );
+					return Read;
+				};
+			};
+			auto& Lines = GetCorpus( Corpora, "ndjson" );
+			Runner.Run( Library, "stream_values", Lines.mName, Lines.mJson.size(), Lines.mLines.size(), [&]()
+			{
+				for ( auto& Record : Stream::ReadValues( GetStringReader( Lines.mJson ) ) )
+					Consume( Record.GetChildCount() );
+			});
+			auto& Twitter = GetCorpus( Corpora, "twitter" );
+			Runner.Run( Library, "stream_elements", Twitter.mName, Twitter.mJson.size(), 1, [&]()
+			{
+				for ( auto& Status : Stream::ReadElements( GetStringReader( Twitter.mJson ), "/statuses" ) )
+					Consume( Status.GetChildCount() );
+			});
+
+#if defined(POPJSON_ZLIB)
+			//	gzip'd records; inflate everything then parse, vs inflating on another thread while parsing
+			std::string Compressed;
+			{
+				z_stream Stream = {};
+				deflateInit2( &Stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15+16, 8, Z_DEFAULT_STRATEGY );
+				Compressed.resize( deflateBound( &Stream, Lines.mJson.size() ) );
+				Stream.next_in = reinterpret_cast<Bytef*>( const_cast<char*>( Lines.mJson.data() ) );
+				Stream.avail_in = static_cast<uInt>( Lines.mJson.size() );
+				Stream.next_out = reinterpret_cast<Bytef*>( Compressed.data() );
+				Stream.avail_out = static_cast<uInt>( Compressed.size() );
+				deflate( &Stream, Z_FINISH );
+				Compressed.resize( Stream.total_out );
+				deflateEnd( &Stream );
+			}
+			Runner.Run( Library, "gzip_inflate_then_parse", Lines.mName, Lines.mJson.size(), Lines.mLines.size(), [&]()
+			{
+				auto Json = Stream::ReadAll( Stream::GetInflateReader( GetStringReader( Compressed ) ) );
+				for ( auto& Record : Stream::ReadValues( GetStringReader( Json ) ) )
+					Consume( Record.GetChildCount() );
+			});
+			Runner.Run( Library, "gzip_stream_values", Lines.mName, Lines.mJson.size(), Lines.mLines.size(), [&]()
+			{
+				for ( auto& Record : Stream::ReadValues( Stream::GetInflateReader( GetStringReader( Compressed ) ) ) )
+					Consume( Record.GetChildCount() );
+			});
+#endif
+		}
+
+		//	key lookup in a wide object
+		{
+			auto& Corpus = GetCorpus( Corpora, "citm" );
+			std::string_view Json = Corpus.mJson;
+			Value_t Root( Json );
+			auto AreaNames = Root.GetValue( "areaNames", Json );
+			auto& Keys = Corpus.mLookupKeys;
+			size_t KeyIndex = 0;
+			Runner.Run( Library, "key_lookup", Corpus.mName, 0, 1, [&]()
+			{
+				//	stride through keys so lookups hit the whole object
+				KeyIndex = (KeyIndex + 7919) % Keys.size();
+				auto Value = AreaNames.GetValue( Keys[KeyIndex], Json );
+				Consume( Value.GetType() );
+			});
+			Runner.Run( Library, "key_lookup_missing", Corpus.mName, 0, 1, [&]()
+			{
+				Consume( AreaNames.HasKey( "not-a-key", Json ) );
+			});
+
+			//	optional fields; roughly a third of lookups miss
+			auto GetOptionalKey = [&]()
+			{
+				KeyIndex = (KeyIndex + 7919) % Keys.size();
+				return (KeyIndex % 3) == 0 ? std::string_view("not-a-key") : std::string_view(Keys[KeyIndex]);
+			};
+			Runner.Run( Library, "optional_lookup_throw", Corpus.mName, 0, 1, [&]()
+			{
+				try
+				{
+					Consume( AreaNames.GetValue( GetOptionalKey(), Json ).GetType() );
+				}
+				catch(std::exception&)
+				{
+					Consume( 0 );
+				}
+			});
+			Runner.Run( Library, "optional_lookup_try", Corpus.mName, 0, 1, [&]()
+			{
+				auto Value = AreaNames.TryGetValue( GetOptionalKey(), Json );
+				Consume( Value ? Value->GetType() : 0 );
+			});
+		}
+
+		//	a handler's worth of fields from each message; a lookup per key vs one pass for them all
+		{
+			auto& Corpus = GetCorpus( Corpora, "twitter" );
+			std::string_view Json = Corpus.mJson;
+			std::string_view FieldNames[] = { "id", "text", "source", "truncated", "in_reply_to_status_id", "in_reply_to_user_id", "user", "geo", "coordinates", "place", "retweet_count", "favorite_count", "favorited", "retweeted", "lang", "not_a_field" };
+			KeySet_t Fields( FieldNames );
+			auto Statuses = Value_t( Json ).GetValue( "statuses", Json );
+			std::vector<Value_t> Messages;
+			for ( size_t i=0;	i<Statuses.GetChildCount();	i++ )
+				Messages.push_back( Statuses.GetValue( i, Json ) );
+			size_t MessageIndex = 0;
+			Runner.Run( Library, "multi_key_lookup", Corpus.mName, 0, 1, [&]()
+			{
+				auto& Message = Messages[MessageIndex++ % Messages.size()];
+				for ( auto Field : FieldNames )
+				{
+					auto Value = Message.TryGetValue( Field, Json );
+					Consume( Value ? Value->GetType() : 0 );
+				}
+			});
+			Runner.Run( Library, "multi_key_lookup_bulk", Corpus.mName, 0, 1, [&]()
+			{
+				auto& Message = Messages[MessageIndex++ % Messages.size()];
+				Node_t* Nodes[std::size(FieldNames)];
+				Message.FindNodes( Fields, Json, Nodes );
+				for ( auto* Node : Nodes )
+					Consume( Node ? Node->GetType() : 0 );
+			});
+
+			auto Map = Parse( Json );
+			std::vector<NodeIndex_t> MessageNodes;
+			auto StatusesNode = Map.GetChild( 0, "statuses", Json );
+			for ( auto Child = Map.GetFirstChild(StatusesNode);	Child != InvalidNodeIndex;	Child = Map.GetNextSibling(Child) )
+				MessageNodes.push_back( Child );
+			Runner.Run( Library, "map_multi_key_lookup", Corpus.mName, 0, 1, [&]()
+			{
+				auto Message = MessageNodes[MessageIndex++ % MessageNodes.size()];
+				for ( auto Field : FieldNames )
+					Consume( Map.FindChild( Message, Field, Json ) );
+			});
+			Runner.Run( Library, "map_multi_key_lookup_bulk", Corpus.mName, 0, 1, [&]()
+			{
+				auto Message = MessageNodes[MessageIndex++ % MessageNodes.size()];
+				NodeIndex_t Children[std::size(FieldNames)];
+				Map.FindChildren( Message, Fields, Json, Children );
+				for ( auto Child : Children )
+					Consume( Child );
+			});
+		}
+
+		//	records sharing a layout; a lookup per field vs reading fields by the record's (predicted) shape.
+		//	ndjson log lines are narrow, twitter statuses are ~25 members
+		for ( auto& Corpus : Corpora )
+		{
+			std::string_view Json = Corpus.mJson;
+			std::vector<std::string_view> FieldNames;
+			std::vector<std::pair<std::string_view,Value_t>> Records;
+			if ( Corpus.mName == "ndjson" )
+			{
+				FieldNames = { "status", "latency_ms", "level", "service", "msg", "ts" };
+				for ( auto& Line : Corpus.mLines )
+				{
+					auto Record = Json.substr( Line.first, Line.second );
+					Records.push_back( { Record, Value_t( Record ) } );
+				}
+			}
+			else if ( Corpus.mName == "twitter" )
+			{
+				FieldNames = { "id", "text", "truncated", "in_reply_to_status_id", "retweet_count", "favorite_count", "favorited", "retweeted", "lang" };
+				auto Statuses = Value_t( Json ).GetValue( "statuses", Json );
+				for ( size_t i=0;	i<Statuses.GetChildCount();	i++ )
+					Records.push_back( { Json, Statuses.GetValue( i, Json ) } );
+			}
+			else
+			{
+				continue;
+			}
+
+			Runner.Run( Library, "record_lookup", Corpus.mName, 0, Records.size(), [&]()
+			{
+				for ( auto& [RecordJson,Record] : Records )
+					for ( auto Field : FieldNames )
+						Consume( Record.TryGetValue( Field, RecordJson ).HasValue() );
+			});
+			ShapeCache_t Shapes;
+			KeySet_t Fields( FieldNames );
+			std::vector<size_t> ChildIndexes( Fields.size() );
+			Runner.Run( Library, "record_lookup_shape", Corpus.mName, 0, Records.size(), [&]()
+			{
+				const Shape_t* Shape = nullptr;
+				const Shape_t* ResolvedShape = nullptr;
+				for ( auto& [RecordJson,Record] : Records )
+				{
+					Shape = Shapes.GetShape( Record, RecordJson, Shape );
+					if ( Shape != ResolvedShape )
+					{
+						Shape->FindMembers( Fields, ChildIndexes );
+						ResolvedShape = Shape;
+					}
+					for ( auto Child : ChildIndexes )
+						Consume( Child == Shape_t::InvalidChildIndex ? ValueType_t::Null : Record.mNodes[Child].GetValue( RecordJson ).GetType() );
+				}
+			});
+		}
+
+		//	dedup of subtrees; content hashes are built once for the whole map, vs hashing each status' text
+		//	(which also differs for equal values with different whitespace, key order or escapes)
+		{
+			auto& Corpus = GetCorpus( Corpora, "twitter" );
+			std::string_view Json = Corpus.mJson;
+			auto Map = Parse( Json );
+			std::vector<NodeIndex_t> StatusNodes;
+			for ( auto Child = Map.GetFirstChild( Map.GetChild( 0, "statuses", Json ) );	Child != InvalidNodeIndex;	Child = Map.GetNextSibling(Child) )
+				StatusNodes.push_back( Child );
+			Runner.Run( Library, "content_hash_build", Corpus.mName, Json.size(), 1, [&]()
+			{
+				Map.BuildContentHashes( Json );
+				Consume( Map.GetContentHash(0) );
+			});
+			std::unordered_set<uint64_t> Distinct;
+			Runner.Run( Library, "dedup_subtrees_raw_hash", Corpus.mName, 0, StatusNodes.size(), [&]()
+			{
+				Distinct.clear();
+				for ( auto Status : StatusNodes )
+				{
+					auto Raw = Map.GetNode(Status).GetValuePosition().GetContents( Json );
+					Distinct.insert( Hash64( Raw.data(), Raw.size() ) );
+				}
+				Consume( Distinct.size() );
+			});
+			Runner.Run( Library, "dedup_subtrees_content_hash", Corpus.mName, 0, StatusNodes.size(), [&]()
+			{
+				Distinct.clear();
+				for ( auto Status : StatusNodes )
+					Distinct.insert( Map.GetContentHash( Status ) );
+				Consume( Distinct.size() );
+			});
+
+			//	a document's hash after a write; only the written member is rehashed (the patch is the same for both)
+			Json_t Document( Json );
+			Consume( Document.GetContentHash() );
+			int Counter = 0;
+			Runner.Run( Library, "json_content_hash_after_set", Corpus.mName, 0, 1, [&]()
+			{
+				Document.ApplyMergePatch( "{\"counter\":" + std::to_string( Counter++ % 100 ) + "}" );
+				Consume( Document.GetContentHash() );
+			});
+			Json_t Rehashed( Json );
+			Runner.Run( Library, "json_content_hash_after_set_full", Corpus.mName, 0, 1, [&]()
+			{
+				Rehashed.ApplyMergePatch( "{\"counter\":" + std::to_string( Counter++ % 100 ) + "}" );
+				auto Stringified = Rehashed.GetJsonString();
+				auto RehashedMap = Parse( Stringified );
+				RehashedMap.BuildContentHashes( Stringified );
+				Consume( RehashedMap.GetContentHash(0) );
+			});
+		}
+
+		//	deep path; root.statuses[i].user.screen_name
+		{
+			auto& Corpus = GetCorpus( Corpora, "twitter" );
+			std::string_view Json = Corpus.mJson;
+			Value_t Root( Json );
+			auto StatusCount = Root.GetValue( "statuses", Json ).GetChildCount();
+			size_t StatusIndex = 0;
+			std::string Buffer;
+			Runner.Run( Library, "deep_path", Corpus.mName, 0, 1, [&]()
+			{
+				StatusIndex = (StatusIndex + 31) % StatusCount;
+				auto ScreenName = Root.GetValue( "statuses", Json ).GetValue( StatusIndex, Json ).GetValue( "user", Json ).GetValue( "screen_name", Json );
+				Consume( ScreenName.GetString( Buffer, Json ).size() );
+			});
+		}
+
+		//	numeric bulk extraction of every coordinate
+		{
+			auto& Corpus = GetCorpus( Corpora, "canada" );
+			std::string_view Json = Corpus.mJson;
+			Value_t Root( Json );
+			auto Rings = Root.GetValue( "features", Json ).GetValue( 0, Json ).GetValue( "geometry", Json ).GetValue( "coordinates", Json );
+			size_t ValueCount = 0;
+			for ( auto& Ring : Rings.GetChildren() )
+				ValueCount += Ring.GetValue(Json).GetChildCount() * 2;
+
+			std::vector<double> Values;
+			Values.reserve( ValueCount );
+			Runner.Run( Library, "numeric_extract", Corpus.mName, Json.size(), ValueCount, [&]()
+			{
+				Values.clear();
+				for ( auto& RingNode : Rings.GetChildren() )
+				{
+					auto Ring = RingNode.GetValue( Json );
+					for ( auto& PointNode : Ring.GetChildren() )
+					{
+						auto Point = PointNode.GetValue( Json );
+						Values.push_back( Point.GetValue( 0, Json ).GetDouble( Json ) );
+						Values.push_back( Point.GetValue( 1, Json ).GetDouble( Json ) );
+					}
+				}
+				Consume( Values.size() );
+			});
+		}
+
+		//	decoding every number while parsing, then reading them from the tape rather than the text
+		{
+			auto& Corpus = GetCorpus( Corpora, "canada" );
+			std::string_view Json = Corpus.mJson;
+			//	compare with map_parse
+			Runner.Run( Library, "map_parse_number_tape", Corpus.mName, Json.size(), 1, [&]()
+			{
+				Consume( Parse<NumberTapePolicy_t>( Json ).GetNodeCount() );
+			});
+
+			auto SumNumbers = [&](const Map_t& Map)
+			{
+				double Total = 0;
+				for ( NodeIndex_t Node=0;	Node<Map.GetNodeCount();	Node++ )
+					Total += SliceReadOnly_t( Map, Json, Node ).TryGetDouble().ValueOr(0);
+				Consume( Total );
+			};
+			auto Plain = Parse( Json );
+			auto Taped = Parse<NumberTapePolicy_t>( Json );
+			Runner.Run( Library, "map_read_numbers", Corpus.mName, Json.size(), Plain.GetNodeCount(), [&]()	{	SumNumbers( Plain );	} );
+			Runner.Run( Library, "map_read_numbers_tape", Corpus.mName, Json.size(), Taped.GetNodeCount(), [&]()	{	SumNumbers( Taped );	} );
+		}
+
+		//	mapping only a couple of fields of each status; compare with map_parse
+		{
+			auto& Corpus = GetCorpus( Corpora, "twitter" );
+			std::string_view Json = Corpus.mJson;
+			Projection_t Projection{ "/statuses/*/id", "/statuses/*/user/screen_name" };
+			Runner.Run( Library, "map_parse_projected", Corpus.mName, Json.size(), 1, [&]()
+			{
+				Consume( Parse( Json, Projection ).GetNodeCount() );
+			});
+		}
+
+		//	JSONPath queries over a parsed map
+		{
+			auto& Corpus = GetCorpus( Corpora, "twitter" );
+			std::string_view Json = Corpus.mJson;
+			auto Map = Parse( Json );
+			std::vector<NodeIndex_t> Nodes;
+			JsonPath_t ScreenNames( "$.statuses[*].user.screen_name" );
+			JsonPath_t Ids( "$..id" );
+			Runner.Run( Library, "jsonpath_wildcard", Corpus.mName, Json.size(), 1, [&]()
+			{
+				ScreenNames.Evaluate( Map, Json, Nodes );
+				Consume( Nodes.size() );
+			});
+			Runner.Run( Library, "jsonpath_descendants", Corpus.mName, Json.size(), 1, [&]()
+			{
+				Ids.Evaluate( Map, Json, Nodes );
+				Consume( Nodes.size() );
+			});
+
+			const size_t ElementCount = 200*1000;
+			std::string Wide = "[";
+			for ( size_t i=0;	i<ElementCount;	i++ )
+				Wide += "{\"level\":\"" + std::string( i % 7 ? "info" : "error" ) + "\",\"id\":" + std::to_string(i) + "},";
+			Wide.back() = ']';
+			auto WideMap = Parse( Wide );
+			JsonPath_t Errors( "$[?(@.level=='error')].id" );
+			size_t ThreadCount = std::max<size_t>( 1, std::thread::hardware_concurrency() );
+			Runner.Run( Library, "jsonpath_filter", "generated", Wide.size(), ElementCount, [&]()
+			{
+				Errors.Evaluate( WideMap, Wide, Nodes );
+				Consume( Nodes.size() );
+			});
+			Runner.Run( Library, "jsonpath_filter_threaded", "generated", Wide.size(), ElementCount, [&]()
+			{
+				Errors.Evaluate( WideMap, Wide, Nodes, ThreadCount );
+				Consume( Nodes.size() );
+			});
+		}
+
+		//	columns of an array of objects; per row slices vs the columnar extractor
+		{
+			const size_t RowCount = 200*1000;
+			std::string Json = "[";
+			for ( size_t i=0;	i<RowCount;	i++ )
+				Json += "{\"id\":" + std::to_string(i) + ",\"name\":\"row" + std::to_string(i%100) + "\",\"price\":" + std::to_string(i*0.25) + ",\"ok\":true},";
+			Json.back() = ']';
+			auto Map = Parse( Json );
+			Value_t Root( Json );
+			Runner.Run( Library, "columns_per_row_value", "generated", Json.size(), RowCount, [&]()
+			{
+				std::vector<int64_t> Ids;
+				std::vector<double> Prices;
+				std::vector<std::string> Names;
+				for ( auto& RowNode : Root.GetChildren() )
+				{
+					auto Row = RowNode.GetValue( Json );
+					Ids.push_back( Row.GetValue( "id", Json ).GetInteger( Json ) );
+					Prices.push_back( Row.GetValue( "price", Json ).GetDouble( Json ) );
+					Names.push_back( Row.GetValue( "name", Json ).GetString( Json ) );
+				}
+				Consume( Ids.size() + Prices.size() + Names.size() );
+			});
+
+			KeySet_t Keys{ "id", "price", "name" };
+			Runner.Run( Library, "columns_per_row", "generated", Json.size(), RowCount, [&]()
+			{
+				std::vector<int64_t> Ids;
+				std::vector<double> Prices;
+				std::vector<std::string_view> Names;
+				SliceReadOnly_t Values[3];
+				for ( auto Row : SliceReadOnly_t( Map, Json ).elements() )
+				{
+					Row.GetValues( Keys, Values );
+					Ids.push_back( Values[0].TryGetInteger64().ValueOr(0) );
+					Prices.push_back( Values[1].TryGetDouble().ValueOr(0) );
+					Names.push_back( Values[2].GetRawValue() );
+				}
+				Consume( Ids.size() + Prices.size() + Names.size() );
+			});
+
+			ColumnSpec_t Specs[] = { { "id", ColumnType_t::Integer }, { "price", ColumnType_t::Double }, { "name", ColumnType_t::String } };
+			size_t ThreadCount = std::max<size_t>( 1, std::thread::hardware_concurrency() );
+			Runner.Run( Library, "columns_extract", "generated", Json.size(), RowCount, [&]()
+			{
+				Consume( ExtractColumns( Map, Json, 0, Specs )[0].GetValidCount() );
+			});
+			Runner.Run( Library, "columns_extract_threaded", "generated", Json.size(), RowCount, [&]()
+			{
+				Consume( ExtractColumns( Map, Json, 0, Specs, ThreadCount )[0].GetValidCount() );
+			});
+		}
+
+		//	unescape every string
+		{
+			auto& Corpus = GetCorpus( Corpora, "strings" );
+			std::string_view Json = Corpus.mJson;
+			Value_t Root( Json );
+			auto Strings = Root.GetValue( "strings", Json );
+			Runner.Run( Library, "unescape", Corpus.mName, Json.size(), Strings.GetChildCount(), [&]()
+			{
+				for ( auto& Node : Strings.GetChildren() )
+					Consume( Node.GetValue( Json ).GetString( Json ).size() );
+			});
+		}
+
+		//	stringify
+		{
+			auto& Corpus = GetCorpus( Corpora, "twitter" );
+			Json_t Document( Corpus.mJson );
+			auto OutputSize = Document.GetJsonString().size();
+			Runner.Run( Library, "stringify", Corpus.mName, OutputSize, 1, [&]()
+			{
+				Consume( Document.GetJsonString().size() );
+			});
+		}
+
+		//	flat map parse, map lookups, and reloading from a sidecar
+		for ( auto& Corpus : Corpora )
+		{
+			if ( !Corpus.mLines.empty() )
+				continue;
+			std::string_view Json = Corpus.mJson;
+			Runner.Run( Library, "map_parse", Corpus.mName, Json.size(), 1, [&]()
+			{
+				auto Map = Parse( Json );
+				Consume( Map.GetNodeCount() );
+			});
+			Runner.Run( Library, "map_parse_utf8", Corpus.mName, Json.size(), 1, [&]()
+			{
+				auto Map = Parse<Utf8Policy_t>( Json );
+				Consume( Map.GetNodeCount() );
+			});
+			Runner.Run( Library, "utf8_validate", Corpus.mName, Json.size(), 1, [&]()
+			{
+				Consume( Scan::FindInvalidUtf8( Json.data(), Json.size() ) );
+			});
+		}
+		{
+			auto& Corpus = GetCorpus( Corpora, "citm" );
+			std::string_view Json = Corpus.mJson;
+			auto Map = Parse( Json );
+			auto AreaNames = Map.GetChild( 0, "areaNames", Json );
+			auto& Keys = Corpus.mLookupKeys;
+			size_t KeyIndex = 0;
+			Runner.Run( Library, "map_key_lookup", Corpus.mName, 0, 1, [&]()
+			{
+				KeyIndex = (KeyIndex + 7919) % Keys.size();
+				Consume( Map.FindChild( AreaNames, Keys[KeyIndex], Json ) );
+			});
+			Map.BuildKeyIndex( Json );
+			Runner.Run( Library, "map_key_lookup_indexed", Corpus.mName, 0, 1, [&]()
+			{
+				KeyIndex = (KeyIndex + 7919) % Keys.size();
+				Consume( Map.FindChild( AreaNames, Keys[KeyIndex], Json ) );
+			});
+		}
+		{
+			auto& Corpus = GetCorpus( Corpora, "twitter" );
+			std::string_view Json = Corpus.mJson;
+			auto Map = std::make_shared<Map_t>( Parse( Json ) );
+			Map->BuildKeyIndex( Json );
+			View_t Root( Map, 0, Json );
+			auto StatusCount = Map->GetNode( Map->GetChild( 0, "statuses", Json ) ).GetChildCount();
+			size_t StatusIndex = 0;
+			std::string Buffer;
+			Runner.Run( Library, "map_deep_path", Corpus.mName, 0, 1, [&]()
+			{
+				StatusIndex = (StatusIndex + 31) % StatusCount;
+				auto ScreenName = Map->GetChild( Map->GetChild( Map->GetChild( Map->GetChild( 0, "statuses", Json ), StatusIndex ), "user", Json ), "screen_name", Json );
+				Consume( Map->GetNode(ScreenName).GetValuePosition().mLength );
+			});
+
+			auto SidecarFilename = (std::filesystem::temp_directory_path() / "PopJsonBenchmark.sidecar").string();
+			Sidecar::Write( *Map, Json, SidecarFilename );
+			Runner.Run( Library, "sidecar_open_header", Corpus.mName, Json.size(), 1, [&]()
+			{
+				auto Loaded = Sidecar::Open( SidecarFilename, Json, Sidecar::Validate_t::Header );
+				Consume( Loaded.GetNodeCount() );
+			});
+			Runner.Run( Library, "sidecar_open_full", Corpus.mName, Json.size(), 1, [&]()
+			{
+				auto Loaded = Sidecar::Open( SidecarFilename, Json, Sidecar::Validate_t::Full );
+				Consume( Loaded.GetNodeCount() );
+			});
+			std::filesystem::remove( SidecarFilename );
+		}
+
+		//	transcoding the parsed map to binary, and back to json
+		for ( auto& Corpus : Corpora )
+		{
+			if ( !Corpus.mLines.empty() )
+				continue;
+			std::string_view Json = Corpus.mJson;
+			auto Map = Parse( Json );
+			std::vector<uint8_t> Output;
+			Runner.Run( Library, "msgpack_write", Corpus.mName, Json.size(), 1, [&]()
+			{
+				Output.clear();
+				Transcode::Write( Transcode::Format_t::MessagePack, Map, Json, Output );
+				Consume( Output.size() );
+			});
+			std::vector<char> Decoded;
+			Runner.Run( Library, "msgpack_read", Corpus.mName, Json.size(), 1, [&]()
+			{
+				Decoded.clear();
+				Consume( Transcode::ReadToJson( Transcode::Format_t::MessagePack, Output, Decoded ) );
+			});
+			Runner.Run( Library, "cbor_write", Corpus.mName, Json.size(), 1, [&]()
+			{
+				Output.clear();
+				Transcode::Write( Transcode::Format_t::Cbor, Map, Json, Output );
+				Consume( Output.size() );
+			});
+		}
+
+		//	streaming whitespace transforms. minify input is the pretty printed corpus; chunked
+		//	output is drained per chunk, as if written to a file
+		for ( auto& Corpus : Corpora )
+		{
+			if ( !Corpus.mLines.empty() )
+				continue;
+			auto Pretty = PrettyPrint( Corpus.mJson );
+			std::string Output;
+			Runner.Run( Library, "minify", Corpus.mName, Pretty.size(), 1, [&]()
+			{
+				Output.clear();
+				Reformat_t Reformat;
+				Reformat.Write( Pretty, Output );
+				Reformat.Finish();
+				Consume( Output.size() );
+			});
+			Runner.Run( Library, "minify_chunked", Corpus.mName, Pretty.size(), 1, [&]()
+			{
+				const size_t ChunkSize = 64 * 1024;
+				Reformat_t Reformat;
+				size_t Written = 0;
+				for ( size_t Position=0;	Position<Pretty.size();	Position+=ChunkSize )
+				{
+					Output.clear();
+					Reformat.Write( std::string_view(Pretty).substr( Position, ChunkSize ), Output );
+					Written += Output.size();
+				}
+				Reformat.Finish();
+				Consume( Written );
+			});
+			Runner.Run( Library, "pretty_print", Corpus.mName, Corpus.mJson.size(), 1, [&]()
+			{
+				Output.clear();
+				Reformat_t Reformat( 1, '\t' );
+				Reformat.Write( Corpus.mJson, Output );
+				Reformat.Finish();
+				Consume( Output.size() );
+			});
+		}
+
+		//	patching a few top level members of a large document; the rest is copied by splicing
+		for ( auto& Corpus : Corpora )
+		{
+			if ( !Corpus.mLines.empty() )
+				continue;
+			std::string_view Json = Corpus.mJson;
+			auto Map = Parse( Json );
+			auto First = Map.GetFirstChild(0);
+			if ( Map.GetNode(0).GetType() != ValueType_t::Object || First == InvalidNodeIndex )
+				continue;
+			auto Key = std::string( Map.GetNode(First).GetKey(Json) );
+			auto Operations = R"JSON([{"op":"replace","path":"/)JSON" + Key + R"JSON(","value":[1,2,3]},{"op":"add","path":"/patched","value":{"a":1}}])JSON";
+			auto Merge = R"JSON({")JSON" + Key + R"JSON(":null,"patched":{"a":1}})JSON";
+			Runner.Run( Library, "json_patch", Corpus.mName, Json.size(), 1, [&]()
+			{
+				Consume( Patch::Apply( Json, Operations ).size() );
+			});
+			Runner.Run( Library, "merge_patch", Corpus.mName, Json.size(), 1, [&]()
+			{
+				Consume( Patch::MergePatch( Json, Merge ).size() );
+			});
+			Json_t Document( Json );
+			Runner.Run( Library, "json_patch_in_place", Corpus.mName, 0, 1, [&]()
+			{
+				Document.ApplyPatch( Operations );
+				Consume( Document.GetChildCount() );
+			});
+		}
+
+		//	diff against an edited copy; unchanged values are skipped by comparing their bytes.
+		//	citm's events (as a root object) are wide enough to split across threads
+		for ( auto& Corpus : Corpora )
+		{
+			std::string From;
+			std::string To;
+			if ( Corpus.mName == "twitter" )
+			{
+				From = Corpus.mJson;
+				To = Patch::Apply( From, R"JSON([{"op":"replace","path":"/statuses/3/text","value":"edited"},{"op":"remove","path":"/statuses/7"},{"op":"add","path":"/statuses/20/user/extra","value":[1,2]}])JSON" );
+			}
+			else if ( Corpus.mName == "citm" )
+			{
+				auto Map = Parse( Corpus.mJson );
+				auto Events = Map.GetChild( 0, "events", Corpus.mJson );
+				From = "{" + std::string( Map.GetNode(Events).GetValuePosition().GetContents( Corpus.mJson ) ) + "}";
+				auto EventsMap = Parse( From );
+				std::string Merge = "{\"added\":1";
+				size_t Index = 0;
+				for ( auto Event = EventsMap.GetFirstChild(0);	Event != InvalidNodeIndex;	Event = EventsMap.GetNextSibling(Event), Index++ )
+				{
+					if ( Index % 50 == 0 )
+						Merge += ",\"" + std::string( EventsMap.GetNode(Event).GetKey(From) ) + "\":null";
+					else if ( Index % 50 == 25 )
+						Merge += ",\"" + std::string( EventsMap.GetNode(Event).GetKey(From) ) + "\":{\"name\":\"edited\"}";
+				}
+				To = Patch::MergePatch( From, Merge + "}" );
+			}
+			else
+			{
+				continue;
+			}
+			auto FromMap = Parse( From );
+			auto ToMap = Parse( To );
+			Runner.Run( Library, "diff", Corpus.mName, From.size(), 1, [&]()
+			{
+				Consume( Patch::Diff( FromMap, From, ToMap, To ).size() );
+			});
+			auto ThreadCount = std::max<size_t>( 2, std::thread::hardware_concurrency() );
+			Runner.Run( Library, "diff_threads", Corpus.mName, From.size(), 1, [&]()
+			{
+				Consume( Patch::Diff( FromMap, From, ToMap, To, ThreadCount ).size() );
+			});
+		}
+
+		//	iterating a 1M element array through slices; should be memory bound
+		{
+			const size_t ElementCount = 1000*1000;
+			std::string Json = "[";
+			for ( size_t i=0;	i<ElementCount;	i++ )
+				Json += std::to_string(i % 1000) + ",";
+			Json.back() = ']';
+			auto Map = Parse( Json );
+			SliceReadOnly_t Root( Map, Json );
+			Runner.Run( Library, "map_iterate_elements", "generated", Map.GetNodeCount() * sizeof(MapNode_t), ElementCount, [&]()
+			{
+				size_t Total = 0;
+				for ( auto Element : Root.elements() )
+					Total += Element.GetRawValue().size();
+				Consume( Total );
+			});
+			Runner.Run( Library, "map_iterate_integers", "generated", Map.GetNodeCount() * sizeof(MapNode_t), ElementCount, [&]()
+			{
+				int64_t Total = 0;
+				for ( auto Element : Root.elements() )
+					Total += Element.TryGetInteger().ValueOr(0);
+				Consume( Total );
+			});
+		}
+
+		//	building documents; typed Set<T> vs the ValueInput_t path
+		{
+			const size_t SetCount = 1000;
+			const char* Keys[] = { "id", "name", "latency", "ok", "count", "region", "ratio", "enabled" };
+			Runner.Run( Library, "set_typed", "generated", 0, SetCount, [&]()
+			{
+				Json_t Document;
+				for ( size_t i=0;	i<SetCount;	i++ )
+				{
+					auto* Key = Keys[i%8];
+					switch ( i % 4 )
+					{
+						case 0:	Document.Set( Key, static_cast<int>(i) );	break;
+						case 1:	Document.Set( Key, "some string value" );	break;
+						case 2:	Document.Set( Key, i * 0.25 );	break;
+						case 3:	Document.Set( Key, (i&1) != 0 );	break;
+					}
+				}
+				Consume( Document.GetChildCount() );
+			});
+			Runner.Run( Library, "set_valueinput", "generated", 0, SetCount, [&]()
+			{
+				Json_t Document;
+				for ( size_t i=0;	i<SetCount;	i++ )
+				{
+					auto* Key = Keys[i%8];
+					switch ( i % 4 )
+					{
+						case 0:	Document.Set( Key, ValueInput_t( static_cast<int>(i) ) );	break;
+						case 1:	Document.Set( Key, ValueInput_t( std::string_view("some string value") ) );	break;
+						case 2:	Document.Set( Key, ValueInput_t( static_cast<float>(i * 0.25) ) );	break;
+						case 3:	Document.Set( Key, ValueInput_t( (i&1) != 0 ) );	break;
+					}
+				}
+				Consume( Document.GetChildCount() );
+			});
+		}
+
+		//	writing a big array member; a std::function call and string per element vs the bulk typed writer
+		{
+			const size_t ElementCount = 100000;
+			std::vector<uint32_t> Indexes( ElementCount );
+			std::vector<double> Values( ElementCount );
+			for ( size_t i=0;	i<ElementCount;	i++ )
+			{
+				Indexes[i] = static_cast<uint32_t>(i);
+				Values[i] = i * 0.37;
+			}
+			Runner.Run( Library, "push_back_function", "generated", 0, ElementCount, [&]()
+			{
+				Json_t Document;
+				Document.PushBack( "values", Indexes, [&](const uint32_t& Index)	{	return std::to_string( Values[Index] );	} );
+				Consume( Document.GetChildCount() );
+			});
+			Runner.Run( Library, "push_back_bulk", "generated", 0, ElementCount, [&]()
+			{
+				Json_t Document;
+				Document.PushBack( "values", Values );
+				Consume( Document.GetChildCount() );
+			});
+		}
+
+		//	an aggregator appending one element per event to a nested array; re-writing the top level
+		//	value each time (as an in-place json patch does) vs growing it in place
+		{
+			const size_t EventCount = 4000;
+			const char* Document = R"JSON({"source":{"name":"sensor","events":[],"count":0},"tags":[]})JSON";
+			Runner.Run( Library, "append_nested_patch", "generated", 0, EventCount, [&]()
+			{
+				Json_t Json( Document );
+				for ( size_t i=0;	i<EventCount;	i++ )
+					Json.ApplyPatch( R"JSON([{"op":"add","path":"/source/events/-","value":12345}])JSON" );
+				Consume( Json.GetChildCount() );
+			});
+			Runner.Run( Library, "append_nested", "generated", 0, EventCount, [&]()
+			{
+				Json_t Json( Document );
+				for ( size_t i=0;	i<EventCount;	i++ )
+					Json.PushBackAt( "/source/events", 12345 );
+				Consume( Json.GetChildCount() );
+			});
+		}
+
+		//	changing a nested value of a twitter status; patching splices & re-writes the whole top level value
+		{
+			auto& Corpus = GetCorpus( Corpora, "twitter" );
+			const size_t SetCount = 100;
+			Json_t Base( Corpus.mJson );
+			Runner.Run( Library, "set_nested_patch", Corpus.mName, 0, SetCount, [&]()
+			{
+				Json_t Json( Base );
+				for ( size_t i=0;	i<SetCount;	i++ )
+					Json.ApplyPatch( "[{\"op\":\"replace\",\"path\":\"/search_metadata/count\",\"value\":" + std::to_string(i) + "},{\"op\":\"replace\",\"path\":\"/statuses/0/user/followers_count\",\"value\":" + std::to_string(i) + "}]" );
+				Consume( Json.GetChildCount() );
+			});
+			Runner.Run( Library, "set_nested", Corpus.mName, 0, SetCount, [&]()
+			{
+				Json_t Json( Base );
+				for ( size_t i=0;	i<SetCount;	i++ )
+				{
+					Json["search_metadata"]["count"] = i;
+					Json.SetAt( "/statuses/0/user/followers_count", i );
+				}
+				Consume( Json.GetChildCount() );
+			});
+		}
+	}
+
+
+#if defined(POPJSON_BENCHMARK_JSON11)
+	void RunJson11(Runner_t& Runner,const std::vector<PopJsonBenchmark::Corpus_t>& Corpora)
+	{
+		const std::string Library = "json11";
+
+		for ( auto& Corpus : Corpora )
+		{
+			if ( Corpus.mLines.empty() )
+			{
+				Runner.Run( Library, "parse", Corpus.mName, Corpus.mJson.size(), 1, [&]()
+				{
+					std::string Error;
+					auto Root = json11::Json::parse( Corpus.mJson, Error );
+					Consume( Root.object_items().size() );
+				});
+			}
+			else
+			{
+				Runner.Run( Library, "parse", Corpus.mName, Corpus.mJson.size(), Corpus.mLines.size(), [&]()
+				{
+					for ( auto& Line : Corpus.mLines )
+					{
+						std::string Error;
+						auto Record = json11::Json::parse( Corpus.mJson.substr( Line.first, Line.second ), Error );
+						Consume( Record.object_items().size() );
+					}
+				});
+			}
+		}
+
+		{
+			auto& Corpus = GetCorpus( Corpora, "citm" );
+			std::string Error;
+			auto Root = json11::Json::parse( Corpus.mJson, Error );
+			auto& AreaNames = Root["areaNames"].object_items();
+			auto& Keys = Corpus.mLookupKeys;
+			size_t KeyIndex = 0;
+			Runner.Run( Library, "key_lookup", Corpus.mName, 0, 1, [&]()
+			{
+				KeyIndex = (KeyIndex + 7919) % Keys.size();
+				Consume( AreaNames.find( Keys[KeyIndex] ) != AreaNames.end() );
+			});
+		}
+
+		{
+			auto& Corpus = GetCorpus( Corpora, "twitter" );
+			std::string Error;
+			auto Root = json11::Json::parse( Corpus.mJson, Error );
+			auto StatusCount = Root["statuses"].array_items().size();
+			size_t StatusIndex = 0;
+			Runner.Run( Library, "deep_path", Corpus.mName, 0, 1, [&]()
+			{
+				StatusIndex = (StatusIndex + 31) % StatusCount;
+				Consume( Root["statuses"][StatusIndex]["user"]["screen_name"].string_value().size() );
+			});
+			Runner.Run( Library, "stringify", Corpus.mName, Root.dump().size(), 1, [&]()
+			{
+				Consume( Root.dump().size() );
+			});
+		}
+
+		{
+			auto& Corpus = GetCorpus( Corpora, "canada" );
+			std::string Error;
+			auto Root = json11::Json::parse( Corpus.mJson, Error );
+			auto& Rings = Root["features"][0]["geometry"]["coordinates"].array_items();
+			size_t ValueCount = 0;
+			for ( auto& Ring : Rings )
+				ValueCount += Ring.array_items().size() * 2;
+			std::vector<double> Values;
+			Values.reserve( ValueCount );
+			Runner.Run( Library, "numeric_extract", Corpus.mName, Corpus.mJson.size(), ValueCount, [&]()
+			{
+				Values.clear();
+				for ( auto& Ring : Rings )
+					for ( auto& Point : Ring.array_items() )
+					{
+						Values.push_back( Point[0].number_value() );
+						Values.push_back( Point[1].number_value() );
+					}
+				Consume( Values.size() );
+			});
+		}
+	}
+#endif
+}
+
+
+int main(int argc,const char* argv[])
+{
+	Params_t Params;
+	for ( int a=1;	a<argc;	a++ )
+	{
+		std::string_view Arg = argv[a];
+		auto NextArg = [&]()
+		{
+			if ( a+1 >= argc )
+				throw std::runtime_error("Missing value for " + std::string(Arg));
+			return std::string( argv[++a] );
+		};
+
+		try
+		{
+			if ( Arg == "--scale" )			Params.mScale = std::stod( NextArg() );
+			else if ( Arg == "--seed" )		Params.mSeed = std::stoull( NextArg() );
+			else if ( Arg == "--min-time" )	Params.mMinBatchSeconds = std::stod( NextArg() );
+			else if ( Arg == "--repeats" )	Params.mRepeats = std::max( 1, std::stoi( NextArg() ) );
+			else if ( Arg == "--filter" )	Params.mFilter = NextArg();
+			else if ( Arg == "--label" )	Params.mLabel = NextArg();
+			else if ( Arg == "--out" )		Params.mOutputFilename = NextArg();
+			else
+				throw std::runtime_error("Unknown argument " + std::string(Arg));
+		}
+		catch(std::exception& e)
+		{
+			std::cerr << e.what() << std::endl;
+			return 1;
+		}
+	}
+
+	auto CorpusBytes = static_cast<size_t>( Params.mScale * 4 * 1024 * 1024 );
+	std::vector<PopJsonBenchmark::Corpus_t> Corpora;
+	Corpora.push_back( PopJsonBenchmark::GenerateTwitter( CorpusBytes, Params.mSeed ) );
+	Corpora.push_back( PopJsonBenchmark::GenerateCanada( CorpusBytes, Params.mSeed ) );
+	Corpora.push_back( PopJsonBenchmark::GenerateCitm( CorpusBytes, Params.mSeed ) );
+	Corpora.push_back( PopJsonBenchmark::GenerateNdjson( CorpusBytes, Params.mSeed ) );
+	Corpora.push_back( PopJsonBenchmark::GenerateStrings( CorpusBytes/2, Params.mSeed ) );
+
+	Runner_t Runner( Params );
+	RunPopJson( Runner, Corpora );
+#if defined(POPJSON_BENCHMARK_JSON11)
+	RunJson11( Runner, Corpora );
+#endif
+
+	if ( Params.mOutputFilename.empty() )
+	{
+		WriteResults( std::cout, Params, Corpora, Runner.mResults );
+	}
+	else
+	{
+		std::ofstream File( Params.mOutputFilename );
+		WriteResults( File, Params, Corpora, Runner.mResults );
+		if ( !File )
+		{
+			std::cerr << "Failed to write " << Params.mOutputFilename << std::endl;
+			return 1;
+		}
+	}
+	return 0;
+}
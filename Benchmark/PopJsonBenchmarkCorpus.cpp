@@ -0,0 +1,275 @@
+#include "PopJsonBenchmarkCorpus.hpp"
+#include <charconv>
+#include <string_view>
+
+
+namespace
+{
+	//	xorshift64*; deterministic across platforms, unlike std:: distributions
+	class Random_t
+	{
+	public:
+		Random_t(uint64_t Seed) :
+			mState	( Seed ? Seed : 0x9E3779B97F4A7C15ull )
+		{
+		}
+
+		uint64_t	Next()
+		{
+			mState ^= mState >> 12;
+			mState ^= mState << 25;
+			mState ^= mState >> 27;
+			return mState * 2685821657736338717ull;
+		}
+		uint64_t	Range(uint64_t Min,uint64_t Max)	{	return Min + (Next() % (Max-Min+1));	}
+		double		Unit()								{	return (Next() >> 11) * (1.0/9007199254740992.0);	}
+		bool		Chance(int Percent)					{	return Range(0,99) < static_cast<uint64_t>(Percent);	}
+
+		template<typename TYPE>
+		const TYPE&	Pick(const std::vector<TYPE>& Values)	{	return Values[Range(0,Values.size()-1)];	}
+
+	private:
+		uint64_t	mState;
+	};
+
+	const std::vector<std::string> Words =
+	{
+		"the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog", "json", "parser",
+		"stream", "benchmark", "latency", "coffee", "tokyo", "berlin", "release", "build",
+		"caf\\u00e9", "na\\u00efve", "\\u65e5\\u672c", "\\ud83d\\ude00", "https:\\/\\/t.co\\/abc",
+	};
+	const std::vector<std::string> Levels = { "debug", "info", "info", "info", "warn", "error" };
+	const std::vector<std::string> Services = { "api", "auth", "billing", "search", "gateway" };
+
+	void AppendInteger(std::string& Json,int64_t Value)
+	{
+		char Buffer[32];
+		auto Result = std::to_chars( Buffer, Buffer+sizeof(Buffer), Value );
+		Json.append( Buffer, Result.ptr );
+	}
+
+	void AppendDouble(std::string& Json,double Value,int Precision)
+	{
+		char Buffer[64];
+		auto Result = std::to_chars( Buffer, Buffer+sizeof(Buffer), Value, std::chars_format::fixed, Precision );
+		Json.append( Buffer, Result.ptr );
+	}
+
+	void AppendSentence(std::string& Json,Random_t& Random,int MinWords,int MaxWords)
+	{
+		auto WordCount = Random.Range(MinWords,MaxWords);
+		for ( uint64_t w=0;	w<WordCount;	w++ )
+		{
+			if ( w > 0 )
+				Json += ' ';
+			Json += Random.Pick(Words);
+		}
+	}
+
+	void AppendKey(std::string& Json,std::string_view Key)
+	{
+		Json += '"';
+		Json += Key;
+		Json += "\":";
+	}
+}
+
+
+PopJsonBenchmark::Corpus_t PopJsonBenchmark::GenerateTwitter(size_t TargetBytes,uint64_t Seed)
+{
+	Random_t Random(Seed);
+	Corpus_t Corpus;
+	Corpus.mName = "twitter";
+	auto& Json = Corpus.mJson;
+	Json.reserve( TargetBytes + 4096 );
+
+	Json += "{\"statuses\":[";
+	int64_t Id = 250075927172759552;
+	for ( int s=0;	Json.size() < TargetBytes;	s++ )
+	{
+		if ( s > 0 )
+			Json += ',';
+		Id += Random.Range(1,100000);
+		Json += '{';
+		AppendKey( Json, "created_at" );	Json += "\"Mon Sep 24 03:35:21 +0000 2012\",";
+		AppendKey( Json, "id" );			AppendInteger( Json, Id );	Json += ',';
+		AppendKey( Json, "id_str" );		Json += '"';	AppendInteger( Json, Id );	Json += "\",";
+		AppendKey( Json, "text" );			Json += "\"@";	AppendSentence( Json, Random, 4, 20 );	Json += "\",";
+		AppendKey( Json, "truncated" );		Json += "false,";
+		AppendKey( Json, "entities" );
+		{
+			Json += "{\"hashtags\":[";
+			auto TagCount = Random.Range(0,3);
+			for ( uint64_t t=0;	t<TagCount;	t++ )
+			{
+				if ( t > 0 )
+					Json += ',';
+				Json += "{\"text\":\"";
+				Json += Random.Pick(Words);
+				Json += "\",\"indices\":[";
+				auto Start = Random.Range(0,100);
+				AppendInteger( Json, Start );	Json += ',';	AppendInteger( Json, Start + Random.Range(3,12) );
+				Json += "]}";
+			}
+			Json += "],\"urls\":[],\"user_mentions\":[]},";
+		}
+		AppendKey( Json, "user" );
+		{
+			Json += '{';
+			auto UserId = Random.Range(1000,99999999);
+			AppendKey( Json, "id" );				AppendInteger( Json, UserId );	Json += ',';
+			AppendKey( Json, "name" );				Json += '"';	AppendSentence( Json, Random, 1, 3 );	Json += "\",";
+			AppendKey( Json, "screen_name" );		Json += "\"user";	AppendInteger( Json, UserId );	Json += "\",";
+			AppendKey( Json, "description" );		Json += '"';	AppendSentence( Json, Random, 0, 12 );	Json += "\",";
+			AppendKey( Json, "followers_count" );	AppendInteger( Json, Random.Range(0,5000000) );	Json += ',';
+			AppendKey( Json, "verified" );			Json += Random.Chance(5) ? "true," : "false,";
+			AppendKey( Json, "profile_image_url" );	Json += "\"http:\\/\\/a0.twimg.com\\/profile_images\\/";	AppendInteger( Json, UserId );	Json += "\\/normal.jpg\"";
+			Json += "},";
+		}
+		AppendKey( Json, "retweet_count" );	AppendInteger( Json, Random.Range(0,1000) );	Json += ',';
+		AppendKey( Json, "favorited" );		Json += "false,";
+		AppendKey( Json, "lang" );			Json += "\"en\",";
+		AppendKey( Json, "geo" );			Json += "null";
+		Json += '}';
+	}
+	Json += "],\"search_metadata\":{\"completed_in\":0.087,\"count\":100,\"query\":\"%23json\"}}";
+	return Corpus;
+}
+
+
+PopJsonBenchmark::Corpus_t PopJsonBenchmark::GenerateCanada(size_t TargetBytes,uint64_t Seed)
+{
+	Random_t Random(Seed);
+	Corpus_t Corpus;
+	Corpus.mName = "canada";
+	auto& Json = Corpus.mJson;
+	Json.reserve( TargetBytes + 4096 );
+
+	Json += "{\"type\":\"FeatureCollection\",\"features\":[{\"type\":\"Feature\",\"properties\":{\"name\":\"Canada\"},\"geometry\":{\"type\":\"Polygon\",\"coordinates\":[";
+	for ( int r=0;	Json.size() < TargetBytes;	r++ )
+	{
+		if ( r > 0 )
+			Json += ',';
+		Json += '[';
+		double x = -65.0 - Random.Unit() * 70.0;
+		double y = 43.0 + Random.Unit() * 40.0;
+		auto PointCount = Random.Range(50,2000);
+		for ( uint64_t p=0;	p<PointCount;	p++ )
+		{
+			if ( p > 0 )
+				Json += ',';
+			x += (Random.Unit() - 0.5) * 0.01;
+			y += (Random.Unit() - 0.5) * 0.01;
+			Json += '[';
+			AppendDouble( Json, x, 15 );
+			Json += ',';
+			AppendDouble( Json, y, 15 );
+			Json += ']';
+		}
+		Json += ']';
+	}
+	Json += "]}}]}";
+	return Corpus;
+}
+
+
+PopJsonBenchmark::Corpus_t PopJsonBenchmark::GenerateCitm(size_t TargetBytes,uint64_t Seed)
+{
+	Random_t Random(Seed);
+	Corpus_t Corpus;
+	Corpus.mName = "citm";
+	auto& Json = Corpus.mJson;
+	Json.reserve( TargetBytes + 4096 );
+
+	//	half the budget goes on a wide object of id:name pairs (used for key lookups)
+	Json += "{\"areaNames\":{";
+	int64_t AreaId = 205705993;
+	for ( int a=0;	Json.size() < TargetBytes/2;	a++ )
+	{
+		if ( a > 0 )
+			Json += ',';
+		AreaId += Random.Range(1,1000);
+		auto Key = std::to_string(AreaId);
+		Corpus.mLookupKeys.push_back(Key);
+		AppendKey( Json, Key );
+		Json += '"';
+		AppendSentence( Json, Random, 1, 3 );
+		Json += '"';
+	}
+	Json += "},\"events\":{";
+	int64_t EventId = 138586341;
+	for ( int e=0;	Json.size() < TargetBytes;	e++ )
+	{
+		if ( e > 0 )
+			Json += ',';
+		EventId += Random.Range(1,1000);
+		Json += '"';	AppendInteger( Json, EventId );	Json += "\":{";
+		AppendKey( Json, "description" );	Json += "null,";
+		AppendKey( Json, "id" );			AppendInteger( Json, EventId );	Json += ',';
+		AppendKey( Json, "logo" );			Json += Random.Chance(50) ? "null," : "\"\\/images\\/UE0AAAAACEKo6QAAAAZDSVRN\",";
+		AppendKey( Json, "name" );			Json += '"';	AppendSentence( Json, Random, 2, 6 );	Json += "\",";
+		AppendKey( Json, "subTopicIds" );	Json += '[';	AppendInteger( Json, 337184269 );	Json += ',';	AppendInteger( Json, 337184283 + Random.Range(0,20) );	Json += "],";
+		AppendKey( Json, "subjectCode" );	Json += "null,";
+		AppendKey( Json, "topicIds" );		Json += '[';	AppendInteger( Json, 324846099 );	Json += ',';	AppendInteger( Json, 107888604 );	Json += ']';
+		Json += '}';
+	}
+	Json += "}}";
+	return Corpus;
+}
+
+
+PopJsonBenchmark::Corpus_t PopJsonBenchmark::GenerateNdjson(size_t TargetBytes,uint64_t Seed)
+{
+	Random_t Random(Seed);
+	Corpus_t Corpus;
+	Corpus.mName = "ndjson";
+	auto& Json = Corpus.mJson;
+	Json.reserve( TargetBytes + 4096 );
+
+	for ( int r=0;	Json.size() < TargetBytes;	r++ )
+	{
+		auto LineStart = Json.size();
+		Json += '{';
+		AppendKey( Json, "ts" );			Json += "\"2024-01-01T00:";	AppendInteger( Json, 10 + (r/60)%50 );	Json += ':';	AppendInteger( Json, 10 + r%50 );	Json += ".123Z\",";
+		AppendKey( Json, "level" );			Json += '"';	Json += Random.Pick(Levels);	Json += "\",";
+		AppendKey( Json, "service" );		Json += '"';	Json += Random.Pick(Services);	Json += "\",";
+		AppendKey( Json, "msg" );			Json += '"';	AppendSentence( Json, Random, 2, 10 );	Json += "\",";
+		AppendKey( Json, "latency_ms" );	AppendDouble( Json, Random.Unit()*250.0, 3 );	Json += ',';
+		AppendKey( Json, "status" );		AppendInteger( Json, Random.Chance(90) ? 200 : 500 );	Json += ',';
+		AppendKey( Json, "user" );			Json += "{\"id\":";	AppendInteger( Json, Random.Range(1,1000000) );	Json += ",\"region\":\"eu-west\"},";
+		AppendKey( Json, "tags" );			Json += "[\"";	Json += Random.Pick(Services);	Json += "\",\"v2\"]";
+		Json += '}';
+		Corpus.mLines.push_back( { LineStart, Json.size()-LineStart } );
+		Json += '\n';
+	}
+	return Corpus;
+}
+
+
+PopJsonBenchmark::Corpus_t PopJsonBenchmark::GenerateStrings(size_t TargetBytes,uint64_t Seed)
+{
+	Random_t Random(Seed);
+	Corpus_t Corpus;
+	Corpus.mName = "strings";
+	auto& Json = Corpus.mJson;
+	Json.reserve( TargetBytes + 4096 );
+
+	const std::vector<std::string> Fragments =
+	{
+		"plain ascii text ", "line\\nbreak ", "\\\"quoted\\\" ", "back\\\\slash ", "tab\\tseparated ",
+		"caf\\u00e9 ", "\\u4e2d\\u6587 ", "\\ud83d\\ude00 ", "\\r\\n", "\\/path\\/to ",
+	};
+	Json += "{\"strings\":[";
+	for ( int s=0;	Json.size() < TargetBytes;	s++ )
+	{
+		if ( s > 0 )
+			Json += ',';
+		Json += '"';
+		auto FragmentCount = Random.Range(1,30);
+		for ( uint64_t f=0;	f<FragmentCount;	f++ )
+			Json += Random.Pick(Fragments);
+		Json += '"';
+	}
+	Json += "]}";
+	return Corpus;
+}
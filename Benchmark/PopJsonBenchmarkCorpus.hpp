@@ -0,0 +1,36 @@
+/*
+	Generates benchmark corpora offline, shaped like the standard json benchmark files
+	(twitter.json, canada.json, citm_catalog.json) plus ndjson logs & escape-heavy strings.
+	Generation is seeded, so the same size & seed always produce the same bytes and
+	results can be compared across commits.
+*/
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace PopJsonBenchmark
+{
+	class Corpus_t;
+
+	//	TargetBytes is approximate, generators stop at the first record past it
+	Corpus_t	GenerateTwitter(size_t TargetBytes,uint64_t Seed);	//	nested objects, {"statuses":[{...,"user":{...}}]}
+	Corpus_t	GenerateCanada(size_t TargetBytes,uint64_t Seed);	//	geojson; arrays of [x,y] doubles
+	Corpus_t	GenerateCitm(size_t TargetBytes,uint64_t Seed);		//	wide objects keyed by numeric-string ids
+	Corpus_t	GenerateNdjson(size_t TargetBytes,uint64_t Seed);	//	one log record object per line
+	Corpus_t	GenerateStrings(size_t TargetBytes,uint64_t Seed);	//	{"strings":[...]} heavy with escapes & \u sequences
+}
+
+
+class PopJsonBenchmark::Corpus_t
+{
+public:
+	std::string					mName;
+	std::string					mJson;
+
+	//	keys which exist, for lookup benchmarks
+	std::vector<std::string>	mLookupKeys;
+	//	ndjson; offset & length of each line
+	std::vector<std::pair<size_t,size_t>>	mLines;
+};
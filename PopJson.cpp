@@ -1,13 +1,34 @@
 #include "PopJson.hpp"
+#include "PopJsonColumns.hpp"
+#include "PopJsonSidecar.hpp"
+#include "PopJsonTranscode.hpp"
+#include "PopJsonReformat.hpp"
+#include "PopJsonPatch.hpp"
+#include "PopJsonPath.hpp"
+#include "PopJsonShape.hpp"
+#include "PopJsonStream.hpp"
+#include "PopJsonScan.hpp"
 #include <string>
 #include <charconv>
 #include <sstream>
 #include <iostream>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <unordered_set>
+#include <algorithm>
+
+#if defined(POPJSON_ZLIB)
+#include <zlib.h>
+#endif
 
 
 void WriteEscapedString(std::stringstream& Json,PopJson::Value_t Value,std::string_view ValueStorage);
 void WriteSanitisedValue(std::stringstream& Json,PopJson::Value_t Value,std::string_view ValueStorage);
 std::string UnescapeString(std::string_view EscapedString);
+void UnescapeString(std::string_view EscapedString,std::string& Output);
 
 
 void PopJson::UnitTest()
@@ -36,7 +57,1114 @@ void PopJson::UnitTest()
 		if ( Value0.GetType() != ValueType_t::Object )
 			throw std::runtime_error(".Array[0] not an object");
 	}
-	
+
+	//	typed writes format straight into storage, doubles round-trip
+	{
+		Json_t Json;
+		Json.Set("Int", -42);
+		Json.Set("Big", uint64_t(12345678901234) );
+		Json.Set("Double", 0.1 );
+		Json.Set("Bool", true );
+		Json.Set("String", "a\"b\n" );
+		Json["Proxy"] = 3.5f;
+
+		if ( Json.GetValue("Int").GetString() != "-42" )
+			throw std::runtime_error("Set(int) wrote wrong value");
+		if ( Json.GetValue("Big").GetString() != "12345678901234" )
+			throw std::runtime_error("Set(uint64) wrote wrong value");
+		if ( Json.GetValue("Double").GetString() != "0.1" )
+			throw std::runtime_error("Set(double) is not shortest round-trip");
+		if ( Json.GetValue("Bool").GetBool() != true )
+			throw std::runtime_error("Set(bool) wrote wrong value");
+		if ( Json.GetValue("String").GetString() != "a\"b\n" )
+			throw std::runtime_error("Set(string) did not round trip");
+		if ( Json.GetValue("Proxy").GetString() != "3.5" )
+			throw std::runtime_error("proxy = float wrote wrong value");
+
+		auto Expected = R"JSON({"Int":-42,"Big":12345678901234,"Double":0.1,"Bool":true,"String":"a\"b\n","Proxy":3.5})JSON";
+		if ( Json.GetJsonString() != Expected )
+			throw std::runtime_error("Typed Set() json mismatch; " + Json.GetJsonString() );
+	}
+
+	//	once reserved, typed writes don't reallocate, and moves hand over buffers rather than copying.
+	//	Test/PopJsonTest.cpp also checks these make no allocations at all
+	{
+		Json_t Json;
+		Json.Reserve( 1024, 64 );
+		Json.Set("First", "Value");
+		std::string Buffer;
+		auto FirstStringData = Json.GetValue("First").GetString(Buffer).data();
+		auto ChildrenData = Json.GetChildren().data();
+		for ( int i=0;	i<60;	i++ )
+			Json.Set("Key", i * 1.5 );
+		if ( Json.GetValue("First").GetString(Buffer).data() != FirstStringData )
+			throw std::runtime_error("Reserved storage reallocated during Set()");
+		if ( Json.GetChildren().data() != ChildrenData )
+			throw std::runtime_error("Reserved children reallocated during Set()");
+
+		Json_t Moved( std::move(Json) );
+		if ( Moved.GetChildren().data() != ChildrenData || Moved.GetValue("First").GetString(Buffer).data() != FirstStringData )
+			throw std::runtime_error("Json_t move constructor copied data");
+		Json_t MoveAssigned;
+		MoveAssigned = std::move(Moved);
+		if ( MoveAssigned.GetChildren().data() != ChildrenData || MoveAssigned.GetValue("First").GetString(Buffer).data() != FirstStringData )
+			throw std::runtime_error("Json_t move assignment copied data");
+	}
+
+	//	flat map; children follow parents, siblings skip descendants, key index matches a scan
+	{
+		std::string_view Json = R"JSON( {"a":[1,{"x":2},[3,4]],"b":{"c":"d","e":null},"a":"dup"} )JSON";
+		auto Map = std::make_shared<Map_t>( Parse(Json) );
+		if ( Map->GetNodeCount() != 12 || Map->GetNode(0).GetChildCount() != 3 || Map->GetNode(0).GetDescendantCount() != 11 )
+			throw std::runtime_error("Map node counts wrong");
+		auto b = Map->GetChild( 0, "b", Json );
+		if ( Map->GetNode( Map->GetChild( b, "c", Json ) ).GetValue().GetString(Json) != "d" )
+			throw std::runtime_error("Map .b.c wrong");
+		auto a = Map->GetChild( 0, "a", Json );
+		if ( Map->GetNode( Map->GetChild( Map->GetChild( a, 2 ), 1 ) ).GetValue().GetInteger(Json) != 4 )
+			throw std::runtime_error("Map .a[2][1] wrong");
+		if ( Map->Stringify(Json) != std::string_view(Json).substr(1, Json.size()-2) )
+			throw std::runtime_error("Map stringify wrong");
+
+		Map_t IndexedMap = Parse(Json);
+		IndexedMap.BuildKeyIndex( Json, 1 );
+		if ( IndexedMap.GetChild( 0, "a", Json ) != a || IndexedMap.FindChild( 0, "z", Json ) != InvalidNodeIndex )
+			throw std::runtime_error("Key index lookup differs from scan");
+
+		View_t View( Map, 0, Json );
+		if ( View["b"]["c"].GetString() != "d" || View["a"].GetValue(1)["x"].GetInteger() != 2 || !View.HasKey("b") || View.HasKey("z") )
+			throw std::runtime_error("Map-backed View_t lookups wrong");
+
+		//	a Json_t copied from a map-backed view drops the map when it's assigned another document
+		Json_t Copied( View );
+		Json_t Other( R"JSON({"y":22,"x":11})JSON" );
+		Copied = Other;
+		if ( Copied.GetValue("x").GetInteger() != 11 || Copied.HasKey("a") )
+			throw std::runtime_error("Json_t copy assignment kept the old map");
+	}
+
+	//	sidecar round trip, and detecting a stale source
+	{
+		std::string Json = R"JSON({"list":[1,2,3],"name":"sidecar","nested":{"k":true}})JSON";
+		auto Filename = (std::filesystem::temp_directory_path() / "PopJsonUnitTest.sidecar").string();
+		auto Map = Parse(Json);
+		Map.BuildKeyIndex( Json, 1 );
+		Sidecar::Write( Map, Json, Filename );
+
+		auto Loaded = std::make_shared<Map_t>( Sidecar::Open( Filename, Json ) );
+		if ( Loaded->GetNodeCount() != Map.GetNodeCount() || !Loaded->HasKeyIndex() )
+			throw std::runtime_error("Sidecar lost nodes");
+		View_t View( Loaded, 0, Json );
+		if ( View["name"].GetString() != "sidecar" || View["nested"]["k"].GetBool() != true )
+			throw std::runtime_error("Sidecar view lookups wrong");
+
+		auto Stale = Json;
+		Stale[Stale.find("sidecar")] = 'S';
+		bool Rejected = false;
+		try
+		{
+			Sidecar::Open( Filename, Stale );
+		}
+		catch(std::exception&)
+		{
+			Rejected = true;
+		}
+		if ( !Rejected )
+			throw std::runtime_error("Sidecar accepted a changed source");
+
+		//	a header (with a valid checksum) whose node count overflows the byte count, or whose
+		//	nodes are misaligned. Offsets are of the header's fields; count, nodes offset, checksum
+		auto ReadFile = [&]
+		{
+			std::ifstream File( Filename, std::ios::binary );
+			return std::vector<char>( std::istreambuf_iterator<char>(File), std::istreambuf_iterator<char>() );
+		};
+		auto Original = ReadFile();
+		auto IsRejected = [&](size_t FieldOffset,uint64_t Value)
+		{
+			auto Contents = Original;
+			std::memcpy( Contents.data() + FieldOffset, &Value, sizeof(Value) );
+			uint64_t Checksum = 0;
+			std::memcpy( Contents.data() + 88, &Checksum, sizeof(Checksum) );
+			Checksum = Hash64( Contents.data(), 96 );
+			std::memcpy( Contents.data() + 88, &Checksum, sizeof(Checksum) );
+			std::ofstream( Filename, std::ios::binary ).write( Contents.data(), Contents.size() );
+			try	{	Sidecar::Open( Filename, Json, Sidecar::Validate_t::Header );	}	catch(std::exception&)	{	return true;	}
+			return false;
+		};
+		uint64_t NodesOffset = 0;
+		std::memcpy( &NodesOffset, Original.data() + 48, sizeof(NodesOffset) );
+		bool Overflowed = IsRejected( 40, std::numeric_limits<uint64_t>::max() / sizeof(MapNode_t) + 2 );
+		bool Misaligned = IsRejected( 48, NodesOffset + 1 );
+		std::filesystem::remove( Filename );
+		if ( !Overflowed || !Misaligned )
+			throw std::runtime_error("Sidecar accepted a corrupt node count or offset");
+	}
+
+	//	binary transcoding; known small encodings, then json -> binary -> json for both formats
+	{
+		std::vector<uint8_t> ExpectedMessagePack = { 0x81, 0xa1, 'a', 0x01 };
+		std::vector<uint8_t> ExpectedCbor = { 0xa1, 0x61, 'a', 0x01 };
+		if ( Transcode::Write( Transcode::Format_t::MessagePack, R"JSON({"a":1})JSON" ) != ExpectedMessagePack )
+			throw std::runtime_error("MessagePack encoding wrong");
+		if ( Transcode::Write( Transcode::Format_t::Cbor, R"JSON({"a":1})JSON" ) != ExpectedCbor )
+			throw std::runtime_error("CBOR encoding wrong");
+		//	indefinite array containing a chunked string and a half float
+		std::vector<uint8_t> IndefiniteCbor = { 0x9f, 0x01, 0x7f, 0x61, 'a', 0x61, 'b', 0xff, 0xf9, 0x3c, 0x00, 0xff };
+		if ( Transcode::Read( Transcode::Format_t::Cbor, IndefiniteCbor ).GetJsonString() != R"JSON([1,"ab",1])JSON" )
+			throw std::runtime_error("CBOR indefinite decoding wrong");
+
+		std::string_view Json = R"JSON( {"a":[1,-2,300,-70000,4294967296,1.5,"x\ny\u00e9",true,false,null,[],{}],"":{"k":"v"},"big":18446744073709551615,"huge":1e300} )JSON";
+		std::string_view Minified = R"JSON({"a":[1,-2,300,-70000,4294967296,1.5,"x\nyé",true,false,null,[],{}],"":{"k":"v"},"big":18446744073709551615,"huge":1e+300})JSON";
+		for ( auto Format : { Transcode::Format_t::MessagePack, Transcode::Format_t::Cbor } )
+		{
+			auto Binary = Transcode::Write( Format, Json );
+			std::vector<char> Decoded;
+			Transcode::ReadToJson( Format, Binary, Decoded );
+			if ( std::string_view( Decoded.data(), Decoded.size() ) != Minified )
+				throw std::runtime_error("Transcode round trip mismatch; " + std::string( Decoded.data(), Decoded.size() ) );
+
+			auto Document = Transcode::Read( Format, Binary );
+			if ( Document.GetValue("a").GetValue(6).GetString() != "x\nyé" )
+				throw std::runtime_error("Transcoded Json_t string wrong");
+		}
+	}
+
+	//	minify/pretty print; strings are untouched, and output is the same however the input is chunked
+	{
+		std::string_view Json = " {\n\t\"a b\" : [ 1 , 2.5e3 ,\"x\\\" ]\"] ,\r\n \"e\":{ } ,\"f\":[],\"g\":null } ";
+		std::string_view Minified = R"JSON({"a b":[1,2.5e3,"x\" ]"],"e":{},"f":[],"g":null})JSON";
+		std::string_view Pretty = "{\n  \"a b\": [\n    1,\n    2.5e3,\n    \"x\\\" ]\"\n  ],\n  \"e\": {},\n  \"f\": [],\n  \"g\": null\n}";
+		if ( Minify(Json) != Minified )
+			throw std::runtime_error("Minify wrong; " + Minify(Json) );
+		if ( PrettyPrint( Json, 2, ' ' ) != Pretty )
+			throw std::runtime_error("PrettyPrint wrong; " + PrettyPrint( Json, 2, ' ' ) );
+		if ( Minify( PrettyPrint( Json ) ) != Minified )
+			throw std::runtime_error("Minify of PrettyPrint wrong");
+
+		for ( size_t Split=0;	Split<=Json.size();	Split++ )
+		{
+			for ( size_t Indent : { 0, 2 } )
+			{
+				Reformat_t Reformat( Indent, ' ' );
+				std::string Output;
+				Reformat.Write( Json.substr(0,Split), Output );
+				Reformat.Write( Json.substr(Split), Output );
+				Reformat.Finish();
+				if ( Output != (Indent ? Pretty : Minified) )
+					throw std::runtime_error("Chunked reformat differs at split " + std::to_string(Split) + "; " + Output );
+			}
+		}
+
+		//	long enough for the 64 byte block path, with escape runs landing on block edges
+		std::string Long = "[";
+		std::string LongMinified = "[";
+		for ( int i=0;	i<12;	i++ )
+		{
+			auto Element = std::string( i, ' ' ) + "\"\\\\\\\" \\\\\" , ";
+			Long += Element + std::string(Json) + ",";
+			LongMinified += "\"\\\\\\\" \\\\\"," + std::string(Minified) + ",";
+		}
+		Long += "0 ]";
+		LongMinified += "0]";
+		for ( size_t Split=0;	Split<=Long.size();	Split++ )
+		{
+			Reformat_t Reformat;
+			std::string Output;
+			Reformat.Write( std::string_view(Long).substr(0,Split), Output );
+			Reformat.Write( std::string_view(Long).substr(Split), Output );
+			Reformat.Finish();
+			if ( Output != LongMinified )
+				throw std::runtime_error("Block minify differs at split " + std::to_string(Split) + "; " + Output );
+		}
+	}
+
+	//	parser policies
+	{
+		auto Jsonc = R"JSON( { // comment
+			"a" : [ 1, /* two */ 2, ],
+			"b" : { "c" : "d", },
+		} )JSON";
+		auto Map = Parse<JsoncPolicy_t>( Jsonc );
+		if ( Map.GetNode(0).GetChildCount() != 2 || Map.GetNode( Map.FindChild(0,"a",Jsonc) ).GetChildCount() != 2 )
+			throw std::runtime_error("JSONC policy parse wrong");
+		Json_t Document( Jsonc, JsoncPolicy_t() );
+		if ( Document.GetValue("b").GetValue("c").GetString() != "d" || Document.GetValue("a").GetValue(1).GetInteger() != 2 )
+			throw std::runtime_error("JSONC policy Json_t wrong");
+
+		auto Throws = [](auto Function)
+		{
+			try
+			{
+				Function();
+			}
+			catch(std::exception&)
+			{
+				return true;
+			}
+			return false;
+		};
+		if ( !Throws( [&]{	Parse( Jsonc );	} ) || !Throws( [&]{	Value_t Value( Jsonc );	} ) )
+			throw std::runtime_error("Strict policy accepted comments");
+		if ( !Throws( [&]{	Parse( "[1,]" );	} ) || !Throws( [&]{	Parse( "[NaN]" );	} ) || !Throws( [&]{	Parse( "[01]" );	} ) )
+			throw std::runtime_error("Strict policy accepted a trailing comma, NaN or leading zero");
+		if ( !Throws( [&]{	Parse<UniqueKeysPolicy_t>( R"JSON({"a":1,"b":{"a":2},"a":3})JSON" );	} ) )
+			throw std::runtime_error("Unique keys policy accepted a duplicate key");
+		Parse<UniqueKeysPolicy_t>( R"JSON({"a":1,"b":{"a":2}})JSON" );
+
+		//	only whitespace (and comments with JSONC) can follow the root value
+		if ( !Throws( [&]{	Parse<StrictPolicy_t>( "{} x" );	} ) || !Throws( [&]{	Value_t Value( "[1] [2]" );	} ) || !Throws( [&]{	Json_t Value( "{}}" );	} ) )
+			throw std::runtime_error("Parse accepted trailing bytes after the root value");
+		if ( !Throws( [&]{	Parse( "{} // comment" );	} ) || !Throws( [&]{	Parse( "1 2" );	} ) || !Throws( [&]{	Parse( "[1] /" );	} ) )
+			throw std::runtime_error("Strict policy accepted trailing bytes after the root value");
+		Parse( " {} \n\t " );
+		Parse<JsoncPolicy_t>( "{} // comment\n/* another */ " );
+		auto Trailing = TryParse( R"JSON({"a":1}  ,)JSON" );
+		if ( Trailing || Trailing.GetError() != Error_t::Syntax || Trailing.GetErrorPosition() != 9 )
+			throw std::runtime_error("TryParse didn't report the position of trailing bytes");
+		if ( Json_t::TryParse( "[] 0" ).GetErrorPosition() != 3 )
+			throw std::runtime_error("Json_t::TryParse didn't report the position of trailing bytes");
+
+		//	numbers at the end of a view which isn't null terminated stop at the end of the view
+		std::string_view Digits( "12.5e3", 1 );
+		auto Number = Parse( Digits );
+		if ( Number.GetNode(0).GetValue().GetInteger(Digits) != 1 || Value_t( std::string_view("7.25",3) ).GetPosition().mLength != 3 )
+			throw std::runtime_error("Number at the end of a view read past it");
+		if ( !Throws( [&]{	Parse( std::string_view("1.5e3",4) );	} ) || TryParse( std::string_view("-12",1) ).GetError() != Error_t::Syntax )
+			throw std::runtime_error("Truncated number at the end of a view was accepted");
+	}
+
+	//	iterating a map's children through slices
+	{
+		static_assert( std::ranges::forward_range<ChildRange_t<Member_t>> && std::ranges::sized_range<ChildRange_t<Member_t>> );
+		static_assert( std::ranges::view<ChildRange_t<SliceReadOnly_t>> );
+		std::string_view Json = R"JSON({"a":1,"b":[10,{"x":[1,2,3]},30],"c":"s","d":{}})JSON";
+		auto Map = Parse( Json );
+		SliceReadOnly_t Root( Map, Json );
+
+		std::string Keys;
+		for ( auto [Key,Value] : Root.members() )
+			Keys += std::string(Key);
+		if ( Keys != "abcd" || Root.members().size() != 4 )
+			throw std::runtime_error("Slice members wrong");
+
+		auto Elements = Root.TryGetValue("b")->elements();
+		if ( std::ranges::distance( Elements.begin(), Elements.end() ) != 3 )
+			throw std::runtime_error("Slice elements skipped descendants wrong");
+		auto Object = std::ranges::find_if( Elements, [](const SliceReadOnly_t& Element)	{	return Element.GetType() == ValueType_t::Object;	} );
+		auto Numbers = (*Object).TryGetValue("x")->elements();
+		auto Sum = 0;
+		for ( auto Element : Numbers )
+			Sum += Element.TryGetInteger().ValueOr(0);
+		if ( Sum != 6 || (*std::ranges::next( Elements.begin(), 2 )).GetRawValue() != "30" || Root.TryGetValue("d")->elements().size() != 0 )
+			throw std::runtime_error("Slice element access wrong");
+		if ( Root.members().front().mValue.TryGetInteger().ValueOr(0) != 1 || Root.TryGetValue("c")->TryGetString().ValueOr("") != "s" )
+			throw std::runtime_error("Slice value access wrong");
+	}
+
+	//	json patch & merge patch; untouched parts of the document keep their formatting
+	{
+		std::string_view Json = R"JSON({ "foo": [ "bar", "baz" ], "keep": { "x" : 1, "y" : [1,2] }, "n": 1 })JSON";
+		std::string_view Operations = R"JSON([
+			{ "op": "add", "path": "/foo/1", "value": "qux" },
+			{ "op": "remove", "path": "/keep/x" },
+			{ "op": "replace", "path": "/n", "value": {"a/b":2} },
+			{ "op": "test", "path": "/n/a~1b", "value": 2.0 },
+			{ "op": "copy", "from": "/foo/0", "path": "/foo/-" },
+			{ "op": "move", "from": "/keep/y", "path": "/moved" },
+			{ "op": "test", "path": "/keep", "value": {} }
+		])JSON";
+		std::string_view Expected = R"JSON({ "foo": [ "bar", "qux","baz","bar" ], "keep": {  }, "n": {"a/b":2},"moved":[1,2] })JSON";
+		auto Patched = Patch::Apply( Json, Operations );
+		if ( Patched != Expected )
+			throw std::runtime_error("Json patch wrong; " + Patched );
+
+		Json_t Document( Json );
+		Document.ApplyPatch( Operations );
+		//	nested operations are spliced in, so the formatting around them is kept
+		if ( Minify( Document.GetJsonString() ) != Minify( Expected ) )
+			throw std::runtime_error("In place json patch wrong; " + Document.GetJsonString() );
+
+		//	a failed operation leaves the Json_t as it was
+		auto Before = Document.GetJsonString();
+		bool Rejected = false;
+		try
+		{
+			Document.ApplyPatch( R"JSON([{"op":"remove","path":"/foo/0"},{"op":"test","path":"/n","value":null}])JSON" );
+		}
+		catch(std::exception&)
+		{
+			Rejected = true;
+		}
+		if ( !Rejected || Document.GetJsonString() != Before )
+			throw std::runtime_error("Failed json patch wasn't rejected, or changed the Json_t");
+
+		std::string_view Target = R"JSON({"a":"b", "c":{"d":"e","f":"g"}, "h":[1]})JSON";
+		std::string_view Merge = R"JSON({"a":"z","c":{"f":null,"i":{"j":null,"k":1}},"h":null,"l":null})JSON";
+		std::string_view Merged = R"JSON({"a":"z", "c":{"d":"e","i":{"k":1}}})JSON";
+		if ( Patch::MergePatch( Target, Merge ) != Merged )
+			throw std::runtime_error("Merge patch wrong; " + Patch::MergePatch( Target, Merge ) );
+		Json_t MergeDocument( Target );
+		MergeDocument.ApplyMergePatch( Merge );
+		if ( MergeDocument.GetJsonString() != Json_t(Merged).GetJsonString() )
+			throw std::runtime_error("In place merge patch wrong; " + MergeDocument.GetJsonString() );
+
+		//	a Json_t root can only be an object or array, so a scalar root is rejected and reverted
+		for ( auto ScalarRoot : { R"JSON([{"op":"replace","path":"","value":null}])JSON", R"JSON([{"op":"add","path":"","value":"x"}])JSON" } )
+		{
+			Json_t Array( "[1]" );
+			bool Threw = false;
+			try	{	Array.ApplyPatch( ScalarRoot );	}	catch(std::exception&)	{	Threw = true;	}
+			if ( !Threw || Array.GetJsonString() != "[1]" )
+				throw std::runtime_error("Json patch with a scalar root should fail and leave the Json_t as it was");
+		}
+		Json_t ReplacedRoot( "[1]" );
+		ReplacedRoot.ApplyPatch( R"JSON([{"op":"replace","path":"","value":{"a":[2]}}])JSON" );
+		if ( ReplacedRoot.GetJsonString() != R"JSON({"a":[2]})JSON" )
+			throw std::runtime_error("Json patch replacing the root wrote " + ReplacedRoot.GetJsonString() );
+
+		//	nested operations are spliced into the top level value; values found by index are renumbered
+		//	as elements are removed or inserted before them, and spliced bytes are put back on failure
+		Json_t Nested( R"JSON({"a":{"list":[{"v":0},{"v":1},{"v":2},{"v":3}],"k":"x"},"b":1})JSON" );
+		Nested.ApplyPatch( R"JSON([
+			{ "op": "replace", "path": "/a/list/2/v", "value": 20 },
+			{ "op": "remove", "path": "/a/list/0" },
+			{ "op": "replace", "path": "/a/list/1/v", "value": 21 },
+			{ "op": "add", "path": "/a/list/0", "value": {"v":"first"} },
+			{ "op": "test", "path": "/a/list/2/v", "value": 21 },
+			{ "op": "add", "path": "/a/k~1", "value": [] },
+			{ "op": "remove", "path": "/a/k" }
+		])JSON" );
+		std::string_view NestedExpected = R"JSON({"a":{"list":[{"v":"first"},{"v":1},{"v":21},{"v":3}],"k/":[]},"b":1})JSON";
+		if ( Minify( Nested.GetJsonString() ) != NestedExpected )
+			throw std::runtime_error("Nested json patch wrote " + Nested.GetJsonString() );
+		bool NestedRejected = false;
+		try	{	Nested.ApplyPatch( R"JSON([{"op":"remove","path":"/a/list/1"},{"op":"add","path":"/a/list/9","value":1}])JSON" );	}	catch(std::exception&)	{	NestedRejected = true;	}
+		if ( !NestedRejected || Minify( Nested.GetJsonString() ) != NestedExpected || Nested.GetValue("a").GetValue("list").GetChildCount() != 4 )
+			throw std::runtime_error("Failed nested json patch wasn't reverted; " + Nested.GetJsonString() );
+		auto NestedMap = Parse( NestedExpected );
+		NestedMap.BuildContentHashes( NestedExpected );
+		if ( Nested.GetContentHash() != NestedMap.GetContentHash(0) )
+			throw std::runtime_error("Content hash wrong after nested json patch");
+		bool MergeThrew = false;
+		try	{	MergeDocument.ApplyMergePatch( "7" );	}	catch(std::exception&)	{	MergeThrew = true;	}
+		if ( !MergeThrew || MergeDocument.GetJsonString() != Json_t(Merged).GetJsonString() )
+			throw std::runtime_error("Merge patch with a scalar root should fail and leave the Json_t as it was");
+	}
+
+	//	non-throwing accessors & parse
+	{
+		std::string_view Json = R"JSON({"Int":42,"Big":99999999999,"Text":"a\nb","Flag":false,"List":[1,2]})JSON";
+		Json_t Document( Json );
+		View_t MapView( std::make_shared<Map_t>( Parse(Json) ), 0, Json );
+		for ( ViewBase_t* View : std::initializer_list<ViewBase_t*>{ &Document, &MapView } )
+		{
+			if ( View->TryGetValue("Int")->TryGetInteger().ValueOr(0) != 42 )
+				throw std::runtime_error("TryGetInteger wrong");
+			if ( View->TryGetValue("Missing").GetError() != Error_t::MissingKey )
+				throw std::runtime_error("TryGetValue didn't report a missing key");
+			if ( View->TryGetValue("List")->TryGetValue(2).GetError() != Error_t::IndexOutOfRange )
+				throw std::runtime_error("TryGetValue didn't report an out of range index");
+			if ( View->TryGetValue("Text")->TryGetInteger().GetError() != Error_t::WrongType )
+				throw std::runtime_error("TryGetInteger of a string didn't report WrongType");
+			if ( View->TryGetValue("Big")->TryGetInteger().GetError() != Error_t::InvalidNumber || View->TryGetValue("Big")->TryGetDouble().ValueOr(0) != 99999999999.0 )
+				throw std::runtime_error("TryGetInteger/TryGetDouble of a big number wrong");
+			if ( View->TryGetValue("Text")->TryGetString().ValueOr("") != "a\nb" || View->TryGetValue("Flag")->TryGetBool().ValueOr(true) != false )
+				throw std::runtime_error("TryGetString/TryGetBool wrong");
+		}
+
+		auto Bad = TryParse( R"JSON({"a":[1,2,}])JSON" );
+		if ( Bad || Bad.GetError() != Error_t::Syntax || Bad.GetErrorPosition() != 11 )
+			throw std::runtime_error("TryParse didn't report syntax error position");
+		if ( TryParse( R"JSON(["\q"])JSON" ).GetError() != Error_t::Syntax || Json_t::TryParse( R"JSON({"a":"\x"})JSON" ).GetError() != Error_t::Syntax )
+			throw std::runtime_error("TryParse didn't report an invalid escape");
+		if ( TryParse<UniqueKeysPolicy_t>( R"JSON({"a":1,"a":2})JSON" ).GetError() != Error_t::DuplicateKey )
+			throw std::runtime_error("TryParse didn't report duplicate key");
+		auto Good = Json_t::TryParse( Json );
+		if ( !Good || Good->GetValue("List").GetValue(1).GetInteger() != 2 || Json_t::TryParse("[nul]") )
+			throw std::runtime_error("Json_t::TryParse wrong");
+	}
+
+	//	bulk key lookup; one pass over the members for a set of keys
+	{
+		std::string_view Json = R"JSON({"id":1, "name":"x", "dup":1, "dup":2, "quote\"d":true, "a_key_longer_than_sixteen_bytes":[3], "a_key_longer_than_sixteen_bytez":4, "":"empty"})JSON";
+		KeySet_t Keys = { "name", "missing", "dup", "quote\"d", "a_key_longer_than_sixteen_bytez", "", "id" };
+		if ( Keys.GetEscapedKey(3) != "quote\\\"d" || Keys.Find( "dup", Json.data()+Json.size() ) != 2 || Keys.Find( "dux", Json.data()+Json.size() ) != KeySet_t::InvalidKeyIndex )
+			throw std::runtime_error("KeySet_t find wrong");
+
+		auto Map = Parse( Json );
+		NodeIndex_t Children[7];
+		if ( Map.FindChildren( 0, Keys, Json, Children ) != 6 || Children[1] != InvalidNodeIndex )
+			throw std::runtime_error("Map FindChildren count wrong");
+		for ( size_t k : { 0, 2, 3, 4, 5, 6 } )
+			if ( Children[k] != Map.FindChild( 0, Keys.GetEscapedKey(k), Json ) )
+				throw std::runtime_error("Map FindChildren found the wrong child for " + std::string(Keys.GetEscapedKey(k)));
+
+		SliceReadOnly_t Slices[7];
+		SliceReadOnly_t( Map, Json ).GetValues( Keys, Slices );
+		if ( Slices[1].IsValid() || Slices[2].TryGetInteger().ValueOr(0) != 1 || Slices[4].TryGetInteger().ValueOr(0) != 4 || Slices[5].TryGetString().ValueOr("") != "empty" )
+			throw std::runtime_error("Slice GetValues wrong");
+
+		Value_t Object( Json );
+		Node_t* Nodes[7];
+		if ( Object.FindNodes( Keys, Json, Nodes ) != 6 || Nodes[1] || Nodes[6]->GetValue(Json).GetInteger(Json) != 1 )
+			throw std::runtime_error("Value_t FindNodes wrong");
+
+		Json_t Document( Json );
+		View_t MapView( std::make_shared<Map_t>( Parse(Json) ), 0, Json );
+		for ( ViewBase_t* View : std::initializer_list<ViewBase_t*>{ &Document, &MapView } )
+		{
+			auto Values = View->TryGetValues( Keys );
+			if ( Values.size() != 7 || Values[1].GetError() != Error_t::MissingKey || Values[0]->GetString() != "x" || !Values[3]->GetBool() || Values[2]->GetInteger() != 1 )
+				throw std::runtime_error("TryGetValues wrong");
+		}
+
+		//	an array's elements have no keys to match, not even an empty one
+		auto Array = Parse( "[1,2]" );
+		if ( Array.FindChildren( 0, Keys, "[1,2]", Children ) != 0 )
+			throw std::runtime_error("FindChildren matched array elements");
+
+		bool Rejected = false;
+		try
+		{
+			KeySet_t Duplicates = { "a", "b", "a" };
+		}
+		catch(std::exception&)
+		{
+			Rejected = true;
+		}
+		if ( !Rejected )
+			throw std::runtime_error("KeySet_t accepted duplicate keys");
+	}
+
+	//	shapes; records with the same keys in the same order share one, and read members by child index
+	{
+		std::string_view Lines[] =
+		{
+			R"JSON({"id":1,"name":"a","dup":1,"dup":2,"a_key_longer_than_sixteen_bytes":[3]})JSON",
+			R"JSON({ "id" : 2, "name":"b", "dup":3, "dup":4, "a_key_longer_than_sixteen_bytes":[] })JSON",
+			R"JSON({"id":3,"nome":"c","dup":5,"dup":6,"a_key_longer_than_sixteen_bytes":[]})JSON",
+			R"JSON({"id":4,"name":"d","dup":7,"dup":8})JSON",
+		};
+		ShapeCache_t Cache;
+		const Shape_t* Shapes[std::size(Lines)];
+		const Shape_t* Predicted = nullptr;
+		for ( size_t l=0;	l<std::size(Lines);	l++ )
+		{
+			Value_t Record( Lines[l] );
+			Predicted = Shapes[l] = Cache.GetShape( Record, Lines[l], Predicted );
+			auto Map = Parse( Lines[l] );
+			if ( Cache.GetShape( Map, 0, Lines[l] ) != Shapes[l] )
+				throw std::runtime_error("Shape of map and Value_t differ");
+			if ( Shapes[l]->TryGetValue( Record, "id", Lines[l] )->GetInteger( Lines[l] ) != int(l+1) || Shapes[l]->TryGetValue( Record, "dup", Lines[l] )->GetInteger( Lines[l] ) != int(l*2+1) )
+				throw std::runtime_error("Shape TryGetValue wrong");
+			if ( Shapes[l]->FindChild( Map, 0, "dup" ) != Map.FindChild( 0, "dup", Lines[l] ) || Shapes[l]->FindChild( Map, 0, "missing" ) != InvalidNodeIndex )
+				throw std::runtime_error("Shape FindChild wrong");
+		}
+		if ( Shapes[0] != Shapes[1] || Shapes[1] == Shapes[2] || Shapes[2] == Shapes[3] || Cache.GetShapeCount() != 3 )
+			throw std::runtime_error("Records given wrong shapes");
+		if ( Shapes[3]->FindMember("a_key_longer_than_sixteen_bytes") != Shape_t::InvalidChildIndex || Shapes[0]->FindMember("a_key_longer_than_sixteen_bytes") != 4 )
+			throw std::runtime_error("Shape FindMember wrong");
+		size_t ChildIndexes[3];
+		Shapes[2]->FindMembers( KeySet_t{ "dup", "name", "nome" }, ChildIndexes );
+		if ( ChildIndexes[0] != 2 || ChildIndexes[1] != Shape_t::InvalidChildIndex || ChildIndexes[2] != 1 )
+			throw std::runtime_error("Shape FindMembers wrong");
+
+		ShapeCache_t Full( 1 );
+		Value_t First( Lines[0] );
+		Value_t Third( Lines[2] );
+		if ( !Full.GetShape( First, Lines[0] ) || Full.GetShape( Third, Lines[2] ) || Full.GetShape( First, Lines[0] ) == nullptr )
+			throw std::runtime_error("Full shape cache wrong");
+	}
+
+	//	record-at-a-time streaming; tiny blocks so records, strings & escapes straddle reads
+	{
+		auto GetStringReader = [](std::string_view Json,size_t MaxRead)
+		{
+			return [=](std::span<char> Buffer) mutable
+			{
+				auto Read = std::min( { Buffer.size(), MaxRead, Json.size() } );
+				std::copy_n( Json.data(), Read, Buffer.data() );
+				Json.remove_prefix( Read );
+				return Read;
+			};
+		};
+		std::string_view Lines = "{\"id\":1,\"s\":\"a\\\"]}\"}\n\n[2, {}]\n  \"three\"  4\ntrue\n";
+		for ( size_t BlockSize : { 1, 3, 64 } )
+		{
+			std::vector<std::string> Records;
+			for ( auto& Record : Stream::ReadValues( GetStringReader( Lines, 5 ), BlockSize ) )
+				Records.push_back( Record.GetType() == ValueType_t::Object ? Record.GetValue("s").GetString() : std::to_string( Record.GetType() ) );
+			if ( Records != std::vector<std::string>{ "a\"]}", std::to_string(ValueType_t::Array), std::to_string(ValueType_t::String), std::to_string(ValueType_t::NumberInteger), std::to_string(ValueType_t::BooleanTrue) } )
+				throw std::runtime_error("Stream ReadValues wrong");
+		}
+
+		std::string_view Document = R"JSON({"skip":[{"a":"]"}], "a/b" : {"x":0, "items":[ {"n":1}, "two", [3] ,4 ]}, "after":)JSON";
+		std::vector<std::string> Elements;
+		for ( auto& Element : Stream::ReadElements( GetStringReader( Document, 2 ), "/a~1b/items", 4 ) )
+		{
+			auto Type = Element.GetType();
+			Elements.push_back( Type == ValueType_t::String ? Element.GetString() : Type == ValueType_t::NumberInteger ? std::to_string( Element.GetInteger() ) : Element.GetJsonString() );
+		}
+		if ( Elements != std::vector<std::string>{ R"JSON({"n":1})JSON", "two", "[3]", "4" } )
+			throw std::runtime_error("Stream ReadElements wrong");
+
+		size_t Count = 0;
+		for ( auto& Element : Stream::ReadElements( GetStringReader( "[[1],[2,3]]", 64 ), "/1" ) )
+			Count += Element.GetInteger();
+		if ( Count != 5 )
+			throw std::runtime_error("Stream ReadElements of array wrong");
+
+		for ( std::string_view Bad : { "{\"a\":1} }", "[1,2" } )
+		{
+			bool Rejected = false;
+			try
+			{
+				for ( auto& Record : Stream::ReadValues( GetStringReader( Bad, 64 ) ) )
+					Record.GetType();
+			}
+			catch(std::exception&)
+			{
+				Rejected = true;
+			}
+			if ( !Rejected )
+				throw std::runtime_error("Stream accepted bad json " + std::string(Bad));
+		}
+		bool Rejected = false;
+		try
+		{
+			for ( auto& Element : Stream::ReadElements( GetStringReader( Document, 64 ), "/missing" ) )
+				Element.GetType();
+		}
+		catch(std::exception&)
+		{
+			Rejected = true;
+		}
+		if ( !Rejected )
+			throw std::runtime_error("Stream ReadElements found a missing pointer");
+
+#if defined(POPJSON_ZLIB)
+		//	gzip members (concatenated, as from appending to a .gz) inflated on another thread
+		auto Gzip = [](std::string_view Json)
+		{
+			z_stream Stream = {};
+			deflateInit2( &Stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15+16, 8, Z_DEFAULT_STRATEGY );
+			std::string Output( deflateBound( &Stream, Json.size() ) + 32, 0 );
+			Stream.next_in = reinterpret_cast<Bytef*>( const_cast<char*>( Json.data() ) );
+			Stream.avail_in = static_cast<uInt>( Json.size() );
+			Stream.next_out = reinterpret_cast<Bytef*>( Output.data() );
+			Stream.avail_out = static_cast<uInt>( Output.size() );
+			deflate( &Stream, Z_FINISH );
+			Output.resize( Stream.total_out );
+			deflateEnd( &Stream );
+			return Output;
+		};
+		std::string Ndjson;
+		for ( int i=0;	i<2000;	i++ )
+			Ndjson += "{\"i\":" + std::to_string(i) + ",\"s\":\"" + std::string( i%50, 'x' ) + "\"}\n";
+		auto Compressed = Gzip( Ndjson.substr( 0, Ndjson.size()/2 ) ) + Gzip( Ndjson.substr( Ndjson.size()/2 ) );
+		size_t Total = 0;
+		size_t RecordCount = 0;
+		for ( auto& Record : Stream::ReadValues( Stream::GetInflateReader( GetStringReader( Compressed, 100 ), 256, 2 ), 128 ) )
+		{
+			Total += Record.GetValue("i").GetInteger();
+			RecordCount++;
+		}
+		if ( RecordCount != 2000 || Total != 1999*2000/2 )
+			throw std::runtime_error("Stream of inflated gzip wrong");
+		if ( Stream::ReadAll( Stream::GetInflateReader( GetStringReader( Compressed, 64 ) ) ) != Ndjson )
+			throw std::runtime_error("Inflated gzip doesn't match");
+
+		bool Truncated = false;
+		try
+		{
+			Stream::ReadAll( Stream::GetInflateReader( GetStringReader( std::string_view(Compressed).substr( 0, Compressed.size()-10 ), 64 ) ) );
+		}
+		catch(std::exception&)
+		{
+			Truncated = true;
+		}
+		if ( !Truncated )
+			throw std::runtime_error("Truncated gzip wasn't reported");
+#endif
+	}
+
+	//	content hashes ignore whitespace, key order, escapes and number formatting
+	{
+		auto GetHash = [](std::string_view Json)
+		{
+			auto Map = Parse( Json );
+			Map.BuildContentHashes( Json );
+			return Map.GetContentHash(0);
+		};
+		auto Hash = GetHash( R"JSON({"a":[1,2,{"x":"y"}],"b":null,"c":true})JSON" );
+		if ( GetHash( R"JSON( { "c" : true , "b":null,"a":[ 1.0, 2e0, {"x":"\u0079"} ] } )JSON" ) != Hash )
+			throw std::runtime_error("Content hash of equal json differs");
+		for ( auto Different : { R"JSON({"a":[2,1,{"x":"y"}],"b":null,"c":true})JSON", R"JSON({"a":[1,2,{"x":"y"}],"b":null,"c":false})JSON", R"JSON({"a":[1,2,{"y":"y"}],"b":null,"c":true})JSON", R"JSON({"a":[1,2,{"x":"y"}],"b":null})JSON", R"JSON({"a":[1,2,{"x":"y"}],"b":"null","c":true})JSON" } )
+			if ( GetHash( Different ) == Hash )
+				throw std::runtime_error("Content hash of different json matches; " + std::string(Different) );
+		if ( GetHash("[[]]") == GetHash("[]") || GetHash("[0]") != GetHash("[-0]") || GetHash("[1]") == GetHash("[\"1\"]") )
+			throw std::runtime_error("Content hash of nested/numbers wrong");
+
+		//	subtrees; the two statuses are equal, so IsEqual still walks them
+		auto Json = R"JSON([{"id":1,"tags":["a","b"]},{"tags":["a","b"],"id":1},{"id":2,"tags":["a","b"]}])JSON";
+		auto Map = Parse( Json );
+		Map.BuildContentHashes( Json );
+		auto First = Map.GetFirstChild(0);
+		auto Second = Map.GetNextSibling(First);
+		auto Third = Map.GetNextSibling(Second);
+		if ( Map.GetContentHash(First) != Map.GetContentHash(Second) || Map.GetContentHash(First) == Map.GetContentHash(Third) )
+			throw std::runtime_error("Subtree content hashes wrong");
+		if ( !Patch::IsEqual( Map, Json, First, Map, Json, Second ) || Patch::IsEqual( Map, Json, First, Map, Json, Third ) )
+			throw std::runtime_error("IsEqual with content hashes wrong");
+
+		//	Json_t keeps children's hashes, a write only rehashes what changed
+		Json_t Document( R"JSON({"a":[1,2,{"x":"y"}],"b":null})JSON" );
+		if ( Document.GetContentHash() != GetHash( Document.GetJsonString() ) )
+			throw std::runtime_error("Json_t content hash doesn't match its map");
+		Document.Set("c", true );
+		if ( Document.GetContentHash() != Hash )
+			throw std::runtime_error("Json_t content hash not updated after Set");
+		Document.ApplyMergePatch( R"JSON({"b":1})JSON" );
+		if ( Document.GetContentHash() != GetHash( Document.GetJsonString() ) || Document.GetContentHash() == Hash )
+			throw std::runtime_error("Json_t content hash not updated after patch");
+		bool Failed = false;
+		try
+		{
+			Document.ApplyPatch( R"JSON([{"op":"replace","path":"/b","value":"xyz"},{"op":"test","path":"/c","value":false}])JSON" );
+		}
+		catch(std::exception&)
+		{
+			Failed = true;
+		}
+		Document.Set("d", "later" );
+		if ( !Failed || Document.GetContentHash() != GetHash( Document.GetJsonString() ) )
+			throw std::runtime_error("Json_t content hash stale after reverted patch");
+	}
+
+	//	structural diff; applying the patch it makes turns one document into the other
+	{
+		auto CheckDiff = [](std::string_view From,std::string_view To,size_t ThreadCount=1)
+		{
+			auto FromMap = Parse( From );
+			auto ToMap = Parse( To );
+			auto Diff = Patch::Diff( FromMap, From, ToMap, To, ThreadCount );
+			auto Patched = Patch::Apply( From, Diff );
+			if ( !Patch::IsEqual( Parse(Patched), Patched, 0, ToMap, To, 0 ) )
+				throw std::runtime_error("Diff patch doesn't make the same document; " + Diff + " made " + Patched );
+			return Diff;
+		};
+		if ( CheckDiff( R"JSON({"a":1,"b":2})JSON", R"JSON({"a":1,"c":3})JSON" ) != R"JSON([{"op":"remove","path":"/b"},{"op":"add","path":"/c","value":3}])JSON" )
+			throw std::runtime_error("Diff of members wrong");
+		if ( CheckDiff( R"JSON({"a":[1,2],"b":{"c":1.0}})JSON", R"JSON( { "b" : { "c" : 1 } , "a" : [ 1, 2 ] } )JSON" ) != "[]" )
+			throw std::runtime_error("Diff of reformatted json isn't empty");
+		if ( CheckDiff( "[1,2,3,4,5]", "[1,5]" ) != R"JSON([{"op":"remove","path":"/1"},{"op":"remove","path":"/1"},{"op":"remove","path":"/1"}])JSON" )
+			throw std::runtime_error("Diff of array removal wrong");
+		if ( CheckDiff( "[1,2]", "[0,1,2,3]" ) != R"JSON([{"op":"add","path":"/0","value":0},{"op":"add","path":"/3","value":3}])JSON" )
+			throw std::runtime_error("Diff of array insert wrong");
+		//	elements are aligned (shortest edit script) before changed ones are diffed
+		if ( CheckDiff( R"JSON([{"a":1},{"b":2},{"c":3},{"d":4}])JSON", R"JSON([{"a":1},{"b":9},{"c":3},{"x":1},{"d":4}])JSON" ) != R"JSON([{"op":"add","path":"/3","value":{"x":1}},{"op":"replace","path":"/1/b","value":9}])JSON" )
+			throw std::runtime_error("Diff of array elements wrong");
+		CheckDiff( "[1,2,3,4,5,6,7,8]", "[8,7,6,5,4,3,2,1]" );
+		{
+			//	too many differences to align, so they're diffed pairwise
+			std::string FromArray = "[";
+			std::string ToArray = "[";
+			for ( int i=0;	i<200;	i++ )
+			{
+				FromArray += std::to_string(i) + ",";
+				ToArray += std::to_string( i % 3 ? i : -i ) + ",";
+			}
+			FromArray.back() = ']';
+			ToArray += "0]";
+			CheckDiff( FromArray, ToArray );
+		}
+		CheckDiff( R"JSON({"a":1,"b":[1,2,3],"c":{"d":"x","e":[{"f":1}]},"e~/":true,"q\"u":1})JSON", R"JSON({"b":[1,9,2,3],"c":{"d":"y","e":[{"f":2},{}],"g":null},"a":1.0,"h":[],"e~/":false,"q\"u":[1]})JSON" );
+		CheckDiff( "1", R"JSON({"a":[1]})JSON" );
+		CheckDiff( R"JSON([[1,[2,[3]]],{}])JSON", R"JSON([[1,[2,[4]]],[]])JSON" );
+
+		//	a wide root object is split across threads, changes come out in the same order
+		std::string From = "{";
+		std::string To = "{";
+		for ( int i=0;	i<2000;	i++ )
+		{
+			auto Key = "\"k" + std::to_string(i) + "\":";
+			if ( i % 97 != 0 )
+				From += ( From.size() > 1 ? "," : "" ) + Key + "{\"v\":" + std::to_string(i) + "}";
+			if ( i % 89 != 0 )
+				To += ( To.size() > 1 ? "," : "" ) + Key + "{\"v\":" + std::to_string( i % 13 ? i : -i ) + "}";
+		}
+		From += "}";
+		To += "}";
+		if ( CheckDiff( From, To, 4 ) != CheckDiff( From, To, 1 ) )
+			throw std::runtime_error("Threaded diff differs");
+
+		std::vector<Patch::Change_t::Operation_t> Operations;
+		auto FromMap = Parse( From );
+		auto ToMap = Parse( To );
+		Patch::Diff( FromMap, From, ToMap, To, [&](const Patch::Change_t& Change)	{	Operations.push_back( Change.mOperation );	}, 3 );
+		if ( std::count( Operations.begin(), Operations.end(), Patch::Change_t::Remove ) != 22 || std::count( Operations.begin(), Operations.end(), Patch::Change_t::Add ) != 20 )
+			throw std::runtime_error("Diff changes wrong");
+	}
+
+	//	bulk typed array writers
+	{
+		Json_t Json;
+		std::vector<int32_t> Ints = { 1, -2, 300 };
+		std::vector<double> Doubles = { 0.5, -1e300 };
+		std::vector<float> Floats = { 0.1f };
+		std::vector<bool> Bools = { true, false };
+		std::vector<std::string_view> Strings = { "a", "q\"u\n" };
+		Json.PushBack( "i", Ints );
+		Json.PushBack( "d", std::span<const double>( Doubles ) );
+		Json.PushBack( "f", Floats );
+		Json.PushBack( "b", Bools );
+		Json.PushBack( "s", Strings );
+		Json.PushBack( "i", std::span<const int32_t>( Ints.data(), 1 ) );
+		Json["e"].PushBack( std::vector<int32_t>() );
+		auto Expected = R"JSON({"i":[1,-2,300,1],"d":[0.5,-1e+300],"f":[0.1],"b":[true,false],"s":["a","q\"u\n"],"e":[]})JSON";
+		if ( Json.GetJsonString() != Expected )
+			throw std::runtime_error("Bulk array writers wrote " + Json.GetJsonString() );
+		if ( Json.GetValue("i").GetChildCount() != 4 || Json.GetValue("s").GetValue(1).GetString() != "q\"u\n" || Json.GetValue("d").GetValue(1).TryGetDouble().Value() != -1e300 )
+			throw std::runtime_error("Bulk array writers read back wrong");
+
+		//	appending to a parsed array (with whitespace), and the strings of the older writer
+		Json_t Parsed( R"JSON({ "x" : [ 1 , 2 ], "y":{} })JSON" );
+		Parsed.PushBack( "x", Ints );
+		std::vector<uint32_t> Indexes = { 7, 8 };
+		Parsed.PushBack( "z", Indexes, [](const uint32_t& Index)	{	return std::to_string(Index);	} );
+		if ( Json_t( Parsed.GetJsonString() ).GetValue("x").GetChildCount() != 5 || Parsed.GetValue("z").GetValue(1).GetString() != "8" )
+			throw std::runtime_error("Bulk array writer append wrong; " + Parsed.GetJsonString() );
+		bool Threw = false;
+		try	{	Parsed.PushBack( "y", Ints );	}	catch(std::exception&)	{	Threw = true;	}
+		if ( !Threw )
+			throw std::runtime_error("Bulk array writer should fail on non-array member");
+		Threw = false;
+		try	{	Parsed.PushBack( "x", std::vector<double>{ 1, NAN } );	}	catch(std::exception&)	{	Threw = true;	}
+		if ( !Threw || Json_t( Parsed.GetJsonString() ).GetValue("x").GetChildCount() != 5 )
+			throw std::runtime_error("Bulk array writer should fail on nan, and leave the array as it was");
+
+		Json_t Array;
+		Array.PushBack( std::span<const double>( Doubles ) );
+		Array.PushBack( std::span<const std::string_view>( Strings ) );
+		if ( Array.GetJsonString() != R"JSON([0.5,-1e+300,"a","q\"u\n"])JSON" )
+			throw std::runtime_error("Bulk array push wrote " + Array.GetJsonString() );
+	}
+
+	//	appends to nested arrays and objects, in place
+	{
+		Json_t Json( R"JSON({"a":{"events":[],"n":1},"list":[ 1 , 2 ]})JSON" );
+		std::string Events;
+		std::string List = "1,2";
+		std::string Members;
+		for ( int i=0;	i<200;	i++ )
+		{
+			Json.PushBackAt( "/a/events", i );
+			Events += ( i ? "," : "" ) + std::to_string(i);
+			if ( i % 3 == 0 )
+			{
+				Json.PushBackAt( "/list", "s" + std::to_string(i) );
+				List += ",\"s" + std::to_string(i) + "\"";
+			}
+			if ( i % 50 == 0 )
+			{
+				Json.SetAt( "/a", "k" + std::to_string(i), i % 100 == 0 );
+				Members += ",\"k" + std::to_string(i) + "\":" + ( i % 100 == 0 ? "true" : "false" );
+			}
+		}
+		auto Expected = R"JSON({"a":{"events":[)JSON" + Events + R"JSON(],"n":1)JSON" + Members + R"JSON(},"list":[1,2,)JSON" + List.substr(4) + "]}";
+		auto Minified = Minify( Json.GetJsonString() );
+		if ( Minified != Expected )
+			throw std::runtime_error("Nested appends wrote " + Minified );
+		auto Map = Parse( Minified );
+		Map.BuildContentHashes( Minified );
+		if ( Json.GetContentHash() != Map.GetContentHash(0) )
+			throw std::runtime_error("Content hash wrong after nested appends");
+
+		//	a copy keeps its own spare capacity
+		Json_t Copy( Json );
+		Copy.PushBackAt( "/a/events", -1 );
+		Json.PushBackAt( "/a/events", -2 );
+		if ( Copy.GetValue("a").GetValue("events").GetChildCount() != 201 || Minify( Json.GetJsonString() ).find(",199,-2]") == std::string::npos )
+			throw std::runtime_error("Nested append to a copy wrong");
+
+		Json_t Object( R"JSON({"x":[1]})JSON" );
+		Json.PushBackAt( "/a/events", Object );
+		Json.SetAt( "/a", "o", Object );
+		Json.PushBackAt( "/a/events/201/x", 2 );
+		Json.PushBack( "tags", "first" );
+		Json["tags"].PushBack( "second" );
+		Json.PushBack( "tags", std::vector<int>{ 1, 2 } );
+		auto Tail = Minify( Json.GetJsonString() );
+		if ( Tail.find(R"JSON(,-2,{"x":[1,2]}],"n":1,"k0":true,"k50":false,"k100":true,"k150":false,"o":{"x":[1]}},)JSON") == std::string::npos || Tail.find(R"JSON("tags":["first","second",1,2])JSON") == std::string::npos )
+			throw std::runtime_error("Nested appends of values wrote " + Tail );
+
+		bool Threw = false;
+		try	{	Json.PushBackAt( "/a", 1 );	}	catch(std::exception&)	{	Threw = true;	}
+		try	{	Json.PushBackAt( "/a/missing", 1 );	Threw = false;	}	catch(std::exception&)	{}
+		try	{	Json.SetAt( "/list", "k", 1 );	Threw = false;	}	catch(std::exception&)	{}
+		if ( !Threw )
+			throw std::runtime_error("Nested append should fail on the wrong type of container, or a missing one");
+
+		//	arrays written through a ValueInput_t keep their brackets
+		Json_t Strings;
+		std::vector<std::string> Values = { "x", "y" };
+		Strings.Set( "s", ValueInput_t( std::span<std::string>( Values ) ) );
+		if ( Strings.GetJsonString() != R"JSON({"s":["x","y"]})JSON" )
+			throw std::runtime_error("Set of array wrote " + Strings.GetJsonString() );
+	}
+
+	//	nested values set in place, by pointer or chained []
+	{
+		Json_t Json( R"JSON({"a":{"b":{"c":1,"d":[1,2]},"e":"x"},"f":true,"arr":[{"v":1},{"v":2}]})JSON" );
+		Json["a"]["b"]["c"] = 5;
+		Json["a"]["b"]["d"].PushBack( 3 );
+		Json["a"]["b"]["c"] = "a longer value";
+		Json["a"]["e"] = 0;
+		Json["a"]["b"]["new"] = true;
+		Json["a"]["z"].PushBack( 1 );
+		Json["arr"]["1"]["v"] = 9;
+		Json["f"] = false;
+		Json.SetAt( "/arr/-", 3 );
+		Json.PushBackAt( "/a/b/d", 4 );
+		auto Expected = R"JSON({"a":{"b":{"c":"a longer value","d":[1,2,3,4],"new":true},"e":0,"z":[1]},"f":false,"arr":[{"v":1},{"v":9},3]})JSON";
+		auto Minified = Minify( Json.GetJsonString() );
+		if ( Minified != Expected )
+			throw std::runtime_error("Nested set wrote " + Minified );
+		if ( Json["a"]["b"]["c"].GetString() != "a longer value" || Json["arr"]["1"]["v"].GetInteger() != 9 || Json["a"]["b"]["d"].GetChildCount() != 4 || Json["a"]["missing"].GetType() != ValueType_t::Null )
+			throw std::runtime_error("Nested set read back wrong");
+		auto Map = Parse( Minified );
+		Map.BuildContentHashes( Minified );
+		if ( Json.GetContentHash() != Map.GetContentHash(0) )
+			throw std::runtime_error("Content hash wrong after nested set");
+
+		//	replacing a container drops what was known about the values inside it
+		Json_t Object( R"JSON({"d":[7]})JSON" );
+		Json["a"]["b"] = Object;
+		Json.PushBackAt( "/a/b/d", 8 );
+		Json.SetAt( "/a/b/d/0", -7 );
+		if ( Minify( Json.GetJsonString() ).find(R"JSON({"a":{"b":{"d":[-7,8]},"e":0,)JSON") != 0 )
+			throw std::runtime_error("Nested set of a container wrote " + Json.GetJsonString() );
+
+		bool Threw = false;
+		try	{	Json["a"]["missing"]["c"] = 1;	}	catch(std::exception&)	{	Threw = true;	}
+		try	{	Json.SetAt( "/arr/7", 1 );	Threw = false;	}	catch(std::exception&)	{}
+		if ( !Threw )
+			throw std::runtime_error("Nested set should fail when the parent doesn't exist");
+	}
+
+	//	numbers decoded once while parsing, read the same as from the text
+	{
+		std::string_view Json = R"JSON({"i":-42,"big":9007199254740993,"huge":123456789012345678901,"d":0.25,"e":-1.5e3,"s":"7","inf":1e999,"a":[1,2.5,3]})JSON";
+		auto Taped = Parse<NumberTapePolicy_t>( Json );
+		auto Plain = Parse( Json );
+		if ( !Taped.HasNumberTape() || Plain.HasNumberTape() )
+			throw std::runtime_error("Number tape should only be built by a DecodeNumbers policy");
+		if ( !Taped.GetTapeNumber( Taped.GetChild(0,"i",Json) ) || Taped.GetTapeNumber( Taped.GetChild(0,"s",Json) ) || Taped.GetTapeNumber( Taped.GetChild(0,"inf",Json) ) )
+			throw std::runtime_error("Number tape has the wrong nodes");
+
+		for ( NodeIndex_t Node=0;	Node<Plain.GetNodeCount();	Node++ )
+		{
+			SliceReadOnly_t TapeSlice( Taped, Json, Node );
+			SliceReadOnly_t TextSlice( Plain, Json, Node );
+			auto Same = [](auto a,auto b)	{	return a.GetError() == b.GetError() && ( !a || *a == *b );	};
+			if ( !Same( TapeSlice.TryGetInteger(), TextSlice.TryGetInteger() ) || !Same( TapeSlice.TryGetInteger64(), TextSlice.TryGetInteger64() ) || !Same( TapeSlice.TryGetDouble(), TextSlice.TryGetDouble() ) )
+				throw std::runtime_error("Number tape read differs from the text at " + std::string( TextSlice.GetRawValue() ) );
+		}
+		if ( SliceReadOnly_t( Taped, Json ).TryGetValue("big").Value().TryGetInteger64().Value() != 9007199254740993 )
+			throw std::runtime_error("Number tape lost integer precision");
+	}
+
+	//	projected parse only maps the values on the given paths
+	{
+		std::string_view Json = R"JSON({"skip":{"s":"}]\"{[","n":[1,{"x":[]}]},"user":{"id":7,"name":"n"},"items":[{"price":1,"q":2},{"q":3},{"price":[4,5]}],"event":{"ts":9},"0":{"a":1,"b":2}})JSON";
+		Projection_t Projection{ "/user/id", "/items/*/price", "/items/1/q", "/event", "/0/b" };
+		auto Map = Parse( Json, Projection );
+		std::vector<std::string> Mapped;
+		for ( NodeIndex_t Node=1;	Node<Map.GetNodeCount();	Node++ )
+			Mapped.push_back( std::string( Map.GetNode(Node).GetKey(Json) ) + "=" + std::string( SliceReadOnly_t( Map, Json, Node ).GetRawValue() ) );
+		std::vector<std::string> Expected = { "user=\"id\":7,\"name\":\"n\"", "id=7", "items=" + std::string( SliceReadOnly_t( Parse(Json), Json ).TryGetValue("items").Value().GetRawValue() ),
+			"=\"price\":1,\"q\":2", "price=1", "=\"q\":3", "q=3", "=\"price\":[4,5]", "price=4,5", "=4", "=5", "event=\"ts\":9", "ts=9", "0=\"a\":1,\"b\":2", "b=2" };
+		if ( Mapped != Expected )
+			throw std::runtime_error("Projected map has the wrong nodes");
+		if ( Map.GetNode(0).GetDescendantCount() != Map.GetNodeCount()-1 )
+			throw std::runtime_error("Projected map has the wrong descendant count");
+
+		bool Threw = false;
+		try	{	Parse( R"JSON({"skip":{"s":"}]","user":{}})JSON", Projection );	}	catch(std::exception&)	{	Threw = true;	}
+		if ( !Threw )
+			throw std::runtime_error("Projected parse should fail on an unclosed skipped value");
+	}
+
+	//	JSONPath queries over a map
+	{
+		std::string_view Json = R"JSON({"items":[{"price":1,"id":"a"},{"price":2.5},{"id":"b","sub":{"id":"c"}}],
+			"events":[{"level":"error","m":1},{"level":"info","m":2},{"level":"err\u006fr","m":3}],"n":[0,1,2,3,4,5],"a b":{"c":true}})JSON";
+		auto Map = Parse( Json );
+		auto Query = [&](std::string_view Path,size_t ThreadCount=1)
+		{
+			std::string Results;
+			for ( auto& Slice : JsonPath_t( Path ).Evaluate( Map, Json, ThreadCount ) )
+				Results += ( Results.empty() ? "" : "," ) + std::string( Slice.GetRawValue() );
+			return Results;
+		};
+		std::pair<std::string_view,std::string_view> Cases[] =
+		{
+			{ "$.items[*].price", "1,2.5" },
+			{ "$..id", "a,b,c" },
+			{ "$.events[?(@.level=='error')].m", "1,3" },
+			{ "$.events[?(@.m >= 2)].level", "info,err\\u006fr" },
+			{ "$.items[?(@.id)].id", "a,b" },
+			{ "$.n[1:4]", "1,2,3" },
+			{ "$.n[::2]", "0,2,4" },
+			{ "$.n[-2:]", "4,5" },
+			{ "$.n[::-2]", "5,3,1" },
+			{ "$.n[-1]", "5" },
+			{ "$['a b'].c", "true" },
+			{ "$.n[?(@ > 3)]", "4,5" },
+			{ "$.missing[*]", "" },
+		};
+		for ( auto& [Path,Expected] : Cases )
+			if ( Query( Path ) != Expected )
+				throw std::runtime_error("JSONPath " + std::string(Path) + " gave " + Query( Path ) );
+
+		//	a wide array is split across threads, with the same results in the same order
+		std::string Wide = "[";
+		for ( int i=0;	i<20000;	i++ )
+			Wide += "{\"v\":" + std::to_string(i) + "},";
+		Wide.back() = ']';
+		auto WideMap = Parse( Wide );
+		JsonPath_t WideQuery( "$[?(@.v < 15000)].v" );
+		std::vector<NodeIndex_t> Single, Threaded;
+		WideQuery.Evaluate( WideMap, Wide, Single, 1 );
+		WideQuery.Evaluate( WideMap, Wide, Threaded, 3 );
+		if ( Single.size() != 15000 || Single != Threaded )
+			throw std::runtime_error("JSONPath threaded results differ");
+
+		bool Threw = false;
+		try	{	JsonPath_t( "$.a[?(@.b=='x')" );	}	catch(std::exception&)	{	Threw = true;	}
+		if ( !Threw )
+			throw std::runtime_error("JSONPath syntax error should throw");
+	}
+
+	//	columns of an array of objects, with validity bitmaps
+	{
+		std::string_view Json = R"JSON([{"x":1.5,"n":3,"s":"a"},{"n":4.5,"s":null,"x":-2},7,{"s":"b\"c","n":12345678901},{"x":"1"}])JSON";
+		auto Map = Parse( Json );
+		ColumnSpec_t Specs[] = { { "x", ColumnType_t::Double }, { "n", ColumnType_t::Integer }, { "s", ColumnType_t::String } };
+		auto Columns = ExtractColumns( Map, Json, 0, Specs );
+		auto& x = Columns[0];
+		auto& n = Columns[1];
+		auto& s = Columns[2];
+		if ( x.GetRowCount() != 5 || x.GetValidCount() != 2 || x.mDoubles[0] != 1.5 || x.mDoubles[1] != -2 || x.IsValid(4) )
+			throw std::runtime_error("Double column extracted wrong");
+		if ( n.GetValidCount() != 2 || n.mIntegers[0] != 3 || n.IsValid(1) || n.mIntegers[3] != 12345678901 )
+			throw std::runtime_error("Integer column extracted wrong");
+		if ( s.GetValidCount() != 2 || s.mStrings[0] != "a" || s.IsValid(1) || s.IsValid(2) || s.mStrings[3] != "b\\\"c" )
+			throw std::runtime_error("String column extracted wrong");
+
+		//	split across threads, with the same results
+		std::string Rows = "[";
+		for ( int i=0;	i<40000;	i++ )
+			Rows += i % 3 ? "{\"v\":" + std::to_string(i) + "}," : "{},";
+		Rows.back() = ']';
+		auto RowsMap = Parse<NumberTapePolicy_t>( Rows );
+		ColumnSpec_t v[] = { { "v", ColumnType_t::Integer } };
+		auto Single = ExtractColumns( RowsMap, Rows, 0, v );
+		auto Threaded = ExtractColumns( RowsMap, Rows, 0, v, 3 );
+		if ( Single[0].mIntegers != Threaded[0].mIntegers || Single[0].mValid != Threaded[0].mValid || Single[0].mIntegers[39998] != 39998 || Single[0].GetValidCount() != 26666 )
+			throw std::runtime_error("Threaded column extraction differs");
+	}
+
+	//	deep nesting is parsed without recursion, up to the policy's MaxDepth
+	{
+		auto MakeNested = [](size_t Depth)
+		{
+			std::string Json;
+			for ( size_t d=0;	d<Depth;	d++ )
+				Json += (d&1) ? "[" : "{\"a\":";
+			Json += "1";
+			for ( size_t d=Depth;	d-->0;	)
+				Json += (d&1) ? "]" : "}";
+			return Json;
+		};
+		auto Deep = MakeNested( 10000 );
+		auto Map = Parse( Deep );
+		if ( Map.GetNodeCount() != 10001 || Map.GetNode(10000).GetType() != ValueType_t::NumberInteger )
+			throw std::runtime_error("Deep map parse wrong");
+		Json_t Document( Deep );
+		auto Inner = Document.GetValue("a").GetValue(0).GetValue("a");
+		if ( Inner.GetType() != ValueType_t::Array )
+			throw std::runtime_error("Deep Json_t access wrong");
+		if ( Minify( Deep ) != Deep || Transcode::Read( Transcode::Format_t::Cbor, Transcode::Write( Transcode::Format_t::Cbor, Deep ) ).GetJsonString() != Deep )
+			throw std::runtime_error("Deep reformat/transcode wrong");
+
+		bool Rejected = false;
+		try
+		{
+			Parse( MakeNested( StrictPolicy_t::MaxDepth + 1 ) );
+		}
+		catch(std::exception&)
+		{
+			Rejected = true;
+		}
+		if ( !Rejected )
+			throw std::runtime_error("Nesting deeper than MaxDepth was accepted");
+	}
+
+	//	utf-8 validation; errors are found at the start of the bad sequence, including across 16 byte chunks
+	{
+		std::string Valid = "{\"caf\xc3\xa9\":\"\xe6\x97\xa5\xe6\x9c\xac \xf0\x9f\x98\x80 padding to cross a chunk\"}";
+		Parse<Utf8Policy_t>( Valid );
+		Json_t Document( Valid, Utf8Policy_t() );
+
+		std::pair<std::string,size_t> Invalids[] =
+		{
+			{	"0123456789abcd\xe6\x97\"\" more ascii after", 14	},	//	truncated, straddling a chunk
+			{	"0123456789abcdef\x80", 16	},						//	stray continuation
+			{	"\"\xc0\xaf\"", 1	},									//	overlong
+			{	"\"\xed\xa0\x80\"", 1	},								//	surrogate
+			{	"\"\xf4\x90\x80\x80\"", 1	},							//	> U+10FFFF
+			{	"\"0123456789abc\xf0\x9f\x98", 14	},					//	truncated by the end
+		};
+		for ( auto& [Json,Offset] : Invalids )
+		{
+			if ( Scan::FindInvalidUtf8( Json.data(), Json.size() ) != Offset )
+				throw std::runtime_error("FindInvalidUtf8 wrong for case at " + std::to_string(Offset));
+		}
+
+		std::string Invalid = "[\"0123456789abcdefghij\xff\"]";
+		bool Rejected = false;
+		try
+		{
+			Parse<Utf8Policy_t>( Invalid );
+		}
+		catch(std::exception& e)
+		{
+			Rejected = std::string(e.what()).find("byte 22") != std::string::npos;
+		}
+		if ( !Rejected )
+			throw std::runtime_error("Utf8 policy didn't report invalid byte offset");
+		Parse( Invalid );
+	}
+
+#if POPJSON_INSTRUMENTATION
+	{
+		Instrumentation::Reset();
+		auto Json = R"JSON( {"a":[1,2.5,{"b":"x\ny"}],"c":true} )JSON";
+		Value_t Data( Json );
+		Data.GetValue("a",Json);
+		auto Stats = Instrumentation::GetSnapshot();
+		auto& Document = Stats.mDocumentTotals;
+		if ( Stats.mCounters[Instrumentation::Counter_t::Document] != 1 )
+			throw std::runtime_error("Instrumentation counted re-parse as a document");
+		if ( Document.mNodeCount != 7 || Document.mMaxDepth != 3 || Document.mNumberCount != 2 || Document.mStringCount != 4 || Document.mEscapeCount != 1 )
+			throw std::runtime_error("Instrumentation document stats wrong");
+		if ( Stats.mCounters[Instrumentation::Counter_t::Reparse] != 1 || Stats.mPhaseCalls[Instrumentation::Phase_t::Parse] != 1 )
+			throw std::runtime_error("Instrumentation phase/counter stats wrong");
+	}
+#endif
+
 
 
 	
@@ -54,6 +1182,19 @@ static inline std::string EscapeChar(char c)
 	return std::string(buf);
 }
 
+//	input is the second part of \X, other than u
+static bool IsEscapeChar(char SlashChar)
+{
+	switch ( SlashChar )
+	{
+		case 'b':	case 'f':	case 'n':	case 'r':	case 't':
+		case '"':	case '\\':	case '/':
+			return true;
+		default:
+			return false;
+	}
+}
+
 //	input is the second part of \X
 static char GetEscapedChar(char SlashChar)
 {
@@ -83,40 +1224,142 @@ static inline bool in_range(long x, long lower, long upper) {
 
 bool in_rangeHex(long x)
 {
-	if ( !in_range( x, 'a', 'f') )
-		return false;
-	if ( !in_range( x, 'A', 'F') )
-		return false;
-	if ( !in_range( x, '0', '9') )
-		return false;
-	return true;
+	if ( in_range( x, 'a', 'f') )
+		return true;
+	if ( in_range( x, 'A', 'F') )
+		return true;
+	if ( in_range( x, '0', '9') )
+		return true;
+	return false;
+}
+
+//	format a number with std::to_chars (locale independent, doubles are shortest round-trip)
+//	Buffer must be at least 32 chars. returns length written
+template<typename NUMBER>
+static size_t ToChars(char* Buffer,NUMBER Value)
+{
+	if constexpr ( std::is_floating_point_v<NUMBER> )
+	{
+		if ( !std::isfinite(Value) )
+			throw std::runtime_error("Cannot write nan or infinite number to json");
+	}
+	auto Result = std::to_chars( Buffer, Buffer+32, Value );
+	if ( Result.ec != std::errc() )
+		throw std::runtime_error("Failed to format number");
+	return Result.ptr - Buffer;
+}
+
+void PopJson::AppendEscapedString(std::vector<char>& Storage,std::string_view Value)
+{
+	static const char HexChars[] = "0123456789abcdef";
+	size_t RunStart = 0;
+	for ( size_t i=0;	i<Value.size();	i++ )
+	{
+		auto Char = static_cast<uint8_t>(Value[i]);
+		if ( Char >= 0x20 && Char != '"' && Char != '\\' )
+			continue;
+		
+		Storage.insert( Storage.end(), Value.data()+RunStart, Value.data()+i );
+		RunStart = i+1;
+		Storage.push_back('\\');
+		switch ( Char )
+		{
+			case '"':	Storage.push_back('"');	break;
+			case '\\':	Storage.push_back('\\');	break;
+			case '\b':	Storage.push_back('b');	break;
+			case '\f':	Storage.push_back('f');	break;
+			case '\n':	Storage.push_back('n');	break;
+			case '\r':	Storage.push_back('r');	break;
+			case '\t':	Storage.push_back('t');	break;
+			default:
+			{
+				char Unicode[] = { 'u', '0', '0', HexChars[Char>>4], HexChars[Char&0xf] };
+				Storage.insert( Storage.end(), std::begin(Unicode), std::end(Unicode) );
+				break;
+			}
+		}
+	}
+	Storage.insert( Storage.end(), Value.data()+RunStart, Value.data()+Value.size() );
 }
 
 
-static const int max_depth = 200;
+//	re-parsing (Node_t::GetValue) only happens on data which has already been parsed (with whatever policy),
+//	so it accepts everything
+class ReparsePolicy_t
+{
+public:
+	static constexpr bool	AllowComments = true;
+	static constexpr bool	AllowTrailingCommas = true;
+	static constexpr bool	AllowNanAndInfinity = true;
+	static constexpr bool	StrictNumbers = false;
+	static constexpr PopJson::DuplicateKeys_t::Type	DuplicateKeys = PopJson::DuplicateKeys_t::Allow;
+	static constexpr bool	ValidateUtf8 = false;
+	static constexpr size_t	MaxDepth = SIZE_MAX;
+	static constexpr bool	DecodeNumbers = false;
+};
 
 //	JsonParser stolen from dropbox/json11
+//	POLICY is one of the parser policies (see StrictPolicy_t)
+//	thrown by the parser instead of a std::runtime_error when no message is wanted (TryParse)
+class ParseFailed_t
+{
+public:
+	PopJson::Error_t::Type	mError;
+	size_t					mPosition;
+};
+
+template<typename POLICY>
 struct JsonParser final
 {
-	JsonParser(std::string_view InputJson,bool AllowComments=false) :
+	//	without ErrorMessages, errors throw a ParseFailed_t and no message string is ever built
+	JsonParser(std::string_view InputJson,bool ErrorMessages=true) :
 		str				( InputJson ),
-		AllowComments	( AllowComments )
+		ErrorMessages	( ErrorMessages )
 	{
+		//	done up front rather than per string; sequences can straddle the runs the string parser
+		//	skips, and one pass over the whole buffer is mostly the ascii fast path
+		if constexpr ( POLICY::ValidateUtf8 )
+		{
+			auto Invalid = PopJson::Scan::FindInvalidUtf8( str.data(), str.size() );
+			if ( Invalid != str.size() )
+			{
+				i = Invalid;
+				fail( PopJson::Error_t::InvalidUtf8, [&]{	return "Invalid utf-8 at byte " + std::to_string(Invalid);	} );
+			}
+		}
 	}
 
+	//	keys seen in the current object, only needed when rejecting duplicates
+	class NoKeySet_t
+	{
+	};
+	using KeySet_t = std::conditional_t<POLICY::DuplicateKeys==PopJson::DuplicateKeys_t::Reject, std::unordered_set<std::string_view>, NoKeySet_t>;
+
     /* State
      */
     std::string_view str;	//	input
     size_t i = 0;				//	parsing position
-	bool AllowComments = false;		//	allow json with comments
+	bool ErrorMessages = true;
+	PopJson::Instrumentation::DocumentStats_t Stats;	//	only written when instrumentation is enabled
+	PopJson::TapeNumber_t LastNumber;	//	the last number scanned, only written when POLICY::DecodeNumbers
+
+	//	GetMessage is only called if the message is going to be used
+	template<typename GETMESSAGE>
+	[[noreturn]] void fail(PopJson::Error_t::Type Error,GETMESSAGE GetMessage)
+	{
+		if ( !ErrorMessages )
+			throw ParseFailed_t{ Error, i };
+		throw std::runtime_error( GetMessage() );
+	}
 
 	/* consume_whitespace()
   *
   * Advance until the current character is non-whitespace.
   */
  void consume_whitespace() {
-	 while (str[i] == ' ' || str[i] == '\r' || str[i] == '\n' || str[i] == '\t')
-		 i++;
+	 //	most tokens have no whitespace before them, so only start a scan if there is some
+	 if ( i < str.size() && PopJson::Scan::IsWhitespace(str[i]) )
+		 i += PopJson::Scan::SkipWhitespace( str.data()+i, str.size()-i );
  }
 
     /* consume_comment()
@@ -126,10 +1369,10 @@ struct JsonParser final
     bool consume_comment()
 	{
       bool comment_found = false;
-      if (str[i] == '/') {
+      if (i < str.size() && str[i] == '/') {
         i++;
         if (i == str.size())
-          throw std::runtime_error("unexpected end of input after start of comment");
+          fail( PopJson::Error_t::Syntax, [&]{	return "unexpected end of input after start of comment";	} );
 		  
         if (str[i] == '/') { // inline comment
           i++;
@@ -142,19 +1385,19 @@ struct JsonParser final
         else if (str[i] == '*') { // multiline comment
           i++;
           if (i > str.size()-2)
-			  throw std::runtime_error("unexpected end of input inside multi-line comment");
+			  fail( PopJson::Error_t::Syntax, [&]{	return "unexpected end of input inside multi-line comment";	} );
 			
           // advance until closing tokens
           while (!(str[i] == '*' && str[i+1] == '/')) {
             i++;
             if (i > str.size()-2)
-				throw std::runtime_error("unexpected end of input inside multi-line comment");
+				fail( PopJson::Error_t::Syntax, [&]{	return "unexpected end of input inside multi-line comment";	} );
           }
           i += 2;
           comment_found = true;
         }
         else
-			throw std::runtime_error("malformed comment");
+			fail( PopJson::Error_t::Syntax, [&]{	return "malformed comment";	} );
       }
       return comment_found;
     }
@@ -165,7 +1408,7 @@ struct JsonParser final
      */
     void consume_garbage() {
       consume_whitespace();
-      if ( AllowComments )
+      if constexpr ( POLICY::AllowComments )
 	  {
         bool comment_found = false;
         do {
@@ -176,6 +1419,14 @@ struct JsonParser final
       }
     }
 
+	//	only whitespace (and comments, if allowed) can follow the root value
+	void consume_end()
+	{
+		consume_garbage();
+		if ( i < str.size() )
+			fail( PopJson::Error_t::Syntax, [&]{	return "unexpected " + EscapeChar(str[i]) + " after json";	} );
+	}
+
     /* get_next_token()
      *
      * Return the next non-whitespace character. If the end of the input is reached,
@@ -185,7 +1436,7 @@ struct JsonParser final
 	{
         consume_garbage();
         if (i == str.size())
-            throw std::runtime_error("unexpected end of json");
+            fail( PopJson::Error_t::Syntax, [&]{	return "unexpected end of json";	} );
 
         return str[i++];
     }
@@ -199,8 +1450,16 @@ struct JsonParser final
 		
 		while (true)
 		{
+			//	skip the plain run up to the next quote, escape or control char
+			auto PlainLength = PopJson::Scan::FindStringSpecial( str.data()+i, str.size()-i );
+			if ( PlainLength > 0 )
+			{
+				i += PlainLength;
+				last_escaped_codepoint = -1;
+			}
+
 			if (i == str.size())
-				throw std::runtime_error("unexpected end of input in string");
+				fail( PopJson::Error_t::Syntax, [&]{	return "unexpected end of input in string";	} );
 
 			char ch = str[i++];
 
@@ -211,7 +1470,7 @@ struct JsonParser final
 			}
 
 			if (in_range(ch, 0, 0x1f))
-				throw std::runtime_error("unescaped " + EscapeChar(ch) + " in string");
+				fail( PopJson::Error_t::Syntax, [&]{	return "unescaped " + EscapeChar(ch) + " in string";	} );
 
 			// The usual case: non-escaped characters
 			if (ch != '\\')
@@ -222,7 +1481,10 @@ struct JsonParser final
 
 			// Handle escapes
 			if ( i == str.size() )
-				throw std::runtime_error("unexpected end of input in string");
+				fail( PopJson::Error_t::Syntax, [&]{	return "unexpected end of input in string";	} );
+
+			if constexpr ( PopJson::Instrumentation::Enabled )
+				Stats.mEscapeCount++;
 
 			ch = str[i++];
 
@@ -234,12 +1496,12 @@ struct JsonParser final
 				// relies on std::string returning the terminating NUL when
 				// accessing str[length]. Checking here reduces brittleness.
 				if (esc.length() < 4)
-					throw std::runtime_error("bad \\u escape: " + std::string(esc));
+					fail( PopJson::Error_t::Syntax, [&]{	return "bad \\u escape: " + std::string(esc);	} );
 
 				for (size_t j = 0; j < 4; j++)
 				{
 					if ( !in_rangeHex(esc[j]) )
-						throw std::runtime_error("bad \\u escape: " + std::string(esc));
+						fail( PopJson::Error_t::Syntax, [&]{	return "bad \\u escape: " + std::string(esc);	} );
 				}
 
 				long codepoint = strtol( std::string(esc).data(), nullptr, 16);
@@ -262,43 +1524,60 @@ struct JsonParser final
 			}
 
 			last_escaped_codepoint = -1;
-			//	will throw if not valid
-			auto EscapedChar = GetEscapedChar(ch);
+			if ( !IsEscapeChar(ch) )
+				fail( PopJson::Error_t::Syntax, [&]{	return "invalid escape character " + EscapeChar(ch);	} );
 		}
 	}
 
+	//	the current character, or 0 at the end of the input (which needn't be null terminated)
+	char peek() const
+	{
+		return i < str.size() ? str[i] : 0;
+	}
+
 	PopJson::Value_t parse_number(size_t WritePositionOffset)
 	{
 		size_t start_pos = i;
 
-		if (str[i] == '-')
+		if (peek() == '-')
 			i++;
 
 		//	Integer part
-		if (str[i] == '0')
+		bool HasIntegerPart = true;
+		if (peek() == '0')
 		{
 			i++;
-			if (in_range(str[i], '0', '9'))
-				throw std::runtime_error("leading 0s not permitted in numbers");
-			
+			if (in_range(peek(), '0', '9'))
+			{
+				if constexpr ( POLICY::StrictNumbers )
+					fail( PopJson::Error_t::Syntax, [&]{	return "leading 0s not permitted in numbers";	} );
+				while (in_range(peek(), '0', '9'))
+					i++;
+			}
 		}
-		else if (in_range(str[i], '1', '9'))
+		else if (in_range(peek(), '1', '9'))
 		{
 			i++;
-			while (in_range(str[i], '0', '9'))
+			while (in_range(peek(), '0', '9'))
 				i++;
 		}
+		else if ( !POLICY::StrictNumbers && peek() == '.' )
+		{
+			HasIntegerPart = false;
+		}
 		else
 		{
-			throw std::runtime_error("invalid " + EscapeChar(str[i]) + " in number");
+			fail( PopJson::Error_t::Syntax, [&]{	return "invalid " + EscapeChar(peek()) + " in number";	} );
 		}
 
-		bool IsDecimal = str[i] == '.';
+		bool IsDecimal = peek() == '.';
 		{
-			bool IsExponentChar = str[i] == 'e' || str[i] == 'E';
+			bool IsExponentChar = peek() == 'e' || peek() == 'E';
 			if ( !IsDecimal && !IsExponentChar && (i - start_pos) <= static_cast<size_t>(std::numeric_limits<int>::digits10))
 			{
 				PopJson::Value_t Value( PopJson::ValueType_t::NumberInteger, PopJson::Location_t(start_pos + WritePositionOffset, i-start_pos) );
+				if constexpr ( POLICY::DecodeNumbers )
+					decode_number( start_pos, true );
 				//return std::atoi(str.c_str() + start_pos);
 				return Value;
 			}
@@ -308,49 +1587,78 @@ struct JsonParser final
 		if ( IsDecimal )
 		{
 			i++;
-			if (!in_range(str[i], '0', '9'))
-				throw std::runtime_error("at least one digit required in fractional part");
+			if (!in_range(peek(), '0', '9'))
+			{
+				//	lenient numbers allow 5. but not a lone .
+				if ( POLICY::StrictNumbers || !HasIntegerPart )
+					fail( PopJson::Error_t::Syntax, [&]{	return "at least one digit required in fractional part";	} );
+			}
 
-			while (in_range(str[i], '0', '9'))
+			while (in_range(peek(), '0', '9'))
 				i++;
 		}
 
 		//	verify exponent part
-		if (str[i] == 'e' || str[i] == 'E')
+		bool IsExponent = peek() == 'e' || peek() == 'E';
+		if ( IsExponent )
 		{
 			i++;
 
-			if (str[i] == '+' || str[i] == '-')
+			if (peek() == '+' || peek() == '-')
 				i++;
 
-			if (!in_range(str[i], '0', '9'))
-				throw std::runtime_error("at least one digit required in exponent");
+			if (!in_range(peek(), '0', '9'))
+				fail( PopJson::Error_t::Syntax, [&]{	return "at least one digit required in exponent";	} );
 
-			while (in_range(str[i], '0', '9'))
+			while (in_range(peek(), '0', '9'))
 				i++;
 		}
 
 		PopJson::Value_t Value( PopJson::ValueType_t::NumberDouble, PopJson::Location_t(start_pos + WritePositionOffset, i-start_pos) );
+		if constexpr ( POLICY::DecodeNumbers )
+			decode_number( start_pos, !IsDecimal && !IsExponent );
 		//return std::strtod(str.c_str() + start_pos, nullptr);
 		return Value;
 	}
 
-    /* expect(str, res)
-     *
-     * Expect that 'str' starts at the character that was just read. If it does, advance
-     * the input and return res. If not, flag an error.
-     */
+	//	POLICY::DecodeNumbers; the number which was just scanned, from start_pos to i, into LastNumber.
+	//	Numbers which don't fit a double (1e999) are left undecoded, so reading them gives the usual error
+	void decode_number(size_t start_pos,bool IsIntegral)
+	{
+		auto* Start = str.data() + start_pos;
+		auto* End = str.data() + i;
+		if ( IsIntegral )
+		{
+			auto Result = std::from_chars( Start, End, LastNumber.mInteger );
+			if ( Result.ec == std::errc() )
+			{
+				LastNumber.mKind = PopJson::TapeNumber_t::Integer;
+				return;
+			}
+		}
+		auto Result = std::from_chars( Start, End, LastNumber.mDouble );
+		if ( Result.ec != std::errc() )
+			LastNumber.mKind = PopJson::TapeNumber_t::None;
+		else
+			LastNumber.mKind = IsIntegral ? PopJson::TapeNumber_t::LargeInteger : PopJson::TapeNumber_t::Double;
+	}
+
+    /* expect(str, res)
+     *
+     * Expect that 'str' starts at the character that was just read. If it does, advance
+     * the input and return res. If not, flag an error.
+     */
 	PopJson::Value_t expect(std::string_view expected,PopJson::ValueType_t::Type ResultType,size_t WritePositionOffset)
 	{
 		if ( i <= 0 )
-			throw std::runtime_error("Bad position");
+			fail( PopJson::Error_t::Syntax, [&]{	return "Bad position";	} );
 		
 		i--;
 		auto Slice = str.substr( i, expected.length() );
 		//if ( str.compare(i, expected.length(), expected) != 0)
 		if ( Slice != expected )
 		{
-			throw std::runtime_error("parse error: expected " + std::string(expected) + ", got " + std::string(Slice) );
+			fail( PopJson::Error_t::Syntax, [&]{	return "parse error: expected " + std::string(expected) + ", got " + std::string(Slice);	} );
 		}
 		
 		PopJson::Value_t Result( ResultType, PopJson::Location_t(i+WritePositionOffset, expected.length()) );
@@ -359,16 +1667,50 @@ struct JsonParser final
 	}
 
 
-	PopJson::Value_t parse_json(int depth,size_t WritePositionOffset)
+	bool is_number_start(char ch)
 	{
-		const bool IncludeStartAndEndTokensInValue = false;
-		
-		if (depth > max_depth)
-			throw std::runtime_error("exceeded maximum nesting depth");
+		if ( ch == '-' || (ch >= '0' && ch <= '9') )
+			return true;
+		return !POLICY::StrictNumbers && ch == '.';
+	}
+
+	void count_value(size_t depth,char ch)
+	{
+		if constexpr ( PopJson::Instrumentation::Enabled )
+		{
+			Stats.mNodeCount++;
+			Stats.mMaxDepth = std::max<uint64_t>( Stats.mMaxDepth, depth );
+			if ( ch == '"' )
+				Stats.mStringCount++;
+			if ( is_number_start(ch) )
+				Stats.mNumberCount++;
+		}
+	}
 
-		char ch = get_next_token();
+	//	any value other than an object or array. ch has just been read
+	PopJson::Value_t parse_scalar(char ch,size_t WritePositionOffset)
+	{
+		if constexpr ( POLICY::AllowNanAndInfinity )
+		{
+			auto ExpectNonFinite = [&](std::string_view Expected,double Number)
+			{
+				auto Value = expect( Expected, PopJson::ValueType_t::NumberDouble, WritePositionOffset );
+				if constexpr ( POLICY::DecodeNumbers )
+				{
+					LastNumber.mDouble = Number;
+					LastNumber.mKind = PopJson::TapeNumber_t::Double;
+				}
+				return Value;
+			};
+			if ( ch == 'N' )
+				return ExpectNonFinite("NaN", std::numeric_limits<double>::quiet_NaN() );
+			if ( ch == 'I' )
+				return ExpectNonFinite("Infinity", std::numeric_limits<double>::infinity() );
+			if ( ch == '-' && i < str.size() && str[i] == 'I' )
+				return ExpectNonFinite("-Infinity", -std::numeric_limits<double>::infinity() );
+		}
 
-		if (ch == '-' || (ch >= '0' && ch <= '9'))
+		if ( is_number_start(ch) )
 		{
 			i--;
 			return parse_number(WritePositionOffset);
@@ -386,226 +1728,1365 @@ struct JsonParser final
 		if (ch == '"')
 			return parse_string_faster(WritePositionOffset);
 
-		if (ch == '{')
+		fail( PopJson::Error_t::Syntax, [&]{	return "expected value, got " + EscapeChar(ch);	} );
+	}
+
+	//	DuplicateKeys_t::Reject; Key's location includes WritePositionOffset
+	void check_duplicate_key(KeySet_t& Keys,const PopJson::Value_t& Key,size_t WritePositionOffset)
+	{
+		if constexpr ( POLICY::DuplicateKeys == PopJson::DuplicateKeys_t::Reject )
 		{
-			auto StartPosition = i;
-			
+			auto& Position = Key.GetPosition();
+			auto Raw = str.substr( Position.mPosition - WritePositionOffset, Position.mLength );
+			if ( !Keys.insert(Raw).second )
+				fail( PopJson::Error_t::DuplicateKey, [&]{	return "duplicate key \"" + std::string(Raw) + "\" in object";	} );
+		}
+	}
+
+	//	an open container on the explicit stack
+	class Frame_t
+	{
+	public:
+		bool					mIsObject = false;
+		size_t					mStart = 0;		//	after the opening bracket
+		PopJson::Location_t		mKey;			//	if the parent is an object
+		PopJson::NodeIndex_t	mNode = PopJson::InvalidNodeIndex;	//	from BUILDER::Open
+		KeySet_t				mKeys;
+	};
+
+	//	iterative; containers are pushed onto Stack (which is reused as it grows) rather than
+	//	recursing, so depth is only limited by POLICY::MaxDepth, not the native stack.
+	//	BUILDER receives every value (see MapBuilder_t); positions include WritePositionOffset
+	template<typename BUILDER>
+	void parse_values(BUILDER& Builder,size_t WritePositionOffset)
+	{
+		//	typical documents never grow this
+		Stack.clear();
+		Stack.reserve( 32 );
+		PopJson::Location_t Key;
+		auto GetParent = [&]()	{	return Stack.empty() ? PopJson::InvalidNodeIndex : Stack.back().mNode;	};
+
+		//	read a key and its : ch has just been read
+		auto ParseKey = [&](char ch,Frame_t& Frame)
+		{
+			if (ch != '"')
+				fail( PopJson::Error_t::Syntax, [&]{	return "expected '\"' in object, got " + EscapeChar(ch);	} );
+
+			auto KeyValue = parse_string_faster(WritePositionOffset);
+			if constexpr ( PopJson::Instrumentation::Enabled )
+				Stats.mStringCount++;
+			check_duplicate_key( Frame.mKeys, KeyValue, WritePositionOffset );
+
 			ch = get_next_token();
-			
-			std::vector<PopJson::Node_t> Nodes;
-			if (ch != '}')
+			if (ch != ':')
+				fail( PopJson::Error_t::Syntax, [&]{	return "expected ':' in object, got " + EscapeChar(ch);	} );
+			return KeyValue.GetPosition();
+		};
+
+		auto Close = [&]()
+		{
+			auto& Frame = Stack.back();
+			PopJson::Location_t Value( Frame.mStart+WritePositionOffset, i-Frame.mStart-1 );
+			Stack.pop_back();
+			Builder.Close( Stack.size(), Frame, Value );
+		};
+
+		while ( true )
+		{
+			//	a value, at the depth of the stack
+			char ch = get_next_token();
+			count_value( Stack.size(), ch );
+
+			if ( skip_unprojected( Builder, ch, Key ) )
+			{
+			}
+			else if ( ch == '{' || ch == '[' )
+			{
+				if ( Stack.size() >= POLICY::MaxDepth )
+					fail( PopJson::Error_t::TooDeep, [&]{	return "exceeded maximum nesting depth";	} );
+
+				bool IsObject = ch == '{';
+				auto Type = IsObject ? PopJson::ValueType_t::Object : PopJson::ValueType_t::Array;
+				auto Node = Builder.Open( Stack.size(), GetParent(), Key, PopJson::Location_t(i+WritePositionOffset,0), Type );
+				auto& Frame = Stack.emplace_back();
+				Frame.mIsObject = IsObject;
+				Frame.mStart = i;
+				Frame.mKey = Key;
+				Frame.mNode = Node;
+
+				ch = get_next_token();
+				if ( ch != (IsObject ? '}' : ']') )
+				{
+					//	first child
+					if ( IsObject )
+					{
+						Key = ParseKey( ch, Frame );
+					}
+					else
+					{
+						i--;
+						Key = PopJson::Location_t();
+					}
+					continue;
+				}
+				Close();
+			}
+			else
+			{
+				auto Value = parse_scalar( ch, WritePositionOffset );
+				Builder.Scalar( Stack.size(), GetParent(), Key, Value );
+			}
+
+			//	close containers until one continues with another element
+			while ( !Stack.empty() )
 			{
-				while (1)
+				auto& Frame = Stack.back();
+				auto CloseChar = Frame.mIsObject ? '}' : ']';
+				ch = get_next_token();
+				if ( ch == CloseChar )
+				{
+					Close();
+					continue;
+				}
+				if ( ch != ',' )
+					fail( PopJson::Error_t::Syntax, [&]{	return "expected ',' in " + std::string(Frame.mIsObject ? "object" : "list") + ", got " + EscapeChar(ch);	} );
+
+				ch = get_next_token();
+				if constexpr ( POLICY::AllowTrailingCommas )
 				{
-					if (ch != '"')
-						throw std::runtime_error("expected '\"' in object, got " + EscapeChar(ch));
-					
-					auto Key = parse_string_faster(WritePositionOffset);
-					
-					ch = get_next_token();
-					if (ch != ':')
-						throw std::runtime_error("expected ':' in object, got " + EscapeChar(ch));
-					
-					auto Value = parse_json( depth + 1, WritePositionOffset );
-					
-					Nodes.push_back( PopJson::Node_t( Key, Value ) );
-					
-					ch = get_next_token();
-					if (ch == '}')
-						break;
-					if (ch != ',')
-						throw std::runtime_error("expected ',' in object, got " + EscapeChar(ch));
-					
-					ch = get_next_token();
+					if ( ch == CloseChar )
+					{
+						Close();
+						continue;
+					}
 				}
+				break;
+			}
+			if ( Stack.empty() )
+				return;
+
+			//	next element of the open container
+			auto& Frame = Stack.back();
+			if ( Frame.mIsObject )
+			{
+				Key = ParseKey( ch, Frame );
+			}
+			else
+			{
+				i--;
+				Key = PopJson::Location_t();
 			}
+		}
+	}
 
-			auto ValueStart = StartPosition;
-			auto ValueLength = i-StartPosition-1;
-			if ( ValueStart + ValueLength > str.size() )
-				std::cerr << "Read oob" << std::endl;
-			auto ValueRaw = str.substr( ValueStart, ValueLength );
-			PopJson::Value_t Object( PopJson::ValueType_t::Object, PopJson::Location_t(ValueStart+WritePositionOffset, ValueLength) );
-			Object.mNodes = std::move(Nodes);
-			return Object;
+	//	BUILDER::Projects; skip the value (ch has just been read) if the builder doesn't want it
+	template<typename BUILDER>
+	bool skip_unprojected(BUILDER& Builder,char ch,PopJson::Location_t Key)
+	{
+		if constexpr ( BUILDER::Projects )
+		{
+			if ( Builder.IsWanted( Stack.size(), Key ) )
+				return false;
+			skip_value( ch );
+			return true;
 		}
+		return false;
+	}
 
-		if (ch == '[')
+	//	find the end of a value (ch has just been read) without parsing it; strings are only scanned
+	//	for their closing quote, and containers for their closing bracket outside of strings
+	void skip_value(char ch)
+	{
+		static_assert( !POLICY::AllowComments, "Skipped values are bracket matched, so can't contain comments" );
+		if ( ch == '"' )
 		{
-			auto StartPosition = i;
-			
-			ch = get_next_token();
-			if (ch == ']')
+			skip_string();
+			return;
+		}
+		if ( ch == '{' || ch == '[' )
+		{
+			size_t Depth = 1;
+			while ( Depth > 0 )
 			{
-				//	location of array value should not include []
-				auto Start = StartPosition;	//	after [
-				auto Length = i - StartPosition - 1;
-				PopJson::Location_t Location( Start, Length );
-				PopJson::Location_t LocationWithOffset( Start+WritePositionOffset, Length );
-				PopJson::Value_t Array( PopJson::ValueType_t::Array, LocationWithOffset );
-				auto Contents = Location.GetContents( this->str );
-				return Array;
+				i += PopJson::Scan::FindQuoteOrBracket( str.data()+i, str.size()-i );
+				if ( i == str.size() )
+					fail( PopJson::Error_t::Syntax, [&]{	return "unexpected end of input in " + std::string( ch == '{' ? "object" : "list" );	} );
+				auto Char = str[i++];
+				if ( Char == '"' )
+					skip_string();
+				else if ( Char == '{' || Char == '[' )
+					Depth++;
+				else
+					Depth--;
 			}
+			return;
+		}
+		if ( PopJson::Scan::IsStructural(ch) )
+			fail( PopJson::Error_t::Syntax, [&]{	return "expected value, got " + EscapeChar(ch);	} );
+		i += PopJson::Scan::FindTokenEnd( str.data()+i, str.size()-i );
+	}
+
+	//	after the opening quote
+	void skip_string()
+	{
+		while ( true )
+		{
+			i += PopJson::Scan::FindStringSpecial( str.data()+i, str.size()-i );
+			if ( i == str.size() )
+				fail( PopJson::Error_t::Syntax, [&]{	return "unexpected end of input in string";	} );
+			auto Char = str[i++];
+			if ( Char == '"' )
+				return;
+			if ( Char == '\\' )
+				i = std::min( i+1, str.size() );
+		}
+	}
 
-			std::vector<PopJson::Node_t> Nodes;
-			while ( true )
+	//	writes every value into a flat map
+	class MapBuilder_t
+	{
+	public:
+		static constexpr bool	Projects = false;
+
+		PopJson::NodeIndex_t	Open(size_t /*Depth*/,PopJson::NodeIndex_t Parent,PopJson::Location_t Key,PopJson::Location_t Value,PopJson::ValueType_t::Type Type)
+		{
+			return mMap.AddNode( Parent, Key, Value, Type );
+		}
+		void	Close(size_t /*Depth*/,const Frame_t& Frame,PopJson::Location_t Value)
+		{
+			mMap.FinishNode( Frame.mNode, Value );
+		}
+		void	Scalar(size_t /*Depth*/,PopJson::NodeIndex_t Parent,PopJson::Location_t Key,const PopJson::Value_t& Value)
+		{
+			auto Node = mMap.AddNode( Parent, Key, Value.GetPosition(), Value.GetType() );
+			if constexpr ( POLICY::DecodeNumbers )
 			{
-				i--;
+				auto Type = Value.GetType();
+				if ( Type == PopJson::ValueType_t::NumberInteger || Type == PopJson::ValueType_t::NumberDouble )
+					mMap.SetTapeNumber( Node, mLastNumber );
+			}
+		}
 
-				auto Value = parse_json(depth + 1, WritePositionOffset);
-				
-				PopJson::Node_t Node(Value);
-				Nodes.push_back(Node);
+		PopJson::Map_t&					mMap;
+		const PopJson::TapeNumber_t&	mLastNumber;
+	};
 
-				ch = get_next_token();
-				if (ch == ']')
-					break;
-				if (ch != ',')
-					throw std::runtime_error("expected ',' in list, got " + EscapeChar(ch));
+	//	a map of only the values a projection leads to. The step of each open container is kept by
+	//	depth, and every value is checked against its parent's step before it's parsed
+	class ProjectedMapBuilder_t : public MapBuilder_t
+	{
+	public:
+		static constexpr bool	Projects = true;
 
-				ch = get_next_token();
+		ProjectedMapBuilder_t(PopJson::Map_t& Map,const PopJson::TapeNumber_t& LastNumber,const PopJson::Projection_t& Projection,std::string_view Json) :
+			MapBuilder_t	{ Map, LastNumber },
+			mProjection		( Projection ),
+			mJson			( Json )
+		{
+		}
+
+		bool	IsWanted(size_t Depth,PopJson::Location_t Key)
+		{
+			if ( Depth == 0 )
+			{
+				mValueStep = PopJson::Projection_t::RootStep;
+				return true;
 			}
-			
-			auto ValueStart = StartPosition;
-			auto ValueLength = i-StartPosition-1;
-			auto ValueRaw = str.substr( ValueStart, ValueLength );
-			
-			PopJson::Value_t Array( PopJson::ValueType_t::Array, PopJson::Location_t(ValueStart+WritePositionOffset, ValueLength) );
-			Array.mNodes = std::move(Nodes);
-			return Array;
+			auto& Parent = mContainers[Depth-1];
+			if ( Parent.mIsObject )
+				mValueStep = mProjection.GetMemberStep( Parent.mStep, Key.GetContents(mJson), mJson.data() + mJson.size() );
+			else
+				mValueStep = mProjection.GetElementStep( Parent.mStep, Parent.mElementCount++ );
+			return mValueStep != PopJson::Projection_t::InvalidStep;
+		}
+
+		PopJson::NodeIndex_t	Open(size_t Depth,PopJson::NodeIndex_t Parent,PopJson::Location_t Key,PopJson::Location_t Value,PopJson::ValueType_t::Type Type)
+		{
+			if ( mContainers.size() <= Depth )
+				mContainers.resize( Depth+1 );
+			auto& Container = mContainers[Depth];
+			Container.mStep = mValueStep;
+			Container.mIsObject = Type == PopJson::ValueType_t::Object;
+			Container.mElementCount = 0;
+			return MapBuilder_t::Open( Depth, Parent, Key, Value, Type );
+		}
+
+	private:
+		class Container_t
+		{
+		public:
+			uint32_t	mStep = PopJson::Projection_t::InvalidStep;
+			bool		mIsObject = false;
+			size_t		mElementCount = 0;
+		};
+
+		const PopJson::Projection_t&	mProjection;
+		std::string_view				mJson;
+		uint32_t						mValueStep = PopJson::Projection_t::InvalidStep;	//	of the value being parsed
+		std::vector<Container_t>		mContainers;	//	open containers, by depth
+	};
+
+	//	a Value_t only keeps its direct children (deeper values are re-parsed on access), so
+	//	anything below depth 1 is only validated
+	class ValueBuilder_t
+	{
+	public:
+		static constexpr bool	Projects = false;
+
+		PopJson::NodeIndex_t	Open(size_t Depth,PopJson::NodeIndex_t /*Parent*/,PopJson::Location_t /*Key*/,PopJson::Location_t Value,PopJson::ValueType_t::Type Type)
+		{
+			if ( Depth == 0 )
+				mRoot = PopJson::Value_t( Type, Value );
+			return PopJson::InvalidNodeIndex;
+		}
+		void	Close(size_t Depth,const Frame_t& Frame,PopJson::Location_t Value)
+		{
+			if ( Depth == 0 )
+			{
+				auto Children = std::move(mRoot.mNodes);
+				mRoot = PopJson::Value_t( mRoot.GetType(), Value );
+				mRoot.mNodes = std::move(Children);
+			}
+			else if ( Depth == 1 )
+				AddChild( Frame.mKey, Value, Frame.mIsObject ? PopJson::ValueType_t::Object : PopJson::ValueType_t::Array );
+		}
+		void	Scalar(size_t Depth,PopJson::NodeIndex_t /*Parent*/,PopJson::Location_t Key,const PopJson::Value_t& Value)
+		{
+			if ( Depth == 0 )
+				mRoot = Value;
+			else if ( Depth == 1 )
+				AddChild( Key, Value.GetPosition(), Value.GetType() );
+		}
+
+		PopJson::Value_t	mRoot;
+
+	private:
+		void	AddChild(PopJson::Location_t Key,PopJson::Location_t Value,PopJson::ValueType_t::Type Type)
+		{
+			if constexpr ( PopJson::Instrumentation::Enabled )
+				if ( mRoot.mNodes.size() == mRoot.mNodes.capacity() )
+					POPJSON_COUNT(AllocationSite);
+			auto& Node = mRoot.mNodes.emplace_back();
+			Node.mKeyPosition = Key;
+			Node.mValuePosition = Value;
+			Node.mValueType = Type;
 		}
+	};
+
+	PopJson::Value_t parse_json(size_t WritePositionOffset)
+	{
+		ValueBuilder_t Builder;
+		parse_values( Builder, WritePositionOffset );
+		consume_end();
+		return std::move(Builder.mRoot);
+	}
+
+	void parse_json_map(PopJson::Map_t& Map)
+	{
+		MapBuilder_t Builder{ Map, LastNumber };
+		parse_values( Builder, 0 );
+		consume_end();
+	}
 
-		throw std::runtime_error("expected value, got " + EscapeChar(ch));
+	void parse_json_map(PopJson::Map_t& Map,const PopJson::Projection_t& Projection)
+	{
+		ProjectedMapBuilder_t Builder( Map, LastNumber, Projection, str );
+		parse_values( Builder, 0 );
+		consume_end();
 	}
+
+	std::vector<Frame_t>	Stack;
 };
 
 
-PopJson::Value_t::Value_t(std::string_view Json,size_t WritePositionOffset)
+template<typename POLICY>
+static PopJson::Map_t ParseMap(std::string_view Json,bool ErrorMessages)
 {
-	bool AllowComments = false;
-	JsonParser parser( Json, AllowComments );
-	auto Root = parser.parse_json( 0, WritePositionOffset );
-	*this = Root;
-}
+	POPJSON_PHASE(Parse);
+	JsonParser<POLICY> parser( Json, ErrorMessages );
+	PopJson::Map_t Map;
+	parser.parse_json_map( Map );
 
-std::string PopJson::Value_t::GetString(std::string_view JsonData)
-{
-	auto EscapedString = GetRawString(JsonData);
-	if ( mType == ValueType_t::String )
+#if POPJSON_INSTRUMENTATION
+	if ( PopJsonPhase.IsOutermost() )
 	{
-		auto DecodedString = UnescapeString( EscapedString );
-		return DecodedString;
+		parser.Stats.mBytes = Json.size();
+		PopJson::Instrumentation::OnDocumentParsed( parser.Stats );
 	}
-	//	probably shouldnt be returning a string at all here
-	return std::string(EscapedString);
+#endif
+	return Map;
 }
 
-std::string_view PopJson::Value_t::GetString(std::string& Buffer,std::string_view JsonData)
+template<typename POLICY>
+PopJson::Map_t PopJson::Parse(std::string_view Json)
 {
-	auto EscapedString = GetRawString(JsonData);
-	//	todo: decode escaped
-	return EscapedString;
+	return ParseMap<POLICY>( Json, true );
 }
 
-void PopJson::Value_t::GetArray(std::vector<std::string>& OutputValues,std::string_view JsonData)
+template<typename POLICY>
+PopJson::Map_t PopJson::Parse(std::string_view Json,const Projection_t& Projection)
 {
-	//	throw if not an array?
-	//if ( this->GetType() != Value)
-	for ( auto& Child : mNodes )
+	POPJSON_PHASE(Parse);
+	JsonParser<POLICY> parser( Json, true );
+	Map_t Map;
+	parser.parse_json_map( Map, Projection );
+	return Map;
+}
+
+template<typename POLICY>
+PopJson::Result_t<PopJson::Map_t> PopJson::TryParse(std::string_view Json)
+{
+	try
 	{
-		auto Value = Child.GetValue(JsonData);
-		auto ValueString = Value.GetString(JsonData);
-		OutputValues.push_back(ValueString);
+		return ParseMap<POLICY>( Json, false );
+	}
+	catch(ParseFailed_t& Error)
+	{
+		return Result_t<Map_t>( Error.mError, Error.mPosition );
 	}
 }
 
-int PopJson::Value_t::GetInteger(std::string_view JsonData)
+template PopJson::Map_t PopJson::Parse<PopJson::StrictPolicy_t>(std::string_view Json);
+template PopJson::Map_t PopJson::Parse<PopJson::JsoncPolicy_t>(std::string_view Json);
+template PopJson::Map_t PopJson::Parse<PopJson::UniqueKeysPolicy_t>(std::string_view Json);
+template PopJson::Map_t PopJson::Parse<PopJson::Utf8Policy_t>(std::string_view Json);
+template PopJson::Map_t PopJson::Parse<PopJson::NumberTapePolicy_t>(std::string_view Json);
+template PopJson::Map_t PopJson::Parse<PopJson::StrictPolicy_t>(std::string_view Json,const Projection_t& Projection);
+template PopJson::Map_t PopJson::Parse<PopJson::UniqueKeysPolicy_t>(std::string_view Json,const Projection_t& Projection);
+template PopJson::Map_t PopJson::Parse<PopJson::Utf8Policy_t>(std::string_view Json,const Projection_t& Projection);
+template PopJson::Map_t PopJson::Parse<PopJson::NumberTapePolicy_t>(std::string_view Json,const Projection_t& Projection);
+template PopJson::Result_t<PopJson::Map_t> PopJson::TryParse<PopJson::StrictPolicy_t>(std::string_view Json);
+template PopJson::Result_t<PopJson::Map_t> PopJson::TryParse<PopJson::JsoncPolicy_t>(std::string_view Json);
+template PopJson::Result_t<PopJson::Map_t> PopJson::TryParse<PopJson::UniqueKeysPolicy_t>(std::string_view Json);
+template PopJson::Result_t<PopJson::Map_t> PopJson::TryParse<PopJson::Utf8Policy_t>(std::string_view Json);
+template PopJson::Result_t<PopJson::Map_t> PopJson::TryParse<PopJson::NumberTapePolicy_t>(std::string_view Json);
+
+const char* PopJson::GetErrorString(Error_t::Type Error)
 {
-	auto ValueString = GetRawString( JsonData );
+	switch ( Error )
+	{
+		case Error_t::None:				return "No error";
+		case Error_t::MissingKey:		return "Missing key";
+		case Error_t::IndexOutOfRange:	return "Index out of range";
+		case Error_t::WrongType:		return "Wrong type";
+		case Error_t::InvalidNumber:	return "Number doesn't fit in type";
+		case Error_t::Syntax:			return "Syntax error";
+		case Error_t::InvalidUtf8:		return "Invalid utf-8";
+		case Error_t::TooDeep:			return "Exceeded maximum nesting depth";
+		case Error_t::DuplicateKey:		return "Duplicate key";
+	}
+	return "Unknown error";
+}
 
-	if ( mType != PopJson::ValueType_t::NumberInteger )
-		throw std::runtime_error("todo: conversion of value to integer");
-	
-	int Value = 0;
-	auto result = std::from_chars( ValueString.data(), ValueString.data() + ValueString.size(), Value );
-	if ( result.ec == std::errc::invalid_argument || result.ec == std::errc::result_out_of_range )
-		throw std::runtime_error("Failed to convert" + std::string(ValueString) + " to int");
+//	xxhash64-style; 4 lanes over 32 byte stripes, then tail
+uint64_t PopJson::Hash64(const void* Data,size_t Length,uint64_t Seed)
+{
+	constexpr uint64_t Prime1 = 11400714785074694791ull;
+	constexpr uint64_t Prime2 = 14029467366897019727ull;
+	constexpr uint64_t Prime3 = 1609587929392839161ull;
+	constexpr uint64_t Prime4 = 9650029242287828579ull;
+	constexpr uint64_t Prime5 = 2870177450012600261ull;
+	auto Rotate = [](uint64_t Value,int Bits)	{	return (Value << Bits) | (Value >> (64-Bits));	};
+	auto Read64 = [](const uint8_t* p)	{	uint64_t v;	std::memcpy( &v, p, 8 );	return v;	};
+	auto Read32 = [](const uint8_t* p)	{	uint32_t v;	std::memcpy( &v, p, 4 );	return v;	};
+	auto Round = [&](uint64_t Acc,uint64_t Input)
+	{
+		Acc += Input * Prime2;
+		Acc = Rotate( Acc, 31 );
+		return Acc * Prime1;
+	};
+	auto Merge = [&](uint64_t Acc,uint64_t Value)
+	{
+		Acc ^= Round( 0, Value );
+		return Acc * Prime1 + Prime4;
+	};
 
-	return Value;
+	auto* p = static_cast<const uint8_t*>(Data);
+	auto* End = p + Length;
+	uint64_t Hash;
+	if ( Length >= 32 )
+	{
+		uint64_t v1 = Seed + Prime1 + Prime2;
+		uint64_t v2 = Seed + Prime2;
+		uint64_t v3 = Seed;
+		uint64_t v4 = Seed - Prime1;
+		do
+		{
+			v1 = Round( v1, Read64(p) );
+			v2 = Round( v2, Read64(p+8) );
+			v3 = Round( v3, Read64(p+16) );
+			v4 = Round( v4, Read64(p+24) );
+			p += 32;
+		}
+		while ( p + 32 <= End );
+		Hash = Rotate(v1,1) + Rotate(v2,7) + Rotate(v3,12) + Rotate(v4,18);
+		Hash = Merge( Hash, v1 );
+		Hash = Merge( Hash, v2 );
+		Hash = Merge( Hash, v3 );
+		Hash = Merge( Hash, v4 );
+	}
+	else
+	{
+		Hash = Seed + Prime5;
+	}
+	Hash += Length;
+
+	for ( ;	p + 8 <= End;	p += 8 )
+	{
+		Hash ^= Round( 0, Read64(p) );
+		Hash = Rotate( Hash, 27 ) * Prime1 + Prime4;
+	}
+	if ( p + 4 <= End )
+	{
+		Hash ^= Read32(p) * Prime1;
+		Hash = Rotate( Hash, 23 ) * Prime2 + Prime3;
+		p += 4;
+	}
+	for ( ;	p < End;	p++ )
+	{
+		Hash ^= (*p) * Prime5;
+		Hash = Rotate( Hash, 11 ) * Prime1;
+	}
+
+	Hash ^= Hash >> 33;
+	Hash *= Prime2;
+	Hash ^= Hash >> 29;
+	Hash *= Prime3;
+	Hash ^= Hash >> 32;
+	return Hash;
 }
 
-bool PopJson::Value_t::GetBool()
+
+PopJson::Value_t PopJson::MapNode_t::GetValue() const
 {
-	if ( mType == PopJson::ValueType_t::BooleanTrue )
-		return true;
-	if ( mType == PopJson::ValueType_t::BooleanFalse )
-		return false;
-	
-	throw std::runtime_error("todo: conversion of value to bool");
+	return Value_t( mValueType, mValuePosition );
 }
 
+PopJson::Result_t<PopJson::SliceReadOnly_t> PopJson::SliceReadOnly_t::TryGetValue(std::string_view Key) const
+{
+	auto Child = mMap->FindChild( mNode, Key, mStorage );
+	if ( Child == InvalidNodeIndex )
+		return Error_t::MissingKey;
+	return SliceReadOnly_t( *mMap, mStorage, Child );
+}
 
+PopJson::Result_t<PopJson::SliceReadOnly_t> PopJson::SliceReadOnly_t::TryGetValue(size_t Index) const
+{
+	auto Child = mMap->FindChild( mNode, Index );
+	if ( Child == InvalidNodeIndex )
+		return Error_t::IndexOutOfRange;
+	return SliceReadOnly_t( *mMap, mStorage, Child );
+}
 
-PopJson::Value_t PopJson::Value_t::GetValue(std::string_view Key,std::string_view JsonData)
+size_t PopJson::SliceReadOnly_t::GetValues(const KeySet_t& Keys,std::span<SliceReadOnly_t> Values) const
 {
-	for ( auto& Child : mNodes )
+	if ( Values.size() < Keys.size() )
+		throw std::runtime_error("GetValues output has " + std::to_string(Values.size()) + " entries for " + std::to_string(Keys.size()) + " keys");
+
+	//	the map writes node indexes; usual key sets fit on the stack
+	NodeIndex_t FewChildren[32];
+	std::vector<NodeIndex_t> ManyChildren;
+	std::span<NodeIndex_t> Children;
+	if ( Keys.size() <= std::size(FewChildren) )
 	{
-		auto ChildKey = Child.GetKey(JsonData);
-		if ( ChildKey == Key )
-			return Child.GetValue(JsonData);
+		Children = std::span( FewChildren, Keys.size() );
 	}
-	//	throw or undefined?
-	//return Value_t( PopJson::ValueType_t::Undefined, 0, 0 );
-	throw std::runtime_error("No key named " + std::string(Key));
+	else
+	{
+		ManyChildren.resize( Keys.size() );
+		Children = ManyChildren;
+	}
+
+	auto Found = mMap->FindChildren( mNode, Keys, mStorage, Children );
+	for ( size_t k=0;	k<Keys.size();	k++ )
+		Values[k] = Children[k] == InvalidNodeIndex ? SliceReadOnly_t() : SliceReadOnly_t( *mMap, mStorage, Children[k] );
+	return Found;
 }
 
+PopJson::Result_t<int> PopJson::SliceReadOnly_t::TryGetInteger() const
+{
+	auto* Number = mMap->GetTapeNumber( mNode );
+	if ( !Number )
+		return GetNode().GetValue().TryGetInteger( mStorage );
+
+	if ( Number->mKind == TapeNumber_t::Double )
+		return Error_t::WrongType;
+	if ( Number->mKind == TapeNumber_t::LargeInteger || Number->mInteger < std::numeric_limits<int>::min() || Number->mInteger > std::numeric_limits<int>::max() )
+		return Error_t::InvalidNumber;
+	return static_cast<int>( Number->mInteger );
+}
 
-PopJson::Value_t PopJson::Value_t::GetValue(size_t Index,std::string_view JsonData)
+PopJson::Result_t<int64_t> PopJson::SliceReadOnly_t::TryGetInteger64() const
 {
-	//	gr: should this throw if keys are named? make this only work for arrays?
-	if ( Index >= mNodes.size() )
+	if ( auto* Number = mMap->GetTapeNumber( mNode ) )
 	{
-		std::stringstream Error;
-		Error << "Key " << Index << "/" << mNodes.size() << " out of range";
-		throw std::runtime_error( Error.str() );
+		if ( Number->mKind == TapeNumber_t::Double )
+			return Error_t::WrongType;
+		if ( Number->mKind == TapeNumber_t::LargeInteger )
+			return Error_t::InvalidNumber;
+		return Number->mInteger;
 	}
 
-	auto& Child = mNodes[Index];
-	return Child.GetValue(JsonData);
+	//	same rules as Value_t::TryGetInteger; long integers are typed as doubles
+	auto Type = GetType();
+	auto ValueString = GetRawValue();
+	bool IsInteger = Type == ValueType_t::NumberInteger;
+	if ( Type == ValueType_t::NumberDouble )
+		IsInteger = ValueString.find_first_of(".eE") == std::string_view::npos;
+	if ( !IsInteger )
+		return Error_t::WrongType;
+
+	int64_t Value = 0;
+	auto Result = std::from_chars( ValueString.data(), ValueString.data() + ValueString.size(), Value );
+	if ( Result.ec == std::errc::invalid_argument || Result.ec == std::errc::result_out_of_range )
+		return Error_t::InvalidNumber;
+	return Value;
 }
 
+PopJson::Result_t<double> PopJson::SliceReadOnly_t::TryGetDouble() const
+{
+	if ( auto* Number = mMap->GetTapeNumber( mNode ) )
+		return Number->GetDouble();
+	return GetNode().GetValue().TryGetDouble( mStorage );
+}
 
+PopJson::Result_t<bool> PopJson::SliceReadOnly_t::TryGetBool() const
+{
+	return GetNode().GetValue().TryGetBool();
+}
 
-bool PopJson::Value_t::GetNode(std::string_view Key,std::string_view JsonData,std::function<void(Node_t&)> OnLockedNode)
+PopJson::Result_t<std::string> PopJson::SliceReadOnly_t::TryGetString() const
 {
-	for ( auto& Child : mNodes )
-	{
-		auto ChildKey = Child.GetKey(JsonData);
-		if ( ChildKey != Key )
-			continue;
-		if ( OnLockedNode )
-			OnLockedNode( Child );
-		return true;
-	}
-	return false;
+	return GetNode().GetValue().TryGetString( mStorage );
 }
 
+PopJson::NodeIndex_t PopJson::Map_t::AddNode(NodeIndex_t Parent,Location_t Key,Location_t Value,ValueType_t::Type Type)
+{
+	if ( mFlatTree.size() >= InvalidNodeIndex )
+		throw std::runtime_error("Too many nodes in json map");
+	if ( !mMappedTree.empty() )
+		throw std::runtime_error("Cannot add nodes to a map of external data");
+
+	NodeIndex_t Index = static_cast<NodeIndex_t>( mFlatTree.size() );
+	MapNode_t Node;
+	Node.mParent = Parent;
+	Node.mKeyPosition = Key;
+	Node.mValuePosition = Value;
+	Node.mValueType = Type;
+	mFlatTree.push_back( Node );
+
+	if ( Parent != InvalidNodeIndex )
+		mFlatTree[Parent].mChildCount++;
+	return Index;
+}
 
+void PopJson::Map_t::SetTapeNumber(NodeIndex_t Index,const TapeNumber_t& Number)
+{
+	//	the tape only extends to the last number, nodes after it have no entry
+	if ( Index >= mNumberTape.size() )
+		mNumberTape.resize( Index+1 );
+	mNumberTape[Index] = Number;
+}
 
-PopJson::Node_t::Node_t(Value_t Key,Value_t Value) :
-	mValuePosition	( Value.mPosition ),
-	mValueType		( Value.mType ),
-	mKeyPosition	( Key.mPosition )
+void PopJson::Map_t::FinishNode(NodeIndex_t Index,Location_t Value)
 {
+	//	nodes are added depth first, so everything after this container is a descendant
+	auto& Node = mFlatTree[Index];
+	Node.mValuePosition = Value;
+	Node.mDescendantCount = static_cast<NodeIndex_t>( mFlatTree.size() - Index - 1 );
 }
 
-PopJson::Node_t::Node_t(Value_t Value) :
-	mValuePosition	( Value.mPosition ),
-	mValueType		( Value.mType )
+PopJson::NodeIndex_t PopJson::Map_t::GetNextSibling(NodeIndex_t Index) const
 {
+	auto Nodes = GetNodes();
+	auto& Node = Nodes[Index];
+	size_t Next = Index + 1 + Node.mDescendantCount;
+	if ( Next >= Nodes.size() || Nodes[Next].mParent != Node.mParent )
+		return InvalidNodeIndex;
+	return static_cast<NodeIndex_t>(Next);
 }
-	
-PopJson::Value_t PopJson::Node_t::GetValue(std::string_view JsonData)
+
+uint64_t PopJson::Map_t::GetKeyHash(NodeIndex_t Parent,std::string_view Key)
+{
+	return Hash64( Key.data(), Key.size(), Parent );
+}
+
+PopJson::NodeIndex_t PopJson::Map_t::FindChild(NodeIndex_t Parent,std::string_view Key,std::string_view Storage) const
+{
+	auto Nodes = GetNodes();
+	auto& ParentNode = Nodes[Parent];
+	auto KeyIndex = GetKeyIndex();
+	if ( !KeyIndex.empty() && ParentNode.mChildCount >= mKeyIndexMinChildren )
+	{
+		auto Mask = KeyIndex.size()-1;
+		for ( auto Slot = GetKeyHash( Parent, Key ) & Mask;	KeyIndex[Slot] != InvalidNodeIndex;	Slot = (Slot+1) & Mask )
+		{
+			auto& Child = Nodes[KeyIndex[Slot]];
+			if ( Child.mParent == Parent && Child.GetKey(Storage) == Key )
+				return KeyIndex[Slot];
+		}
+		return InvalidNodeIndex;
+	}
+
+	for ( auto Child = GetFirstChild(Parent);	Child != InvalidNodeIndex;	Child = GetNextSibling(Child) )
+	{
+		if ( Nodes[Child].GetKey(Storage) == Key )
+			return Child;
+	}
+	return InvalidNodeIndex;
+}
+
+PopJson::NodeIndex_t PopJson::Map_t::FindChild(NodeIndex_t Parent,size_t ChildIndex) const
+{
+	auto Nodes = GetNodes();
+	if ( ChildIndex >= Nodes[Parent].mChildCount )
+		return InvalidNodeIndex;
+
+	auto Child = GetFirstChild(Parent);
+	for ( size_t i=0;	i<ChildIndex;	i++ )
+		Child += 1 + Nodes[Child].mDescendantCount;
+	return Child;
+}
+
+PopJson::Projection_t::Projection_t(std::span<const std::string_view> Pointers)
+{
+	std::vector<std::vector<std::string>> Paths;
+	for ( auto Pointer : Pointers )
+	{
+		auto& Path = Paths.emplace_back();
+		while ( !Pointer.empty() )
+		{
+			auto [Token,ChildPointer] = Json_t::SplitPointer( Pointer );
+			Path.push_back( Token );
+			Pointer = ChildPointer;
+		}
+	}
+	AddStep( Paths, 0 );
+}
+
+uint32_t PopJson::Projection_t::AddStep(std::span<const std::vector<std::string>> Paths,size_t Depth)
+{
+	auto Index = static_cast<uint32_t>( mSteps.size() );
+	mSteps.emplace_back();
+	for ( auto& Path : Paths )
+	{
+		if ( Path.size() == Depth )
+		{
+			mSteps[Index].mWholeValue = true;
+			return Index;
+		}
+	}
+
+	//	a key's paths include the wildcard's, so a member with its own step still gets everything * leads to
+	std::vector<std::string_view> Keys;
+	std::vector<std::vector<std::string>> WildcardPaths;
+	for ( auto& Path : Paths )
+	{
+		if ( Path[Depth] == "*" )
+			WildcardPaths.push_back( Path );
+		else if ( std::find( Keys.begin(), Keys.end(), Path[Depth] ) == Keys.end() )
+			Keys.push_back( Path[Depth] );
+	}
+
+	std::vector<uint32_t> KeySteps;
+	for ( auto Key : Keys )
+	{
+		std::vector<std::vector<std::string>> KeyPaths;
+		for ( auto& Path : Paths )
+			if ( Path[Depth] == Key || Path[Depth] == "*" )
+				KeyPaths.push_back( Path );
+		KeySteps.push_back( AddStep( KeyPaths, Depth+1 ) );
+	}
+	auto WildcardStep = WildcardPaths.empty() ? InvalidStep : AddStep( WildcardPaths, Depth+1 );
+
+	//	steps were added since, so this is looked up again
+	auto& Step = mSteps[Index];
+	Step.mKeys = KeySet_t( Keys );
+	Step.mKeySteps = std::move( KeySteps );
+	Step.mWildcardStep = WildcardStep;
+	return Index;
+}
+
+uint32_t PopJson::Projection_t::GetMemberStep(uint32_t Step,std::string_view Key,const char* BufferEnd) const
+{
+	auto& Parent = mSteps[Step];
+	if ( Parent.mWholeValue )
+		return Step;
+	auto KeyIndex = Parent.mKeys.Find( Key, BufferEnd );
+	if ( KeyIndex != KeySet_t::InvalidKeyIndex )
+		return Parent.mKeySteps[KeyIndex];
+	return Parent.mWildcardStep;
+}
+
+uint32_t PopJson::Projection_t::GetElementStep(uint32_t Step,size_t Index) const
+{
+	auto& Parent = mSteps[Step];
+	if ( Parent.mWholeValue )
+		return Step;
+	if ( Parent.mKeys.size() )
+	{
+		char IndexString[24];
+		auto Result = std::to_chars( std::begin(IndexString), std::end(IndexString), Index );
+		auto KeyIndex = Parent.mKeys.Find( std::string_view( IndexString, Result.ptr - IndexString ), nullptr );
+		if ( KeyIndex != KeySet_t::InvalidKeyIndex )
+			return Parent.mKeySteps[KeyIndex];
+	}
+	return Parent.mWildcardStep;
+}
+
+PopJson::KeySet_t::KeySet_t(std::span<const std::string_view> Keys)
+{
+	//	escape into the key data first; offsets are fixed up when sorted
+	std::vector<Key_t> Unsorted;
+	for ( auto Key : Keys )
+	{
+		Key_t Entry;
+		Entry.mOffset = static_cast<uint32_t>( mKeyData.size() );
+		Entry.mIndex = static_cast<uint32_t>( Unsorted.size() );
+		AppendEscapedString( mKeyData, Key );
+		Entry.mLength = static_cast<uint32_t>( mKeyData.size() - Entry.mOffset );
+		//	pad so 16 bytes can always be read from the start of a key
+		mKeyData.resize( mKeyData.size() + std::max<size_t>( 16, Entry.mLength ) - Entry.mLength, 0 );
+		Unsorted.push_back( Entry );
+	}
+
+	mKeys = Unsorted;
+	std::stable_sort( mKeys.begin(), mKeys.end(), [](const Key_t& a,const Key_t& b)	{	return a.mLength < b.mLength;	} );
+
+	size_t MaxLength = mKeys.empty() ? 0 : mKeys.back().mLength;
+	mFirstOfLength.assign( MaxLength+2, 0 );
+	for ( auto& Key : mKeys )
+		mFirstOfLength[Key.mLength+1]++;
+	for ( size_t Length=1;	Length<mFirstOfLength.size();	Length++ )
+		mFirstOfLength[Length] += mFirstOfLength[Length-1];
+
+	mSortedIndexes.resize( mKeys.size() );
+	for ( size_t i=0;	i<mKeys.size();	i++ )
+		mSortedIndexes[mKeys[i].mIndex] = static_cast<uint32_t>(i);
+
+	//	a duplicate would never be found
+	for ( size_t i=0;	i<mKeys.size();	i++ )
+	{
+		auto& Key = mKeys[i];
+		if ( Find( GetEscapedKey(Key.mIndex), nullptr ) != Key.mIndex )
+			throw std::runtime_error("Duplicate key " + std::string(GetEscapedKey(Key.mIndex)) + " in key set");
+	}
+}
+
+std::string_view PopJson::KeySet_t::GetEscapedKey(size_t Index) const
+{
+	auto& Key = mKeys.at( mSortedIndexes.at(Index) );
+	return std::string_view( mKeyData.data() + Key.mOffset, Key.mLength );
+}
+
+size_t PopJson::KeySet_t::Find(std::string_view Key,const char* BufferEnd) const
+{
+	auto Length = Key.size();
+	if ( Length+1 >= mFirstOfLength.size() )
+		return InvalidKeyIndex;
+	auto First = mFirstOfLength[Length];
+	auto Last = mFirstOfLength[Length+1];
+
+	bool CanReadShort = Length <= 16 && BufferEnd && BufferEnd - Key.data() >= 16;
+	for ( auto i=First;	i<Last;	i++ )
+	{
+		auto& Candidate = mKeys[i];
+		auto* CandidateData = mKeyData.data() + Candidate.mOffset;
+		bool Equal = CanReadShort ? Scan::IsEqualShort( Key.data(), CandidateData, Length ) : std::memcmp( Key.data(), CandidateData, Length ) == 0;
+		if ( Equal )
+			return Candidate.mIndex;
+	}
+	return InvalidKeyIndex;
+}
+
+size_t PopJson::Map_t::FindChildren(NodeIndex_t Parent,const KeySet_t& Keys,std::string_view Storage,std::span<NodeIndex_t> Children) const
+{
+	if ( Children.size() < Keys.size() )
+		throw std::runtime_error("FindChildren output has " + std::to_string(Children.size()) + " entries for " + std::to_string(Keys.size()) + " keys");
+	std::fill_n( Children.begin(), Keys.size(), InvalidNodeIndex );
+
+	auto Nodes = GetNodes();
+	auto& ParentNode = Nodes[Parent];
+	//	array elements have no keys, but would match an empty one
+	if ( ParentNode.GetType() != ValueType_t::Object )
+		return 0;
+
+	size_t Found = 0;
+	//	with a key index, a few lookups are cheaper than visiting every member of a wide object
+	if ( HasKeyIndex() && ParentNode.mChildCount >= mKeyIndexMinChildren && ParentNode.mChildCount > Keys.size()*4 )
+	{
+		for ( size_t k=0;	k<Keys.size();	k++ )
+		{
+			Children[k] = FindChild( Parent, Keys.GetEscapedKey(k), Storage );
+			Found += Children[k] != InvalidNodeIndex;
+		}
+		return Found;
+	}
+
+	auto* StorageEnd = Storage.data() + Storage.size();
+	for ( auto Child = GetFirstChild(Parent);	Child != InvalidNodeIndex && Found < Keys.size();	Child = GetNextSibling(Child) )
+	{
+		auto KeyIndex = Keys.Find( Nodes[Child].GetKey(Storage), StorageEnd );
+		//	first of duplicate keys wins
+		if ( KeyIndex == KeySet_t::InvalidKeyIndex || Children[KeyIndex] != InvalidNodeIndex )
+			continue;
+		Children[KeyIndex] = Child;
+		Found++;
+	}
+	return Found;
+}
+
+PopJson::NodeIndex_t PopJson::Map_t::GetChild(NodeIndex_t Parent,std::string_view Key,std::string_view Storage) const
+{
+	auto Child = FindChild( Parent, Key, Storage );
+	if ( Child == InvalidNodeIndex )
+		throw std::runtime_error("No key named " + std::string(Key));
+	return Child;
+}
+
+PopJson::NodeIndex_t PopJson::Map_t::GetChild(NodeIndex_t Parent,size_t ChildIndex) const
+{
+	auto Child = FindChild( Parent, ChildIndex );
+	if ( Child == InvalidNodeIndex )
+	{
+		std::stringstream Error;
+		Error << "Key " << ChildIndex << "/" << GetNode(Parent).mChildCount << " out of range";
+		throw std::runtime_error( Error.str() );
+	}
+	return Child;
+}
+
+void PopJson::Map_t::BuildKeyIndex(std::string_view Storage,size_t MinChildren)
+{
+	if ( !mMappedTree.empty() )
+		throw std::runtime_error("Cannot build key index on a map of external data");
+
+	mKeyIndex.clear();
+	mKeyIndexMinChildren = std::max<size_t>( MinChildren, 1 );
+
+	size_t KeyCount = 0;
+	for ( auto& Node : mFlatTree )
+		if ( Node.mValueType == ValueType_t::Object && Node.mChildCount >= mKeyIndexMinChildren )
+			KeyCount += Node.mChildCount;
+	if ( KeyCount == 0 )
+		return;
+
+	//	keep load under 50%
+	size_t SlotCount = 16;
+	while ( SlotCount < KeyCount * 2 )
+		SlotCount *= 2;
+	mKeyIndex.resize( SlotCount, InvalidNodeIndex );
+	auto Mask = SlotCount-1;
+
+	//	children are inserted in order, so with duplicate keys the first is found first (same as a linear scan)
+	for ( NodeIndex_t Index=0;	Index<mFlatTree.size();	Index++ )
+	{
+		auto& Node = mFlatTree[Index];
+		if ( Node.mParent == InvalidNodeIndex )
+			continue;
+		auto& Parent = mFlatTree[Node.mParent];
+		if ( Parent.mValueType != ValueType_t::Object || Parent.mChildCount < mKeyIndexMinChildren )
+			continue;
+
+		auto Slot = GetKeyHash( Node.mParent, Node.GetKey(Storage) ) & Mask;
+		while ( mKeyIndex[Slot] != InvalidNodeIndex )
+			Slot = (Slot+1) & Mask;
+		mKeyIndex[Slot] = Index;
+	}
+}
+
+//	content hashes of each kind of value. Members are combined with a sum so key order doesn't
+//	matter, elements in order; counts are mixed in so [] isn't [[]] and {"a":[]} isn't {"a":[],"a":[]}
+static uint64_t MixContentHash(uint64_t Hash)
+{
+	//	splitmix64 finaliser
+	Hash ^= Hash >> 30;
+	Hash *= 0xbf58476d1ce4e5b9ull;
+	Hash ^= Hash >> 27;
+	Hash *= 0x94d049bb133111ebull;
+	Hash ^= Hash >> 31;
+	return Hash;
+}
+
+//	Buffer is reused for unescaping, so hashing a whole map doesn't allocate per string
+static uint64_t GetContentHashOfString(std::string_view Escaped,uint64_t Seed,std::string& Buffer)
+{
+	if ( Escaped.find('\\') == std::string_view::npos )
+		return PopJson::Hash64( Escaped.data(), Escaped.size(), Seed );
+	Buffer.clear();
+	UnescapeString( Escaped, Buffer );
+	return PopJson::Hash64( Buffer.data(), Buffer.size(), Seed );
+}
+
+static uint64_t GetContentHashOfScalar(PopJson::ValueType_t::Type Type,std::string_view Raw,std::string& Buffer)
+{
+	using namespace PopJson;
+	switch ( Type )
+	{
+		case ValueType_t::String:
+			return GetContentHashOfString( Raw, 0x5354, Buffer );
+
+		case ValueType_t::NumberInteger:
+		case ValueType_t::NumberDouble:
+		{
+			//	by value, so integers and doubles of the same number match; -0 == 0
+			double Value = 0;
+			auto Result = std::from_chars( Raw.data(), Raw.data() + Raw.size(), Value );
+			if ( Result.ec != std::errc() )
+				return PopJson::Hash64( Raw.data(), Raw.size(), 0x4e55 );
+			if ( Value == 0 )
+				Value = 0;
+			uint64_t Bits;
+			std::memcpy( &Bits, &Value, sizeof(Bits) );
+			return MixContentHash( Bits ^ 0x4e554d4245520000ull );
+		}
+
+		default:
+			return MixContentHash( 0x4c49540000000000ull + Type );
+	}
+}
+
+static uint64_t GetContentHashOfMember(std::string_view EscapedKey,uint64_t ValueHash,std::string& Buffer)
+{
+	return MixContentHash( GetContentHashOfString( EscapedKey, 0x4b4559, Buffer ) + ValueHash * 0x9e3779b97f4a7c15ull );
+}
+
+static uint64_t GetContentHashOfObject(uint64_t MemberHashSum,size_t MemberCount)
+{
+	return MixContentHash( MemberHashSum ^ (0x4f424a0000000000ull + MemberCount) );
+}
+
+static uint64_t AddContentHashOfElement(uint64_t ArrayHash,uint64_t ElementHash)
+{
+	return MixContentHash( ArrayHash * 0x9e3779b97f4a7c15ull + ElementHash );
+}
+
+static uint64_t GetContentHashOfArray(uint64_t ElementHashes,size_t ElementCount)
+{
+	return MixContentHash( ElementHashes ^ (0x4152520000000000ull + ElementCount) );
+}
+
+void PopJson::Map_t::BuildContentHashes(std::string_view Storage)
+{
+	auto Nodes = GetNodes();
+	mContentHashes.assign( Nodes.size(), 0 );
+	std::string Buffer;
+
+	//	children always come after their parent, so going backwards they're hashed first
+	for ( auto Index=static_cast<NodeIndex_t>(Nodes.size());	Index-->0;	)
+	{
+		auto& Node = Nodes[Index];
+		uint64_t Hash = 0;
+		switch ( Node.GetType() )
+		{
+			case ValueType_t::Object:
+				for ( auto Child = GetFirstChild(Index);	Child != InvalidNodeIndex;	Child = GetNextSibling(Child) )
+					Hash += GetContentHashOfMember( Nodes[Child].GetKey(Storage), mContentHashes[Child], Buffer );
+				Hash = GetContentHashOfObject( Hash, Node.GetChildCount() );
+				break;
+
+			case ValueType_t::Array:
+				for ( auto Child = GetFirstChild(Index);	Child != InvalidNodeIndex;	Child = GetNextSibling(Child) )
+					Hash = AddContentHashOfElement( Hash, mContentHashes[Child] );
+				Hash = GetContentHashOfArray( Hash, Node.GetChildCount() );
+				break;
+
+			default:
+				Hash = GetContentHashOfScalar( Node.GetType(), Node.GetRawValue(Storage), Buffer );
+				break;
+		}
+		mContentHashes[Index] = Hash;
+	}
+}
+
+uint64_t PopJson::Map_t::GetContentHash(NodeIndex_t Index) const
+{
+	if ( !HasContentHashes() )
+		throw std::runtime_error("Content hashes have not been built for this map");
+	return mContentHashes[Index];
+}
+
+void PopJson::Map_t::SetExternalData(std::shared_ptr<const void> Owner,std::span<const MapNode_t> Nodes,std::span<const NodeIndex_t> KeyIndex,size_t KeyIndexMinChildren)
+{
+	mFlatTree.clear();
+	mKeyIndex.clear();
+	mContentHashes.clear();
+	mNumberTape.clear();
+	mExternalOwner = Owner;
+	mMappedTree = Nodes;
+	mMappedKeyIndex = KeyIndex;
+	mKeyIndexMinChildren = KeyIndexMinChildren;
+}
+
+std::string PopJson::Map_t::Stringify(std::string_view Storage)
+{
+	//	the map describes unmodified data, so the root's extent is the json
+	if ( GetNodes().empty() )
+		return "null";
+	auto& Root = GetNode(0);
+	auto Contents = Root.GetRawValue(Storage);
+	switch ( Root.GetType() )
+	{
+		case ValueType_t::Object:	return "{" + std::string(Contents) + "}";
+		case ValueType_t::Array:	return "[" + std::string(Contents) + "]";
+		case ValueType_t::String:	return "\"" + std::string(Contents) + "\"";
+		default:					return std::string(Contents);
+	}
+}
+
+
+template<typename POLICY>
+static PopJson::Value_t ParseValue(std::string_view Json,size_t WritePositionOffset,bool ErrorMessages=true)
+{
+	POPJSON_PHASE(Parse);
+	JsonParser<POLICY> parser( Json, ErrorMessages );
+	auto Root = parser.parse_json( WritePositionOffset );
+
+#if POPJSON_INSTRUMENTATION
+	//	re-parses (which happen inside another phase) aren't new documents
+	if ( PopJsonPhase.IsOutermost() )
+	{
+		parser.Stats.mBytes = Json.size();
+		PopJson::Instrumentation::OnDocumentParsed( parser.Stats );
+	}
+#endif
+	return Root;
+}
+
+PopJson::Value_t::Value_t(std::string_view Json,size_t WritePositionOffset)
+{
+	*this = ParseValue<StrictPolicy_t>( Json, WritePositionOffset );
+}
+
+template<typename POLICY>
+PopJson::Value_t::Value_t(std::string_view Json,POLICY)
+{
+	*this = ParseValue<POLICY>( Json, 0 );
+}
+
+template PopJson::Value_t::Value_t(std::string_view Json,StrictPolicy_t Policy);
+template PopJson::Value_t::Value_t(std::string_view Json,JsoncPolicy_t Policy);
+template PopJson::Value_t::Value_t(std::string_view Json,UniqueKeysPolicy_t Policy);
+template PopJson::Value_t::Value_t(std::string_view Json,Utf8Policy_t Policy);
+template PopJson::Value_t::Value_t(std::string_view Json,NumberTapePolicy_t Policy);
+
+std::string PopJson::Value_t::GetString(std::string_view JsonData)
+{
+	auto EscapedString = GetRawString(JsonData);
+	if ( mType == ValueType_t::String )
+	{
+		auto DecodedString = UnescapeString( EscapedString );
+		return DecodedString;
+	}
+	//	probably shouldnt be returning a string at all here
+	return std::string(EscapedString);
+}
+
+std::string_view PopJson::Value_t::GetString(std::string& Buffer,std::string_view JsonData)
+{
+	auto EscapedString = GetRawString(JsonData);
+	//	todo: decode escaped
+	return EscapedString;
+}
+
+void PopJson::Value_t::GetArray(std::vector<std::string>& OutputValues,std::string_view JsonData)
+{
+	//	throw if not an array?
+	//if ( this->GetType() != Value)
+	for ( auto& Child : mNodes )
+	{
+		auto Value = Child.GetValue(JsonData);
+		auto ValueString = Value.GetString(JsonData);
+		OutputValues.push_back(ValueString);
+	}
+}
+
+PopJson::Result_t<int> PopJson::Value_t::TryGetInteger(std::string_view JsonData)
+{
+	//	the parser types long integers as doubles, so those are integers if they have no fraction or exponent
+	auto ValueString = GetRawString( JsonData );
+	bool IsInteger = mType == PopJson::ValueType_t::NumberInteger;
+	if ( mType == PopJson::ValueType_t::NumberDouble )
+		IsInteger = ValueString.find_first_of(".eE") == std::string_view::npos;
+	if ( !IsInteger )
+		return Error_t::WrongType;
+
+	int Value = 0;
+	auto result = std::from_chars( ValueString.data(), ValueString.data() + ValueString.size(), Value );
+	if ( result.ec == std::errc::invalid_argument || result.ec == std::errc::result_out_of_range )
+		return Error_t::InvalidNumber;
+	return Value;
+}
+
+int PopJson::Value_t::GetInteger(std::string_view JsonData)
+{
+	auto Value = TryGetInteger( JsonData );
+	if ( Value.GetError() == Error_t::WrongType )
+		throw std::runtime_error("todo: conversion of value to integer");
+	if ( !Value )
+		throw std::runtime_error("Failed to convert" + std::string(GetRawString(JsonData)) + " to int");
+	return *Value;
+}
+
+PopJson::Result_t<double> PopJson::Value_t::TryGetDouble(std::string_view JsonData)
+{
+	if ( mType != PopJson::ValueType_t::NumberDouble && mType != PopJson::ValueType_t::NumberInteger )
+		return Error_t::WrongType;
+
+	auto ValueString = GetRawString( JsonData );
+	double Value = 0;
+	auto result = std::from_chars( ValueString.data(), ValueString.data() + ValueString.size(), Value );
+	if ( result.ec == std::errc::invalid_argument || result.ec == std::errc::result_out_of_range )
+		return Error_t::InvalidNumber;
+	return Value;
+}
+
+double PopJson::Value_t::GetDouble(std::string_view JsonData)
+{
+	auto Value = TryGetDouble( JsonData );
+	if ( Value.GetError() == Error_t::WrongType )
+		throw std::runtime_error("todo: conversion of value to double");
+	if ( !Value )
+		throw std::runtime_error("Failed to convert" + std::string(GetRawString(JsonData)) + " to double");
+	return *Value;
+}
+
+float PopJson::Value_t::GetFloat(std::string_view JsonData)
+{
+	return static_cast<float>( GetDouble(JsonData) );
+}
+
+void PopJson::Value_t::GetArray(std::vector<int>& OutputValues,std::string_view JsonData)
+{
+	for ( auto& Child : mNodes )
+	{
+		auto Value = Child.GetValue(JsonData);
+		OutputValues.push_back( Value.GetInteger(JsonData) );
+	}
+}
+
+PopJson::Result_t<bool> PopJson::Value_t::TryGetBool()
+{
+	if ( mType == PopJson::ValueType_t::BooleanTrue )
+		return true;
+	if ( mType == PopJson::ValueType_t::BooleanFalse )
+		return false;
+	return Error_t::WrongType;
+}
+
+bool PopJson::Value_t::GetBool()
+{
+	auto Value = TryGetBool();
+	if ( !Value )
+		throw std::runtime_error("todo: conversion of value to bool");
+	return *Value;
+}
+
+PopJson::Result_t<std::string> PopJson::Value_t::TryGetString(std::string_view JsonData)
+{
+	if ( mType != ValueType_t::String )
+		return Error_t::WrongType;
+	return UnescapeString( GetRawString(JsonData) );
+}
+
+
+
+PopJson::Result_t<PopJson::Value_t> PopJson::Value_t::TryGetValue(std::string_view Key,std::string_view JsonData)
+{
+	for ( auto& Child : mNodes )
+	{
+		auto ChildKey = Child.GetKey(JsonData);
+		if ( ChildKey == Key )
+			return Child.GetValue(JsonData);
+	}
+	return Error_t::MissingKey;
+}
+
+size_t PopJson::Value_t::FindNodes(const KeySet_t& Keys,std::string_view JsonData,std::span<Node_t*> Nodes)
+{
+	if ( Nodes.size() < Keys.size() )
+		throw std::runtime_error("FindNodes output has " + std::to_string(Nodes.size()) + " entries for " + std::to_string(Keys.size()) + " keys");
+	std::fill_n( Nodes.begin(), Keys.size(), nullptr );
+	if ( mType != ValueType_t::Object )
+		return 0;
+
+	auto* JsonEnd = JsonData.data() + JsonData.size();
+	size_t Found = 0;
+	for ( auto& Child : mNodes )
+	{
+		if ( Found == Keys.size() )
+			break;
+		auto KeyIndex = Keys.Find( Child.GetKey(JsonData), JsonEnd );
+		if ( KeyIndex == KeySet_t::InvalidKeyIndex || Nodes[KeyIndex] )
+			continue;
+		Nodes[KeyIndex] = &Child;
+		Found++;
+	}
+	return Found;
+}
+
+PopJson::Value_t PopJson::Value_t::GetValue(std::string_view Key,std::string_view JsonData)
+{
+	auto Value = TryGetValue( Key, JsonData );
+	if ( !Value )
+		throw std::runtime_error("No key named " + std::string(Key));
+	return std::move(*Value);
+}
+
+PopJson::Result_t<PopJson::Value_t> PopJson::Value_t::TryGetValue(size_t Index,std::string_view JsonData)
+{
+	//	gr: should this throw if keys are named? make this only work for arrays?
+	if ( Index >= mNodes.size() )
+		return Error_t::IndexOutOfRange;
+
+	auto& Child = mNodes[Index];
+	return Child.GetValue(JsonData);
+}
+
+PopJson::Value_t PopJson::Value_t::GetValue(size_t Index,std::string_view JsonData)
+{
+	auto Value = TryGetValue( Index, JsonData );
+	if ( !Value )
+	{
+		std::stringstream Error;
+		Error << "Key " << Index << "/" << mNodes.size() << " out of range";
+		throw std::runtime_error( Error.str() );
+	}
+	return std::move(*Value);
+}
+
+
+
+bool PopJson::Value_t::GetNode(std::string_view Key,std::string_view JsonData,std::function<void(Node_t&)> OnLockedNode)
+{
+	for ( auto& Child : mNodes )
+	{
+		auto ChildKey = Child.GetKey(JsonData);
+		if ( ChildKey != Key )
+			continue;
+		if ( OnLockedNode )
+			OnLockedNode( Child );
+		return true;
+	}
+	return false;
+}
+
+
+
+PopJson::Node_t::Node_t(Value_t Key,Value_t Value) :
+	mValuePosition	( Value.mPosition ),
+	mValueType		( Value.mType ),
+	mKeyPosition	( Key.mPosition )
+{
+}
+
+PopJson::Node_t::Node_t(Value_t Value) :
+	mValuePosition	( Value.mPosition ),
+	mValueType		( Value.mType )
+{
+}
+	
+PopJson::Value_t PopJson::Node_t::GetValue(std::string_view JsonData)
 {
 	Value_t Value( mValueType, mValuePosition );
 
@@ -614,6 +3095,8 @@ PopJson::Value_t PopJson::Node_t::GetValue(std::string_view JsonData)
 	//		we can't really store nodes in nodes, so need a better plan
 	if ( mValueType == ValueType_t::Object || mValueType == ValueType_t::Array )
 	{
+		POPJSON_PHASE(Reparse);
+		POPJSON_COUNT(Reparse);
 		//	these positions don't include start & end tokens...
 		//	which is difficult as they may not be right before & after...
 		//	need to adjust parser to have fake bits/parse a specific content type
@@ -628,12 +3111,12 @@ PopJson::Value_t PopJson::Node_t::GetValue(std::string_view JsonData)
 			FixedData << (IsArray ? "[" : "{");
 			FixedData << ContentData;
 			FixedData << (IsArray ? "]" : "}");
-			Value = Value_t( FixedData.str(), ValueTokenPosition );
+			Value = ParseValue<ReparsePolicy_t>( FixedData.str(), ValueTokenPosition );
 		}
 		else
 		{
 			auto NodeJson = JsonData.substr( ValueTokenPosition, ValueTokenLength );
-			Value = Value_t( NodeJson, ValueTokenPosition );
+			Value = ParseValue<ReparsePolicy_t>( NodeJson, ValueTokenPosition );
 		}
 	}
 	return Value;
@@ -653,6 +3136,41 @@ PopJson::Json_t::Json_t(std::string_view Json) :
 	std::copy( Json.begin(), Json.end(), std::back_inserter(mStorage) );
 }
 
+template<typename POLICY>
+PopJson::Json_t::Json_t(std::string_view Json,POLICY Policy) :
+	ViewBase_t		( Json, Policy )
+{
+	std::copy( Json.begin(), Json.end(), std::back_inserter(mStorage) );
+}
+
+template PopJson::Json_t::Json_t(std::string_view Json,StrictPolicy_t Policy);
+template PopJson::Json_t::Json_t(std::string_view Json,JsoncPolicy_t Policy);
+template PopJson::Json_t::Json_t(std::string_view Json,UniqueKeysPolicy_t Policy);
+template PopJson::Json_t::Json_t(std::string_view Json,Utf8Policy_t Policy);
+template PopJson::Json_t::Json_t(std::string_view Json,NumberTapePolicy_t Policy);
+
+template<typename POLICY>
+PopJson::Result_t<PopJson::Json_t> PopJson::Json_t::TryParse(std::string_view Json)
+{
+	Json_t Parsed;
+	try
+	{
+		static_cast<Value_t&>(Parsed) = ParseValue<POLICY>( Json, 0, false );
+	}
+	catch(ParseFailed_t& Error)
+	{
+		return Result_t<Json_t>( Error.mError, Error.mPosition );
+	}
+	Parsed.mStorage.assign( Json.begin(), Json.end() );
+	return Result_t<Json_t>( std::move(Parsed) );
+}
+
+template PopJson::Result_t<PopJson::Json_t> PopJson::Json_t::TryParse<PopJson::StrictPolicy_t>(std::string_view Json);
+template PopJson::Result_t<PopJson::Json_t> PopJson::Json_t::TryParse<PopJson::JsoncPolicy_t>(std::string_view Json);
+template PopJson::Result_t<PopJson::Json_t> PopJson::Json_t::TryParse<PopJson::UniqueKeysPolicy_t>(std::string_view Json);
+template PopJson::Result_t<PopJson::Json_t> PopJson::Json_t::TryParse<PopJson::Utf8Policy_t>(std::string_view Json);
+template PopJson::Result_t<PopJson::Json_t> PopJson::Json_t::TryParse<PopJson::NumberTapePolicy_t>(std::string_view Json);
+
 PopJson::Json_t::Json_t(ViewBase_t& Copy) :
 	ViewBase_t		( Copy )
 {
@@ -669,19 +3187,53 @@ PopJson::ValueProxy_t PopJson::Json_t::operator[](std::string_view Key)
 
 void PopJson::ValueProxy_t::PushBack(std::span<uint32_t> Values,std::function<std::string(const uint32_t&)> WriteStringValue)
 {
+	mLoaded = false;
 	mJson.PushBack( mKey, Values, WriteStringValue );
 
 }
 
+void PopJson::ValueProxy_t::AppendPointerToken(std::string& Pointer,std::string_view Key)
+{
+	for ( auto Char : Key )
+	{
+		if ( Char == '~' )
+			Pointer.append("~0");
+		else if ( Char == '/' )
+			Pointer.append("~1");
+		else
+			Pointer.push_back( Char );
+	}
+}
+
+void PopJson::ValueProxy_t::AddMissingArray()
+{
+	Value_t Existing;
+	if ( !mJson.GetValueAt( mPointer, Existing ) )
+		mJson.SetAt( mPointer, ValueInput_t( std::span<std::string_view>() ) );
+}
+
+void PopJson::ValueProxy_t::Load()
+{
+	if ( mLoaded )
+		return;
+	mLoaded = true;
+	auto& ThisValue = static_cast<Value_t&>(*this);
+	ThisValue = Value_t();
+	mJson.GetValueAt( mPointer, ThisValue );
+}
+
 void PopJson::Json_t::Set(std::string_view Key,const ValueInput_t& ValueInput)
 {
+	POPJSON_PHASE(Write);
+	mMap.reset();
 	//	write the raw data (without type-encapsulation, ie, no quotes) to our storage
 	//	leave escaping for Writing to Json time too
 	//	then reference it and add to list
 	auto Node = AppendNodeToStorage( Key, ValueInput.mSerialisedValue, ValueInput.mType );
 	
 	//	gr: we're putting {} and [] into the storage for the -1+2 hack, but the node doesn't reference it
-	if ( ValueInput.mType == ValueType_t::Array || ValueInput.mType == ValueType_t::Object )
+	//		(AppendValueToStorage has already done this for arrays)
+	if ( ValueInput.mType == ValueType_t::Object )
 	{
 		Node.mValuePosition.mPosition += 1;
 		Node.mValuePosition.mLength -= 2;
@@ -689,10 +3241,58 @@ void PopJson::Json_t::Set(std::string_view Key,const ValueInput_t& ValueInput)
 
 	mNodes.push_back( Node );
 	UpdateObjectType();
-	
-	auto Test = this->GetJsonString();
-	static int i =0 ;
-	i++;
+}
+
+uint64_t PopJson::Json_t::GetContentHash()
+{
+	auto Storage = GetStorageString();
+	mChildHashes.resize( mNodes.size() );
+
+	auto IsArray = GetType() == ValueType_t::Array;
+	uint64_t Hash = 0;
+	std::string Buffer;
+	for ( size_t i=0;	i<mNodes.size();	i++ )
+	{
+		auto& Node = mNodes[i];
+		auto& Cached = mChildHashes[i];
+		bool Valid = Cached.mHashed && Cached.mValueType == Node.mValueType &&
+			Cached.mValuePosition.mPosition == Node.mValuePosition.mPosition && Cached.mValuePosition.mLength == Node.mValuePosition.mLength &&
+			Cached.mKeyPosition.mPosition == Node.mKeyPosition.mPosition && Cached.mKeyPosition.mLength == Node.mKeyPosition.mLength;
+		if ( !Valid )
+		{
+			auto Raw = Node.mValuePosition.GetContents( Storage );
+			if ( Node.mValueType == ValueType_t::Object || Node.mValueType == ValueType_t::Array )
+			{
+				//	containers' positions don't include their brackets, which are either side in storage.
+				//	The whole child is rehashed; nothing is kept for the values inside it
+				std::string_view Json( Storage.data() + Node.mValuePosition.mPosition - 1, Node.mValuePosition.mLength + 2 );
+				auto Map = Parse( Json );
+				Map.BuildContentHashes( Json );
+				Cached.mHash = Map.GetContentHash(0);
+			}
+			else
+			{
+				Cached.mHash = GetContentHashOfScalar( Node.mValueType, Raw, Buffer );
+			}
+			Cached.mKeyPosition = Node.mKeyPosition;
+			Cached.mValuePosition = Node.mValuePosition;
+			Cached.mValueType = Node.mValueType;
+			Cached.mHashed = true;
+		}
+
+		if ( IsArray )
+			Hash = AddContentHashOfElement( Hash, Cached.mHash );
+		else
+			Hash += GetContentHashOfMember( Node.GetKey(Storage), Cached.mHash, Buffer );
+	}
+	//	stringified as an object unless an array (as GetJsonString)
+	return IsArray ? GetContentHashOfArray( Hash, mNodes.size() ) : GetContentHashOfObject( Hash, mNodes.size() );
+}
+
+void PopJson::Json_t::Reserve(size_t StorageBytes,size_t ChildCount)
+{
+	mStorage.reserve( mStorage.size() + StorageBytes );
+	mNodes.reserve( mNodes.size() + ChildCount );
 }
 
 
@@ -700,207 +3300,738 @@ PopJson::ValueInput_t::ValueInput_t()
 {
 }
 
-PopJson::ValueInput_t::ValueInput_t(const int& Value)
+void PopJson::ValueInput_t::SetInteger(int64_t Value)
 {
-	mSerialisedValue = std::to_string(Value);
+	char Buffer[32];
+	auto Written = ToChars( Buffer, Value );
+	mSerialisedValue.assign( Buffer, Written );
 	mType = ValueType_t::NumberInteger;
 }
 
-PopJson::ValueInput_t::ValueInput_t(const uint32_t& Value)
+void PopJson::ValueInput_t::SetInteger(uint64_t Value)
 {
-	mSerialisedValue = std::to_string(Value);
+	char Buffer[32];
+	auto Written = ToChars( Buffer, Value );
+	mSerialisedValue.assign( Buffer, Written );
 	mType = ValueType_t::NumberInteger;
 }
 
-PopJson::ValueInput_t::ValueInput_t(const uint64_t& Value)
+PopJson::ValueInput_t::ValueInput_t(const bool& Value)
+{
+	//mSerialisedValue = Value ? "true" : "false";
+	mType = Value ? ValueType_t::BooleanTrue : ValueType_t::BooleanFalse;
+}
+
+PopJson::ValueInput_t::ValueInput_t(const float& Value)
+{
+	char Buffer[32];
+	auto Written = ToChars( Buffer, Value );
+	mSerialisedValue.assign( Buffer, Written );
+	mType = ValueType_t::NumberDouble;
+}
+
+PopJson::ValueInput_t::ValueInput_t(const double& Value)
+{
+	char Buffer[32];
+	auto Written = ToChars( Buffer, Value );
+	mSerialisedValue.assign( Buffer, Written );
+	mType = ValueType_t::NumberDouble;
+}
+
+PopJson::ValueInput_t::ValueInput_t(const std::string& Value)
+{
+	mSerialisedValue = Value;
+	mType = ValueType_t::String;
+}
+
+PopJson::ValueInput_t::ValueInput_t(std::string_view Value)
+{
+	mSerialisedValue = Value;
+	mType = ValueType_t::String;
+}
+
+PopJson::ValueInput_t::ValueInput_t(const std::span<std::string_view>& Value)
+{
+	//	when this writes, it needs to write multiple Value_t's
+	if ( !Value.empty() )
+		throw std::runtime_error("Serialise values here");
+	mSerialisedValue = "[]";
+	mType = ValueType_t::Array;
+}
+
+
+PopJson::ValueInput_t::ValueInput_t(const std::span<std::string>& Values)
 {
-	size_t Max = std::numeric_limits<int32_t>::max();
-	if ( Value > Max )
-		throw std::runtime_error("Trying to write number greater than json 32bit limit");
+	std::stringstream ArrayValuesSerialised;
+	ArrayValuesSerialised << '[';
+	for ( int i=0;	i<Values.size();	i++ )
+	{
+		if ( i > 0 )
+			ArrayValuesSerialised << ',';
+		
+		auto InputValueString = Values[i];
+		Value_t InputValue( ValueType_t::String, Location_t(0,InputValueString.size()) );
+		WriteSanitisedValue( ArrayValuesSerialised, InputValue, InputValueString );
+	}
+	ArrayValuesSerialised << ']';
+	mSerialisedValue = ArrayValuesSerialised.str();
 	
-	mSerialisedValue = std::to_string(Value);
-	mType = ValueType_t::NumberInteger;
+	mType = ValueType_t::Array;
+}
+
+PopJson::ValueInput_t::ValueInput_t(const ViewBase_t& Value)
+{
+	//	stringified first, so a ValueProxy_t has read its value
+	mSerialisedValue = Value.GetJsonString();
+	mType = Value.GetType();
+}
+
+/*
+//	write interface
+void PopJson::Json_t::Set(std::string_view Key,std::string_view Value)
+{
+	//	write the raw data (without type-encapsulation, ie, no quotes) to our storage
+	//	leave escaping for Writing to Json time too
+	//	then reference it and add to list
+	auto Node = AppendNodeToStorage(Key,Value,ValueType_t::String);
+	mNodes.push_back( Node );
+}
+
+void PopJson::Json_t::Set(std::string_view Key,int32_t Value)
+{
+	auto ValueString = std::to_string(Value);
+	auto Node = AppendNodeToStorage( Key, ValueString, ValueType_t::String );
+	mNodes.push_back( Node );
+}
+
+void PopJson::Json_t::Set(std::string_view Key,bool Value)
+{
+	auto Node = AppendNodeToStorage( Key, "", Value ? ValueType_t::BooleanTrue : ValueType_t::BooleanFalse );
+	mNodes.push_back( Node );
+}
+
+void PopJson::Json_t::PushBack(std::span<uint32_t> Values,std::function<std::string(const uint32_t&)> WriteStringValue)
+{
+	for ( auto& InputValue : Values )
+	{
+		auto WriteValue = WriteStringValue(InputValue);
+		auto Value = AppendValueToStorage( WriteValue, ValueType_t::String );
+		mChildren.push_back(Value);
+	}
+}
+*/
+
+
+PopJson::ValueType_t::Type PopJson::Json_t::CalculateObjectType() const
+{
+	if ( mNodes.empty() )
+	{
+		//	cannot be null! - this might not be a number
+		//	gr: boolean may have no position...
+		if ( !mPosition.IsEmpty() )
+			return ValueType_t::BooleanTrue;
+		
+		return ValueType_t::Null;
+	}
+	
+	//	evaluate children
+	auto ChildrenWithKeys = 0;
+	for ( auto& Node : mNodes )
+	{
+		if ( Node.HasKey() )
+			ChildrenWithKeys++;
+	}
+	auto ChildrenWithoutKeys = mNodes.size() - ChildrenWithKeys;
+	if ( ChildrenWithKeys > 0 && ChildrenWithoutKeys > 0 )
+		throw std::runtime_error("Json has children with a mix of key and indexed elements. Corrupted");
+	
+	if ( ChildrenWithKeys > 0 )
+		return ValueType_t::Object;
+	
+	return ValueType_t::Array;
 }
 
-PopJson::ValueInput_t::ValueInput_t(const size_t& Value)
+void PopJson::Json_t::UpdateObjectType()
 {
-	size_t Max = std::numeric_limits<int32_t>::max();
-	if ( Value > Max )
-		throw std::runtime_error("Trying to write number greater than json 32bit limit");
+	//	called after each child is added; once we're a container only the new child needs checking,
+	//	rather than every child each time
+	if ( ( mType == ValueType_t::Object || mType == ValueType_t::Array ) && !mNodes.empty() )
+	{
+		if ( mNodes.back().HasKey() != ( mType == ValueType_t::Object ) )
+			throw std::runtime_error("Json has children with a mix of key and indexed elements. Corrupted");
+		return;
+	}
+
+	auto ExpectedType = CalculateObjectType();
 	
-	mSerialisedValue = std::to_string(Value);
-	mType = ValueType_t::NumberInteger;
+	//	some formats we can change
+	if ( mType == ValueType_t::Null )
+	{
+		if ( mType != ExpectedType )
+		{
+			//std::cerr << "Changing json value type from " << mType << " to " << ExpectedType << std::endl;
+			mType = ExpectedType;
+		}
+		return;
+	}
+
+	if ( mType != ExpectedType )
+	{
+		std::cerr << "Warning, json value type is wrong " << mType << " to " << ExpectedType << std::endl;
+	}
+
 }
 
-PopJson::ValueInput_t::ValueInput_t(const bool& Value)
+PopJson::Node_t PopJson::Json_t::AppendNodeToStorage(std::string_view Key,std::string_view ValueAsString,ValueType_t::Type ValueType)
 {
-	//mSerialisedValue = Value ? "true" : "false";
-	mType = Value ? ValueType_t::BooleanTrue : ValueType_t::BooleanFalse;
+	if ( Key.empty() )
+	{
+		auto ClippedValue = ValueAsString.substr( 0, std::min<int>(ValueAsString.length(),14) );
+		std::stringstream Error;
+		Error << "Cannot write key(" << Key << "=" << ClippedValue << ") with no name. Todo: support null & undefined";
+		throw std::runtime_error(Error.str());
+	}
+	
+	//	todo: validate the node's content by reading back the value
+	
+	Node_t Node;
+	//Node.mValueType = Type;
+	
+	Node.mKeyPosition = Location_t( mStorage.size(), Key.length() );
+	std::copy( Key.begin(), Key.end(), std::back_inserter(mStorage) );
+
+	auto Value = AppendValueToStorage( ValueAsString, ValueType );
+	Node.mValuePosition = Value.mPosition;
+	Node.mValueType = Value.mType;
+	
+	return Node;
+}
+
+PopJson::Node_t PopJson::Json_t::AppendKeyToStorage(std::string_view Key)
+{
+	if ( Key.empty() )
+		throw std::runtime_error("Cannot write key with no name. Todo: support null & undefined");
+
+	Node_t Node;
+	Node.mKeyPosition = Location_t( mStorage.size(), Key.length() );
+	mStorage.insert( mStorage.end(), Key.begin(), Key.end() );
+	return Node;
+}
+
+char* PopJson::Json_t::FormatNumber(char* Buffer,int64_t Value)
+{
+	return Buffer + ToChars( Buffer, Value );
+}
+
+char* PopJson::Json_t::FormatNumber(char* Buffer,uint64_t Value)
+{
+	return Buffer + ToChars( Buffer, Value );
+}
+
+char* PopJson::Json_t::FormatNumber(char* Buffer,double Value)
+{
+	return Buffer + ToChars( Buffer, Value );
+}
+
+char* PopJson::Json_t::FormatNumber(char* Buffer,float Value)
+{
+	return Buffer + ToChars( Buffer, Value );
+}
+
+PopJson::Value_t PopJson::Json_t::AppendIntegerToStorage(int64_t Value)
+{
+	char Buffer[32];
+	auto Length = ToChars( Buffer, Value );
+	Location_t ValuePosition( mStorage.size(), Length );
+	mStorage.insert( mStorage.end(), Buffer, Buffer+Length );
+	return Value_t( ValueType_t::NumberInteger, ValuePosition );
+}
+
+PopJson::Value_t PopJson::Json_t::AppendIntegerToStorage(uint64_t Value)
+{
+	char Buffer[32];
+	auto Length = ToChars( Buffer, Value );
+	Location_t ValuePosition( mStorage.size(), Length );
+	mStorage.insert( mStorage.end(), Buffer, Buffer+Length );
+	return Value_t( ValueType_t::NumberInteger, ValuePosition );
+}
+
+PopJson::Value_t PopJson::Json_t::AppendDoubleToStorage(double Value)
+{
+	char Buffer[32];
+	auto Length = ToChars( Buffer, Value );
+	Location_t ValuePosition( mStorage.size(), Length );
+	mStorage.insert( mStorage.end(), Buffer, Buffer+Length );
+	return Value_t( ValueType_t::NumberDouble, ValuePosition );
+}
+
+PopJson::Value_t PopJson::Json_t::AppendFloatToStorage(float Value)
+{
+	char Buffer[32];
+	auto Length = ToChars( Buffer, Value );
+	Location_t ValuePosition( mStorage.size(), Length );
+	mStorage.insert( mStorage.end(), Buffer, Buffer+Length );
+	return Value_t( ValueType_t::NumberDouble, ValuePosition );
+}
+
+void PopJson::Json_t::AppendQuotedStringToStorage(std::string_view Value)
+{
+	mStorage.push_back('"');
+	AppendEscapedString( mStorage, Value );
+	mStorage.push_back('"');
+}
+
+void PopJson::Json_t::AppendMemberKeyToStorage(std::string_view Key)
+{
+	AppendQuotedStringToStorage( Key );
+	mStorage.push_back(':');
+}
+
+void PopJson::Json_t::AppendJsonValueToStorage(const ValueInput_t& Value)
+{
+	std::string_view Json = Value.mSerialisedValue;
+	switch ( Value.mType )
+	{
+		case ValueType_t::String:		return AppendQuotedStringToStorage( Value.mSerialisedValue );
+		case ValueType_t::Null:			Json = "null";	break;
+		case ValueType_t::BooleanTrue:	Json = "true";	break;
+		case ValueType_t::BooleanFalse:	Json = "false";	break;
+		default:	break;
+	}
+	mStorage.insert( mStorage.end(), Json.begin(), Json.end() );
+}
+
+void PopJson::Json_t::PushBackAt(std::string_view Pointer,const ValueInput_t& Value)
+{
+	POPJSON_PHASE(Write);
+	if ( Pointer.empty() )
+	{
+		mMap.reset();
+		if ( this->GetType() != ValueType_t::Array && this->GetType() != ValueType_t::Null )
+			throw std::runtime_error("Trying to append to non-array");
+		//	stored as Set() stores it
+		auto NodeValue = AppendValueToStorage( Value.mSerialisedValue, Value.mType );
+		if ( Value.mType == ValueType_t::Object )
+		{
+			NodeValue.mPosition.mPosition += 1;
+			NodeValue.mPosition.mLength -= 2;
+		}
+		Node_t Node;
+		Node.ReplaceValue( NodeValue );
+		mNodes.push_back( Node );
+		UpdateObjectType();
+		return;
+	}
+	auto [Node,ChildPointer] = GetContainerNode( Pointer );
+	auto Start = mStorage.size();
+	AppendJsonValueToStorage( Value );
+	InsertIntoContainer( Node, ChildPointer, Start, ValueType_t::Array );
 }
 
-PopJson::ValueInput_t::ValueInput_t(const float& Value)
+void PopJson::Json_t::SetAt(std::string_view Pointer,std::string_view Key,const ValueInput_t& Value)
 {
-	mSerialisedValue = std::to_string(Value);
-	mType = ValueType_t::NumberDouble;
+	POPJSON_PHASE(Write);
+	if ( Pointer.empty() )
+		return Set( Key, Value );
+	auto [Node,ChildPointer] = GetContainerNode( Pointer );
+	auto Start = mStorage.size();
+	AppendMemberKeyToStorage( Key );
+	AppendJsonValueToStorage( Value );
+	InsertIntoContainer( Node, ChildPointer, Start, ValueType_t::Object );
 }
 
-PopJson::ValueInput_t::ValueInput_t(const std::string& Value)
+void PopJson::Json_t::SetAt(std::string_view Pointer,const ValueInput_t& Value)
 {
-	mSerialisedValue = Value;
-	mType = ValueType_t::String;
+	POPJSON_PHASE(Write);
+	auto Start = mStorage.size();
+	AppendJsonValueToStorage( Value );
+	SetJsonAt( Pointer, Start );
 }
 
-PopJson::ValueInput_t::ValueInput_t(std::string_view Value)
+size_t PopJson::Json_t::GetArrayMember(std::string_view Key)
 {
-	mSerialisedValue = Value;
-	mType = ValueType_t::String;
+	auto Storage = GetStorageString();
+	for ( size_t n=0;	n<mNodes.size();	n++ )
+	{
+		if ( mNodes[n].mKeyPosition.GetContents( Storage ) != Key )
+			continue;
+		if ( mNodes[n].GetType() != ValueType_t::Array )
+			throw std::runtime_error("Key already exists and isnt an array");
+		return n;
+	}
+
+	if ( this->GetType() != ValueType_t::Object && this->GetType() != ValueType_t::Null )
+		throw std::runtime_error("Trying to add an array member to non-object");
+	mMap.reset();
+	auto Node = AppendKeyToStorage( Key );
+	mStorage.push_back('[');
+	Node.mValuePosition = Location_t( mStorage.size(), 0 );
+	Node.mValueType = ValueType_t::Array;
+	mStorage.push_back(']');
+	mNodes.push_back( Node );
+	UpdateObjectType();
+	return mNodes.size()-1;
 }
 
-PopJson::ValueInput_t::ValueInput_t(const std::span<std::string_view>& Value)
+//	[start,end) of a parsed value's json, including the brackets or quotes its position doesn't
+static std::pair<size_t,size_t> GetJsonSpan(const PopJson::MapNode_t& Node)
 {
-	//	when this writes, it needs to write multiple Value_t's
-	if ( !Value.empty() )
-		throw std::runtime_error("Serialise values here");
-	mSerialisedValue = "[]";
-	mType = ValueType_t::Array;
+	using namespace PopJson;
+	auto Contents = Node.GetValuePosition();
+	auto Enclosed = Node.GetType() == ValueType_t::Object || Node.GetType() == ValueType_t::Array || Node.GetType() == ValueType_t::String;
+	return { Contents.mPosition - ( Enclosed ? 1 : 0 ), Contents.mPosition + Contents.mLength + ( Enclosed ? 1 : 0 ) };
 }
 
-
-PopJson::ValueInput_t::ValueInput_t(const std::span<std::string>& Values)
+std::pair<std::string,std::string_view> PopJson::Json_t::SplitPointer(std::string_view Pointer)
 {
-	std::stringstream ArrayValuesSerialised;
-	ArrayValuesSerialised << '[';
-	for ( int i=0;	i<Values.size();	i++ )
+	if ( Pointer.empty() || Pointer[0] != '/' )
+		throw std::runtime_error("Json pointer \"" + std::string(Pointer) + "\" doesn't start with /");
+
+	auto TokenEnd = std::min( Pointer.find( '/', 1 ), Pointer.size() );
+	std::string Token;
+	for ( size_t i=1;	i<TokenEnd;	i++ )
 	{
-		if ( i > 0 )
-			ArrayValuesSerialised << ',';
-		
-		auto InputValueString = Values[i];
-		Value_t InputValue( ValueType_t::String, Location_t(0,InputValueString.size()) );
-		WriteSanitisedValue( ArrayValuesSerialised, InputValue, InputValueString );
+		if ( Pointer[i] == '~' && i+1 < TokenEnd && ( Pointer[i+1] == '0' || Pointer[i+1] == '1' ) )
+			Token += Pointer[++i] == '0' ? '~' : '/';
+		else
+			Token += Pointer[i];
 	}
-	ArrayValuesSerialised << ']';
-	mSerialisedValue = ArrayValuesSerialised.str();
-	
-	mType = ValueType_t::Array;
+	return { Token, Pointer.substr( TokenEnd ) };
 }
 
-PopJson::ValueInput_t::ValueInput_t(const ViewBase_t& Value)
+size_t PopJson::Json_t::FindChildNode(std::string_view Token)
 {
-	mType = Value.GetType();
-	mSerialisedValue = Value.GetJsonString();
+	if ( GetType() == ValueType_t::Array )
+	{
+		size_t Index = 0;
+		auto Result = std::from_chars( Token.data(), Token.data()+Token.size(), Index );
+		if ( Result.ec != std::errc() || Result.ptr != Token.data()+Token.size() || Index >= mNodes.size() )
+			return SIZE_MAX;
+		return Index;
+	}
+
+	//	keys are matched as they are in storage; escaped, or as given to Set()
+	std::string_view EscapedKey = Token;
+	std::vector<char> Key;
+	if ( std::any_of( Token.begin(), Token.end(), [](char Char)	{	return static_cast<uint8_t>(Char) < 0x20 || Char == '"' || Char == '\\';	} ) )
+	{
+		AppendEscapedString( Key, Token );
+		EscapedKey = std::string_view( Key.data(), Key.size() );
+	}
+	auto Storage = GetStorageString();
+	for ( size_t n=0;	n<mNodes.size();	n++ )
+	{
+		if ( !mNodes[n].HasKey() )
+			continue;
+		auto NodeKey = mNodes[n].GetKey( Storage );
+		if ( NodeKey == EscapedKey || NodeKey == Token )
+			return n;
+	}
+	return SIZE_MAX;
 }
 
-/*
-//	write interface
-void PopJson::Json_t::Set(std::string_view Key,std::string_view Value)
+std::pair<size_t,std::string_view> PopJson::Json_t::GetContainerNode(std::string_view Pointer)
 {
-	//	write the raw data (without type-encapsulation, ie, no quotes) to our storage
-	//	leave escaping for Writing to Json time too
-	//	then reference it and add to list
-	auto Node = AppendNodeToStorage(Key,Value,ValueType_t::String);
-	mNodes.push_back( Node );
+	auto [Token,ChildPointer] = SplitPointer( Pointer );
+	auto Node = FindChildNode( Token );
+	if ( Node == SIZE_MAX )
+		throw std::runtime_error("Json pointer \"" + std::string(Pointer) + "\" doesn't exist");
+	return { Node, ChildPointer };
 }
 
-void PopJson::Json_t::Set(std::string_view Key,int32_t Value)
+PopJson::Json_t::Region_t& PopJson::Json_t::GetRegion(size_t NodeIndex,size_t& Start)
 {
-	auto ValueString = std::to_string(Value);
-	auto Node = AppendNodeToStorage( Key, ValueString, ValueType_t::String );
-	mNodes.push_back( Node );
+	auto& Node = mNodes[NodeIndex];
+	if ( Node.GetType() != ValueType_t::Array && Node.GetType() != ValueType_t::Object )
+		throw std::runtime_error("Trying to write inside a value which isn't an array or object");
+
+	//	the node's json is [contents] (positions don't include the brackets), followed by spare storage
+	auto ValueLength = mStorage.size() - Start;
+	auto ValueEnd = Node.mValuePosition.mPosition + Node.mValuePosition.mLength + 1;
+	auto RegionIt = mRegions.find( Node.mValuePosition.mPosition );
+	if ( RegionIt != mRegions.end() && ValueEnd + ValueLength + 1 <= RegionIt->second.mEnd )
+		return RegionIt->second;
+
+	//	move the value being written out of the way, then copy the node to the end of storage with as
+	//	much again spare; the old copy is left unreferenced, like any replaced value
+	std::string Value( mStorage.data() + Start, ValueLength );
+	mStorage.resize( Start );
+
+	Region_t Region;
+	if ( RegionIt != mRegions.end() )
+	{
+		Region = std::move( RegionIt->second );
+		mRegions.erase( RegionIt );
+	}
+	auto Contents = Node.mValuePosition;
+	auto Length = Contents.mLength + 2;
+	auto Capacity = std::max<size_t>( 64, 2 * ( Length + ValueLength + 1 ) );
+	auto RegionStart = mStorage.size();
+	mStorage.resize( RegionStart + Capacity, ' ' );
+	mStorage[RegionStart] = Node.GetType() == ValueType_t::Object ? '{' : '[';
+	std::memcpy( mStorage.data() + RegionStart + 1, mStorage.data() + Contents.mPosition, Contents.mLength );
+	mStorage[RegionStart + Length - 1] = Node.GetType() == ValueType_t::Object ? '}' : ']';
+	for ( auto& Found : Region.mValues )
+	{
+		Found.mStart = Found.mStart - Contents.mPosition + RegionStart + 1;
+		Found.mEnd = Found.mEnd - Contents.mPosition + RegionStart + 1;
+	}
+	Region.mEnd = mStorage.size();
+	Node.mValuePosition.mPosition = RegionStart + 1;
+
+	Start = mStorage.size();
+	mStorage.insert( mStorage.end(), Value.begin(), Value.end() );
+	return mRegions.emplace( Node.mValuePosition.mPosition, std::move(Region) ).first->second;
 }
 
-void PopJson::Json_t::Set(std::string_view Key,bool Value)
+const PopJson::Json_t::RegionValue_t* PopJson::Json_t::FindRegionValue(Region_t& Region,size_t NodeIndex,std::string_view ChildPointer)
 {
-	auto Node = AppendNodeToStorage( Key, "", Value ? ValueType_t::BooleanTrue : ValueType_t::BooleanFalse );
-	mNodes.push_back( Node );
+	auto& Found = Region.mValues;
+	auto Cached = std::find_if( Found.begin(), Found.end(), [&](auto& Value)	{	return Value.mPointer == ChildPointer;	} );
+	if ( Cached != Found.end() )
+		return &*Cached;
+
+	//	found once, then kept up to date as the node changes
+	auto& Node = mNodes[NodeIndex];
+	auto NodeStart = Node.mValuePosition.mPosition - 1;
+	std::string_view Json( mStorage.data() + NodeStart, Node.mValuePosition.mLength + 2 );
+	RegionValue_t Value;
+	Value.mPointer = ChildPointer;
+	if ( ChildPointer.empty() )
+	{
+		Value.mStart = NodeStart;
+		Value.mEnd = NodeStart + Json.size();
+	}
+	else
+	{
+		//	only the values on the way to the child are mapped (everything else is skipped, not parsed),
+		//	so each has one child; * and escaped tokens mean something else to a projection
+		NodeIndex_t Child = 0;
+		Map_t Map;
+		if ( ChildPointer.find_first_of("*~") == std::string_view::npos )
+		{
+			Map = Parse( Json, Projection_t{ ChildPointer } );
+			for ( auto Depth=std::count( ChildPointer.begin(), ChildPointer.end(), '/' );	Depth>0 && Child != InvalidNodeIndex;	Depth-- )
+				Child = Map.FindChild( Child, 0 );
+		}
+		else
+		{
+			Map = Parse( Json );
+			Child = Patch::FindPointer( Map, Json, ChildPointer );
+		}
+		if ( Child == InvalidNodeIndex )
+			return nullptr;
+		auto [ChildStart,ChildEnd] = GetJsonSpan( Map.GetNode( Child ) );
+		Value.mStart = NodeStart + ChildStart;
+		Value.mEnd = NodeStart + ChildEnd;
+	}
+	//	a few per node; writes usually go to the same ones
+	if ( Found.size() >= 16 )
+		Found.erase( Found.begin() );
+	Found.push_back( std::move(Value) );
+	return &Found.back();
 }
 
-void PopJson::Json_t::PushBack(std::span<uint32_t> Values,std::function<std::string(const uint32_t&)> WriteStringValue)
+void PopJson::Json_t::SpliceRegion(size_t NodeIndex,Region_t& Region,size_t SpliceStart,size_t SpliceEnd,size_t Start,bool Separator)
 {
-	for ( auto& InputValue : Values )
+	auto& Node = mNodes[NodeIndex];
+	auto ValueLength = mStorage.size() - Start;
+	auto InsertLength = ValueLength + ( Separator ? 1 : 0 );
+	auto RemoveLength = SpliceEnd - SpliceStart;
+	auto ValueEnd = Node.mValuePosition.mPosition + Node.mValuePosition.mLength + 1;
+
+	if ( mSpliceLog && SpliceStart < mSpliceLog->mStorageSize )
+		mSpliceLog->mSplices.push_back( { SpliceStart, std::string( mStorage.data() + SpliceStart, RemoveLength ), InsertLength, ValueEnd - SpliceEnd } );
+
+	//	shift what follows (up to the end of the node) to make room, the capacity has been checked
+	std::memmove( mStorage.data() + SpliceStart + InsertLength, mStorage.data() + SpliceEnd, ValueEnd - SpliceEnd );
+	auto* Insert = mStorage.data() + SpliceStart;
+	if ( Separator )
+		*Insert++ = ',';
+	std::memcpy( Insert, mStorage.data() + Start, ValueLength );
+	mStorage.resize( Start );
+	Node.mValuePosition.mLength = Node.mValuePosition.mLength + InsertLength - RemoveLength;
+
+	//	values after the splice move, those around it change length, those inside it are gone
+	auto& Found = Region.mValues;
+	for ( size_t i=0;	i<Found.size();	)
 	{
-		auto WriteValue = WriteStringValue(InputValue);
-		auto Value = AppendValueToStorage( WriteValue, ValueType_t::String );
-		mChildren.push_back(Value);
+		auto& Value = Found[i];
+		if ( Value.mStart >= SpliceEnd && ( Value.mStart > SpliceStart || RemoveLength > 0 ) )
+		{
+			Value.mStart = Value.mStart + InsertLength - RemoveLength;
+			Value.mEnd = Value.mEnd + InsertLength - RemoveLength;
+		}
+		else if ( Value.mStart < SpliceStart && Value.mEnd > SpliceEnd )
+		{
+			Value.mEnd = Value.mEnd + InsertLength - RemoveLength;
+		}
+		else if ( Value.mStart == SpliceStart && Value.mEnd == SpliceEnd && RemoveLength > 0 )
+		{
+			Value.mEnd = SpliceStart + InsertLength;
+		}
+		else if ( Value.mEnd > SpliceStart && Value.mStart < SpliceEnd )
+		{
+			Found.erase( Found.begin() + i );
+			continue;
+		}
+		i++;
 	}
+	if ( NodeIndex < mChildHashes.size() )
+		mChildHashes[NodeIndex].mHashed = false;
 }
-*/
 
+void PopJson::Json_t::InsertIntoContainer(size_t NodeIndex,std::string_view ChildPointer,size_t Start,ValueType_t::Type ContainerType)
+{
+	mMap.reset();
+	auto& Region = GetRegion( NodeIndex, Start );
+	auto* Container = FindRegionValue( Region, NodeIndex, ChildPointer );
+	if ( !Container )
+		throw std::runtime_error("Json pointer \"" + std::string(ChildPointer) + "\" doesn't exist");
+	auto Close = Container->mEnd - 1;
+	auto Type = mStorage[Close] == '}' ? ValueType_t::Object : mStorage[Close] == ']' ? ValueType_t::Array : ValueType_t::Null;
+	if ( Type != ContainerType )
+		throw std::runtime_error( ContainerType == ValueType_t::Array ? "Trying to append to non-array" : "Trying to add a member to non-object" );
+
+	auto Previous = Close;
+	while ( Scan::IsWhitespace( mStorage[Previous-1] ) )
+		Previous--;
+	bool HasChildren = mStorage[Previous-1] != '[' && mStorage[Previous-1] != '{';
+	SpliceRegion( NodeIndex, Region, Close, Close, Start, HasChildren );
+}
 
-PopJson::ValueType_t::Type PopJson::Json_t::CalculateObjectType() const
+void PopJson::Json_t::SetJsonAt(std::string_view Pointer,size_t Start)
 {
-	if ( mNodes.empty() )
+	mMap.reset();
+	if ( Pointer.empty() )
+		throw std::runtime_error("Cannot set the root by pointer");
+	auto [Token,ChildPointer] = SplitPointer( Pointer );
+	auto NodeIndex = FindChildNode( Token );
+
+	//	a top level value; only the new value is parsed, for its position & type
+	if ( ChildPointer.empty() )
 	{
-		//	cannot be null! - this might not be a number
-		//	gr: boolean may have no position...
-		if ( !mPosition.IsEmpty() )
-			return ValueType_t::BooleanTrue;
-		
-		return ValueType_t::Null;
+		std::string_view Json( mStorage.data() + Start, mStorage.size() - Start );
+		Value_t NewValue( Json, Start );
+		if ( NodeIndex != SIZE_MAX )
+		{
+			mNodes[NodeIndex].ReplaceValue( NewValue );
+			return;
+		}
+		Node_t Node;
+		Node.ReplaceValue( NewValue );
+		if ( GetType() == ValueType_t::Array )
+		{
+			if ( Token != "-" )
+				throw std::runtime_error("Json pointer \"" + std::string(Pointer) + "\" doesn't exist");
+		}
+		else
+		{
+			if ( GetType() != ValueType_t::Object && GetType() != ValueType_t::Null )
+				throw std::runtime_error("Trying to set a member of non-object");
+			std::vector<char> Key;
+			AppendEscapedString( Key, Token );
+			Node.mKeyPosition = Location_t( mStorage.size(), Key.size() );
+			mStorage.insert( mStorage.end(), Key.begin(), Key.end() );
+		}
+		mNodes.push_back( Node );
+		UpdateObjectType();
+		return;
 	}
-	
-	//	evaluate children
-	auto ChildrenWithKeys = 0;
-	for ( auto& Node : mNodes )
+
+	if ( NodeIndex == SIZE_MAX )
+		throw std::runtime_error("Json pointer \"" + std::string(Pointer) + "\" doesn't exist");
+	auto& Region = GetRegion( NodeIndex, Start );
+	if ( auto* Existing = FindRegionValue( Region, NodeIndex, ChildPointer ) )
+		return SpliceRegion( NodeIndex, Region, Existing->mStart, Existing->mEnd, Start, false );
+
+	//	a new member of an object, or "-" to append to an array
+	auto ParentEnd = ChildPointer.rfind('/');
+	auto [ChildToken,Unused] = SplitPointer( ChildPointer.substr( ParentEnd ) );
+	auto ParentPointer = ChildPointer.substr( 0, ParentEnd );
+	auto* Parent = FindRegionValue( Region, NodeIndex, ParentPointer );
+	if ( !Parent || mStorage[Parent->mStart] != '{' )
 	{
-		if ( Node.HasKey() )
-			ChildrenWithKeys++;
+		if ( Parent && mStorage[Parent->mStart] == '[' && ChildToken == "-" )
+			return InsertIntoContainer( NodeIndex, ParentPointer, Start, ValueType_t::Array );
+		throw std::runtime_error("Json pointer \"" + std::string(Pointer) + "\" doesn't exist");
 	}
-	auto ChildrenWithoutKeys = mNodes.size() - ChildrenWithKeys;
-	if ( ChildrenWithKeys > 0 && ChildrenWithoutKeys > 0 )
-		throw std::runtime_error("Json has children with a mix of key and indexed elements. Corrupted");
-	
-	if ( ChildrenWithKeys > 0 )
-		return ValueType_t::Object;
-	
-	return ValueType_t::Array;
+	std::string Value( mStorage.data() + Start, mStorage.size() - Start );
+	mStorage.resize( Start );
+	AppendMemberKeyToStorage( ChildToken );
+	mStorage.insert( mStorage.end(), Value.begin(), Value.end() );
+	InsertIntoContainer( NodeIndex, ParentPointer, Start, ValueType_t::Object );
 }
 
-void PopJson::Json_t::UpdateObjectType()
+bool PopJson::Json_t::GetValueAt(std::string_view Pointer,Value_t& Value)
 {
-	auto ExpectedType = CalculateObjectType();
-	
-	//	some formats we can change
-	if ( mType == ValueType_t::Null )
+	if ( Pointer.empty() )
 	{
-		if ( mType != ExpectedType )
-		{
-			//std::cerr << "Changing json value type from " << mType << " to " << ExpectedType << std::endl;
-			mType = ExpectedType;
-		}
-		return;
+		Value = static_cast<Value_t&>(*this);
+		return true;
+	}
+	auto [Token,ChildPointer] = SplitPointer( Pointer );
+	auto NodeIndex = FindChildNode( Token );
+	if ( NodeIndex == SIZE_MAX )
+		return false;
+	auto& Node = mNodes[NodeIndex];
+	if ( ChildPointer.empty() )
+	{
+		Value = Node.GetValue( GetStorageString() );
+		return true;
 	}
+	if ( Node.GetType() != ValueType_t::Array && Node.GetType() != ValueType_t::Object )
+		return false;
 
-	if ( mType != ExpectedType )
+	//	a node being written has the positions of what's inside it, otherwise it's found in the node's json
+	std::string_view Json;
+	size_t Offset = 0;
+	auto RegionIt = mRegions.find( Node.mValuePosition.mPosition );
+	if ( RegionIt != mRegions.end() )
 	{
-		std::cerr << "Warning, json value type is wrong " << mType << " to " << ExpectedType << std::endl;
+		auto* Found = FindRegionValue( RegionIt->second, NodeIndex, ChildPointer );
+		if ( !Found )
+			return false;
+		Offset = Found->mStart;
+		Json = std::string_view( mStorage.data() + Offset, Found->mEnd - Offset );
+	}
+	else
+	{
+		auto NodeStart = Node.mValuePosition.mPosition - 1;
+		std::string_view NodeJson( mStorage.data() + NodeStart, Node.mValuePosition.mLength + 2 );
+		auto Map = Parse( NodeJson );
+		auto Child = Patch::FindPointer( Map, NodeJson, ChildPointer );
+		if ( Child == InvalidNodeIndex )
+			return false;
+		auto [ChildStart,ChildEnd] = GetJsonSpan( Map.GetNode( Child ) );
+		Offset = NodeStart + ChildStart;
+		Json = NodeJson.substr( ChildStart, ChildEnd - ChildStart );
 	}
+	Value = Value_t( Json, Offset );
+	return true;
+}
 
+PopJson::Json_t::ArrayMemberWrite_t PopJson::Json_t::BeginArrayMember(std::string_view Key,size_t ReserveBytes)
+{
+	ArrayMemberWrite_t Write;
+	Write.mNodeIndex = GetArrayMember( Key );
+	mStorage.reserve( mStorage.size() + ReserveBytes );
+	Write.mStart = mStorage.size();
+	return Write;
 }
 
-PopJson::Node_t PopJson::Json_t::AppendNodeToStorage(std::string_view Key,std::string_view ValueAsString,ValueType_t::Type ValueType)
+void PopJson::Json_t::EndArrayMember(const ArrayMemberWrite_t& Write)
 {
-	if ( Key.empty() )
-	{
-		auto ClippedValue = ValueAsString.substr( 0, std::min<int>(ValueAsString.length(),14) );
-		std::stringstream Error;
-		Error << "Cannot write key(" << Key << "=" << ClippedValue << ") with no name. Todo: support null & undefined";
-		throw std::runtime_error(Error.str());
-	}
-	
-	//	todo: validate the node's content by reading back the value
-	
-	Node_t Node;
-	//Node.mValueType = Type;
-	
-	Node.mKeyPosition = Location_t( mStorage.size(), Key.length() );
-	std::copy( Key.begin(), Key.end(), std::back_inserter(mStorage) );
+	if ( Write.mHasElements )
+		InsertIntoContainer( Write.mNodeIndex, std::string_view(), Write.mStart );
+}
 
-	auto Value = AppendValueToStorage( ValueAsString, ValueType );
-	Node.mValuePosition = Value.mPosition;
-	Node.mValueType = Value.mType;
-	
-	return Node;
+PopJson::Value_t PopJson::Json_t::AppendStringToStorage(std::string_view Value)
+{
+	auto Start = mStorage.size();
+	AppendEscapedString( mStorage, Value );
+	Location_t ValuePosition( Start, mStorage.size()-Start );
+	return Value_t( ValueType_t::String, ValuePosition );
 }
 
 PopJson::Value_t PopJson::Json_t::AppendValueToStorage(std::string_view ValueAsString,ValueType_t::Type Type)
@@ -934,6 +4065,8 @@ PopJson::Value_t PopJson::Json_t::AppendValueToStorage(std::string_view ValueAsS
 
 void PopJson::Json_t::PushBack(ViewBase_t& Value)
 {
+	POPJSON_PHASE(Write);
+	mMap.reset();
 	auto Storage = GetStorageString();
 	
 	//	if this is currently null, we can convert it
@@ -959,56 +4092,164 @@ void PopJson::Json_t::PushBack(ViewBase_t& Value)
 }
 
 
-void PopJson::Json_t::PushBack(std::string_view Key,std::span<uint32_t> InputValues,std::function<std::string(const uint32_t& Value)> GetStringValue)
+void PopJson::Json_t::PushBack(std::span<uint32_t> Values,std::function<std::string(const uint32_t& Value)> GetStringValue)
 {
-	//	if this is an existing array, we need to append
-	//	if its not a key, make a new one
-	//	if we're trying to append to something else, fail
-	if ( !HasKey(Key) )
+	POPJSON_PHASE(Write);
+	mMap.reset();
+	if ( this->GetType() != ValueType_t::Array && this->GetType() != ValueType_t::Null )
+		throw std::runtime_error("Trying to append to non-array");
+
+	mNodes.reserve( mNodes.size() + Values.size() );
+	for ( auto& Value : Values )
 	{
-		//	insert an empty array
-		Set( Key, std::span<std::string_view>() );
+		Node_t Node;
+		auto NodeValue = AppendStringToStorage( GetStringValue(Value) );
+		Node.ReplaceValue( NodeValue );
+		mNodes.push_back( Node );
 	}
+	UpdateObjectType();
+}
+
+void PopJson::Json_t::PushBack(std::string_view Key,std::span<uint32_t> Values,std::function<std::string(const uint32_t& Value)> GetStringValue)
+{
+	POPJSON_PHASE(Write);
+	//	if Key is an existing array, the strings are appended to it, if its missing a new array is added
+	auto Write = BeginArrayMember( Key, Values.size() * 8 );
+	for ( auto& Value : Values )
+	{
+		if ( Write.mHasElements )
+			mStorage.push_back(',');
+		Write.mHasElements = true;
+		AppendQuotedStringToStorage( GetStringValue(Value) );
+	}
+	EndArrayMember( Write );
+}
+
+
+PopJson::ViewBase_t::ViewBase_t(std::shared_ptr<const Map_t> Map,NodeIndex_t Node) :
+	Value_t		( Map->GetNode(Node).GetValue() ),
+	mMap		( Map ),
+	mMapIndex	( Node )
+{
+	//	copy immediate children so the Value_t interface works, but without re-parsing anything
+	auto& MapNode = Map->GetNode(Node);
+	mNodes.reserve( MapNode.GetChildCount() );
+	for ( auto Child = Map->GetFirstChild(Node);	Child != InvalidNodeIndex;	Child = Map->GetNextSibling(Child) )
+	{
+		auto& ChildNode = Map->GetNode(Child);
+		Node_t ChildValue;
+		ChildValue.mKeyPosition = ChildNode.GetKeyPosition();
+		ChildValue.mValuePosition = ChildNode.GetValuePosition();
+		ChildValue.mValueType = ChildNode.GetType();
+		mNodes.push_back( ChildValue );
+	}
+}
+
+PopJson::Result_t<PopJson::View_t> PopJson::ViewBase_t::TryGetValue(std::string_view Key)
+{
+	auto Lock = LockStorage();
 	
-	auto Storage = GetStorageString();
-	
-	auto WriteNewChildrenToNode = [&](Node_t& Node)
+	if ( mMap )
 	{
-		if ( Node.GetType() != ValueType_t::Array )
-			throw std::runtime_error("Key already exists and isnt an array");
+		auto Child = mMap->FindChild( mMapIndex, Key, GetStorageString() );
+		if ( Child == InvalidNodeIndex )
+			return Error_t::MissingKey;
+		return View_t( mMap, Child, GetStorageString() );
+	}
 
+	auto Value = Value_t::TryGetValue( Key, GetStorageString() );
+	if ( !Value )
+		return Value.GetError();
+	return View_t( *Value, GetStorageString() );
+}
+
+std::vector<PopJson::Result_t<PopJson::View_t>> PopJson::ViewBase_t::TryGetValues(const KeySet_t& Keys)
+{
+	auto Lock = LockStorage();
+	auto Storage = GetStorageString();
+	std::vector<Result_t<View_t>> Values;
+	Values.reserve( Keys.size() );
+
+	if ( mMap )
+	{
+		std::vector<NodeIndex_t> Children( Keys.size() );
+		mMap->FindChildren( mMapIndex, Keys, Storage, Children );
+		for ( auto Child : Children )
 		{
-			auto CurrentValue = Node.GetValue( Storage );
-			if ( !CurrentValue.mNodes.empty() )
-				throw std::runtime_error("todo: append values to existing array");
-		}
-		
-		std::vector<std::string> InputValueStrings;
-		for ( auto& Value : InputValues )
-		{
-			InputValueStrings.push_back( GetStringValue(Value) );
+			if ( Child == InvalidNodeIndex )
+				Values.push_back( Error_t::MissingKey );
+			else
+				Values.push_back( View_t( mMap, Child, Storage ) );
 		}
-		
-		ValueInput_t ArrayValue( InputValueStrings );
+		return Values;
+	}
 
-		//	add a new node to the root
-		auto ArrayValuesSerialised_str = ArrayValue.mSerialisedValue;
-		auto JsonValue = AppendValueToStorage( ArrayValuesSerialised_str, ValueType_t::Array );
-		Node.ReplaceValue( JsonValue );
-	};
-	
-	GetNode( Key, Storage, WriteNewChildrenToNode );
+	std::vector<Node_t*> Nodes( Keys.size() );
+	Value_t::FindNodes( Keys, Storage, Nodes );
+	for ( auto* Node : Nodes )
+	{
+		if ( !Node )
+			Values.push_back( Error_t::MissingKey );
+		else
+			Values.push_back( View_t( Node->GetValue(Storage), Storage ) );
+	}
+	return Values;
 }
 
+PopJson::Result_t<PopJson::View_t> PopJson::ViewBase_t::TryGetValue(size_t Index)
+{
+	auto Lock = LockStorage();
+	
+	if ( mMap )
+	{
+		auto Child = mMap->FindChild( mMapIndex, Index );
+		if ( Child == InvalidNodeIndex )
+			return Error_t::IndexOutOfRange;
+		return View_t( mMap, Child, GetStorageString() );
+	}
+
+	auto Value = Value_t::TryGetValue( Index, GetStorageString() );
+	if ( !Value )
+		return Value.GetError();
+	return View_t( *Value, GetStorageString() );
+}
 
 PopJson::View_t PopJson::ViewBase_t::GetValue(std::string_view Key)
 {
-	std::shared_lock Lock(mStorageLock);
+	auto Lock = LockStorage();
 	
+	if ( mMap )
+	{
+		auto Child = mMap->GetChild( mMapIndex, Key, GetStorageString() );
+		return View_t( mMap, Child, GetStorageString() );
+	}
+
 	auto Value = Value_t::GetValue( Key, GetStorageString() );
 	return View_t( Value, GetStorageString() );
 }
 
+PopJson::View_t PopJson::ViewBase_t::GetValue(size_t Index)
+{
+	auto Lock = LockStorage();
+	
+	if ( mMap )
+	{
+		auto Child = mMap->GetChild( mMapIndex, Index );
+		return View_t( mMap, Child, GetStorageString() );
+	}
+
+	auto Value = Value_t::GetValue( Index, GetStorageString() );
+	return View_t( Value, GetStorageString() );
+}
+
+bool PopJson::ViewBase_t::HasKey(std::string_view Key)
+{
+	auto Lock = LockStorage();
+	if ( mMap )
+		return mMap->FindChild( mMapIndex, Key, GetStorageString() ) != InvalidNodeIndex;
+	return Value_t::HasKey( Key, GetStorageString() );
+}
+
 PopJson::View_t PopJson::ViewBase_t::operator[](std::string_view Key)
 {
 	return GetValue(Key);
@@ -1016,6 +4257,8 @@ PopJson::View_t PopJson::ViewBase_t::operator[](std::string_view Key)
 
 std::string PopJson::ViewBase_t::GetJsonString() const
 {
+	POPJSON_PHASE(Stringify);
+	POPJSON_COUNT(AllocationSite);
 	std::stringstream Json;
 	
 	try 
@@ -1106,7 +4349,16 @@ std::string UnescapeString(std::string_view EscapedString)
 	if ( EscapedString.empty() )
 		return {};
 	
+	POPJSON_COUNT(AllocationSite);
 	std::string out;
+	UnescapeString( EscapedString, out );
+	return out;
+}
+
+//	appends to out, so callers can reuse a buffer
+void UnescapeString(std::string_view EscapedString,std::string& out)
+{
+	POPJSON_PHASE(Unescape);
 	long last_escaped_codepoint = -1;
 
 	int i = 0;
@@ -1126,12 +4378,15 @@ std::string UnescapeString(std::string_view EscapedString)
 		if (in_range(ch, 0, 0x1f))
 			throw std::runtime_error("unescaped " + EscapeChar(ch) + " in string");
 
-		// The usual case: non-escaped characters
+		// The usual case: non-escaped characters, appended a run at a time
 		if (ch != '\\')
 		{
 			encode_utf8(last_escaped_codepoint, out);
 			last_escaped_codepoint = -1;
-			out += ch;
+			auto RunStart = i-1;
+			while ( i < str.size() && str[i] != '\\' && str[i] != '"' && !in_range(str[i], 0, 0x1f) )
+				i++;
+			out.append( str.data() + RunStart, i - RunStart );
 			continue;
 		}
 
@@ -1157,7 +4412,12 @@ std::string UnescapeString(std::string_view EscapedString)
 					throw std::runtime_error("bad \\u escape: " + std::string(esc));
 			}
 
-			long codepoint = strtol( std::string(esc).data(), nullptr, 16);
+			long codepoint = 0;
+			for (size_t j = 0; j < 4; j++)
+			{
+				char Hex = esc[j];
+				codepoint = (codepoint << 4) | ( Hex <= '9' ? Hex - '0' : (Hex | 0x20) - 'a' + 10 );
+			}
 
 			// JSON specifies that characters outside the BMP shall be encoded as a pair
 			// of 4-hex-digit \u escapes encoding their surrogate pair components. Check
@@ -1187,9 +4447,6 @@ std::string UnescapeString(std::string_view EscapedString)
 	
 	//	got an escaped codepoint still pending at end of the string
 	encode_utf8(last_escaped_codepoint, out);
-
-	
-	return out;
 }
 
 void WriteEscapedString(std::stringstream& Json,std::string_view Value)
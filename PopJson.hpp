@@ -15,9 +15,21 @@
 #pragma once
 
 #include <vector>
+#include <string>
 #include <string_view>
 #include <span>
 #include <shared_mutex>
+#include <functional>
+#include <stdexcept>
+#include <cstdint>
+#include <type_traits>
+#include <memory>
+#include <optional>
+#include <iterator>
+#include <ranges>
+#include <unordered_map>
+#include <initializer_list>
+#include "PopJsonInstrumentation.hpp"
 
 namespace PopJson
 {
@@ -31,13 +43,58 @@ namespace PopJson
 
 	class Location_t;		//	pos + length of a value or key
 	typedef uint32_t NodeIndex_t;
+	class KeySet_t;			//	keys to find together in one pass over an object's members
+	class Projection_t;		//	json pointers compiled for a parse which only maps the values they lead to
 	class Map_t;			//	This is a map to every element (MapNode_t) in a json object; it is a tree, but flat. Data is kept elsewhere
 	class MapNode_t;		//	replacement of Value_t
+	class TapeNumber_t;		//	a number decoded while parsing, kept beside its node (see NumberTapePolicy_t)
 	class JsonMutable_t;	//	map + storage
 	class JsonReadOnly_t;	//	map + pointer to storage
 	class SliceReadOnly_t;	//	access the map from a point in the subtree
+	class Member_t;			//	key + slice, from SliceReadOnly_t::members()
+	template<typename ELEMENT>
+	class ChildIterator_t;
+	template<typename ELEMENT>
+	class ChildRange_t;
 
+	namespace Patch
+	{
+		class JsonTarget_t;	//	applies json patches to a Json_t in place (PopJsonPatch.hpp)
+	}
+
+	class StrictPolicy_t;
+	class JsoncPolicy_t;
+	class UniqueKeysPolicy_t;
+	class Utf8Policy_t;
+	class NumberTapePolicy_t;
+
+	//	the parser is compiled for each policy, so disabled features have no cost in the parse loop.
+	//	Instantiated for the policies declared here. Only whitespace (and comments, if the policy allows
+	//	them) may follow the root value
+	template<typename POLICY=StrictPolicy_t>
 	Map_t	Parse(std::string_view Json);
+	//	sparse map of only the projected values and the containers on the way to them (see Projection_t).
+	//	Not instantiated for policies which allow comments, as skipped values are only bracket matched
+	template<typename POLICY=StrictPolicy_t>
+	Map_t	Parse(std::string_view Json,const Projection_t& Projection);
+
+	template<typename TYPE>
+	class Result_t;			//	value or Error_t, like std::expected
+	//	non-throwing parse; the error position is the byte offset parsing stopped at
+	template<typename POLICY=StrictPolicy_t>
+	Result_t<Map_t>	TryParse(std::string_view Json);
+
+	constexpr NodeIndex_t	InvalidNodeIndex = 0xffffffff;
+
+	//	fast (non-cryptographic) 64bit hash, used for key indexes and validating sidecar files
+	uint64_t	Hash64(const void* Data,size_t Length,uint64_t Seed=0);
+
+	//	append a string in its json-escaped form (no quotes), as it would appear in parsed json
+	void		AppendEscapedString(std::vector<char>& Storage,std::string_view Value);
+
+	//	types which Json_t can format straight into its storage (numbers, bools, strings) without a ValueInput_t
+	template<typename TYPE>
+	concept TypedValue_t = std::is_arithmetic_v<TYPE> || std::is_convertible_v<const TYPE&,std::string_view>;
 
 	namespace ValueType_t
 	{
@@ -55,10 +112,124 @@ namespace PopJson
 		};
 	}
 	
+	namespace DuplicateKeys_t
+	{
+		enum Type
+		{
+			Allow,		//	all are kept, lookups find the first
+			Reject,		//	parse throws. Keys are compared as they appear in the json (escaped)
+		};
+	}
+	
+	//	failures of the non-throwing (TryXXX) interface
+	namespace Error_t
+	{
+		enum Type
+		{
+			None,
+			MissingKey,
+			IndexOutOfRange,
+			WrongType,			//	eg. integer from a string
+			InvalidNumber,		//	doesn't fit in the requested type
+			Syntax,				//	parse errors...
+			InvalidUtf8,
+			TooDeep,
+			DuplicateKey,
+		};
+	}
+	//	static strings, never allocates
+	const char*	GetErrorString(Error_t::Type Error);
+	
 	void		UnitTest();
 }
 
 
+//	Value or an error code. The failure path never allocates or builds a message; only Value()
+//	on an error throws
+template<typename TYPE>
+class PopJson::Result_t
+{
+public:
+	Result_t(const TYPE& Value) :
+		mValue	( Value )
+	{
+	}
+	Result_t(TYPE&& Value) :
+		mValue	( std::move(Value) )
+	{
+	}
+	Result_t(Error_t::Type Error,size_t ErrorPosition=0) :
+		mError			( Error ),
+		mErrorPosition	( ErrorPosition )
+	{
+	}
+
+	explicit operator	bool() const		{	return mValue.has_value();	}
+	bool				HasValue() const	{	return mValue.has_value();	}
+	Error_t::Type		GetError() const	{	return mError;	}
+	size_t				GetErrorPosition() const	{	return mErrorPosition;	}
+
+	TYPE&				operator*()			{	return *mValue;	}
+	TYPE*				operator->()		{	return &*mValue;	}
+	TYPE&				Value()
+	{
+		if ( !mValue )
+			throw std::runtime_error( GetErrorString(mError) );
+		return *mValue;
+	}
+	TYPE				ValueOr(TYPE Default) const	{	return mValue ? *mValue : Default;	}
+
+private:
+	std::optional<TYPE>	mValue;
+	Error_t::Type		mError = Error_t::None;
+	size_t				mErrorPosition = 0;
+};
+
+
+//	parser policy; standard json
+class PopJson::StrictPolicy_t
+{
+public:
+	static constexpr bool	AllowComments = false;			//	// and /* */
+	static constexpr bool	AllowTrailingCommas = false;	//	[1,2,] and {"a":1,}
+	static constexpr bool	AllowNanAndInfinity = false;	//	NaN, Infinity & -Infinity, typed as NumberDouble
+	static constexpr bool	StrictNumbers = true;			//	false allows leading zeros, and .5 & 5.
+	static constexpr DuplicateKeys_t::Type	DuplicateKeys = DuplicateKeys_t::Allow;
+	static constexpr bool	ValidateUtf8 = false;			//	throw with the offset of the first invalid utf-8 sequence (see Scan::FindInvalidUtf8)
+	static constexpr size_t	MaxDepth = 64*1024;				//	nesting is parsed with a heap stack, so this only bounds memory
+	static constexpr bool	DecodeNumbers = false;			//	decode numbers as they're scanned into the map's number tape (see Map_t::GetTapeNumber)
+};
+
+//	JSONC, eg. config files
+class PopJson::JsoncPolicy_t : public StrictPolicy_t
+{
+public:
+	static constexpr bool	AllowComments = true;
+	static constexpr bool	AllowTrailingCommas = true;
+};
+
+class PopJson::UniqueKeysPolicy_t : public StrictPolicy_t
+{
+public:
+	static constexpr DuplicateKeys_t::Type	DuplicateKeys = DuplicateKeys_t::Reject;
+};
+
+//	for untrusted input which must be valid utf-8
+class PopJson::Utf8Policy_t : public StrictPolicy_t
+{
+public:
+	static constexpr bool	ValidateUtf8 = true;
+};
+
+//	for number-heavy documents (coordinates, samples) which are read more than once; every number
+//	is decoded once while parsing, then slices read it from the tape rather than the text
+class PopJson::NumberTapePolicy_t : public StrictPolicy_t
+{
+public:
+	static constexpr bool	DecodeNumbers = true;
+};
+
+
 class PopJson::Location_t
 {
 public:
@@ -85,8 +256,12 @@ public:
 	size_t		mLength = 0;
 };
 
+//	nodes are stored depth-first, so a node's children directly follow it
+//	and the next sibling is after all of its descendants.
+//	This is plain-old-data so it can be written to, and mapped from, a sidecar file
 class PopJson::MapNode_t
 {
+	friend class Map_t;
 private:
 	constexpr static NodeIndex_t	RootNodeNoParent = 0xffffffff;
 	
@@ -96,16 +271,118 @@ public:
 	ValueType_t::Type	GetType() const			{	return mValueType;	}
 	bool				IsRootNode() const		{	return mParent == RootNodeNoParent;	}
 	NodeIndex_t			GetParentIndex() const	{	return mParent;	}
+	NodeIndex_t			GetChildCount() const	{	return mChildCount;	}
+	NodeIndex_t			GetDescendantCount() const	{	return mDescendantCount;	}
+	const Location_t&	GetKeyPosition() const		{	return mKeyPosition;	}
+	const Location_t&	GetValuePosition() const	{	return mValuePosition;	}	//	objects & arrays don't include {} or []
+	Value_t				GetValue() const;		//	value without children, for use with Value_t accessors
 
 protected:
 	std::string_view	GetRawValue(std::string_view Storage) const	{	return mValuePosition.GetContents(Storage);	}
 
 private:
 	NodeIndex_t			mParent = RootNodeNoParent;	//	the root node is the only one with no parent. 0 is always the root
+	NodeIndex_t			mChildCount = 0;
+	NodeIndex_t			mDescendantCount = 0;		//	all children, grandchildren etc; Index+1+mDescendantCount is the next sibling
+	ValueType_t::Type	mValueType = ValueType_t::Null;
 	//	if no key, this object is an element in an array (order dictated by map)
 	Location_t			mKeyPosition;
 	Location_t			mValuePosition;
-	ValueType_t::Type	mValueType = ValueType_t::Null;
+};
+
+//	a number decoded by the parser; which member holds it depends on how it was written
+class PopJson::TapeNumber_t
+{
+public:
+	enum Kind_t : uint8_t
+	{
+		None,			//	not a number, or not decoded
+		Integer,		//	no fraction or exponent, in mInteger
+		LargeInteger,	//	no fraction or exponent, but beyond int64, in mDouble
+		Double,			//	in mDouble
+	};
+
+public:
+	bool				IsNumber() const	{	return mKind != None;	}
+	double				GetDouble() const	{	return mKind == Integer ? static_cast<double>(mInteger) : mDouble;	}
+
+public:
+	union
+	{
+		int64_t		mInteger;
+		double		mDouble = 0;
+	};
+	Kind_t			mKind = None;
+};
+
+//	a set of keys compiled once, so handlers which need many fields of each object can find them
+//	all in one walk of its members rather than a scan per key. Keys are given unescaped and
+//	stored escaped (as they're matched against the json), grouped by length; a member's key
+//	is only compared against keys of the same length, short ones 16 bytes at a time
+class PopJson::KeySet_t
+{
+public:
+	static constexpr size_t	InvalidKeyIndex = static_cast<size_t>(-1);
+
+public:
+	KeySet_t(std::initializer_list<std::string_view> Keys) : KeySet_t( std::span<const std::string_view>( Keys.begin(), Keys.size() ) )	{}
+	KeySet_t(std::span<const std::string_view> Keys);		//	throws on duplicates
+
+	size_t				size() const					{	return mKeys.size();	}
+	std::string_view	GetEscapedKey(size_t Index) const;
+
+	//	index (in the order the keys were given) of this escaped key, or InvalidKeyIndex.
+	//	BufferEnd is the end of the data Key is in (or null), so we know when it's safe to over-read it
+	size_t				Find(std::string_view Key,const char* BufferEnd) const;
+
+private:
+	class Key_t
+	{
+	public:
+		uint32_t	mOffset = 0;	//	in mKeyData
+		uint32_t	mLength = 0;
+		uint32_t	mIndex = 0;		//	order given
+	};
+	std::vector<char>		mKeyData;			//	each key is zero-padded to at least 16 bytes
+	std::vector<Key_t>		mKeys;				//	sorted by length
+	std::vector<uint32_t>	mFirstOfLength;		//	keys of length L are mKeys[mFirstOfLength[L]...mFirstOfLength[L+1]]
+	std::vector<uint32_t>	mSortedIndexes;		//	mKeys index of each key, in the order given
+};
+
+//	json pointers (RFC 6901) compiled into a tree of steps, for a parse which only maps the values
+//	they lead to, eg. { "/user/id", "/items/*/price" }. A * token matches every member or element.
+//	Everything else is skipped by matching brackets (outside of strings) without being parsed, so
+//	it isn't validated either. Containers on the way only get their projected children, so array
+//	indexes in the map are of the kept elements
+class PopJson::Projection_t
+{
+public:
+	static constexpr uint32_t	InvalidStep = 0xffffffff;
+	static constexpr uint32_t	RootStep = 0;
+
+public:
+	Projection_t(std::initializer_list<std::string_view> Pointers) : Projection_t( std::span<const std::string_view>( Pointers.begin(), Pointers.size() ) )	{}
+	Projection_t(std::span<const std::string_view> Pointers);
+
+	//	the whole value at this step is wanted, so its descendants are all at this step too
+	bool		IsWholeValue(uint32_t Step) const	{	return mSteps[Step].mWholeValue;	}
+	//	step of a member (escaped key, BufferEnd as for KeySet_t::Find) or an element, InvalidStep if not projected
+	uint32_t	GetMemberStep(uint32_t Step,std::string_view Key,const char* BufferEnd) const;
+	uint32_t	GetElementStep(uint32_t Step,size_t Index) const;
+
+private:
+	uint32_t	AddStep(std::span<const std::vector<std::string>> Paths,size_t Depth);
+
+private:
+	class Step_t
+	{
+	public:
+		bool					mWholeValue = false;
+		KeySet_t				mKeys = KeySet_t( std::span<const std::string_view>() );
+		std::vector<uint32_t>	mKeySteps;					//	per key of mKeys
+		uint32_t				mWildcardStep = InvalidStep;	//	members & elements without a key of their own
+	};
+	std::vector<Step_t>		mSteps;
 };
 
 class PopJson::Map_t
@@ -115,13 +392,196 @@ public:
 	NodeIndex_t		AddNode(NodeIndex_t Parent,std::string_view Key,std::string_view RawValue,std::vector<char>& Storage);
 	//	record node into tree
 	NodeIndex_t		AddNode(NodeIndex_t Parent,Location_t Key,Location_t Value,ValueType_t::Type Type);
+	//	once all of a container's children have been added, record its full extent
+	void			FinishNode(NodeIndex_t Index,Location_t Value);
 
 	std::string		Stringify(std::string_view Storage);
+
+	size_t						GetNodeCount() const	{	return GetNodes().size();	}
+	std::span<const MapNode_t>	GetNodes() const		{	return mMappedTree.empty() ? std::span<const MapNode_t>( mFlatTree ) : mMappedTree;	}
+	const MapNode_t&			GetNode(NodeIndex_t Index) const	{	return GetNodes()[Index];	}
+	NodeIndex_t					GetFirstChild(NodeIndex_t Index) const	{	return GetNode(Index).mChildCount ? Index+1 : InvalidNodeIndex;	}
+	//	returns InvalidNodeIndex if this is the last child of its parent
+	NodeIndex_t					GetNextSibling(NodeIndex_t Index) const;
+
+	//	returns InvalidNodeIndex if missing. Uses the key index if built
+	NodeIndex_t		FindChild(NodeIndex_t Parent,std::string_view Key,std::string_view Storage) const;
+	NodeIndex_t		FindChild(NodeIndex_t Parent,size_t ChildIndex) const;
+	//	find each key of the set (Children[KeyIndex], InvalidNodeIndex if missing) in one pass over
+	//	the members; the first of any duplicate keys is found, like FindChild. Returns number found
+	size_t			FindChildren(NodeIndex_t Parent,const KeySet_t& Keys,std::string_view Storage,std::span<NodeIndex_t> Children) const;
+	//	throwing versions
+	NodeIndex_t		GetChild(NodeIndex_t Parent,std::string_view Key,std::string_view Storage) const;
+	NodeIndex_t		GetChild(NodeIndex_t Parent,size_t ChildIndex) const;
+
+	//	hash index of keys for objects with at least MinChildren members, so lookups aren't a linear scan
+	void			BuildKeyIndex(std::string_view Storage,size_t MinChildren=16);
+	bool			HasKeyIndex() const		{	return !GetKeyIndex().empty();	}
+	size_t			GetKeyIndexMinChildren() const	{	return mKeyIndexMinChildren;	}
+	std::span<const NodeIndex_t>	GetKeyIndex() const	{	return mMappedKeyIndex.empty() ? std::span<const NodeIndex_t>( mKeyIndex ) : mMappedKeyIndex;	}
+
+	//	structural hash of every node's content, stored beside the nodes and built bottom-up in one pass.
+	//	Whitespace, object key order, string escapes and number formatting (1, 1.0, 1e0) don't change a
+	//	hash, so values which Patch::IsEqual are equal always hash the same; different hashes mean
+	//	different values. Adding nodes afterwards invalidates the hashes (HasContentHashes is false)
+	void			BuildContentHashes(std::string_view Storage);
+	bool			HasContentHashes() const	{	return !mContentHashes.empty() && mContentHashes.size() == GetNodeCount();	}
+	uint64_t		GetContentHash(NodeIndex_t Index) const;	//	throws if not built
+
+	//	numbers decoded while parsing with a policy which DecodeNumbers, per node. Null if this node
+	//	has no tape entry (not a number, or the map wasn't parsed with a tape) so callers parse the text
+	bool				HasNumberTape() const	{	return !mNumberTape.empty();	}
+	const TapeNumber_t*	GetTapeNumber(NodeIndex_t Index) const
+	{
+		if ( Index >= mNumberTape.size() || !mNumberTape[Index].IsNumber() )
+			return nullptr;
+		return &mNumberTape[Index];
+	}
+	void				SetTapeNumber(NodeIndex_t Index,const TapeNumber_t& Number);
+
+	//	point this map at externally owned (eg. memory mapped) nodes & key index; Owner is kept alive with the map
+	void			SetExternalData(std::shared_ptr<const void> Owner,std::span<const MapNode_t> Nodes,std::span<const NodeIndex_t> KeyIndex,size_t KeyIndexMinChildren);
+
+protected:
+	static uint64_t	GetKeyHash(NodeIndex_t Parent,std::string_view Key);
 	
 protected:
 	std::vector<MapNode_t>	mFlatTree;
+
+	//	open-addressed table of node indexes (InvalidNodeIndex when empty), size is a power of 2
+	std::vector<NodeIndex_t>	mKeyIndex;
+	size_t						mKeyIndexMinChildren = 0;
+
+	std::vector<uint64_t>		mContentHashes;		//	per node, see BuildContentHashes
+	std::vector<TapeNumber_t>	mNumberTape;		//	per node up to the last number, see GetTapeNumber
+
+	std::shared_ptr<const void>		mExternalOwner;
+	std::span<const MapNode_t>		mMappedTree;
+	std::span<const NodeIndex_t>	mMappedKeyIndex;
+};
+
+
+
+//	a node of a map and the data it maps. Nothing is owned or locked (like a string_view, the map
+//	and storage must outlive it) so it's cheap to copy, and iterating children neither allocates
+//	nor re-parses anything
+class PopJson::SliceReadOnly_t
+{
+public:
+	SliceReadOnly_t(){}
+	SliceReadOnly_t(const Map_t& Map,std::string_view Storage,NodeIndex_t Node=0) :
+		mMap		( &Map ),
+		mStorage	( Storage ),
+		mNode		( Node )
+	{
+	}
+
+	const MapNode_t&	GetNode() const			{	return mMap->GetNode(mNode);	}
+	NodeIndex_t			GetNodeIndex() const	{	return mNode;	}
+	ValueType_t::Type	GetType() const			{	return GetNode().GetType();	}
+	std::string_view	GetKey() const			{	return GetNode().GetKey(mStorage);	}		//	as it appears in the json (escaped)
+	std::string_view	GetRawValue() const		{	return GetNode().GetValuePosition().GetContents(mStorage);	}	//	objects & arrays don't include {} or []
+	size_t				GetChildCount() const	{	return GetNode().GetChildCount();	}
+	bool				IsValid() const			{	return mMap && mNode != InvalidNodeIndex;	}	//	false when default constructed, eg. a missing key from GetValues()
+
+	Result_t<SliceReadOnly_t>	TryGetValue(std::string_view Key) const;
+	Result_t<SliceReadOnly_t>	TryGetValue(size_t Index) const;
+	//	Values[KeyIndex] for each key of the set, missing keys are left invalid. Returns number found
+	size_t						GetValues(const KeySet_t& Keys,std::span<SliceReadOnly_t> Values) const;
+	//	numbers are read from the map's number tape when it has one
+	Result_t<int>				TryGetInteger() const;
+	Result_t<int64_t>			TryGetInteger64() const;
+	Result_t<double>			TryGetDouble() const;
+	Result_t<bool>				TryGetBool() const;
+	Result_t<std::string>		TryGetString() const;
+
+	//	forward ranges of (key, value) members of an object, or of the elements of an array (any
+	//	container's children can be iterated either way). Children are found by skipping each
+	//	sibling's descendants, so they can't be random access, but the child count is known
+	ChildRange_t<Member_t>			members() const;
+	ChildRange_t<SliceReadOnly_t>	elements() const;
+
+private:
+	const Map_t*		mMap = nullptr;
+	std::string_view	mStorage;
+	NodeIndex_t			mNode = InvalidNodeIndex;
+};
+
+class PopJson::Member_t
+{
+public:
+	std::string_view	mKey;		//	escaped
+	SliceReadOnly_t		mValue;
+};
+
+template<typename ELEMENT>
+class PopJson::ChildIterator_t
+{
+public:
+	//	dereferencing makes a value (a slice), so this is a c++20 forward iterator, but only a legacy input iterator
+	using iterator_concept = std::forward_iterator_tag;
+	using iterator_category = std::input_iterator_tag;
+	using value_type = ELEMENT;
+	using difference_type = std::ptrdiff_t;
+
+	ChildIterator_t(){}
+	ChildIterator_t(const Map_t& Map,std::string_view Storage,const MapNode_t* Node) :
+		mMap		( &Map ),
+		mStorage	( Storage ),
+		mNode		( Node )
+	{
+	}
+
+	ELEMENT				operator*() const
+	{
+		SliceReadOnly_t Slice( *mMap, mStorage, static_cast<NodeIndex_t>( mNode - mMap->GetNodes().data() ) );
+		if constexpr ( std::is_same_v<ELEMENT,Member_t> )
+			return Member_t{ mNode->GetKey(mStorage), Slice };
+		else
+			return Slice;
+	}
+	ChildIterator_t&	operator++()		{	mNode += 1 + mNode->GetDescendantCount();	return *this;	}
+	ChildIterator_t		operator++(int)		{	auto Previous = *this;	++*this;	return Previous;	}
+	bool				operator==(const ChildIterator_t& That) const	{	return mNode == That.mNode;	}
+
+private:
+	const Map_t*		mMap = nullptr;
+	std::string_view	mStorage;
+	const MapNode_t*	mNode = nullptr;
 };
 
+template<typename ELEMENT>
+class PopJson::ChildRange_t : public std::ranges::view_interface<ChildRange_t<ELEMENT>>
+{
+public:
+	ChildRange_t(){}
+	ChildRange_t(const Map_t& Map,std::string_view Storage,NodeIndex_t Parent)
+	{
+		auto* ParentNode = &Map.GetNode(Parent);
+		mBegin = ChildIterator_t<ELEMENT>( Map, Storage, ParentNode+1 );
+		mEnd = ChildIterator_t<ELEMENT>( Map, Storage, ParentNode+1+ParentNode->GetDescendantCount() );
+		mSize = ParentNode->GetChildCount();
+	}
+
+	ChildIterator_t<ELEMENT>	begin() const	{	return mBegin;	}
+	ChildIterator_t<ELEMENT>	end() const		{	return mEnd;	}
+	size_t						size() const	{	return mSize;	}
+
+private:
+	ChildIterator_t<ELEMENT>	mBegin;
+	ChildIterator_t<ELEMENT>	mEnd;
+	size_t						mSize = 0;
+};
+
+inline PopJson::ChildRange_t<PopJson::Member_t> PopJson::SliceReadOnly_t::members() const
+{
+	return ChildRange_t<Member_t>( *mMap, mStorage, mNode );
+}
+
+inline PopJson::ChildRange_t<PopJson::SliceReadOnly_t> PopJson::SliceReadOnly_t::elements() const
+{
+	return ChildRange_t<SliceReadOnly_t>( *mMap, mStorage, mNode );
+}
 
 
 class PopJson::Node_t
@@ -152,6 +612,8 @@ class PopJson::Value_t
 public:
 	Value_t(){}
 	Value_t(std::string_view Json,size_t WritePositionOffset=0);		//	parser
+	template<typename POLICY>
+	Value_t(std::string_view Json,POLICY Policy);						//	parser with a non-default policy, eg. Value_t( Json, JsoncPolicy_t() )
 	Value_t(ValueType_t::Type Type,Location_t Position) :
 		mType		( Type ),
 		mPosition	( Position )
@@ -163,9 +625,19 @@ public:
 	{
 		mNodes = Copy.mNodes;
 	}
+	Value_t(Value_t&& Move) noexcept :
+		mType		( Move.mType ),
+		mPosition	( Move.mPosition ),
+		mNodes		( std::move(Move.mNodes) )
+	{
+	}
 	virtual ~Value_t(){};
 
+	Value_t&			operator=(const Value_t& Copy)=default;
+	Value_t&			operator=(Value_t&& Move) noexcept=default;
+
 	ValueType_t::Type	GetType() const			{	return mType;	}
+	const Location_t&	GetPosition() const		{	return mPosition;	}
 	
 	//	these need storage, so should be protected
 public:
@@ -184,6 +656,18 @@ public:
 	Value_t				GetValue(size_t Index,std::string_view JsonData);			//	array element
 
 	bool				HasKey(std::string_view Key,std::string_view JsonData)		{	return GetNode( Key, JsonData, nullptr );	}
+
+	//	non-throwing versions; an optional field is a single lookup, and failures don't build messages
+	Result_t<int>		TryGetInteger(std::string_view JsonData);
+	Result_t<double>	TryGetDouble(std::string_view JsonData);
+	Result_t<bool>		TryGetBool();
+	Result_t<std::string>	TryGetString(std::string_view JsonData);	//	WrongType for anything but a string
+	Result_t<Value_t>	TryGetValue(std::string_view Key,std::string_view JsonData);
+	Result_t<Value_t>	TryGetValue(size_t Index,std::string_view JsonData);
+
+	//	Nodes[KeyIndex] for each key of the set (nullptr if missing), in one pass over the children,
+	//	without copying any values. Returns number found
+	size_t				FindNodes(const KeySet_t& Keys,std::string_view JsonData,std::span<Node_t*> Nodes);
 	
 public:
 	//	common helpers
@@ -219,13 +703,32 @@ class PopJson::ViewBase_t : public Value_t
 	friend class ValueProxy_t;	//	allow ValueProxy to do copy constructor
 protected:
 	ViewBase_t(const ViewBase_t& Copy) :
-		Value_t	( Copy )
+		Value_t		( Copy ),
+		mMap		( Copy.mMap ),
+		mMapIndex	( Copy.mMapIndex )
 	{
 	}
 	ViewBase_t&	operator=(const ViewBase_t& Copy)
 	{
 		auto& ThisValue = static_cast<Value_t&>(*this);
 		ThisValue = static_cast<const Value_t&>(Copy);
+		mMap = Copy.mMap;
+		mMapIndex = Copy.mMapIndex;
+		return *this;
+	}
+	//	moves the map, the lock is never moved (each object has its own)
+	ViewBase_t(ViewBase_t&& Move) noexcept :
+		Value_t		( std::move(static_cast<Value_t&>(Move)) ),
+		mMap		( std::move(Move.mMap) ),
+		mMapIndex	( Move.mMapIndex )
+	{
+	}
+	ViewBase_t&	operator=(ViewBase_t&& Move) noexcept
+	{
+		auto& ThisValue = static_cast<Value_t&>(*this);
+		ThisValue = std::move( static_cast<Value_t&>(Move) );
+		mMap = std::move( Move.mMap );
+		mMapIndex = Move.mMapIndex;
 		return *this;
 	}
 public:
@@ -234,6 +737,8 @@ public:
 		Value_t	( Copy )
 	{
 	}
+	//	backed by an already-parsed map; children are looked up in the map rather than re-parsed
+	ViewBase_t(std::shared_ptr<const Map_t> Map,NodeIndex_t Node);
 	
 	//	stringify
 	std::string			GetJsonString() const;
@@ -241,23 +746,43 @@ public:
 
 
 	//	read interface without requiring storage
-	int							GetInteger()					{	std::shared_lock Lock(mStorageLock);	return Value_t::GetInteger( GetStorageString() );	}
-	std::string_view			GetString(std::string& Buffer)	{	std::shared_lock Lock(mStorageLock);	return Value_t::GetString( Buffer, GetStorageString() );	}
-	std::string					GetString()						{	std::shared_lock Lock(mStorageLock);	return Value_t::GetString( GetStorageString() );	}
-	bool						GetBool()						{	std::shared_lock Lock(mStorageLock);	return Value_t::GetBool( GetStorageString() );	}
-	void						GetArray(std::vector<std::string>& Values)		{	std::shared_lock Lock(mStorageLock);	return Value_t::GetArray( Values, GetStorageString() );	}
+	int							GetInteger()					{	auto Lock = LockStorage();	return Value_t::GetInteger( GetStorageString() );	}
+	std::string_view			GetString(std::string& Buffer)	{	auto Lock = LockStorage();	return Value_t::GetString( Buffer, GetStorageString() );	}
+	std::string					GetString()						{	auto Lock = LockStorage();	return Value_t::GetString( GetStorageString() );	}
+	bool						GetBool()						{	auto Lock = LockStorage();	return Value_t::GetBool( GetStorageString() );	}
+	void						GetArray(std::vector<std::string>& Values)		{	auto Lock = LockStorage();	return Value_t::GetArray( Values, GetStorageString() );	}
 	std::vector<std::string>	GetStringArray()				{	std::vector<std::string> Values;	GetArray(Values);	return Values;	}
 
-	bool				HasKey(std::string_view Key)	{	std::shared_lock Lock(mStorageLock);	return Value_t::HasKey( Key, GetStorageString() );	}
+	bool				HasKey(std::string_view Key);
+
+	//	non-throwing read interface
+	Result_t<int>			TryGetInteger()		{	auto Lock = LockStorage();	return Value_t::TryGetInteger( GetStorageString() );	}
+	Result_t<double>		TryGetDouble()		{	auto Lock = LockStorage();	return Value_t::TryGetDouble( GetStorageString() );	}
+	Result_t<bool>			TryGetBool()		{	return Value_t::TryGetBool();	}
+	Result_t<std::string>	TryGetString()		{	auto Lock = LockStorage();	return Value_t::TryGetString( GetStorageString() );	}
+	Result_t<View_t>		TryGetValue(std::string_view Key);
+	Result_t<View_t>		TryGetValue(size_t Index);
+	//	one result per key of the set, in order, MissingKey for those not present
+	std::vector<Result_t<View_t>>	TryGetValues(const KeySet_t& Keys);
 
 	//	gr: this does a copy, we want to change this to return a View_t?
-	//Value_t				GetValue(std::string_view Key)	{	std::shared_lock Lock(mStorageLock);	return Value_t::GetValue( Key, GetStorageString() );	}
-	View_t				GetValue(std::string_view Key);//	{	std::shared_lock Lock(mStorageLock);	return Value_t::GetValue( Key, GetStorageString() );	}
+	//Value_t				GetValue(std::string_view Key)	{	auto Lock = LockStorage();	return Value_t::GetValue( Key, GetStorageString() );	}
+	View_t				GetValue(std::string_view Key);//	{	auto Lock = LockStorage();	return Value_t::GetValue( Key, GetStorageString() );	}
+	View_t				GetValue(size_t Index);
 	View_t				operator[](std::string_view Key);
 
+	bool				HasMap() const		{	return mMap != nullptr;	}
+
 protected:
+	std::shared_lock<std::shared_mutex>	LockStorage()	{	POPJSON_COUNT(LockAcquisition);	return std::shared_lock( mStorageLock );	}
+
 	std::shared_mutex			mStorageLock;		//	not needed in base class, but makes code a lot easier
 	virtual std::string_view	GetStorageString()=0;
+
+	//	optional parsed map this value is a node of. Writers must drop this when they change the structure
+	//	(Json_t only ever appends to storage, so the map stays valid for reading until then)
+	std::shared_ptr<const Map_t>	mMap;
+	NodeIndex_t						mMapIndex = InvalidNodeIndex;
 };
 	
 
@@ -268,6 +793,7 @@ class PopJson::View_t : public ViewBase_t
 {
 public:
 	View_t(std::string_view Json) :
+		ViewBase_t	( Json ),
 		mStorage	( Json )
 	{
 	}
@@ -276,6 +802,12 @@ public:
 		mStorage	( Storage )
 	{
 	}
+	//	view of a node in an existing map over Json; nothing is re-tokenized
+	View_t(std::shared_ptr<const Map_t> Map,NodeIndex_t Node,std::string_view Json) :
+		ViewBase_t	( Map, Node ),
+		mStorage	( Json )
+	{
+	}
 
 protected:
 	virtual std::string_view	GetStorageString() override	{	return mStorage;	}
@@ -292,12 +824,17 @@ class PopJson::ValueInput_t
 {
 public:
 	ValueInput_t();	//	undefined
-	ValueInput_t(const int& Value);	//	if we revert to just int, be wary of implicit conversion from float etc
-	ValueInput_t(const uint32_t& Value);
-	ValueInput_t(const uint64_t& Value);
-	ValueInput_t(const size_t& Value);	//	32bit && 64bit
+	template<typename TYPE> requires std::is_integral_v<TYPE> && (!std::is_same_v<TYPE,bool>)
+	ValueInput_t(const TYPE& Value)	//	one template for all integer types (size_t and uint64_t are the same type on some platforms)
+	{
+		if constexpr ( std::is_signed_v<TYPE> )
+			SetInteger( static_cast<int64_t>(Value) );
+		else
+			SetInteger( static_cast<uint64_t>(Value) );
+	}
 	ValueInput_t(const bool& Value);
 	ValueInput_t(const float& Value);
+	ValueInput_t(const double& Value);
 	ValueInput_t(const std::string& Value);
 	ValueInput_t(std::string_view Value);
 	ValueInput_t(const std::span<std::string_view>& Value);
@@ -306,8 +843,13 @@ public:
 	
 
 	//	gr: is there a way to avoid this alloc
+	//		Json_t::Set<TYPE>() avoids this whole class for numbers, bools & strings
 	std::string			mSerialisedValue;
 	ValueType_t::Type	mType = ValueType_t::Null;
+
+private:
+	void				SetInteger(int64_t Value);
+	void				SetInteger(uint64_t Value);
 };
 
 
@@ -317,37 +859,69 @@ public:
 class PopJson::Json_t : public ViewBase_t
 {
 	friend class ValueProxy_t;
+	friend class Patch::JsonTarget_t;
+	friend class Projection_t;		//	splits its pointers the same way
 public:
 	Json_t(){};
 	Json_t(std::string_view Json);		//	parser but copies the incoming data to become mutable
+	template<typename POLICY>
+	Json_t(std::string_view Json,POLICY Policy);
 	Json_t(ViewBase_t& Copy);
+	//	non-throwing parse
+	template<typename POLICY=StrictPolicy_t>
+	static Result_t<Json_t>	TryParse(std::string_view Json);
 	Json_t(const Json_t& Copy) :
 		ViewBase_t( Copy )	//	copy map
 	{
 		mStorage = Copy.mStorage;
+		mChildHashes = Copy.mChildHashes;
+		mRegions = Copy.mRegions;
 	}
-	Json_t(Json_t&& Move)
-		//ViewBase_t( Copy )
+	//	moves are O(1); the map and storage buffers are handed over, not copied
+	Json_t(Json_t&& Move) noexcept :
+		ViewBase_t	( std::move(static_cast<ViewBase_t&>(Move)) ),
+		mStorage	( std::move(Move.mStorage) ),
+		mChildHashes	( std::move(Move.mChildHashes) ),
+		mRegions	( std::move(Move.mRegions) )
 	{
-		*this = Move;	//	copy map
-		mStorage = std::move( Move.mStorage );
-	};
+	}
 	
-	Json_t&				operator=(const Json_t& Copy) noexcept
+	Json_t&				operator=(const Json_t& Copy)
 	{
-		static_cast<Value_t&>(*this) = Copy;
+		static_cast<ViewBase_t&>(*this) = Copy;	//	copy map
 		mStorage = Copy.mStorage;
+		mChildHashes = Copy.mChildHashes;
+		mRegions = Copy.mRegions;
 		return *this;
 	}
-	Json_t&				operator=(const Json_t&& Move) noexcept
+	Json_t&				operator=(Json_t&& Move) noexcept
 	{
-		static_cast<Value_t&>(*this) = Move;
+		static_cast<ViewBase_t&>(*this) = std::move( static_cast<ViewBase_t&>(Move) );
 		mStorage = std::move( Move.mStorage );
+		mChildHashes = std::move( Move.mChildHashes );
+		mRegions = std::move( Move.mRegions );
 		return *this;
 	}
 
+	//	pre-allocate storage & children so a known-size document can be built without reallocating
+	void				Reserve(size_t StorageBytes,size_t ChildCount);
+
 	//	write interface
 	void				Set(std::string_view Key,const ValueInput_t& Value);
+
+	//	numbers, bools and strings are formatted directly into storage (std::to_chars, doubles are shortest round-trip)
+	//	with no intermediate string allocation
+	template<typename TYPE> requires TypedValue_t<TYPE>
+	void				Set(std::string_view Key,const TYPE& Value)
+	{
+		POPJSON_PHASE(Write);
+		mMap.reset();
+		auto Node = AppendKeyToStorage( Key );
+		auto NodeValue = AppendTypedValueToStorage( Value );
+		Node.ReplaceValue( NodeValue );
+		mNodes.push_back( Node );
+		UpdateObjectType();
+	}
 	/*
 	void				Set(std::string_view Key,std::string_view Value);
 	void				Set(std::string_view Key,int32_t Value);
@@ -365,6 +939,124 @@ public:
 	//	may be able to template this one day...
 	//	this writes an array of strings!
 	void				PushBack(ViewBase_t& Value);
+	template<typename TYPE> requires TypedValue_t<TYPE>
+	void				PushBack(const TYPE& Value)
+	{
+		POPJSON_PHASE(Write);
+		mMap.reset();
+		if ( this->GetType() != ValueType_t::Array && this->GetType() != ValueType_t::Null )
+			throw std::runtime_error("Trying to append to non-array");
+
+		Node_t Node;
+		auto NodeValue = AppendTypedValueToStorage( Value );
+		Node.ReplaceValue( NodeValue );
+		mNodes.push_back( Node );
+		UpdateObjectType();
+	}
+	//	bulk writers; numbers, bools and strings are formatted straight into storage as a real json array
+	//	(numbers stay numbers) in one pass, after one reserve. With a key, the elements are appended to the
+	//	array member Key, which is added if missing; otherwise each is pushed onto this as an array
+	template<typename TYPE> requires TypedValue_t<TYPE>
+	void				PushBack(std::string_view Key,std::span<const TYPE> Values)		{	PushBackArray( Key, Values );	}
+	template<typename TYPE> requires TypedValue_t<TYPE>
+	void				PushBack(std::string_view Key,const std::vector<TYPE>& Values)	{	PushBackArray( Key, Values );	}
+	template<typename TYPE> requires TypedValue_t<TYPE>
+	void				PushBack(std::span<const TYPE> Values)
+	{
+		POPJSON_PHASE(Write);
+		mMap.reset();
+		if ( this->GetType() != ValueType_t::Array && this->GetType() != ValueType_t::Null )
+			throw std::runtime_error("Trying to append to non-array");
+
+		mStorage.reserve( mStorage.size() + GetArrayReserve( Values ) );
+		mNodes.reserve( mNodes.size() + Values.size() );
+		for ( auto& Value : Values )
+		{
+			Node_t Node;
+			auto NodeValue = AppendTypedValueToStorage( Value );
+			Node.ReplaceValue( NodeValue );
+			mNodes.push_back( Node );
+		}
+		UpdateObjectType();
+	}
+	//	single element appended to the array member Key (added if missing)
+	template<typename TYPE> requires TypedValue_t<TYPE>
+	void				PushBack(std::string_view Key,const TYPE& Value)
+	{
+		POPJSON_PHASE(Write);
+		auto Node = GetArrayMember( Key );
+		auto Start = mStorage.size();
+		AppendJsonValueToStorage( Value );
+		InsertIntoContainer( Node, std::string_view(), Start );
+	}
+
+	//	append to the array at Pointer (RFC 6901, eg. "/events" or "/a/b/0"), or add member Key to the
+	//	object at Pointer, in place. The top level value it's inside is moved to the end of storage once,
+	//	with spare capacity after it (doubled as it fills up), and from then on grows inside that; so an
+	//	append costs the new value's bytes, plus the bytes after the container inside its top level value,
+	//	and nothing is re-parsed (where a container ends is kept once found).
+	//	As with Set(), an existing key isn't replaced. "" is this (ie. PushBack or Set)
+	template<typename TYPE> requires TypedValue_t<TYPE>
+	void				PushBackAt(std::string_view Pointer,const TYPE& Value)
+	{
+		POPJSON_PHASE(Write);
+		if ( Pointer.empty() )
+			return PushBack( Value );
+		auto [Node,ChildPointer] = GetContainerNode( Pointer );
+		auto Start = mStorage.size();
+		AppendJsonValueToStorage( Value );
+		InsertIntoContainer( Node, ChildPointer, Start, ValueType_t::Array );
+	}
+	void				PushBackAt(std::string_view Pointer,const ValueInput_t& Value);
+	template<typename TYPE> requires TypedValue_t<TYPE>
+	void				SetAt(std::string_view Pointer,std::string_view Key,const TYPE& Value)
+	{
+		POPJSON_PHASE(Write);
+		if ( Pointer.empty() )
+			return Set( Key, Value );
+		auto [Node,ChildPointer] = GetContainerNode( Pointer );
+		auto Start = mStorage.size();
+		AppendMemberKeyToStorage( Key );
+		AppendJsonValueToStorage( Value );
+		InsertIntoContainer( Node, ChildPointer, Start, ValueType_t::Object );
+	}
+	void				SetAt(std::string_view Pointer,std::string_view Key,const ValueInput_t& Value);
+	template<typename RANGE> requires std::ranges::range<RANGE> && ( !TypedValue_t<RANGE> )
+	void				PushBackAt(std::string_view Pointer,const RANGE& Values)
+	{
+		POPJSON_PHASE(Write);
+		auto [Node,ChildPointer] = GetContainerNode( Pointer );
+		mStorage.reserve( mStorage.size() + GetArrayReserve( Values ) );
+		auto Start = mStorage.size();
+		for ( auto&& Value : Values )
+		{
+			if ( mStorage.size() != Start )
+				mStorage.push_back(',');
+			AppendJsonValueToStorage( static_cast<const std::ranges::range_value_t<RANGE>&>(Value) );
+		}
+		if ( mStorage.size() != Start )
+			InsertIntoContainer( Node, ChildPointer, Start, ValueType_t::Array );
+	}
+
+	//	set the value at Pointer, in place; replacing the value there, or adding it as a member of its
+	//	parent object ("-" appends to an array). Only the new value is written (after the top level
+	//	value it's inside has been given spare capacity, as with PushBackAt) and nothing else is
+	//	stringified or parsed. A top level value's node is just pointed at the new value
+	template<typename TYPE> requires TypedValue_t<TYPE>
+	void				SetAt(std::string_view Pointer,const TYPE& Value)
+	{
+		POPJSON_PHASE(Write);
+		auto Start = mStorage.size();
+		AppendJsonValueToStorage( Value );
+		SetJsonAt( Pointer, Start );
+	}
+	void				SetAt(std::string_view Pointer,const ValueInput_t& Value);
+
+	//	value at Pointer, false if it doesn't exist. Only the value is parsed, not the top level value
+	//	it's inside if that's been written to with the functions above
+	bool				GetValueAt(std::string_view Pointer,Value_t& Value);
+
+	//	strings made by GetStringValue for each value (prefer the typed writers above)
 	void				PushBack(std::span<uint32_t> Values,std::function<std::string(const uint32_t& Value)> GetStringValue);
 	void				PushBack(std::string_view Key,std::span<uint32_t> Values,std::function<std::string(const uint32_t& Value)> GetStringValue);
 	//void				PushBack(const Json_t& Value);	//	change to accept View_t
@@ -372,11 +1064,174 @@ public:
 	//	allow [] operator by giving out a mutable value... but might just have to be a proxy to Set()
 	ValueProxy_t		operator[](std::string_view Key);
 
+	//	RFC 6902 json patch & RFC 7396 merge patch, applied in place (see PopJsonPatch.hpp).
+	//	A top level value which is patched has its new json appended to storage; an operation inside
+	//	one is spliced into it in place (as SetAt), so costs the bytes it changes rather than a copy of
+	//	the whole value. The root can only be replaced with an object or array.
+	//	If an operation fails, this is left as it was
+	void				ApplyPatch(std::string_view Patch);
+	void				ApplyMergePatch(std::string_view Patch);
+
+	//	structural hash of the content, the same as Map_t::GetContentHash of this stringified.
+	//	Each top level child's hash is kept, and invalidated by any write inside it; such a child is
+	//	rehashed whole (one parse of its json), so an edit deep in a large child costs that child
+	uint64_t			GetContentHash();
+
 protected:
 	//	todo: we _could_ store the data here as a raw type (eg. int) and convert during write
 	//			to do that, have additional "non-stringified" value types for int, float, maybe even arrays
 	Node_t				AppendNodeToStorage(std::string_view Key,std::string_view ValueAsString,ValueType_t::Type Type);
 	Value_t				AppendValueToStorage(std::string_view ValueAsString,ValueType_t::Type Type);
+	Node_t				AppendKeyToStorage(std::string_view Key);
+
+	//	typed writers; strings are stored escaped (as they would be in parsed json)
+	Value_t				AppendIntegerToStorage(int64_t Value);
+	Value_t				AppendIntegerToStorage(uint64_t Value);
+	Value_t				AppendDoubleToStorage(double Value);
+	Value_t				AppendFloatToStorage(float Value);		//	shortest round-trip of the float, so 0.1f is 0.1
+	Value_t				AppendStringToStorage(std::string_view Value);
+	//	format Value at Buffer, which has at least 32 bytes; returns the end of it
+	static char*		FormatNumber(char* Buffer,int64_t Value);
+	static char*		FormatNumber(char* Buffer,uint64_t Value);
+	static char*		FormatNumber(char* Buffer,double Value);
+	static char*		FormatNumber(char* Buffer,float Value);
+	template<typename TYPE>
+	static char*		FormatTypedNumber(char* Buffer,TYPE Value)
+	{
+		if constexpr ( std::is_floating_point_v<TYPE> && !std::is_same_v<TYPE,float> )
+			return FormatNumber( Buffer, static_cast<double>(Value) );
+		else if constexpr ( std::is_floating_point_v<TYPE> )
+			return FormatNumber( Buffer, Value );
+		else if constexpr ( std::is_signed_v<TYPE> )
+			return FormatNumber( Buffer, static_cast<int64_t>(Value) );
+		else
+			return FormatNumber( Buffer, static_cast<uint64_t>(Value) );
+	}
+	template<typename TYPE>
+	Value_t				AppendTypedValueToStorage(const TYPE& Value)
+	{
+		if constexpr ( std::is_same_v<TYPE,bool> )
+			return Value_t( Value ? ValueType_t::BooleanTrue : ValueType_t::BooleanFalse, Location_t() );
+		else if constexpr ( std::is_same_v<TYPE,float> )
+			return AppendFloatToStorage( Value );
+		else if constexpr ( std::is_floating_point_v<TYPE> )
+			return AppendDoubleToStorage( static_cast<double>(Value) );
+		else if constexpr ( std::is_integral_v<TYPE> && std::is_signed_v<TYPE> )
+			return AppendIntegerToStorage( static_cast<int64_t>(Value) );
+		else if constexpr ( std::is_integral_v<TYPE> )
+			return AppendIntegerToStorage( static_cast<uint64_t>(Value) );
+		else
+			return AppendStringToStorage( std::string_view(Value) );
+	}
+
+	//	bytes to reserve for writing Values as array elements, with separators (strings may need more once escaped)
+	template<typename RANGE>
+	static size_t		GetArrayReserve(const RANGE& Values)
+	{
+		using ELEMENT = std::ranges::range_value_t<RANGE>;
+		if constexpr ( std::is_same_v<ELEMENT,bool> )
+			return std::size(Values) * 6;
+		else if constexpr ( std::is_floating_point_v<ELEMENT> )
+			return std::size(Values) * 25;
+		else if constexpr ( std::is_arithmetic_v<ELEMENT> )
+			return std::size(Values) * 21;
+		else
+		{
+			size_t Bytes = 0;
+			for ( auto& Value : Values )
+				Bytes += std::string_view(Value).size() + 3;
+			return Bytes;
+		}
+	}
+
+	//	elements are written (comma separated) to the end of storage, then EndArrayMember moves them
+	//	into the array member Key (which BeginArrayMember adds if missing)
+	class ArrayMemberWrite_t
+	{
+	public:
+		size_t		mNodeIndex = 0;
+		size_t		mStart = 0;				//	where the elements start
+		bool		mHasElements = false;	//	so the next element needs a comma
+	};
+	ArrayMemberWrite_t	BeginArrayMember(std::string_view Key,size_t ReserveBytes);
+	void				EndArrayMember(const ArrayMemberWrite_t& Write);
+	void				AppendQuotedStringToStorage(std::string_view Value);
+	void				AppendMemberKeyToStorage(std::string_view Key);		//	"key": with the key escaped
+	void				AppendJsonValueToStorage(const ValueInput_t& Value);
+	template<typename TYPE>
+	void				AppendJsonValueToStorage(const TYPE& Value)
+	{
+		if constexpr ( std::is_same_v<TYPE,bool> )
+		{
+			std::string_view Literal = Value ? "true" : "false";
+			mStorage.insert( mStorage.end(), Literal.begin(), Literal.end() );
+		}
+		else if constexpr ( std::is_arithmetic_v<TYPE> )
+			AppendTypedValueToStorage( Value );
+		else
+			AppendQuotedStringToStorage( Value );
+	}
+
+	//	index of the array member Key, which is added (empty) if missing
+	size_t				GetArrayMember(std::string_view Key);
+	//	first (unescaped) reference token of a pointer, and the rest of it
+	static std::pair<std::string,std::string_view>	SplitPointer(std::string_view Pointer);
+	//	index of the top level value with this (unescaped) key or index, SIZE_MAX if missing
+	size_t				FindChildNode(std::string_view Token);
+	//	the top level node Pointer is in, and the rest of the pointer inside that node
+	std::pair<size_t,std::string_view>	GetContainerNode(std::string_view Pointer);
+	//	move the json from Start to the end of storage into the container at ChildPointer inside node
+	//	Node (which is the container if ChildPointer is empty), after its last child
+	void				InsertIntoContainer(size_t Node,std::string_view ChildPointer,size_t Start,ValueType_t::Type ContainerType=ValueType_t::Array);
+	//	move the json from Start to the end of storage to Pointer
+	void				SetJsonAt(std::string_view Pointer,size_t Start);
+
+	template<typename RANGE>
+	void				PushBackArray(std::string_view Key,const RANGE& Values)
+	{
+		POPJSON_PHASE(Write);
+		using ELEMENT = std::ranges::range_value_t<RANGE>;
+		if constexpr ( std::is_arithmetic_v<ELEMENT> && !std::is_same_v<ELEMENT,bool> )
+		{
+			//	numbers are formatted straight into the reserved bytes, with 32 spare for the last one,
+			//	and storage is trimmed to what was written
+			auto Reserve = GetArrayReserve( Values ) + 32;
+			auto Write = BeginArrayMember( Key, Reserve );
+			auto Start = mStorage.size();
+			mStorage.resize( Start + Reserve );
+			char* Out = mStorage.data() + Start;
+			try
+			{
+				for ( auto&& Value : Values )
+				{
+					if ( Write.mHasElements )
+						*Out++ = ',';
+					Write.mHasElements = true;
+					Out = FormatTypedNumber( Out, static_cast<ELEMENT>(Value) );
+				}
+			}
+			catch(...)
+			{
+				mStorage.resize( Start );
+				throw;
+			}
+			mStorage.resize( Out - mStorage.data() );
+			EndArrayMember( Write );
+		}
+		else
+		{
+			auto Write = BeginArrayMember( Key, GetArrayReserve( Values ) );
+			for ( auto&& Value : Values )
+			{
+				if ( Write.mHasElements )
+					mStorage.push_back(',');
+				Write.mHasElements = true;
+				//	vector<bool> gives proxies
+				AppendJsonValueToStorage( static_cast<const ELEMENT&>(Value) );
+			}
+			EndArrayMember( Write );
+		}
+	}
 
 	//	if we modify our children (mNodes) we may be currently a null, but adding children turns us into an array or object
 	//	check for an invalid mix.
@@ -389,6 +1244,63 @@ private:
 	ValueType_t::Type	CalculateObjectType() const;
 
 	std::vector<char>	mStorage;
+
+	//	a child's hash is still valid while its node points at the same storage; values are only
+	//	ever appended, so a written child has a new position. A reverted patch only truncates storage
+	//	written during the patch, which no cached hash can point at
+	class ChildHash_t
+	{
+	public:
+		Location_t			mKeyPosition;
+		Location_t			mValuePosition;
+		ValueType_t::Type	mValueType = ValueType_t::Null;
+		bool				mHashed = false;
+		uint64_t			mHash = 0;
+	};
+	std::vector<ChildHash_t>	mChildHashes;	//	parallel to mNodes
+
+	//	a top level container written at the end of storage with spare capacity after it, so values
+	//	inside it can change in place (see PushBackAt). Keyed by its node's value position; a node which
+	//	has since been given a new value elsewhere doesn't find it
+	class RegionValue_t
+	{
+	public:
+		std::string	mPointer;		//	inside the node
+		size_t		mStart = 0;		//	json of the value, including its brackets or quotes
+		size_t		mEnd = 0;
+	};
+	class Region_t
+	{
+	public:
+		size_t		mEnd = 0;		//	end of the storage reserved
+		std::vector<RegionValue_t>	mValues;	//	values found inside the node, kept up to date as it changes
+	};
+	std::unordered_map<size_t,Region_t>	mRegions;
+
+	//	set while a json patch is applied; splices inside storage which existed before it are kept, so
+	//	a failed patch can undo them (anything written after that is truncated)
+	class SpliceLog_t
+	{
+	public:
+		class Splice_t
+		{
+		public:
+			size_t		mStart = 0;
+			std::string	mRemoved;
+			size_t		mInsertLength = 0;
+			size_t		mTailLength = 0;	//	bytes after the splice, up to the end of the node
+		};
+		size_t					mStorageSize = 0;
+		std::vector<Splice_t>	mSplices;
+	};
+	SpliceLog_t*		mSpliceLog = nullptr;
+
+	//	region of a top level container, moving it to one if there's not room for the json from Start to
+	//	the end of storage (which is moved after it, and Start updated)
+	Region_t&			GetRegion(size_t Node,size_t& Start);
+	const RegionValue_t*	FindRegionValue(Region_t& Region,size_t Node,std::string_view ChildPointer);	//	null if missing
+	//	replace [SpliceStart,SpliceEnd) inside the node's region with the json from Start to the end of storage
+	void				SpliceRegion(size_t Node,Region_t& Region,size_t SpliceStart,size_t SpliceEnd,size_t Start,bool Separator);
 };
 
 
@@ -399,36 +1311,81 @@ class PopJson::ValueProxy_t : public PopJson::ViewBase_t
 protected:
 	ValueProxy_t()=delete;
 	ValueProxy_t(Json_t& This,std::string_view Key) :
-		//ViewBase_t	( This.GetValue(Key) ),	//	copy elements to make this work as a viewbase
-		mJson		( This ),
-		mKey		( Key )
+		mKey		( Key ),
+		mPointer	( "/" ),
+		mJson		( This )
+	{
+		AppendPointerToken( mPointer, Key );
+	}
+	ValueProxy_t(Json_t& This,std::string_view Key,std::string Pointer) :
+		mKey		( Key ),
+		mPointer	( std::move(Pointer) ),
+		mJson		( This )
 	{
-		//	copy elements to make this work as a viewbase
-		//	but if this is a new [Element] then the key wont exist
-		if ( This.HasKey(Key) )
-		{
-			auto& ThisViewBase = *static_cast<ViewBase_t*>(this);
-			auto ExistingValue = This.GetValue(Key);
-			ThisViewBase = static_cast<ViewBase_t&>(ExistingValue);
-		}
 	}
 
 public:
+	//	json["a"]["b"]["c"] = x; nothing is read until the proxy is
+	ValueProxy_t	operator[](std::string_view Key)
+	{
+		auto Pointer = mPointer + "/";
+		AppendPointerToken( Pointer, Key );
+		return ValueProxy_t( mJson, Key, std::move(Pointer) );
+	}
+
 	//	enable the ability to do an effecient write straight into storage, and easy conversion
 	//	may be able to template this one day...
 	//	this writes an array of strings!
 	void			PushBack(std::span<uint32_t> Values,std::function<std::string(const uint32_t&)> WriteStringValue);
+	//	bulk typed writers (see Json_t::PushBack); a missing array is added
+	template<typename TYPE> requires TypedValue_t<TYPE>
+	void			PushBack(std::span<const TYPE> Values)			{	PushBackArray( Values );	}
+	template<typename TYPE> requires TypedValue_t<TYPE>
+	void			PushBack(const std::vector<TYPE>& Values)		{	PushBackArray( Values );	}
+	template<typename TYPE> requires TypedValue_t<TYPE>
+	void			PushBack(const TYPE& Value)
+	{
+		mLoaded = false;
+		if ( IsTopLevel() )
+			return mJson.PushBack( mKey, Value );
+		AddMissingArray();
+		mJson.PushBackAt( mPointer, Value );
+	}
 
-	ValueProxy_t&	operator=(const ValueInput_t& Value)	{	mJson.Set(mKey,Value);	return *this;	}
-	//ValueProxy_t&	operator=(std::string_view String)	{	mJson.Set(mKey,String);	return *this;	}
-	//ValueProxy_t&	operator=(bool Boolean)				{	mJson.Set(mKey,Boolean);	return *this;	}
-	//ValueProxy_t&	operator=(int Integer)				{	mJson.Set(mKey,Integer);	return *this;	}
-	//ValueProxy_t&	operator=(float Float)				{	mJson.Set(mKey,Float);	return *this;	}
+	//	the value is replaced in place (see Json_t::SetAt)
+	ValueProxy_t&	operator=(const ValueInput_t& Value)	{	mLoaded = false;	mJson.SetAt( mPointer, Value );	return *this;	}
+	template<typename TYPE> requires TypedValue_t<TYPE>
+	ValueProxy_t&	operator=(const TYPE& Value)			{	mLoaded = false;	mJson.SetAt( mPointer, Value );	return *this;	}
+
+	//	these don't need storage, so load the value first
+	ValueType_t::Type	GetType()			{	Load();	return Value_t::GetType();	}
+	size_t				GetChildCount()		{	Load();	return Value_t::GetChildCount();	}
+	std::span<Node_t>	GetChildren()		{	Load();	return Value_t::GetChildren();	}
+	Result_t<bool>		TryGetBool()		{	Load();	return Value_t::TryGetBool();	}
 
 protected:
-	virtual std::string_view	GetStorageString()		{	return mJson.GetStorageString();	}
-	
+	virtual std::string_view	GetStorageString()		{	Load();	return mJson.GetStorageString();	}
+
+private:
+	static void		AppendPointerToken(std::string& Pointer,std::string_view Key);
+	bool			IsTopLevel() const		{	return mPointer.find( '/', 1 ) == std::string::npos;	}
+	void			AddMissingArray();
+	//	copy the value to make this work as a viewbase; if this is a new [Element] then it won't exist
+	void			Load();
+
+	template<typename RANGE>
+	void			PushBackArray(const RANGE& Values)
+	{
+		mLoaded = false;
+		if ( IsTopLevel() )
+			return mJson.PushBack( mKey, Values );
+		AddMissingArray();
+		mJson.PushBackAt( mPointer, Values );
+	}
+
 private:
-	std::string		mKey;	//	the original caller may hold onto this proxy, but not their initial key in the []operator, so we need a copy
+	std::string		mKey;		//	the original caller may hold onto this proxy, but not their initial key in the []operator, so we need a copy
+	std::string		mPointer;	//	from the root of mJson
+	bool			mLoaded = false;
 	Json_t&			mJson;
 };
@@ -0,0 +1,172 @@
+#include "PopJsonColumns.hpp"
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+
+
+namespace
+{
+	using namespace PopJson;
+
+	//	each thread has at least this many rows, below that threads cost more than they save
+	constexpr size_t	MinRowsPerThread = 16*1024;
+
+	bool	IsNumber(ValueType_t::Type Type)	{	return Type == ValueType_t::NumberInteger || Type == ValueType_t::NumberDouble;	}
+
+	bool	ReadDouble(const Map_t& Map,const MapNode_t& Node,NodeIndex_t Index,std::string_view Json,double& Value)
+	{
+		if ( !IsNumber( Node.GetType() ) )
+			return false;
+		if ( auto* Number = Map.GetTapeNumber( Index ) )
+		{
+			Value = Number->GetDouble();
+			return true;
+		}
+		auto Raw = Node.GetValuePosition().GetContents( Json );
+		return std::from_chars( Raw.data(), Raw.data() + Raw.size(), Value ).ec == std::errc();
+	}
+
+	//	long integers are typed as doubles, so those are integers if they have no fraction or exponent
+	bool	ReadInteger(const Map_t& Map,const MapNode_t& Node,NodeIndex_t Index,std::string_view Json,int64_t& Value)
+	{
+		if ( !IsNumber( Node.GetType() ) )
+			return false;
+		if ( auto* Number = Map.GetTapeNumber( Index ) )
+		{
+			if ( Number->mKind != TapeNumber_t::Integer )
+				return false;
+			Value = Number->mInteger;
+			return true;
+		}
+		auto Raw = Node.GetValuePosition().GetContents( Json );
+		if ( Node.GetType() == ValueType_t::NumberDouble && Raw.find_first_of(".eE") != std::string_view::npos )
+			return false;
+		return std::from_chars( Raw.data(), Raw.data() + Raw.size(), Value ).ec == std::errc();
+	}
+
+	//	rows [FirstRow,FirstRow+RowCount), FirstNode is the first of them
+	void	ExtractRows(const Map_t& Map,std::string_view Json,const KeySet_t& Keys,std::vector<Column_t>& Columns,size_t FirstRow,NodeIndex_t FirstNode,size_t RowCount)
+	{
+		auto Nodes = Map.GetNodes();
+		std::vector<NodeIndex_t> Members( Keys.size() );
+		auto Node = FirstNode;
+		for ( auto Row=FirstRow;	Row<FirstRow+RowCount;	Row++, Node += 1 + Nodes[Node].GetDescendantCount() )
+		{
+			if ( Map.FindChildren( Node, Keys, Json, Members ) == 0 )
+				continue;
+
+			auto ValidBit = uint64_t(1) << (Row%64);
+			for ( size_t c=0;	c<Columns.size();	c++ )
+			{
+				auto Member = Members[c];
+				if ( Member == InvalidNodeIndex )
+					continue;
+				auto& Column = Columns[c];
+				auto& MemberNode = Nodes[Member];
+				bool Valid = false;
+				switch ( Column.mType )
+				{
+					case ColumnType_t::Double:
+						Valid = ReadDouble( Map, MemberNode, Member, Json, Column.mDoubles[Row] );
+						break;
+					case ColumnType_t::Integer:
+						Valid = ReadInteger( Map, MemberNode, Member, Json, Column.mIntegers[Row] );
+						break;
+					case ColumnType_t::String:
+						Valid = MemberNode.GetType() == ValueType_t::String;
+						if ( Valid )
+							Column.mStrings[Row] = MemberNode.GetValuePosition().GetContents( Json );
+						break;
+				}
+				if ( Valid )
+					Column.mValid[Row/64] |= ValidBit;
+			}
+		}
+	}
+}
+
+
+size_t PopJson::Column_t::GetValidCount() const
+{
+	size_t Count = 0;
+	for ( auto Word : mValid )
+		Count += std::popcount( Word );
+	return Count;
+}
+
+std::vector<PopJson::Column_t> PopJson::ExtractColumns(const Map_t& Map,std::string_view Json,NodeIndex_t Array,std::span<const ColumnSpec_t> Specs,size_t ThreadCount)
+{
+	auto& ArrayNode = Map.GetNode( Array );
+	if ( ArrayNode.GetType() != ValueType_t::Array )
+		throw std::runtime_error("Columns can only be extracted from an array");
+	size_t RowCount = ArrayNode.GetChildCount();
+
+	std::vector<std::string_view> KeyNames;
+	for ( auto& Spec : Specs )
+		KeyNames.push_back( Spec.mKey );
+	KeySet_t Keys( KeyNames );
+
+	//	every row is written in place, so columns are allocated once
+	std::vector<Column_t> Columns( Specs.size() );
+	for ( size_t c=0;	c<Specs.size();	c++ )
+	{
+		auto& Column = Columns[c];
+		Column.mKey = Specs[c].mKey;
+		Column.mType = Specs[c].mType;
+		Column.mRowCount = RowCount;
+		Column.mValid.assign( (RowCount+63)/64, 0 );
+		switch ( Column.mType )
+		{
+			case ColumnType_t::Double:	Column.mDoubles.resize( RowCount );	break;
+			case ColumnType_t::Integer:	Column.mIntegers.resize( RowCount );	break;
+			case ColumnType_t::String:	Column.mStrings.resize( RowCount );	break;
+		}
+	}
+	if ( RowCount == 0 )
+		return Columns;
+
+	ThreadCount = std::max<size_t>( 1, std::min( ThreadCount, RowCount / MinRowsPerThread ) );
+	if ( ThreadCount == 1 )
+	{
+		ExtractRows( Map, Json, Keys, Columns, 0, Array+1, RowCount );
+		return Columns;
+	}
+
+	//	the first row of each part is found by skipping its siblings, a read per row
+	size_t WordCount = (RowCount+63)/64;
+	size_t RowsPerPart = ( (WordCount + ThreadCount-1) / ThreadCount ) * 64;
+	std::vector<NodeIndex_t> PartFirstNodes;
+	auto Row = Array+1;
+	for ( size_t r=0;	r<RowCount;	r++, Row = Map.GetNextSibling(Row) )
+		if ( r % RowsPerPart == 0 )
+			PartFirstNodes.push_back( Row );
+	ThreadCount = PartFirstNodes.size();
+
+	std::vector<std::exception_ptr> Errors( ThreadCount );
+	auto ExtractPart = [&](size_t Part)
+	{
+		try
+		{
+			auto FirstRow = Part * RowsPerPart;
+			ExtractRows( Map, Json, Keys, Columns, FirstRow, PartFirstNodes[Part], std::min( RowsPerPart, RowCount - FirstRow ) );
+		}
+		catch(...)
+		{
+			Errors[Part] = std::current_exception();
+		}
+	};
+	std::vector<std::thread> Threads;
+	for ( size_t Part=1;	Part<ThreadCount;	Part++ )
+		Threads.emplace_back( ExtractPart, Part );
+	ExtractPart( 0 );
+	for ( auto& Thread : Threads )
+		Thread.join();
+
+	for ( auto& Error : Errors )
+		if ( Error )
+			std::rethrow_exception( Error );
+	return Columns;
+}
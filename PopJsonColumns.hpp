@@ -0,0 +1,65 @@
+/*
+	Columnar (struct of arrays) extraction from an array of objects.
+
+	Given the members wanted and their types, each row's members are found in one pass over it
+	(with a KeySet_t), and numbers & strings are converted straight from the json into columns
+	sized for every row up front. Strings aren't copied; a string column is views (offset & length)
+	into the json, in their escaped form. Rows where a member is missing, null, or of another type
+	have their bit clear in the column's validity bitmap (and a zero or empty value).
+
+	With ThreadCount > 1 the rows are split into parts of whole 64 row words, so threads never
+	write to the same validity word, and each part is extracted on its own thread.
+*/
+#pragma once
+
+#include "PopJson.hpp"
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace PopJson
+{
+	class ColumnSpec_t;
+	class Column_t;
+
+	//	a column per spec, in the same order. Array is a node of Map, which was parsed from Json.
+	//	Throws if Array isn't an array, or the same key is given twice
+	std::vector<Column_t>	ExtractColumns(const Map_t& Map,std::string_view Json,NodeIndex_t Array,std::span<const ColumnSpec_t> Specs,size_t ThreadCount=1);
+}
+
+
+namespace PopJson::ColumnType_t
+{
+	enum Type
+	{
+		Double,			//	any number
+		Integer,		//	numbers without a fraction or exponent, which fit in int64
+		String,
+	};
+}
+
+class PopJson::ColumnSpec_t
+{
+public:
+	std::string_view		mKey;		//	unescaped
+	ColumnType_t::Type		mType = ColumnType_t::Double;
+};
+
+class PopJson::Column_t
+{
+public:
+	bool				IsValid(size_t Row) const	{	return ( mValid[Row/64] >> (Row%64) ) & 1;	}
+	size_t				GetRowCount() const			{	return mRowCount;	}
+	size_t				GetValidCount() const;
+
+public:
+	std::string						mKey;
+	ColumnType_t::Type				mType = ColumnType_t::Double;
+	size_t							mRowCount = 0;
+	std::vector<uint64_t>			mValid;			//	bit per row
+	//	only the one of the column's type is filled
+	std::vector<double>				mDoubles;
+	std::vector<int64_t>			mIntegers;
+	std::vector<std::string_view>	mStrings;		//	escaped, into the json
+};
@@ -0,0 +1,204 @@
+#include "PopJsonInstrumentation.hpp"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define POPJSON_HAS_RDTSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define POPJSON_HAS_RDTSC
+#endif
+
+
+namespace
+{
+	std::atomic<uint64_t>	gPhaseTicks[PopJson::Instrumentation::Phase_t::Count];
+	std::atomic<uint64_t>	gPhaseCalls[PopJson::Instrumentation::Phase_t::Count];
+	std::atomic<uint64_t>	gCounters[PopJson::Instrumentation::Counter_t::Count];
+
+	std::atomic<uint64_t>	gDocumentBytes(0);
+	std::atomic<uint64_t>	gDocumentNodes(0);
+	std::atomic<uint64_t>	gDocumentMaxDepth(0);
+	std::atomic<uint64_t>	gDocumentStrings(0);
+	std::atomic<uint64_t>	gDocumentNumbers(0);
+	std::atomic<uint64_t>	gDocumentEscapes(0);
+
+	std::shared_mutex		gHandlerLock;
+	std::function<void(const PopJson::Instrumentation::DocumentStats_t&)>	gDocumentHandler;
+	std::function<void(std::string_view,uint64_t)>							gExportHandler;
+
+	thread_local bool		gPhaseActive = false;
+}
+
+
+uint64_t PopJson::Instrumentation::GetTicks()
+{
+#if defined(POPJSON_HAS_RDTSC)
+	return __rdtsc();
+#else
+	auto Now = std::chrono::steady_clock::now().time_since_epoch();
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(Now).count();
+#endif
+}
+
+const char* PopJson::Instrumentation::GetName(Phase_t::Type Phase)
+{
+	switch ( Phase )
+	{
+		case Phase_t::Parse:		return "parse";
+		case Phase_t::Reparse:		return "reparse";
+		case Phase_t::Unescape:		return "unescape";
+		case Phase_t::Stringify:	return "stringify";
+		case Phase_t::Write:		return "write";
+		default:					return "unknown";
+	}
+}
+
+const char* PopJson::Instrumentation::GetName(Counter_t::Type Counter)
+{
+	switch ( Counter )
+	{
+		case Counter_t::Document:			return "documents";
+		case Counter_t::Reparse:			return "reparses";
+		case Counter_t::AllocationSite:		return "allocation_sites";
+		case Counter_t::LockAcquisition:	return "lock_acquisitions";
+		default:							return "unknown";
+	}
+}
+
+void PopJson::Instrumentation::AddPhaseTicks(Phase_t::Type Phase,uint64_t Ticks)
+{
+	if constexpr ( !Enabled )
+		return;
+	gPhaseTicks[Phase].fetch_add( Ticks, std::memory_order_relaxed );
+	gPhaseCalls[Phase].fetch_add( 1, std::memory_order_relaxed );
+}
+
+void PopJson::Instrumentation::Increment(Counter_t::Type Counter,uint64_t Amount)
+{
+	if constexpr ( !Enabled )
+		return;
+	gCounters[Counter].fetch_add( Amount, std::memory_order_relaxed );
+}
+
+void PopJson::Instrumentation::OnDocumentParsed(const DocumentStats_t& Stats)
+{
+	if constexpr ( !Enabled )
+		return;
+
+	Increment( Counter_t::Document );
+	gDocumentBytes.fetch_add( Stats.mBytes, std::memory_order_relaxed );
+	gDocumentNodes.fetch_add( Stats.mNodeCount, std::memory_order_relaxed );
+	gDocumentStrings.fetch_add( Stats.mStringCount, std::memory_order_relaxed );
+	gDocumentNumbers.fetch_add( Stats.mNumberCount, std::memory_order_relaxed );
+	gDocumentEscapes.fetch_add( Stats.mEscapeCount, std::memory_order_relaxed );
+	auto MaxDepth = gDocumentMaxDepth.load( std::memory_order_relaxed );
+	while ( Stats.mMaxDepth > MaxDepth && !gDocumentMaxDepth.compare_exchange_weak( MaxDepth, Stats.mMaxDepth ) )
+	{
+	}
+
+	std::shared_lock Lock( gHandlerLock );
+	if ( gDocumentHandler )
+		gDocumentHandler( Stats );
+}
+
+PopJson::Instrumentation::Snapshot_t PopJson::Instrumentation::GetSnapshot()
+{
+	Snapshot_t Snapshot;
+	for ( int p=0;	p<Phase_t::Count;	p++ )
+	{
+		Snapshot.mPhaseTicks[p] = gPhaseTicks[p].load();
+		Snapshot.mPhaseCalls[p] = gPhaseCalls[p].load();
+	}
+	for ( int c=0;	c<Counter_t::Count;	c++ )
+		Snapshot.mCounters[c] = gCounters[c].load();
+
+	Snapshot.mDocumentTotals.mBytes = gDocumentBytes.load();
+	Snapshot.mDocumentTotals.mNodeCount = gDocumentNodes.load();
+	Snapshot.mDocumentTotals.mMaxDepth = gDocumentMaxDepth.load();
+	Snapshot.mDocumentTotals.mStringCount = gDocumentStrings.load();
+	Snapshot.mDocumentTotals.mNumberCount = gDocumentNumbers.load();
+	Snapshot.mDocumentTotals.mEscapeCount = gDocumentEscapes.load();
+	return Snapshot;
+}
+
+void PopJson::Instrumentation::Reset()
+{
+	for ( int p=0;	p<Phase_t::Count;	p++ )
+	{
+		gPhaseTicks[p] = 0;
+		gPhaseCalls[p] = 0;
+	}
+	for ( int c=0;	c<Counter_t::Count;	c++ )
+		gCounters[c] = 0;
+	gDocumentBytes = 0;
+	gDocumentNodes = 0;
+	gDocumentMaxDepth = 0;
+	gDocumentStrings = 0;
+	gDocumentNumbers = 0;
+	gDocumentEscapes = 0;
+}
+
+void PopJson::Instrumentation::SetDocumentHandler(std::function<void(const DocumentStats_t&)> Handler)
+{
+	std::unique_lock Lock( gHandlerLock );
+	gDocumentHandler = Handler;
+}
+
+void PopJson::Instrumentation::SetExportHandler(std::function<void(std::string_view Name,uint64_t Value)> Handler)
+{
+	std::unique_lock Lock( gHandlerLock );
+	gExportHandler = Handler;
+}
+
+void PopJson::Instrumentation::Export()
+{
+	std::shared_lock Lock( gHandlerLock );
+	if ( !gExportHandler )
+		return;
+
+	auto Snapshot = GetSnapshot();
+	std::string Name;
+	for ( int p=0;	p<Phase_t::Count;	p++ )
+	{
+		auto Phase = static_cast<Phase_t::Type>(p);
+		Name = std::string("popjson.phase.") + GetName(Phase);
+		gExportHandler( Name + ".ticks", Snapshot.mPhaseTicks[p] );
+		gExportHandler( Name + ".calls", Snapshot.mPhaseCalls[p] );
+	}
+	for ( int c=0;	c<Counter_t::Count;	c++ )
+	{
+		Name = std::string("popjson.") + GetName( static_cast<Counter_t::Type>(c) );
+		gExportHandler( Name, Snapshot.mCounters[c] );
+	}
+	auto& Totals = Snapshot.mDocumentTotals;
+	gExportHandler( "popjson.document.bytes", Totals.mBytes );
+	gExportHandler( "popjson.document.nodes", Totals.mNodeCount );
+	gExportHandler( "popjson.document.max_depth", Totals.mMaxDepth );
+	gExportHandler( "popjson.document.strings", Totals.mStringCount );
+	gExportHandler( "popjson.document.numbers", Totals.mNumberCount );
+	gExportHandler( "popjson.document.escapes", Totals.mEscapeCount );
+}
+
+
+PopJson::Instrumentation::ScopedPhase_t::ScopedPhase_t(Phase_t::Type Phase) :
+	mPhase	( Phase )
+{
+	if ( gPhaseActive )
+		return;
+	gPhaseActive = true;
+	mOutermost = true;
+	mStartTicks = GetTicks();
+}
+
+PopJson::Instrumentation::ScopedPhase_t::~ScopedPhase_t()
+{
+	if ( !mOutermost )
+		return;
+	AddPhaseTicks( mPhase, GetTicks() - mStartTicks );
+	gPhaseActive = false;
+}
@@ -0,0 +1,122 @@
+/*
+	Optional instrumentation of parsing & access.
+
+	Compile with POPJSON_INSTRUMENTATION=1 (cmake -DPOPJSON_INSTRUMENTATION=ON) to enable.
+	When disabled, POPJSON_PHASE/POPJSON_COUNT expand to nothing and per-document stats
+	are skipped with if constexpr, so there is no cost in the parser or accessors.
+	The functions below still exist (returning zeros) so calling code doesn't need #ifs.
+
+	Phases are timed in cycles (rdtsc where available, otherwise nanoseconds) and are
+	inclusive; only the outermost phase on a thread is timed, so a re-parse inside
+	stringify is stringify time (but still increments the Reparse counter).
+	The parser is single-pass, so tokenizing and tree building are one Parse phase.
+*/
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+#if !defined(POPJSON_INSTRUMENTATION)
+#define POPJSON_INSTRUMENTATION	0
+#endif
+
+namespace PopJson::Instrumentation
+{
+	constexpr bool	Enabled = POPJSON_INSTRUMENTATION != 0;
+
+	namespace Phase_t
+	{
+		enum Type
+		{
+			Parse,			//	Value_t/View_t/Json_t parsing a document
+			Reparse,		//	Node_t::GetValue re-parsing an object or array
+			Unescape,		//	decoding escaped strings
+			Stringify,		//	GetJsonString
+			Write,			//	Json_t::Set/PushBack
+
+			Count
+		};
+	}
+
+	namespace Counter_t
+	{
+		enum Type
+		{
+			Document,			//	documents parsed (not including re-parses)
+			Reparse,
+			AllocationSite,		//	approximate: passes through the main allocating paths (parsed node array growth,
+								//	unescaped strings, stringify). Not every heap allocation; map, Json_t storage and
+								//	stream growth aren't counted, so use an allocator hook for exact numbers
+			LockAcquisition,	//	ViewBase_t storage locks
+
+			Count
+		};
+	}
+
+	class DocumentStats_t;
+	class Snapshot_t;
+	class ScopedPhase_t;
+
+	uint64_t		GetTicks();
+	const char*		GetName(Phase_t::Type Phase);
+	const char*		GetName(Counter_t::Type Counter);
+
+	void			AddPhaseTicks(Phase_t::Type Phase,uint64_t Ticks);
+	void			Increment(Counter_t::Type Counter,uint64_t Amount=1);
+	void			OnDocumentParsed(const DocumentStats_t& Stats);
+
+	Snapshot_t		GetSnapshot();
+	void			Reset();
+
+	//	called after every document is parsed (on the parsing thread)
+	void			SetDocumentHandler(std::function<void(const DocumentStats_t&)> Handler);
+	//	Export() flattens a snapshot into named metrics (eg. "popjson.phase.parse.ticks") and passes each to this handler
+	void			SetExportHandler(std::function<void(std::string_view Name,uint64_t Value)> Handler);
+	void			Export();
+}
+
+
+class PopJson::Instrumentation::DocumentStats_t
+{
+public:
+	uint64_t	mBytes = 0;
+	uint64_t	mNodeCount = 0;		//	every value, including containers
+	uint64_t	mMaxDepth = 0;
+	uint64_t	mStringCount = 0;	//	string values and keys
+	uint64_t	mNumberCount = 0;
+	uint64_t	mEscapeCount = 0;	//	backslash escapes in strings & keys
+};
+
+class PopJson::Instrumentation::Snapshot_t
+{
+public:
+	uint64_t		mPhaseTicks[Phase_t::Count] = {};
+	uint64_t		mPhaseCalls[Phase_t::Count] = {};
+	uint64_t		mCounters[Counter_t::Count] = {};
+	DocumentStats_t	mDocumentTotals;	//	sum of all documents (max depth is the maximum)
+};
+
+//	only the outermost phase on a thread records time
+class PopJson::Instrumentation::ScopedPhase_t
+{
+public:
+	ScopedPhase_t(Phase_t::Type Phase);
+	~ScopedPhase_t();
+
+	bool			IsOutermost() const	{	return mOutermost;	}
+
+private:
+	Phase_t::Type	mPhase;
+	bool			mOutermost = false;
+	uint64_t		mStartTicks = 0;
+};
+
+
+#if POPJSON_INSTRUMENTATION
+#define POPJSON_PHASE(Phase)	PopJson::Instrumentation::ScopedPhase_t PopJsonPhase( PopJson::Instrumentation::Phase_t::Phase )
+#define POPJSON_COUNT(Counter)	PopJson::Instrumentation::Increment( PopJson::Instrumentation::Counter_t::Counter )
+#else
+#define POPJSON_PHASE(Phase)	((void)0)
+#define POPJSON_COUNT(Counter)	((void)0)
+#endif
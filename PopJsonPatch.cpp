@@ -0,0 +1,1730 @@
+#include "PopJsonPatch.hpp"
+#include "PopJsonScan.hpp"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstring>
+#include <exception>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+
+namespace
+{
+	using namespace PopJson;
+
+	typedef std::vector<std::string> Tokens_t;
+
+	//	replace [mStart,mEnd) of the source with mText. Inserts have mStart==mEnd
+	class Edit_t
+	{
+	public:
+		size_t		mStart = 0;
+		size_t		mEnd = 0;
+		std::string	mText = {};
+	};
+
+	//	append Source[Start,End) to Output with the edits (which must be inside it, and not overlap) applied
+	void Splice(std::string_view Source,size_t Start,size_t End,std::vector<Edit_t>& Edits,std::string& Output)
+	{
+		//	an insert goes before an edit starting at the same position; inserts at the same position stay in order
+		std::stable_sort( Edits.begin(), Edits.end(), [](const Edit_t& a,const Edit_t& b)
+		{
+			return a.mStart < b.mStart || ( a.mStart == b.mStart && a.mEnd < b.mEnd );
+		});
+
+		auto Cursor = Start;
+		for ( auto& Edit : Edits )
+		{
+			if ( Edit.mStart < Cursor || Edit.mEnd > End )
+				throw std::runtime_error("Overlapping json patch edits");
+			Output.append( Source.data()+Cursor, Edit.mStart-Cursor );
+			Output.append( Edit.mText );
+			Cursor = Edit.mEnd;
+		}
+		Output.append( Source.data()+Cursor, End-Cursor );
+	}
+
+	size_t GetEnd(const Location_t& Location)
+	{
+		return Location.mPosition + Location.mLength;
+	}
+
+	//	the whole value, including quotes or brackets
+	Location_t GetValueSpan(const MapNode_t& Node)
+	{
+		auto& Position = Node.GetValuePosition();
+		auto Type = Node.GetType();
+		if ( Type == ValueType_t::String || Type == ValueType_t::Object || Type == ValueType_t::Array )
+			return Location_t( Position.mPosition-1, Position.mLength+2 );
+		return Position;
+	}
+
+	std::string_view GetValueJson(const Map_t& Map,std::string_view Json,NodeIndex_t Node)
+	{
+		return GetValueSpan( Map.GetNode(Node) ).GetContents( Json );
+	}
+
+	//	start of an element, or a member's key
+	size_t GetChildStart(const Map_t& Map,NodeIndex_t Child)
+	{
+		auto& Node = Map.GetNode(Child);
+		//	the key of an empty key is empty, so use the parent's type rather than HasKey()
+		if ( Map.GetNode( Node.GetParentIndex() ).GetType() == ValueType_t::Object )
+			return Node.GetKeyPosition().mPosition - 1;
+		return GetValueSpan( Node ).mPosition;
+	}
+
+	NodeIndex_t GetLastChild(const Map_t& Map,NodeIndex_t Container)
+	{
+		auto Last = InvalidNodeIndex;
+		for ( auto Child=Map.GetFirstChild(Container);	Child!=InvalidNodeIndex;	Child=Map.GetNextSibling(Child) )
+			Last = Child;
+		return Last;
+	}
+
+	//	deletions for the children IsRemoved() picks, which leave the separators between the rest valid.
+	//	A removed child takes the comma before it if anything before it is kept, otherwise the one after it.
+	//	returns the number of children kept
+	template<typename IS_REMOVED>
+	size_t RemoveChildren(const Map_t& Map,NodeIndex_t Container,IS_REMOVED IsRemoved,std::vector<Edit_t>& Edits)
+	{
+		size_t Kept = 0;
+		auto Previous = InvalidNodeIndex;
+		for ( auto Child=Map.GetFirstChild(Container);	Child!=InvalidNodeIndex;	)
+		{
+			auto Next = Map.GetNextSibling(Child);
+			if ( !IsRemoved(Child) )
+				Kept++;
+			else if ( Kept > 0 )
+				Edits.push_back( { GetEnd( GetValueSpan( Map.GetNode(Previous) ) ), GetEnd( GetValueSpan( Map.GetNode(Child) ) ) } );
+			else if ( Next != InvalidNodeIndex )
+				Edits.push_back( { GetChildStart( Map, Child ), GetChildStart( Map, Next ) } );
+			else
+				Edits.push_back( { GetChildStart( Map, Child ), GetEnd( GetValueSpan( Map.GetNode(Child) ) ) } );
+			Previous = Child;
+			Child = Next;
+		}
+		return Kept;
+	}
+
+	//	insert members/elements (comma separated json) after the last child of a container
+	void AppendChildren(const Map_t& Map,NodeIndex_t Container,bool HasChildren,std::string_view Children,std::vector<Edit_t>& Edits)
+	{
+		auto Last = GetLastChild( Map, Container );
+		auto Position = Last == InvalidNodeIndex ? Map.GetNode(Container).GetValuePosition().mPosition : GetEnd( GetValueSpan( Map.GetNode(Last) ) );
+		auto& Edit = Edits.emplace_back( Edit_t{ Position, Position } );
+		if ( HasChildren )
+			Edit.mText.push_back(',');
+		Edit.mText.append( Children );
+	}
+
+	std::string GetEscapedKey(std::string_view Key)
+	{
+		std::vector<char> Escaped;
+		AppendEscapedString( Escaped, Key );
+		return std::string( Escaped.data(), Escaped.size() );
+	}
+
+	//	"key": as it would be written in an object
+	void AppendMemberKey(std::string& Json,std::string_view EscapedKey)
+	{
+		Json.push_back('"');
+		Json.append( EscapedKey );
+		Json.append("\":");
+	}
+
+	//	keys in the map are escaped, so a token with characters which need escaping is escaped to match
+	bool NeedsEscaping(std::string_view Key)
+	{
+		for ( auto Char : Key )
+			if ( static_cast<uint8_t>(Char) < 0x20 || Char == '"' || Char == '\\' )
+				return true;
+		return false;
+	}
+
+	NodeIndex_t FindMember(const Map_t& Map,std::string_view Json,NodeIndex_t Object,std::string_view Key)
+	{
+		if ( NeedsEscaping(Key) )
+			return Map.FindChild( Object, GetEscapedKey(Key), Json );
+		return Map.FindChild( Object, Key, Json );
+	}
+
+	//	array index token; digits without leading zeros. SIZE_MAX if invalid
+	size_t GetArrayIndex(std::string_view Token)
+	{
+		if ( Token.empty() || ( Token.size() > 1 && Token[0] == '0' ) )
+			return SIZE_MAX;
+		size_t Index = 0;
+		auto Result = std::from_chars( Token.data(), Token.data()+Token.size(), Index );
+		if ( Result.ec != std::errc() || Result.ptr != Token.data()+Token.size() )
+			return SIZE_MAX;
+		return Index;
+	}
+
+	NodeIndex_t FindToken(const Map_t& Map,std::string_view Json,NodeIndex_t Node,std::string_view Token)
+	{
+		auto& Parent = Map.GetNode(Node);
+		if ( Parent.GetType() == ValueType_t::Object )
+			return FindMember( Map, Json, Node, Token );
+		if ( Parent.GetType() == ValueType_t::Array )
+		{
+			auto Index = GetArrayIndex( Token );
+			if ( Index >= Parent.GetChildCount() )
+				return InvalidNodeIndex;
+			return Map.FindChild( Node, Index );
+		}
+		return InvalidNodeIndex;
+	}
+
+	//	unescaped (~0 ~1) reference tokens of a json pointer
+	Tokens_t GetPointerTokens(std::string_view Pointer)
+	{
+		Tokens_t Tokens;
+		if ( Pointer.empty() )
+			return Tokens;
+		if ( Pointer[0] != '/' )
+			throw std::runtime_error("Json pointer \"" + std::string(Pointer) + "\" doesn't start with /");
+
+		Tokens.emplace_back();
+		for ( size_t i=1;	i<Pointer.size();	i++ )
+		{
+			auto Char = Pointer[i];
+			if ( Char == '/' )
+			{
+				Tokens.emplace_back();
+				continue;
+			}
+			if ( Char == '~' )
+			{
+				auto Escaped = i+1 < Pointer.size() ? Pointer[++i] : 0;
+				if ( Escaped != '0' && Escaped != '1' )
+					throw std::runtime_error("Json pointer \"" + std::string(Pointer) + "\" has an invalid ~ escape");
+				Char = Escaped == '0' ? '~' : '/';
+			}
+			Tokens.back().push_back( Char );
+		}
+		return Tokens;
+	}
+
+	NodeIndex_t FindTokens(const Map_t& Map,std::string_view Json,const Tokens_t& Tokens,size_t Count,NodeIndex_t Node=0)
+	{
+		for ( size_t t=0;	t<Count && Node!=InvalidNodeIndex;	t++ )
+			Node = FindToken( Map, Json, Node, Tokens[t] );
+		return Node;
+	}
+
+	bool IsPrefix(const Tokens_t& Prefix,const Tokens_t& Path)
+	{
+		return Prefix.size() <= Path.size() && std::equal( Prefix.begin(), Prefix.end(), Path.begin() );
+	}
+
+	//	is Path a sibling of Child, or inside a sibling
+	bool IsInParent(const Tokens_t& Child,const Tokens_t& Path)
+	{
+		return !Child.empty() && Child.size() <= Path.size() && std::equal( Child.begin(), Child.end()-1, Path.begin() );
+	}
+
+	//	a merge patch value written as a new value; members with null values are removed from (nested) objects
+	std::string GetMergeValue(const Map_t& Patch,std::string_view PatchJson,NodeIndex_t Node)
+	{
+		auto Span = GetValueSpan( Patch.GetNode(Node) );
+		std::vector<Edit_t> Edits;
+		std::vector<NodeIndex_t> Objects;
+		if ( Patch.GetNode(Node).GetType() == ValueType_t::Object )
+			Objects.push_back( Node );
+		while ( !Objects.empty() )
+		{
+			auto Object = Objects.back();
+			Objects.pop_back();
+			auto IsNull = [&](NodeIndex_t Child)	{	return Patch.GetNode(Child).GetType() == ValueType_t::Null;	};
+			RemoveChildren( Patch, Object, IsNull, Edits );
+			for ( auto Child=Patch.GetFirstChild(Object);	Child!=InvalidNodeIndex;	Child=Patch.GetNextSibling(Child) )
+				if ( Patch.GetNode(Child).GetType() == ValueType_t::Object )
+					Objects.push_back( Child );
+		}
+		std::string Value;
+		Splice( PatchJson, Span.mPosition, GetEnd(Span), Edits, Value );
+		return Value;
+	}
+
+	//	edits merging the patch object into the target object (RFC 7396), for every level where both are objects
+	void AddMergeEdits(const Map_t& Map,std::string_view Json,NodeIndex_t Target,const Map_t& Patch,std::string_view PatchJson,NodeIndex_t PatchObject,std::vector<Edit_t>& Edits)
+	{
+		std::vector<std::pair<NodeIndex_t,NodeIndex_t>> Objects = { { Target, PatchObject } };
+		std::vector<NodeIndex_t> Removed;
+		std::string Added;
+		while ( !Objects.empty() )
+		{
+			auto [TargetObject,PatchMembers] = Objects.back();
+			Objects.pop_back();
+			Removed.clear();
+			Added.clear();
+
+			for ( auto PatchMember=Patch.GetFirstChild(PatchMembers);	PatchMember!=InvalidNodeIndex;	PatchMember=Patch.GetNextSibling(PatchMember) )
+			{
+				auto& PatchNode = Patch.GetNode(PatchMember);
+				auto Key = PatchNode.GetKey(PatchJson);
+				auto Existing = Map.FindChild( TargetObject, Key, Json );
+				if ( PatchNode.GetType() == ValueType_t::Null )
+				{
+					if ( Existing != InvalidNodeIndex )
+						Removed.push_back( Existing );
+				}
+				else if ( Existing == InvalidNodeIndex )
+				{
+					if ( !Added.empty() )
+						Added.push_back(',');
+					AppendMemberKey( Added, Key );
+					Added.append( GetMergeValue( Patch, PatchJson, PatchMember ) );
+				}
+				else if ( PatchNode.GetType() == ValueType_t::Object && Map.GetNode(Existing).GetType() == ValueType_t::Object )
+				{
+					Objects.push_back( { Existing, PatchMember } );
+				}
+				else
+				{
+					auto Span = GetValueSpan( Map.GetNode(Existing) );
+					Edits.push_back( { Span.mPosition, GetEnd(Span), GetMergeValue( Patch, PatchJson, PatchMember ) } );
+				}
+			}
+
+			auto Kept = Map.GetNode(TargetObject).GetChildCount();
+			if ( !Removed.empty() )
+			{
+				std::sort( Removed.begin(), Removed.end() );
+				auto IsRemoved = [&](NodeIndex_t Child)	{	return std::binary_search( Removed.begin(), Removed.end(), Child );	};
+				Kept = RemoveChildren( Map, TargetObject, IsRemoved, Edits );
+			}
+			if ( !Added.empty() )
+				AppendChildren( Map, TargetObject, Kept > 0, Added, Edits );
+		}
+	}
+
+	std::string GetMemberString(const Map_t& Map,std::string_view Json,NodeIndex_t Object,std::string_view Key,bool Required)
+	{
+		auto Member = Map.FindChild( Object, Key, Json );
+		if ( Member == InvalidNodeIndex )
+		{
+			if ( !Required )
+				return std::string();
+			throw std::runtime_error("missing \"" + std::string(Key) + "\"");
+		}
+		if ( Map.GetNode(Member).GetType() != ValueType_t::String )
+			throw std::runtime_error("\"" + std::string(Key) + "\" is not a string");
+		return Map.GetNode(Member).GetValue().GetString( Json );
+	}
+
+	//	runs each operation of a json patch against TARGET's Read/Test/Add/Remove/Replace
+	template<typename TARGET>
+	void ApplyOperations(TARGET& Target,std::string_view PatchJson)
+	{
+		auto Patch = Parse( PatchJson );
+		if ( Patch.GetNode(0).GetType() != ValueType_t::Array )
+			throw std::runtime_error("Json patch is not an array of operations");
+
+		size_t OperationIndex = 0;
+		for ( auto Operation=Patch.GetFirstChild(0);	Operation!=InvalidNodeIndex;	Operation=Patch.GetNextSibling(Operation), OperationIndex++ )
+		{
+			std::string Op;
+			try
+			{
+				if ( Patch.GetNode(Operation).GetType() != ValueType_t::Object )
+					throw std::runtime_error("not an object");
+				Op = GetMemberString( Patch, PatchJson, Operation, "op", true );
+				auto Path = GetPointerTokens( GetMemberString( Patch, PatchJson, Operation, "path", true ) );
+				auto GetValue = [&]()
+				{
+					auto Value = Patch.FindChild( Operation, "value", PatchJson );
+					if ( Value == InvalidNodeIndex )
+						throw std::runtime_error("missing \"value\"");
+					return Value;
+				};
+				auto GetFrom = [&]()	{	return GetPointerTokens( GetMemberString( Patch, PatchJson, Operation, "from", true ) );	};
+
+				if ( Op == "add" )
+				{
+					Target.Add( Path, GetValueJson( Patch, PatchJson, GetValue() ) );
+				}
+				else if ( Op == "remove" )
+				{
+					Target.Remove( Path );
+				}
+				else if ( Op == "replace" )
+				{
+					Target.Replace( Path, GetValueJson( Patch, PatchJson, GetValue() ) );
+				}
+				else if ( Op == "move" )
+				{
+					auto From = GetFrom();
+					if ( From == Path )
+						continue;
+					if ( IsPrefix( From, Path ) )
+						throw std::runtime_error("cannot move a value into itself");
+					auto Value = Target.Read( From );
+					Target.Remove( From );
+					Target.Add( Path, Value );
+				}
+				else if ( Op == "copy" )
+				{
+					Target.Add( Path, Target.Read( GetFrom() ) );
+				}
+				else if ( Op == "test" )
+				{
+					if ( !Target.Test( Path, Patch, PatchJson, GetValue() ) )
+						throw std::runtime_error("test failed");
+				}
+				else
+				{
+					throw std::runtime_error("unknown op");
+				}
+			}
+			catch(std::exception& e)
+			{
+				throw std::runtime_error("Json patch operation " + std::to_string(OperationIndex) + " (" + Op + ") failed; " + e.what());
+			}
+		}
+	}
+
+
+	//	json patch target which produces a new document by splicing.
+	//	Edits are resolved against one parse of the document until an operation depends on one of them
+	class SpliceTarget_t
+	{
+	public:
+		SpliceTarget_t(std::string_view Json) :
+			mJson	( Json ),
+			mMap	( Parse(Json) )
+		{
+		}
+
+		std::string		Read(const Tokens_t& Path);
+		bool			Test(const Tokens_t& Path,const Map_t& Value,std::string_view ValueJson,NodeIndex_t ValueNode);
+		void			Add(const Tokens_t& Path,std::string_view Value);
+		void			Remove(const Tokens_t& Path);
+		void			Replace(const Tokens_t& Path,std::string_view Value);
+
+		std::string		GetResult();
+
+	private:
+		//	flushes if this operation depends on a pending edit; if it's inside a patched value, if it
+		//	and another add/remove to the same object, or if it's in an array an add/remove has renumbered
+		void			Prepare(const Tokens_t& Path,bool Structural,bool Write);
+		//	apply pending edits, and re-parse for the operations to come
+		void			Flush(bool Reparse=true);
+		NodeIndex_t		GetNode(const Tokens_t& Path);
+		void			SetRoot(std::string_view Value);
+
+	private:
+		class Pending_t
+		{
+		public:
+			Tokens_t	mPath;
+			bool		mStructural = false;
+			bool		mInArray = false;		//	structural, and the parent is an array
+		};
+
+		std::string_view		mJson;		//	original, or mDocument once edits have been applied
+		std::string				mDocument;
+		Map_t					mMap;
+		std::vector<Edit_t>		mEdits;
+		std::vector<Pending_t>	mPending;
+	};
+}
+
+
+void SpliceTarget_t::Prepare(const Tokens_t& Path,bool Structural,bool Write)
+{
+	//	adding to or removing from an array renumbers the elements after it
+	auto IsInArray = [&]()
+	{
+		if ( Path.empty() )
+			return false;
+		auto Parent = FindTokens( mMap, mJson, Path, Path.size()-1 );
+		return Parent == InvalidNodeIndex || mMap.GetNode(Parent).GetType() == ValueType_t::Array;
+	};
+	bool InArray = Structural && IsInArray();
+
+	for ( auto& Pending : mPending )
+	{
+		bool Nested = IsPrefix( Pending.mPath, Path ) || IsPrefix( Path, Pending.mPath );
+		//	structural changes to the same object would share the commas between members
+		bool SameObject = Structural && Pending.mStructural && Path.size() == Pending.mPath.size() && IsInParent( Path, Pending.mPath );
+		bool Renumbered = ( InArray && IsInParent( Path, Pending.mPath ) ) || ( Pending.mInArray && IsInParent( Pending.mPath, Path ) );
+		if ( Nested || SameObject || Renumbered )
+		{
+			Flush();
+			InArray = Structural && IsInArray();
+			break;
+		}
+	}
+	if ( Write )
+		mPending.push_back( { Path, Structural, InArray } );
+}
+
+void SpliceTarget_t::Flush(bool Reparse)
+{
+	mPending.clear();
+	if ( mEdits.empty() )
+		return;
+
+	std::string Document;
+	Document.reserve( mJson.size() );
+	Splice( mJson, 0, mJson.size(), mEdits, Document );
+	mEdits.clear();
+	mDocument = std::move(Document);
+	mJson = mDocument;
+	if ( Reparse )
+		mMap = Parse( mJson );
+}
+
+void SpliceTarget_t::SetRoot(std::string_view Value)
+{
+	mPending.clear();
+	mEdits.clear();
+	mDocument = std::string( Value );
+	mJson = mDocument;
+	mMap = Parse( mJson );
+}
+
+NodeIndex_t SpliceTarget_t::GetNode(const Tokens_t& Path)
+{
+	auto Node = FindTokens( mMap, mJson, Path, Path.size() );
+	if ( Node == InvalidNodeIndex )
+		throw std::runtime_error("path doesn't exist");
+	return Node;
+}
+
+std::string SpliceTarget_t::GetResult()
+{
+	Flush( false );
+	if ( mJson.data() == mDocument.data() )
+		return std::move(mDocument);
+	return std::string( mJson );
+}
+
+std::string SpliceTarget_t::Read(const Tokens_t& Path)
+{
+	Prepare( Path, false, false );
+	return std::string( GetValueJson( mMap, mJson, GetNode(Path) ) );
+}
+
+bool SpliceTarget_t::Test(const Tokens_t& Path,const Map_t& Value,std::string_view ValueJson,NodeIndex_t ValueNode)
+{
+	Prepare( Path, false, false );
+	return Patch::IsEqual( mMap, mJson, GetNode(Path), Value, ValueJson, ValueNode );
+}
+
+void SpliceTarget_t::Replace(const Tokens_t& Path,std::string_view Value)
+{
+	Prepare( Path, false, true );
+	if ( Path.empty() )
+		return SetRoot( Value );
+	auto Span = GetValueSpan( mMap.GetNode( GetNode(Path) ) );
+	mEdits.push_back( { Span.mPosition, GetEnd(Span), std::string(Value) } );
+}
+
+void SpliceTarget_t::Remove(const Tokens_t& Path)
+{
+	if ( Path.empty() )
+		throw std::runtime_error("cannot remove the root");
+	Prepare( Path, true, true );
+	auto Node = GetNode( Path );
+	auto IsRemoved = [&](NodeIndex_t Child)	{	return Child == Node;	};
+	RemoveChildren( mMap, mMap.GetNode(Node).GetParentIndex(), IsRemoved, mEdits );
+}
+
+void SpliceTarget_t::Add(const Tokens_t& Path,std::string_view Value)
+{
+	Prepare( Path, true, true );
+	if ( Path.empty() )
+		return SetRoot( Value );
+
+	auto Parent = FindTokens( mMap, mJson, Path, Path.size()-1 );
+	if ( Parent == InvalidNodeIndex )
+		throw std::runtime_error("parent doesn't exist");
+	auto& ParentNode = mMap.GetNode(Parent);
+	auto& Token = Path.back();
+
+	if ( ParentNode.GetType() == ValueType_t::Object )
+	{
+		auto Existing = FindMember( mMap, mJson, Parent, Token );
+		if ( Existing != InvalidNodeIndex )
+		{
+			auto Span = GetValueSpan( mMap.GetNode(Existing) );
+			mEdits.push_back( { Span.mPosition, GetEnd(Span), std::string(Value) } );
+			return;
+		}
+		std::string Member;
+		AppendMemberKey( Member, GetEscapedKey(Token) );
+		Member.append( Value );
+		AppendChildren( mMap, Parent, ParentNode.GetChildCount() > 0, Member, mEdits );
+	}
+	else if ( ParentNode.GetType() == ValueType_t::Array )
+	{
+		auto Index = Token == "-" ? ParentNode.GetChildCount() : GetArrayIndex( Token );
+		if ( Index > ParentNode.GetChildCount() )
+			throw std::runtime_error("array index out of range");
+		if ( Index == ParentNode.GetChildCount() )
+			return AppendChildren( mMap, Parent, Index > 0, Value, mEdits );
+
+		auto Position = GetChildStart( mMap, mMap.FindChild( Parent, Index ) );
+		auto& Edit = mEdits.emplace_back( Edit_t{ Position, Position, std::string(Value) } );
+		Edit.mText.push_back(',');
+	}
+	else
+	{
+		throw std::runtime_error("parent is not an object or array");
+	}
+}
+
+
+//	json patch target which edits a Json_t's node list in place. Only top level values are nodes
+//	of a Json_t; an operation deeper than that splices just its own bytes into the region of the top
+//	level value it is inside (see Json_t::GetRegion), as SetAt/PushBackAt do
+class PopJson::Patch::JsonTarget_t
+{
+public:
+	JsonTarget_t(Json_t& Json) :
+		mJson		( Json ),
+		mOriginal	( Json ),
+		mOriginalStorageSize	( Json.mStorage.size() )
+	{
+		mJson.mMap.reset();
+		mSpliceLog.mStorageSize = mOriginalStorageSize;
+		mJson.mSpliceLog = &mSpliceLog;
+	}
+	~JsonTarget_t()
+	{
+		mJson.mSpliceLog = nullptr;
+	}
+
+	std::string		Read(const Tokens_t& Path);
+	bool			Test(const Tokens_t& Path,const Map_t& Value,std::string_view ValueJson,NodeIndex_t ValueNode);
+	void			Add(const Tokens_t& Path,std::string_view Value);
+	void			Remove(const Tokens_t& Path);
+	void			Replace(const Tokens_t& Path,std::string_view Value);
+
+	//	RFC 7396 merge of a parsed patch
+	void			Merge(const Map_t& Patch,std::string_view PatchJson);
+	//	undo everything; the original nodes still point at the original storage, once splices into it are undone
+	void			Revert();
+	void			SetRoot(std::string_view Value);
+
+	//	json of a top level value including quotes or brackets (values written with Set() have none in storage)
+	std::string		GetChildJson(const Node_t& Node);
+	//	write a new value for a node to storage
+	void			SetChildJson(Node_t& Node,std::string_view Value);
+	//	index into mNodes, or SIZE_MAX
+	size_t			FindChild(std::string_view Token);
+	size_t			GetChild(std::string_view Token);
+	void			AddMember(std::string_view Key,std::string_view Value);
+
+	//	the top level container Path is below, whose region it's spliced in
+	size_t			GetRegionChild(const Tokens_t& Path);
+	//	[start,end) of the value at the pointer inside a region, throws if missing
+	std::pair<size_t,size_t>	GetRegionValue(size_t Node,std::string_view Pointer);
+	//	region values in the array at Pointer are keyed by index; after an element is inserted (Delta=1)
+	//	or removed (Delta=-1) at Index, those after it are renumbered and the one at Index is forgotten
+	void			RenumberRegionValues(size_t Node,std::string_view Pointer,size_t Index,int Delta);
+
+	Json_t&			mJson;
+
+private:
+	Value_t			mOriginal;
+	size_t			mOriginalStorageSize = 0;
+	Json_t::SpliceLog_t	mSpliceLog;
+	std::optional<std::unordered_map<size_t,Json_t::Region_t>>	mOriginalRegions;	//	kept before the first region is used
+};
+
+void PopJson::Patch::JsonTarget_t::Revert()
+{
+	//	latest first, each put back as it was before that splice
+	auto& Storage = mJson.mStorage;
+	for ( auto Splice=mSpliceLog.mSplices.rbegin();	Splice!=mSpliceLog.mSplices.rend();	Splice++ )
+	{
+		auto* Data = Storage.data() + Splice->mStart;
+		std::memmove( Data + Splice->mRemoved.size(), Data + Splice->mInsertLength, Splice->mTailLength );
+		std::memcpy( Data, Splice->mRemoved.data(), Splice->mRemoved.size() );
+	}
+	mSpliceLog.mSplices.clear();
+	if ( mOriginalRegions )
+		mJson.mRegions = std::move( *mOriginalRegions );
+	mOriginalRegions.reset();
+
+	static_cast<Value_t&>(mJson) = mOriginal;
+	Storage.resize( mOriginalStorageSize );
+}
+
+size_t PopJson::Patch::JsonTarget_t::GetRegionChild(const Tokens_t& Path)
+{
+	auto Node = GetChild( Path[0] );
+	auto Type = mJson.mNodes[Node].GetType();
+	if ( Type != ValueType_t::Object && Type != ValueType_t::Array )
+		throw std::runtime_error("path doesn't exist");
+	if ( !mOriginalRegions )
+		mOriginalRegions = mJson.mRegions;
+	return Node;
+}
+
+std::pair<size_t,size_t> PopJson::Patch::JsonTarget_t::GetRegionValue(size_t Node,std::string_view Pointer)
+{
+	auto Start = mJson.mStorage.size();
+	auto& Region = mJson.GetRegion( Node, Start );
+	auto* Value = mJson.FindRegionValue( Region, Node, Pointer );
+	if ( !Value )
+		throw std::runtime_error("path doesn't exist");
+	return { Value->mStart, Value->mEnd };
+}
+
+void PopJson::Patch::JsonTarget_t::RenumberRegionValues(size_t Node,std::string_view Pointer,size_t Index,int Delta)
+{
+	auto Start = mJson.mStorage.size();
+	auto& Values = mJson.GetRegion( Node, Start ).mValues;
+	for ( size_t v=0;	v<Values.size();	)
+	{
+		auto& ValuePointer = Values[v].mPointer;
+		if ( ValuePointer.size() <= Pointer.size()+1 || !ValuePointer.starts_with( Pointer ) || ValuePointer[Pointer.size()] != '/' )
+		{
+			v++;
+			continue;
+		}
+		auto TokenStart = Pointer.size()+1;
+		auto TokenEnd = std::min( ValuePointer.find( '/', TokenStart ), ValuePointer.size() );
+		auto ElementIndex = GetArrayIndex( std::string_view( ValuePointer ).substr( TokenStart, TokenEnd-TokenStart ) );
+		//	the inserted value is where the old element was; the removed one (& inside it) are gone
+		bool IsElement = TokenEnd == ValuePointer.size();
+		if ( ElementIndex == Index && ( Delta < 0 || IsElement ) )
+		{
+			Values.erase( Values.begin() + v );
+			continue;
+		}
+		if ( ElementIndex != SIZE_MAX && ElementIndex >= Index )
+			ValuePointer.replace( TokenStart, TokenEnd-TokenStart, std::to_string( ElementIndex + Delta ) );
+		v++;
+	}
+}
+
+std::string PopJson::Patch::JsonTarget_t::GetChildJson(const Node_t& Node)
+{
+	auto Raw = Node.mValuePosition.GetContents( mJson.GetStorageString() );
+	switch ( Node.GetType() )
+	{
+		case ValueType_t::Null:			return "null";
+		case ValueType_t::BooleanTrue:	return "true";
+		case ValueType_t::BooleanFalse:	return "false";
+		case ValueType_t::String:		return "\"" + std::string(Raw) + "\"";
+		case ValueType_t::Object:		return "{" + std::string(Raw) + "}";
+		case ValueType_t::Array:		return "[" + std::string(Raw) + "]";
+		default:						return std::string(Raw);
+	}
+}
+
+void PopJson::Patch::JsonTarget_t::SetChildJson(Node_t& Node,std::string_view Value)
+{
+	auto Offset = mJson.mStorage.size();
+	mJson.mStorage.insert( mJson.mStorage.end(), Value.begin(), Value.end() );
+	//	only this value is parsed, and only its position and type are kept
+	Value_t NewValue( Value, Offset );
+	Node.ReplaceValue( NewValue );
+}
+
+void PopJson::Patch::JsonTarget_t::SetRoot(std::string_view Value)
+{
+	auto Offset = mJson.mStorage.size();
+	mJson.mStorage.insert( mJson.mStorage.end(), Value.begin(), Value.end() );
+	Value_t Root( Value, Offset );
+	//	a Json_t only writes an object or array, so a scalar root would be lost
+	if ( Root.GetType() != ValueType_t::Object && Root.GetType() != ValueType_t::Array )
+		throw std::runtime_error("Json_t root can only be replaced with an object or array");
+	static_cast<Value_t&>(mJson) = Root;
+}
+
+size_t PopJson::Patch::JsonTarget_t::FindChild(std::string_view Token)
+{
+	auto& Nodes = mJson.mNodes;
+	if ( mJson.GetType() == ValueType_t::Array )
+	{
+		auto Index = GetArrayIndex( Token );
+		return Index < Nodes.size() ? Index : SIZE_MAX;
+	}
+	if ( mJson.GetType() != ValueType_t::Object )
+		return SIZE_MAX;
+
+	auto Key = NeedsEscaping(Token) ? GetEscapedKey(Token) : std::string(Token);
+	auto Storage = mJson.GetStorageString();
+	for ( size_t i=0;	i<Nodes.size();	i++ )
+		if ( Nodes[i].GetKey(Storage) == Key )
+			return i;
+	return SIZE_MAX;
+}
+
+size_t PopJson::Patch::JsonTarget_t::GetChild(std::string_view Token)
+{
+	auto Index = FindChild( Token );
+	if ( Index == SIZE_MAX )
+		throw std::runtime_error("path doesn't exist");
+	return Index;
+}
+
+void PopJson::Patch::JsonTarget_t::AddMember(std::string_view Key,std::string_view Value)
+{
+	auto EscapedKey = GetEscapedKey( Key );
+	Node_t Node;
+	Node.mKeyPosition = Location_t( mJson.mStorage.size(), EscapedKey.size() );
+	mJson.mStorage.insert( mJson.mStorage.end(), EscapedKey.begin(), EscapedKey.end() );
+	SetChildJson( Node, Value );
+	mJson.mNodes.push_back( Node );
+	//	an empty Json_t is null until it has members
+	if ( mJson.GetType() == ValueType_t::Null )
+		mJson.UpdateObjectType();
+}
+
+void PopJson::Patch::JsonTarget_t::Merge(const Map_t& Patch,std::string_view PatchJson)
+{
+	bool IsEmptyJson = mJson.GetType() == ValueType_t::Null && mJson.mNodes.empty();
+	if ( Patch.GetNode(0).GetType() != ValueType_t::Object || ( mJson.GetType() != ValueType_t::Object && !IsEmptyJson ) )
+		return SetRoot( GetMergeValue( Patch, PatchJson, 0 ) );
+
+	auto& Nodes = mJson.mNodes;
+	std::vector<size_t> Removed;
+	for ( auto PatchMember=Patch.GetFirstChild(0);	PatchMember!=InvalidNodeIndex;	PatchMember=Patch.GetNextSibling(PatchMember) )
+	{
+		auto& PatchNode = Patch.GetNode(PatchMember);
+		//	keys in the patch are escaped, as they are in our storage
+		auto Key = PatchNode.GetKey(PatchJson);
+		size_t Existing = SIZE_MAX;
+		auto Storage = mJson.GetStorageString();
+		for ( size_t i=0;	i<Nodes.size() && Existing==SIZE_MAX;	i++ )
+			if ( Nodes[i].GetKey(Storage) == Key )
+				Existing = i;
+
+		if ( PatchNode.GetType() == ValueType_t::Null )
+		{
+			if ( Existing != SIZE_MAX )
+				Removed.push_back( Existing );
+		}
+		else if ( Existing == SIZE_MAX )
+		{
+			Node_t Node;
+			Node.mKeyPosition = Location_t( mJson.mStorage.size(), Key.size() );
+			mJson.mStorage.insert( mJson.mStorage.end(), Key.begin(), Key.end() );
+			SetChildJson( Node, GetMergeValue( Patch, PatchJson, PatchMember ) );
+			Nodes.push_back( Node );
+		}
+		else if ( PatchNode.GetType() == ValueType_t::Object && Nodes[Existing].GetType() == ValueType_t::Object )
+		{
+			auto Merged = MergePatch( GetChildJson( Nodes[Existing] ), GetValueJson( Patch, PatchJson, PatchMember ) );
+			SetChildJson( Nodes[Existing], Merged );
+		}
+		else
+		{
+			SetChildJson( Nodes[Existing], GetMergeValue( Patch, PatchJson, PatchMember ) );
+		}
+	}
+
+	//	erased last so the indexes above stay valid
+	std::sort( Removed.begin(), Removed.end() );
+	Removed.erase( std::unique( Removed.begin(), Removed.end() ), Removed.end() );
+	for ( auto i=Removed.rbegin();	i!=Removed.rend();	i++ )
+		Nodes.erase( Nodes.begin() + *i );
+	//	an empty Json_t is null until it has members
+	if ( mJson.GetType() == ValueType_t::Null )
+		mJson.UpdateObjectType();
+}
+
+namespace
+{
+	//	json pointer of Path[1,Count), as the values in a top level value's region are keyed
+	std::string GetChildPointer(const Tokens_t& Path,size_t Count)
+	{
+		std::string Pointer;
+		for ( size_t t=1;	t<Count;	t++ )
+		{
+			Pointer.push_back('/');
+			for ( auto Char : Path[t] )
+			{
+				if ( Char == '~' )
+					Pointer.append("~0");
+				else if ( Char == '/' )
+					Pointer.append("~1");
+				else
+					Pointer.push_back( Char );
+			}
+		}
+		return Pointer;
+	}
+
+	bool IsEscapedQuote(const std::vector<char>& Storage,size_t Quote)
+	{
+		size_t Slashes = 0;
+		while ( Storage[Quote-1-Slashes] == '\\' )
+			Slashes++;
+		return Slashes % 2 == 1;
+	}
+}
+
+std::string PopJson::Patch::JsonTarget_t::Read(const Tokens_t& Path)
+{
+	//	GetJsonString() only writes objects & arrays
+	if ( Path.empty() && ( mJson.GetType() == ValueType_t::Object || mJson.GetType() == ValueType_t::Array ) )
+		return mJson.GetJsonString();
+	if ( Path.empty() )
+		return GetChildJson( Node_t( static_cast<Value_t&>(mJson) ) );
+	if ( Path.size() == 1 )
+		return GetChildJson( mJson.mNodes[ GetChild( Path[0] ) ] );
+	auto Node = GetRegionChild( Path );
+	auto [Start,End] = GetRegionValue( Node, GetChildPointer( Path, Path.size() ) );
+	return std::string( mJson.mStorage.data() + Start, End - Start );
+}
+
+bool PopJson::Patch::JsonTarget_t::Test(const Tokens_t& Path,const Map_t& Value,std::string_view ValueJson,NodeIndex_t ValueNode)
+{
+	auto Json = Read( Path );
+	return IsEqual( Parse(Json), Json, 0, Value, ValueJson, ValueNode );
+}
+
+void PopJson::Patch::JsonTarget_t::Replace(const Tokens_t& Path,std::string_view Value)
+{
+	if ( Path.empty() )
+		return SetRoot( Value );
+	if ( Path.size() == 1 )
+		return SetChildJson( mJson.mNodes[ GetChild( Path[0] ) ], Value );
+
+	auto Node = GetRegionChild( Path );
+	auto Pointer = GetChildPointer( Path, Path.size() );
+	GetRegionValue( Node, Pointer );
+	auto Start = mJson.mStorage.size();
+	mJson.mStorage.insert( mJson.mStorage.end(), Value.begin(), Value.end() );
+	auto& Region = mJson.GetRegion( Node, Start );
+	auto* Existing = mJson.FindRegionValue( Region, Node, Pointer );
+	mJson.SpliceRegion( Node, Region, Existing->mStart, Existing->mEnd, Start, false );
+}
+
+void PopJson::Patch::JsonTarget_t::Remove(const Tokens_t& Path)
+{
+	if ( Path.empty() )
+		throw std::runtime_error("cannot remove the root");
+	auto Index = GetChild( Path[0] );
+	auto& Nodes = mJson.mNodes;
+	if ( Path.size() == 1 )
+	{
+		Nodes.erase( Nodes.begin() + Index );
+		return;
+	}
+
+	auto Node = GetRegionChild( Path );
+	auto [ValueStart,ValueEnd] = GetRegionValue( Node, GetChildPointer( Path, Path.size() ) );
+
+	//	a member starts at its key; keys can't contain an unescaped quote
+	auto& Storage = mJson.mStorage;
+	auto ChildStart = ValueStart;
+	auto Before = ValueStart;
+	while ( Scan::IsWhitespace( Storage[Before-1] ) )
+		Before--;
+	bool IsMember = Storage[Before-1] == ':';
+	if ( IsMember )
+	{
+		Before--;
+		while ( Scan::IsWhitespace( Storage[Before-1] ) )
+			Before--;
+		ChildStart = Before-1;
+		do
+		{
+			ChildStart--;
+		}
+		while ( Storage[ChildStart] != '"' || IsEscapedQuote( Storage, ChildStart ) );
+		Before = ChildStart;
+		while ( Scan::IsWhitespace( Storage[Before-1] ) )
+			Before--;
+	}
+
+	//	take the comma before it, or after it if it's the first child
+	auto RemoveStart = ChildStart;
+	auto RemoveEnd = ValueEnd;
+	if ( Storage[Before-1] == ',' )
+	{
+		RemoveStart = Before-1;
+	}
+	else
+	{
+		auto After = ValueEnd;
+		while ( Scan::IsWhitespace( Storage[After] ) )
+			After++;
+		if ( Storage[After] == ',' )
+			RemoveEnd = After+1;
+	}
+
+	auto Start = Storage.size();
+	auto& Region = mJson.GetRegion( Node, Start );
+	mJson.SpliceRegion( Node, Region, RemoveStart, RemoveEnd, Start, false );
+	if ( !IsMember )
+		RenumberRegionValues( Node, GetChildPointer( Path, Path.size()-1 ), GetArrayIndex( Path.back() ), -1 );
+}
+
+void PopJson::Patch::JsonTarget_t::Add(const Tokens_t& Path,std::string_view Value)
+{
+	if ( Path.empty() )
+		return SetRoot( Value );
+
+	auto& Nodes = mJson.mNodes;
+	if ( Path.size() > 1 )
+	{
+		auto Node = GetRegionChild( Path );
+		auto ParentPointer = GetChildPointer( Path, Path.size()-1 );
+		auto Pointer = GetChildPointer( Path, Path.size() );
+		auto& ChildToken = Path.back();
+		auto [ParentStart,ParentEnd] = GetRegionValue( Node, ParentPointer );
+		auto& Storage = mJson.mStorage;
+		auto ParentType = Storage[ParentStart];
+		auto Find = [&](std::string_view ValuePointer)
+		{
+			auto Empty = Storage.size();
+			return mJson.FindRegionValue( mJson.GetRegion( Node, Empty ), Node, ValuePointer ) != nullptr;
+		};
+
+		if ( ParentType == '{' )
+		{
+			if ( Find( Pointer ) )
+				return Replace( Path, Value );
+			auto Start = Storage.size();
+			mJson.AppendMemberKeyToStorage( ChildToken );
+			Storage.insert( Storage.end(), Value.begin(), Value.end() );
+			return mJson.InsertIntoContainer( Node, ParentPointer, Start, ValueType_t::Object );
+		}
+		if ( ParentType != '[' )
+			throw std::runtime_error("parent is not an object or array");
+
+		auto Index = ChildToken == "-" ? SIZE_MAX : GetArrayIndex( ChildToken );
+		if ( ChildToken != "-" && Index == SIZE_MAX )
+			throw std::runtime_error("invalid array index");
+		if ( ChildToken != "-" && Find( Pointer ) )
+		{
+			//	inserted before the element at Index, which moves every index after it
+			auto Start = Storage.size();
+			Storage.insert( Storage.end(), Value.begin(), Value.end() );
+			Storage.push_back(',');
+			auto& Region = mJson.GetRegion( Node, Start );
+			auto ElementStart = mJson.FindRegionValue( Region, Node, Pointer )->mStart;
+			mJson.SpliceRegion( Node, Region, ElementStart, ElementStart, Start, false );
+			return RenumberRegionValues( Node, ParentPointer, Index, 1 );
+		}
+		//	appending; Index is the element count if the one before it exists
+		if ( ChildToken != "-" && Index > 0 && !Find( ParentPointer + "/" + std::to_string(Index-1) ) )
+			throw std::runtime_error("array index out of range");
+		if ( ChildToken != "-" && Index == 0 )
+		{
+			auto First = ParentStart + 1;
+			while ( Scan::IsWhitespace( Storage[First] ) )
+				First++;
+			if ( Storage[First] != ']' )
+				throw std::runtime_error("array index out of range");
+		}
+		auto Start = Storage.size();
+		Storage.insert( Storage.end(), Value.begin(), Value.end() );
+		return mJson.InsertIntoContainer( Node, ParentPointer, Start, ValueType_t::Array );
+	}
+
+	auto& Token = Path[0];
+	if ( mJson.GetType() == ValueType_t::Array )
+	{
+		auto Index = Token == "-" ? Nodes.size() : GetArrayIndex( Token );
+		if ( Index > Nodes.size() )
+			throw std::runtime_error("array index out of range");
+		Node_t Node;
+		SetChildJson( Node, Value );
+		Nodes.insert( Nodes.begin() + Index, Node );
+		return;
+	}
+
+	bool IsEmptyJson = mJson.GetType() == ValueType_t::Null && Nodes.empty();
+	if ( mJson.GetType() != ValueType_t::Object && !IsEmptyJson )
+		throw std::runtime_error("parent is not an object or array");
+	auto Existing = FindChild( Token );
+	if ( Existing != SIZE_MAX )
+		return SetChildJson( Nodes[Existing], Value );
+	AddMember( Token, Value );
+}
+
+
+std::string PopJson::Patch::Apply(std::string_view Json,std::string_view Patch)
+{
+	SpliceTarget_t Target( Json );
+	ApplyOperations( Target, Patch );
+	return Target.GetResult();
+}
+
+std::string PopJson::Patch::MergePatch(std::string_view Json,std::string_view PatchJson)
+{
+	auto Patch = Parse( PatchJson );
+	if ( Patch.GetNode(0).GetType() != ValueType_t::Object )
+		return GetMergeValue( Patch, PatchJson, 0 );
+
+	auto Map = Parse( Json );
+	if ( Map.GetNode(0).GetType() != ValueType_t::Object )
+		return GetMergeValue( Patch, PatchJson, 0 );
+
+	std::vector<Edit_t> Edits;
+	AddMergeEdits( Map, Json, 0, Patch, PatchJson, 0, Edits );
+	std::string Output;
+	Output.reserve( Json.size() );
+	Splice( Json, 0, Json.size(), Edits, Output );
+	return Output;
+}
+
+PopJson::NodeIndex_t PopJson::Patch::FindPointer(const Map_t& Map,std::string_view Json,std::string_view Pointer,NodeIndex_t Node)
+{
+	auto Tokens = GetPointerTokens( Pointer );
+	return FindTokens( Map, Json, Tokens, Tokens.size(), Node );
+}
+
+bool PopJson::Patch::IsEqual(const Map_t& a,std::string_view aJson,NodeIndex_t aNode,const Map_t& b,std::string_view bJson,NodeIndex_t bNode)
+{
+	auto IsNumber = [](ValueType_t::Type Type)	{	return Type == ValueType_t::NumberInteger || Type == ValueType_t::NumberDouble;	};
+
+	//	different content hashes are different values, so no need to walk them
+	if ( a.HasContentHashes() && b.HasContentHashes() && a.GetContentHash(aNode) != b.GetContentHash(bNode) )
+		return false;
+
+	std::vector<std::pair<NodeIndex_t,NodeIndex_t>> Pending = { { aNode, bNode } };
+	while ( !Pending.empty() )
+	{
+		auto [aIndex,bIndex] = Pending.back();
+		Pending.pop_back();
+		auto& aValue = a.GetNode(aIndex);
+		auto& bValue = b.GetNode(bIndex);
+		auto aRaw = aValue.GetValuePosition().GetContents(aJson);
+		auto bRaw = bValue.GetValuePosition().GetContents(bJson);
+
+		//	1 and 1.0 are the same number
+		if ( IsNumber(aValue.GetType()) && IsNumber(bValue.GetType()) )
+		{
+			if ( aRaw != bRaw && aValue.GetValue().GetDouble(aJson) != bValue.GetValue().GetDouble(bJson) )
+				return false;
+			continue;
+		}
+		if ( aValue.GetType() != bValue.GetType() )
+			return false;
+
+		switch ( aValue.GetType() )
+		{
+			case ValueType_t::String:
+				if ( aRaw == bRaw )
+					break;
+				if ( aRaw.find('\\') == std::string_view::npos && bRaw.find('\\') == std::string_view::npos )
+					return false;
+				if ( aValue.GetValue().GetString(aJson) != bValue.GetValue().GetString(bJson) )
+					return false;
+				break;
+
+			case ValueType_t::Array:
+			{
+				if ( aValue.GetChildCount() != bValue.GetChildCount() )
+					return false;
+				auto bChild = b.GetFirstChild(bIndex);
+				for ( auto aChild=a.GetFirstChild(aIndex);	aChild!=InvalidNodeIndex;	aChild=a.GetNextSibling(aChild), bChild=b.GetNextSibling(bChild) )
+					Pending.push_back( { aChild, bChild } );
+				break;
+			}
+
+			case ValueType_t::Object:
+			{
+				if ( aValue.GetChildCount() != bValue.GetChildCount() )
+					return false;
+				for ( auto aChild=a.GetFirstChild(aIndex);	aChild!=InvalidNodeIndex;	aChild=a.GetNextSibling(aChild) )
+				{
+					auto bChild = b.FindChild( bIndex, a.GetNode(aChild).GetKey(aJson), bJson );
+					if ( bChild == InvalidNodeIndex )
+						return false;
+					Pending.push_back( { aChild, bChild } );
+				}
+				break;
+			}
+
+			default:
+				break;
+		}
+	}
+	return true;
+}
+
+namespace
+{
+	//	the pointer token for a member; its key unescaped from json, then ~ and / escaped (~0 ~1)
+	void AppendPointerToken(std::string& Path,const Map_t& Map,std::string_view Json,NodeIndex_t Member)
+	{
+		auto& Node = Map.GetNode(Member);
+		auto Key = Node.GetKey(Json);
+		std::string Unescaped;
+		if ( Key.find('\\') != std::string_view::npos )
+		{
+			Unescaped = Value_t( ValueType_t::String, Node.GetKeyPosition() ).GetString( Json );
+			Key = Unescaped;
+		}
+		Path.push_back('/');
+		for ( auto Char : Key )
+		{
+			if ( Char == '~' )
+				Path.append("~0");
+			else if ( Char == '/' )
+				Path.append("~1");
+			else
+				Path.push_back( Char );
+		}
+	}
+
+	void AppendPointerToken(std::string& Path,size_t Index)
+	{
+		char Buffer[24];
+		auto Result = std::to_chars( Buffer, Buffer+sizeof(Buffer), Index );
+		Path.push_back('/');
+		Path.append( Buffer, Result.ptr );
+	}
+
+	//	members of an object by (escaped) key. The map's key index is used if it covers the object and
+	//	narrow objects are scanned, otherwise a table is built, so matching a wide object is linear
+	class MemberIndex_t
+	{
+	public:
+		void		Build(const Map_t& Map,std::string_view Json,NodeIndex_t Object)
+		{
+			mMap = &Map;
+			mJson = Json;
+			mObject = Object;
+			mSlots.clear();
+			auto ChildCount = Map.GetNode(Object).GetChildCount();
+			if ( ChildCount <= 16 )
+				return;
+			if ( Map.HasKeyIndex() && ChildCount >= Map.GetKeyIndexMinChildren() )
+				return;
+
+			//	open addressed with a load under 50%, as the map's key index
+			size_t SlotCount = 32;
+			while ( SlotCount < ChildCount * 2 )
+				SlotCount *= 2;
+			mSlots.assign( SlotCount, InvalidNodeIndex );
+			for ( auto Child=Map.GetFirstChild(Object);	Child!=InvalidNodeIndex;	Child=Map.GetNextSibling(Child) )
+			{
+				auto Key = Map.GetNode(Child).GetKey(Json);
+				auto& Slot = mSlots[FindSlot( Key )];
+				//	the first of duplicate keys is found, as with FindChild
+				if ( Slot == InvalidNodeIndex )
+					Slot = Child;
+			}
+		}
+
+		NodeIndex_t	Find(std::string_view Key) const
+		{
+			if ( mSlots.empty() )
+				return mMap->FindChild( mObject, Key, mJson );
+			return mSlots[FindSlot( Key )];
+		}
+
+	private:
+		//	the key's slot, or the empty slot it would go in
+		size_t		FindSlot(std::string_view Key) const
+		{
+			auto Mask = mSlots.size()-1;
+			auto Slot = Hash64( Key.data(), Key.size() ) & Mask;
+			while ( mSlots[Slot] != InvalidNodeIndex && mMap->GetNode(mSlots[Slot]).GetKey(mJson) != Key )
+				Slot = (Slot+1) & Mask;
+			return Slot;
+		}
+
+	private:
+		const Map_t*				mMap = nullptr;
+		std::string_view			mJson;
+		NodeIndex_t					mObject = InvalidNodeIndex;
+		std::vector<NodeIndex_t>	mSlots;		//	member nodes, InvalidNodeIndex when empty. Size is a power of 2
+	};
+
+	//	walks two maps together (with a heap stack, as deep as the parser allows) reporting changes
+	class Differ_t
+	{
+	public:
+		Differ_t(const Map_t& From,std::string_view FromJson,const Map_t& To,std::string_view ToJson,const Patch::OnChange_t& OnChange) :
+			mFrom		( From ),
+			mFromJson	( FromJson ),
+			mTo			( To ),
+			mToJson		( ToJson ),
+			mOnChange	( OnChange )
+		{
+		}
+
+		void		Diff(NodeIndex_t FromNode,NodeIndex_t ToNode);
+		//	diff the values DiffMembers has left pending
+		void		Run();
+		//	the members in part Part of PartCount of an object; each From member is removed, or left
+		//	pending to diff, then each To member not in From is added
+		void		DiffMembers(NodeIndex_t FromObject,const MemberIndex_t& ToMembers,size_t Part,size_t PartCount);
+		void		AddMembers(NodeIndex_t ToObject,const MemberIndex_t& FromMembers,size_t Part,size_t PartCount);
+		bool		IsSame(NodeIndex_t FromNode,NodeIndex_t ToNode);
+
+	private:
+		void		DiffNodes(NodeIndex_t FromNode,NodeIndex_t ToNode);
+		void		DiffArrays(NodeIndex_t FromArray,NodeIndex_t ToArray);
+		void		GetEditScript(size_t FromStart,size_t FromEnd,size_t ToStart,size_t ToEnd);
+		void		Emit(Patch::Change_t::Operation_t Operation,std::string_view Path,NodeIndex_t FromNode,NodeIndex_t ToNode);
+
+	private:
+		//	a pair of values to diff; its path is the parent's (the first mParentPathLength of mPath) and a token
+		class Pending_t
+		{
+		public:
+			NodeIndex_t		mFrom = InvalidNodeIndex;
+			NodeIndex_t		mTo = InvalidNodeIndex;
+			size_t			mParentPathLength = 0;
+			bool			mIsMember = false;
+			size_t			mIndex = 0;		//	element index if not a member
+		};
+
+		const Map_t&				mFrom;
+		std::string_view			mFromJson;
+		const Map_t&				mTo;
+		std::string_view			mToJson;
+		const Patch::OnChange_t&	mOnChange;
+
+		std::string					mPath;		//	of the value being diffed
+		std::string					mChildPath;
+		std::vector<Pending_t>		mPending;
+		MemberIndex_t				mFromMembers;
+		MemberIndex_t				mToMembers;
+		std::vector<NodeIndex_t>	mFromChildren;
+		std::vector<NodeIndex_t>	mToChildren;
+
+		enum class Step_t : uint8_t
+		{
+			Same,
+			Remove,
+			Insert,
+		};
+		std::vector<Step_t>			mEditScript;
+		std::vector<ptrdiff_t>		mEditTrace;		//	furthest points before each d
+	};
+
+	bool Differ_t::IsSame(NodeIndex_t FromNode,NodeIndex_t ToNode)
+	{
+		auto& FromValue = mFrom.GetNode(FromNode);
+		auto& ToValue = mTo.GetNode(ToNode);
+		auto IsNumber = [](ValueType_t::Type Type)	{	return Type == ValueType_t::NumberInteger || Type == ValueType_t::NumberDouble;	};
+		auto IsContainer = FromValue.GetType() == ValueType_t::Object || FromValue.GetType() == ValueType_t::Array;
+		if ( FromValue.GetType() != ToValue.GetType() && !( IsNumber(FromValue.GetType()) && IsNumber(ToValue.GetType()) ) )
+			return false;
+		//	most of an updated document is usually byte for byte the same
+		if ( FromValue.GetValuePosition().GetContents(mFromJson) == ToValue.GetValuePosition().GetContents(mToJson) )
+			return true;
+		if ( mFrom.HasContentHashes() && mTo.HasContentHashes() )
+		{
+			if ( mFrom.GetContentHash(FromNode) != mTo.GetContentHash(ToNode) )
+				return false;
+			return Patch::IsEqual( mFrom, mFromJson, FromNode, mTo, mToJson, ToNode );
+		}
+		//	differently formatted containers are walked, and only differences reported
+		if ( IsContainer )
+			return false;
+		return Patch::IsEqual( mFrom, mFromJson, FromNode, mTo, mToJson, ToNode );
+	}
+
+	void Differ_t::Emit(Patch::Change_t::Operation_t Operation,std::string_view Path,NodeIndex_t FromNode,NodeIndex_t ToNode)
+	{
+		Patch::Change_t Change;
+		Change.mOperation = Operation;
+		Change.mPath = Path;
+		Change.mFromNode = FromNode;
+		Change.mToNode = ToNode;
+		mOnChange( Change );
+	}
+
+	void Differ_t::Diff(NodeIndex_t FromNode,NodeIndex_t ToNode)
+	{
+		mPath.clear();
+		DiffNodes( FromNode, ToNode );
+		Run();
+	}
+
+	void Differ_t::Run()
+	{
+		while ( !mPending.empty() )
+		{
+			auto Pending = mPending.back();
+			mPending.pop_back();
+			//	pending values are diffed depth first, so the parent's path is still at the start of mPath
+			mPath.resize( Pending.mParentPathLength );
+			if ( Pending.mIsMember )
+				AppendPointerToken( mPath, mFrom, mFromJson, Pending.mFrom );
+			else
+				AppendPointerToken( mPath, Pending.mIndex );
+			DiffNodes( Pending.mFrom, Pending.mTo );
+		}
+	}
+
+	void Differ_t::DiffNodes(NodeIndex_t FromNode,NodeIndex_t ToNode)
+	{
+		if ( IsSame( FromNode, ToNode ) )
+			return;
+
+		auto FromType = mFrom.GetNode(FromNode).GetType();
+		auto ToType = mTo.GetNode(ToNode).GetType();
+		if ( FromType == ValueType_t::Object && ToType == ValueType_t::Object )
+		{
+			mFromMembers.Build( mFrom, mFromJson, FromNode );
+			mToMembers.Build( mTo, mToJson, ToNode );
+			DiffMembers( FromNode, mToMembers, 0, 1 );
+			AddMembers( ToNode, mFromMembers, 0, 1 );
+		}
+		else if ( FromType == ValueType_t::Array && ToType == ValueType_t::Array )
+		{
+			DiffArrays( FromNode, ToNode );
+		}
+		else
+		{
+			Emit( Patch::Change_t::Replace, mPath, FromNode, ToNode );
+		}
+	}
+
+	bool IsInPart(size_t ChildIndex,size_t ChildCount,size_t Part,size_t PartCount)
+	{
+		return ChildIndex >= ChildCount*Part/PartCount && ChildIndex < ChildCount*(Part+1)/PartCount;
+	}
+
+	void Differ_t::DiffMembers(NodeIndex_t FromObject,const MemberIndex_t& ToMembers,size_t Part,size_t PartCount)
+	{
+		auto ParentPathLength = mPath.size();
+		auto FirstPending = mPending.size();
+		size_t ChildIndex = 0;
+		auto FromCount = mFrom.GetNode(FromObject).GetChildCount();
+		for ( auto FromChild=mFrom.GetFirstChild(FromObject);	FromChild!=InvalidNodeIndex;	FromChild=mFrom.GetNextSibling(FromChild), ChildIndex++ )
+		{
+			if ( !IsInPart( ChildIndex, FromCount, Part, PartCount ) )
+				continue;
+			auto ToChild = ToMembers.Find( mFrom.GetNode(FromChild).GetKey(mFromJson) );
+			if ( ToChild == InvalidNodeIndex )
+			{
+				mChildPath = mPath;
+				AppendPointerToken( mChildPath, mFrom, mFromJson, FromChild );
+				Emit( Patch::Change_t::Remove, mChildPath, FromChild, InvalidNodeIndex );
+				continue;
+			}
+			Pending_t Pending;
+			Pending.mFrom = FromChild;
+			Pending.mTo = ToChild;
+			Pending.mParentPathLength = ParentPathLength;
+			Pending.mIsMember = true;
+			mPending.push_back( Pending );
+		}
+		//	popped in member order
+		std::reverse( mPending.begin()+FirstPending, mPending.end() );
+	}
+
+	void Differ_t::AddMembers(NodeIndex_t ToObject,const MemberIndex_t& FromMembers,size_t Part,size_t PartCount)
+	{
+		size_t ChildIndex = 0;
+		auto ToCount = mTo.GetNode(ToObject).GetChildCount();
+		for ( auto ToChild=mTo.GetFirstChild(ToObject);	ToChild!=InvalidNodeIndex;	ToChild=mTo.GetNextSibling(ToChild), ChildIndex++ )
+		{
+			if ( !IsInPart( ChildIndex, ToCount, Part, PartCount ) )
+				continue;
+			if ( FromMembers.Find( mTo.GetNode(ToChild).GetKey(mToJson) ) != InvalidNodeIndex )
+				continue;
+			mChildPath = mPath;
+			AppendPointerToken( mChildPath, mTo, mToJson, ToChild );
+			Emit( Patch::Change_t::Add, mChildPath, InvalidNodeIndex, ToChild );
+		}
+	}
+
+	void Differ_t::DiffArrays(NodeIndex_t FromArray,NodeIndex_t ToArray)
+	{
+		mFromChildren.clear();
+		mToChildren.clear();
+		for ( auto Child=mFrom.GetFirstChild(FromArray);	Child!=InvalidNodeIndex;	Child=mFrom.GetNextSibling(Child) )
+			mFromChildren.push_back( Child );
+		for ( auto Child=mTo.GetFirstChild(ToArray);	Child!=InvalidNodeIndex;	Child=mTo.GetNextSibling(Child) )
+			mToChildren.push_back( Child );
+
+		//	elements inserted or removed leave the same head and tail
+		auto FromCount = mFromChildren.size();
+		auto ToCount = mToChildren.size();
+		auto MinCount = std::min( FromCount, ToCount );
+		size_t Head = 0;
+		while ( Head < MinCount && IsSame( mFromChildren[Head], mToChildren[Head] ) )
+			Head++;
+		size_t Tail = 0;
+		while ( Tail < MinCount-Head && IsSame( mFromChildren[FromCount-1-Tail], mToChildren[ToCount-1-Tail] ) )
+			Tail++;
+
+		GetEditScript( Head, FromCount-Tail, Head, ToCount-Tail );
+
+		//	between unchanged elements, removed and inserted elements are paired up and diffed, the rest
+		//	removed or added. Only elements after the pairs are renumbered, so their changes can come after
+		auto ParentPathLength = mPath.size();
+		auto FirstPending = mPending.size();
+		size_t Position = Head;
+		size_t FromIndex = Head;
+		size_t ToIndex = Head;
+		for ( size_t e=0;	e<mEditScript.size();	)
+		{
+			if ( mEditScript[e] == Step_t::Same )
+			{
+				Position++;
+				FromIndex++;
+				ToIndex++;
+				e++;
+				continue;
+			}
+			size_t Removed = 0;
+			size_t Inserted = 0;
+			for ( ;	e<mEditScript.size() && mEditScript[e] != Step_t::Same;	e++ )
+				( mEditScript[e] == Step_t::Remove ? Removed : Inserted )++;
+
+			for ( size_t p=0;	p<std::min( Removed, Inserted );	p++ )
+			{
+				Pending_t Pending;
+				Pending.mFrom = mFromChildren[FromIndex+p];
+				Pending.mTo = mToChildren[ToIndex+p];
+				Pending.mParentPathLength = ParentPathLength;
+				Pending.mIndex = Position++;
+				mPending.push_back( Pending );
+			}
+			for ( auto r=std::min( Removed, Inserted );	r<Removed;	r++ )
+			{
+				mChildPath = mPath;
+				AppendPointerToken( mChildPath, Position );
+				Emit( Patch::Change_t::Remove, mChildPath, mFromChildren[FromIndex+r], InvalidNodeIndex );
+			}
+			for ( auto i=std::min( Removed, Inserted );	i<Inserted;	i++ )
+			{
+				mChildPath = mPath;
+				AppendPointerToken( mChildPath, Position++ );
+				Emit( Patch::Change_t::Add, mChildPath, InvalidNodeIndex, mToChildren[ToIndex+i] );
+			}
+			FromIndex += Removed;
+			ToIndex += Inserted;
+		}
+		//	popped in element order
+		std::reverse( mPending.begin()+FirstPending, mPending.end() );
+	}
+
+	//	shortest edit script between mFromChildren[FromStart,FromEnd) and mToChildren[ToStart,ToEnd) (Myers' greedy
+	//	O(ND) algorithm). If there are more than MaxEdits differences, they are all removed and inserted (so diffed pairwise)
+	void Differ_t::GetEditScript(size_t FromStart,size_t FromEnd,size_t ToStart,size_t ToEnd)
+	{
+		constexpr ptrdiff_t MaxEdits = 64;
+		mEditScript.clear();
+		auto n = static_cast<ptrdiff_t>( FromEnd - FromStart );
+		auto m = static_cast<ptrdiff_t>( ToEnd - ToStart );
+		auto IsSameAt = [&](ptrdiff_t x,ptrdiff_t y)	{	return IsSame( mFromChildren[FromStart+x], mToChildren[ToStart+y] );	};
+
+		auto MaxD = std::min<ptrdiff_t>( n+m, MaxEdits );
+		std::vector<ptrdiff_t> Furthest( 2*MaxD+3, 0 );		//	furthest x on each diagonal k (x-y), offset by MaxD+1
+		auto Offset = MaxD+1;
+		mEditTrace.clear();
+		ptrdiff_t FoundD = -1;
+		for ( ptrdiff_t d=0;	d<=MaxD && FoundD<0;	d++ )
+		{
+			mEditTrace.insert( mEditTrace.end(), Furthest.begin(), Furthest.end() );
+			for ( ptrdiff_t k=-d;	k<=d;	k+=2 )
+			{
+				ptrdiff_t x = ( k == -d || ( k != d && Furthest[Offset+k-1] < Furthest[Offset+k+1] ) ) ? Furthest[Offset+k+1] : Furthest[Offset+k-1]+1;
+				ptrdiff_t y = x - k;
+				while ( x < n && y < m && IsSameAt( x, y ) )
+				{
+					x++;
+					y++;
+				}
+				Furthest[Offset+k] = x;
+				if ( x >= n && y >= m )
+				{
+					FoundD = d;
+					break;
+				}
+			}
+		}
+
+		if ( FoundD < 0 )
+		{
+			mEditScript.assign( n, Step_t::Remove );
+			mEditScript.insert( mEditScript.end(), m, Step_t::Insert );
+			return;
+		}
+
+		//	walk back through the furthest points of each d
+		ptrdiff_t x = n;
+		ptrdiff_t y = m;
+		for ( auto d=FoundD;	d>0;	d-- )
+		{
+			auto* Previous = &mEditTrace[d*Furthest.size()];
+			auto k = x - y;
+			auto PreviousK = ( k == -d || ( k != d && Previous[Offset+k-1] < Previous[Offset+k+1] ) ) ? k+1 : k-1;
+			auto PreviousX = Previous[Offset+PreviousK];
+			auto PreviousY = PreviousX - PreviousK;
+			while ( x > PreviousX && y > PreviousY )
+			{
+				mEditScript.push_back( Step_t::Same );
+				x--;
+				y--;
+			}
+			mEditScript.push_back( x == PreviousX ? Step_t::Insert : Step_t::Remove );
+			x = PreviousX;
+			y = PreviousY;
+		}
+		mEditScript.insert( mEditScript.end(), x, Step_t::Same );
+		std::reverse( mEditScript.begin(), mEditScript.end() );
+	}
+}
+
+
+void PopJson::Patch::Diff(const Map_t& From,std::string_view FromJson,const Map_t& To,std::string_view ToJson,const OnChange_t& OnChange,size_t ThreadCount)
+{
+	if ( From.GetNodeCount() == 0 || To.GetNodeCount() == 0 )
+		throw std::runtime_error("Cannot diff an empty map");
+
+	//	each thread has at least this many members, below that threads cost more than they save
+	constexpr size_t MinMembersPerThread = 256;
+	auto& FromRoot = From.GetNode(0);
+	auto& ToRoot = To.GetNode(0);
+	auto MemberCount = std::max<size_t>( FromRoot.GetChildCount(), ToRoot.GetChildCount() );
+	ThreadCount = std::min( ThreadCount, MemberCount / MinMembersPerThread );
+	Differ_t Differ( From, FromJson, To, ToJson, OnChange );
+	if ( ThreadCount <= 1 || FromRoot.GetType() != ValueType_t::Object || ToRoot.GetType() != ValueType_t::Object )
+	{
+		Differ.Diff( 0, 0 );
+		return;
+	}
+	if ( Differ.IsSame( 0, 0 ) )
+		return;
+
+	//	each thread collects its part's changes; removed members, added members, then changed members.
+	//	Afterwards all the parts' changes of each kind are reported, in the order one thread would have
+	class Collected_t
+	{
+	public:
+		Change_t::Operation_t	mOperation = Change_t::Replace;
+		std::string				mPath;
+		NodeIndex_t				mFromNode = InvalidNodeIndex;
+		NodeIndex_t				mToNode = InvalidNodeIndex;
+	};
+	MemberIndex_t FromMembers;
+	MemberIndex_t ToMembers;
+	FromMembers.Build( From, FromJson, 0 );
+	ToMembers.Build( To, ToJson, 0 );
+	std::vector<std::vector<Collected_t>> Changes( ThreadCount );
+	std::vector<std::array<size_t,2>> PhaseEnds( ThreadCount );
+	std::vector<std::exception_ptr> Errors( ThreadCount );
+	auto DiffPart = [&](size_t Part)
+	{
+		try
+		{
+			OnChange_t Collect = [&](const Change_t& Change)
+			{
+				Changes[Part].push_back( { Change.mOperation, std::string(Change.mPath), Change.mFromNode, Change.mToNode } );
+			};
+			Differ_t PartDiffer( From, FromJson, To, ToJson, Collect );
+			PartDiffer.DiffMembers( 0, ToMembers, Part, ThreadCount );
+			PhaseEnds[Part][0] = Changes[Part].size();
+			PartDiffer.AddMembers( 0, FromMembers, Part, ThreadCount );
+			PhaseEnds[Part][1] = Changes[Part].size();
+			PartDiffer.Run();
+		}
+		catch(...)
+		{
+			Errors[Part] = std::current_exception();
+		}
+	};
+	std::vector<std::thread> Threads;
+	for ( size_t Part=1;	Part<ThreadCount;	Part++ )
+		Threads.emplace_back( DiffPart, Part );
+	DiffPart( 0 );
+	for ( auto& Thread : Threads )
+		Thread.join();
+
+	for ( auto& Error : Errors )
+		if ( Error )
+			std::rethrow_exception( Error );
+	for ( size_t Phase=0;	Phase<3;	Phase++ )
+	{
+		for ( size_t Part=0;	Part<ThreadCount;	Part++ )
+		{
+			auto First = Phase == 0 ? 0 : PhaseEnds[Part][Phase-1];
+			auto End = Phase == 2 ? Changes[Part].size() : PhaseEnds[Part][Phase];
+			for ( auto i=First;	i<End;	i++ )
+			{
+				auto& Collected = Changes[Part][i];
+				Change_t Change;
+				Change.mOperation = Collected.mOperation;
+				Change.mPath = Collected.mPath;
+				Change.mFromNode = Collected.mFromNode;
+				Change.mToNode = Collected.mToNode;
+				OnChange( Change );
+			}
+		}
+	}
+}
+
+std::string PopJson::Patch::Diff(const Map_t& From,std::string_view FromJson,const Map_t& To,std::string_view ToJson,size_t ThreadCount)
+{
+	std::string Patch = "[";
+	auto OnChange = [&](const Change_t& Change)
+	{
+		if ( Patch.size() > 1 )
+			Patch.push_back(',');
+		switch ( Change.mOperation )
+		{
+			case Change_t::Add:		Patch.append("{\"op\":\"add\",\"path\":\"");		break;
+			case Change_t::Remove:	Patch.append("{\"op\":\"remove\",\"path\":\"");	break;
+			case Change_t::Replace:	Patch.append("{\"op\":\"replace\",\"path\":\"");	break;
+		}
+		Patch.append( GetEscapedKey( Change.mPath ) );
+		Patch.push_back('"');
+		if ( Change.mOperation != Change_t::Remove )
+		{
+			Patch.append(",\"value\":");
+			Patch.append( GetValueJson( To, ToJson, Change.mToNode ) );
+		}
+		Patch.push_back('}');
+	};
+	Diff( From, FromJson, To, ToJson, OnChange, ThreadCount );
+	Patch.push_back(']');
+	return Patch;
+}
+
+std::string PopJson::Patch::Diff(std::string_view FromJson,std::string_view ToJson)
+{
+	auto From = Parse( FromJson );
+	auto To = Parse( ToJson );
+	return Diff( From, FromJson, To, ToJson );
+}
+
+
+void PopJson::Json_t::ApplyPatch(std::string_view PatchJson)
+{
+	POPJSON_PHASE(Write);
+	Patch::JsonTarget_t Target( *this );
+	try
+	{
+		ApplyOperations( Target, PatchJson );
+	}
+	catch(std::exception&)
+	{
+		Target.Revert();
+		throw;
+	}
+}
+
+void PopJson::Json_t::ApplyMergePatch(std::string_view PatchJson)
+{
+	POPJSON_PHASE(Write);
+	auto PatchMap = Parse( PatchJson );
+	Patch::JsonTarget_t Target( *this );
+	try
+	{
+		Target.Merge( PatchMap, PatchJson );
+	}
+	catch(std::exception&)
+	{
+		Target.Revert();
+		throw;
+	}
+}
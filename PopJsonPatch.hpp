@@ -0,0 +1,71 @@
+/*
+	RFC 6902 (json patch) and RFC 7396 (merge patch).
+
+	Targets are resolved on a parsed Map_t of the document, and each operation becomes an edit
+	(replace bytes [start,end) of the original with new text). The output is then spliced
+	together in one pass; untouched ranges of the original are copied wholesale, and only the
+	patched spans are written, so formatting outside of them is preserved.
+	Json patch operations are batched against one parse of the document; an operation which
+	depends on an earlier one in the batch (its path is inside a value already patched, or it adds
+	to or removes from a container another operation has touched) splices the batch and re-parses
+	before continuing.
+
+	Object keys are matched as they appear in the json (escaped), as with duplicate key checks.
+
+	Json_t::ApplyPatch() and Json_t::ApplyMergePatch() are the in-place equivalents; they edit
+	the node list of the Json_t and append new values to its storage instead of producing a new
+	document.
+
+	Diff() goes the other way, producing the changes between two parsed documents. Both maps are
+	walked together; object members are matched by key (through the key index, or a table built for
+	a wide object, never a scan per member), arrays have their common head and tail trimmed and the
+	rest compared pairwise, and values whose bytes are identical (or whose content hashes differ,
+	when both maps have them) aren't walked. The members of a wide root object can be split across
+	threads.
+*/
+#pragma once
+
+#include "PopJson.hpp"
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace PopJson::Patch
+{
+	//	operations are applied in order; if one fails (including a test) this throws
+	std::string		Apply(std::string_view Json,std::string_view Patch);
+	std::string		MergePatch(std::string_view Json,std::string_view Patch);
+
+	//	RFC 6901 json pointer, relative to Node. InvalidNodeIndex if it doesn't resolve (including "-")
+	NodeIndex_t		FindPointer(const Map_t& Map,std::string_view Json,std::string_view Pointer,NodeIndex_t Node=0);
+
+	//	json equality, as used by the test operation; object key order is ignored, numbers compare
+	//	by value and strings compare unescaped. When both maps have content hashes, values with
+	//	different hashes are unequal without being walked
+	bool			IsEqual(const Map_t& a,std::string_view aJson,NodeIndex_t aNode,const Map_t& b,std::string_view bJson,NodeIndex_t bNode);
+
+	//	one operation of a diff; applying them in order turns From into To
+	class Change_t
+	{
+	public:
+		enum Operation_t
+		{
+			Add,
+			Remove,
+			Replace,
+		};
+		Operation_t			mOperation = Replace;
+		std::string_view	mPath;		//	RFC 6901 pointer into the document as patched so far; only valid during the callback
+		NodeIndex_t			mFromNode = InvalidNodeIndex;	//	value removed or replaced
+		NodeIndex_t			mToNode = InvalidNodeIndex;		//	value added or replacing
+	};
+	using OnChange_t = std::function<void(const Change_t& Change)>;
+
+	//	changes from one document to another, reported in order. With ThreadCount > 1 the members of a
+	//	wide root object are diffed on that many threads; changes are still reported in the same order,
+	//	from this thread, once they're all done
+	void			Diff(const Map_t& From,std::string_view FromJson,const Map_t& To,std::string_view ToJson,const OnChange_t& OnChange,size_t ThreadCount=1);
+	//	as an RFC 6902 patch; Apply( FromJson, Patch ) gives a document IsEqual to To
+	std::string		Diff(const Map_t& From,std::string_view FromJson,const Map_t& To,std::string_view ToJson,size_t ThreadCount=1);
+	std::string		Diff(std::string_view FromJson,std::string_view ToJson);
+}
@@ -0,0 +1,592 @@
+#include "PopJsonPath.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+
+
+namespace
+{
+	using namespace PopJson;
+
+	//	each thread has at least this many children, below that threads cost more than they save
+	constexpr size_t	MinChildrenPerThread = 4096;
+
+	class PathParser_t
+	{
+	public:
+		PathParser_t(std::string_view Path) :
+			mPath	( Path )
+		{
+		}
+
+		std::vector<JsonPath_t::Step_t>	Parse()
+		{
+			SkipWhitespace();
+			Expect('$');
+			std::vector<JsonPath_t::Step_t> Steps;
+			while ( true )
+			{
+				SkipWhitespace();
+				if ( IsEnd() )
+					return Steps;
+
+				JsonPath_t::Step_t Step;
+				if ( Peek('.') )
+				{
+					mPosition++;
+					if ( Peek('.') )
+					{
+						mPosition++;
+						Step.mDescendants = true;
+					}
+					if ( Peek('[') )
+					{
+						if ( !Step.mDescendants )
+							Fail("expected a name after .");
+						mPosition++;
+						ParseBracket( Step );
+					}
+					else
+					{
+						ParseDotName( Step );
+					}
+				}
+				else if ( Peek('[') )
+				{
+					mPosition++;
+					ParseBracket( Step );
+				}
+				else
+				{
+					Fail("expected . or [");
+				}
+				Steps.push_back( std::move(Step) );
+			}
+		}
+
+	private:
+		[[noreturn]] void	Fail(std::string_view Message)
+		{
+			throw std::runtime_error("JSONPath " + std::string(Message) + " at " + std::to_string(mPosition) + " of " + std::string(mPath));
+		}
+
+		bool	IsEnd() const			{	return mPosition >= mPath.size();	}
+		bool	Peek(char Char) const	{	return !IsEnd() && mPath[mPosition] == Char;	}
+		void	Expect(char Char)
+		{
+			if ( !Peek(Char) )
+				Fail( std::string("expected ") + Char );
+			mPosition++;
+		}
+		void	SkipWhitespace()
+		{
+			while ( Peek(' ') || Peek('\t') || Peek('\n') || Peek('\r') )
+				mPosition++;
+		}
+
+		static std::string	GetEscapedKey(std::string_view Name)
+		{
+			std::vector<char> Escaped;
+			AppendEscapedString( Escaped, Name );
+			return std::string( Escaped.begin(), Escaped.end() );
+		}
+
+		//	a name runs to the next . or [
+		std::string_view	ParseName()
+		{
+			auto Start = mPosition;
+			while ( !IsEnd() && !Peek('.') && !Peek('[') && !Peek(' ') && !Peek('=') && !Peek('!') && !Peek('<') && !Peek('>') && !Peek(')') && !Peek(']') )
+				mPosition++;
+			if ( mPosition == Start )
+				Fail("expected a name");
+			return mPath.substr( Start, mPosition-Start );
+		}
+
+		void	ParseDotName(JsonPath_t::Step_t& Step)
+		{
+			if ( Peek('*') )
+			{
+				mPosition++;
+				Step.mSelector = JsonPath_t::Step_t::Wildcard;
+				return;
+			}
+			Step.mSelector = JsonPath_t::Step_t::Name;
+			Step.mKey = GetEscapedKey( ParseName() );
+		}
+
+		//	'...' or "...", a backslash takes the next character as it is
+		std::string	ParseQuoted()
+		{
+			auto Quote = mPath[mPosition++];
+			std::string String;
+			while ( true )
+			{
+				if ( IsEnd() )
+					Fail("unterminated string");
+				auto Char = mPath[mPosition++];
+				if ( Char == Quote )
+					return String;
+				if ( Char == '\\' )
+				{
+					if ( IsEnd() )
+						Fail("unterminated string");
+					Char = mPath[mPosition++];
+				}
+				String += Char;
+			}
+		}
+
+		std::optional<int64_t>	ParseOptionalInteger()
+		{
+			SkipWhitespace();
+			if ( !Peek('-') && ( IsEnd() || mPath[mPosition] < '0' || mPath[mPosition] > '9' ) )
+				return {};
+			int64_t Value = 0;
+			auto* Start = mPath.data() + mPosition;
+			auto Result = std::from_chars( Start, mPath.data() + mPath.size(), Value );
+			if ( Result.ec != std::errc() )
+				Fail("invalid integer");
+			mPosition += Result.ptr - Start;
+			SkipWhitespace();
+			return Value;
+		}
+
+		//	after [
+		void	ParseBracket(JsonPath_t::Step_t& Step)
+		{
+			SkipWhitespace();
+			if ( Peek('*') )
+			{
+				mPosition++;
+				Step.mSelector = JsonPath_t::Step_t::Wildcard;
+			}
+			else if ( Peek('\'') || Peek('"') )
+			{
+				Step.mSelector = JsonPath_t::Step_t::Name;
+				Step.mKey = GetEscapedKey( ParseQuoted() );
+			}
+			else if ( Peek('?') )
+			{
+				mPosition++;
+				Step.mSelector = JsonPath_t::Step_t::Filter;
+				SkipWhitespace();
+				bool Parenthesised = Peek('(');
+				if ( Parenthesised )
+					mPosition++;
+				ParseFilter( Step.mFilter );
+				if ( Parenthesised )
+					Expect(')');
+			}
+			else
+			{
+				auto Start = ParseOptionalInteger();
+				if ( !Peek(':') )
+				{
+					if ( !Start )
+						Fail("expected a selector");
+					Step.mSelector = JsonPath_t::Step_t::Index;
+					Step.mIndex = *Start;
+				}
+				else
+				{
+					mPosition++;
+					Step.mSelector = JsonPath_t::Step_t::Slice;
+					Step.mSliceStart = Start;
+					Step.mSliceEnd = ParseOptionalInteger();
+					if ( Peek(':') )
+					{
+						mPosition++;
+						Step.mSliceStep = ParseOptionalInteger().value_or(1);
+					}
+				}
+			}
+			SkipWhitespace();
+			Expect(']');
+		}
+
+		void	ParseFilter(JsonPath_t::Filter_t& Filter)
+		{
+			SkipWhitespace();
+			Expect('@');
+			while ( Peek('.') || Peek('[') )
+			{
+				auto& Token = Filter.mPath.emplace_back();
+				if ( mPath[mPosition++] == '.' )
+				{
+					Token.mKey = GetEscapedKey( ParseName() );
+					continue;
+				}
+				SkipWhitespace();
+				if ( Peek('\'') || Peek('"') )
+				{
+					Token.mKey = GetEscapedKey( ParseQuoted() );
+				}
+				else
+				{
+					auto Index = ParseOptionalInteger();
+					if ( !Index )
+						Fail("expected a name or index");
+					Token.mIsIndex = true;
+					Token.mIndex = *Index;
+				}
+				SkipWhitespace();
+				Expect(']');
+			}
+
+			SkipWhitespace();
+			auto Remaining = mPath.substr( mPosition );
+			using Filter_t = JsonPath_t::Filter_t;
+			std::pair<std::string_view,Filter_t::Operator_t> Operators[] =
+			{
+				{ "==", Filter_t::Equal },			{ "!=", Filter_t::NotEqual },
+				{ "<=", Filter_t::LessOrEqual },	{ ">=", Filter_t::GreaterOrEqual },
+				{ "<", Filter_t::Less },			{ ">", Filter_t::Greater },
+			};
+			for ( auto& [Symbol,Operator] : Operators )
+			{
+				if ( Remaining.substr( 0, Symbol.size() ) != Symbol )
+					continue;
+				mPosition += Symbol.size();
+				Filter.mOperator = Operator;
+				ParseLiteral( Filter );
+				return;
+			}
+		}
+
+		void	ParseLiteral(JsonPath_t::Filter_t& Filter)
+		{
+			SkipWhitespace();
+			if ( Peek('\'') || Peek('"') )
+			{
+				Filter.mLiteralType = ValueType_t::String;
+				Filter.mString = ParseQuoted();
+				SkipWhitespace();
+				return;
+			}
+
+			std::pair<std::string_view,ValueType_t::Type> Literals[] =
+			{
+				{ "true", ValueType_t::BooleanTrue },	{ "false", ValueType_t::BooleanFalse },	{ "null", ValueType_t::Null },
+			};
+			for ( auto& [Literal,Type] : Literals )
+			{
+				if ( mPath.substr( mPosition, Literal.size() ) != Literal )
+					continue;
+				mPosition += Literal.size();
+				Filter.mLiteralType = Type;
+				SkipWhitespace();
+				return;
+			}
+
+			auto* Start = mPath.data() + mPosition;
+			auto Result = std::from_chars( Start, mPath.data() + mPath.size(), Filter.mNumber );
+			if ( Result.ec != std::errc() )
+				Fail("expected a literal");
+			mPosition += Result.ptr - Start;
+			Filter.mLiteralType = ValueType_t::NumberDouble;
+			SkipWhitespace();
+		}
+
+	private:
+		std::string_view	mPath;
+		size_t				mPosition = 0;
+	};
+
+
+	class Evaluator_t
+	{
+	public:
+		Evaluator_t(const std::vector<JsonPath_t::Step_t>& Steps,const Map_t& Map,std::string_view Json) :
+			mSteps	( Steps ),
+			mMap	( Map ),
+			mJson	( Json )
+		{
+		}
+
+		void	Evaluate(size_t StepIndex,std::span<const NodeIndex_t> Nodes,std::vector<NodeIndex_t>& Output,size_t ThreadCount) const;
+
+	private:
+		void	Select(const JsonPath_t::Step_t& Step,NodeIndex_t Parent,std::vector<NodeIndex_t>& Selected) const;
+		void	SelectChildren(const JsonPath_t::Step_t& Step,NodeIndex_t Parent,std::vector<NodeIndex_t>& Selected) const;
+		void	SelectSlice(const JsonPath_t::Step_t& Step,NodeIndex_t Parent,std::vector<NodeIndex_t>& Selected) const;
+		bool	IsMatch(const JsonPath_t::Filter_t& Filter,NodeIndex_t Node) const;
+		//	the children of Parent, and the rest of the query for them, split across threads
+		void	EvaluateParallel(size_t StepIndex,NodeIndex_t Parent,std::vector<NodeIndex_t>& Output,size_t ThreadCount) const;
+
+		NodeIndex_t		FindIndex(NodeIndex_t Parent,int64_t Index) const;
+
+	private:
+		const std::vector<JsonPath_t::Step_t>&	mSteps;
+		const Map_t&							mMap;
+		std::string_view						mJson;
+	};
+}
+
+
+void Evaluator_t::Evaluate(size_t StepIndex,std::span<const NodeIndex_t> Nodes,std::vector<NodeIndex_t>& Output,size_t ThreadCount) const
+{
+	if ( StepIndex == mSteps.size() )
+	{
+		Output.insert( Output.end(), Nodes.begin(), Nodes.end() );
+		return;
+	}
+
+	auto& Step = mSteps[StepIndex];
+	bool CanSplit = ThreadCount > 1 && !Step.mDescendants && ( Step.mSelector == JsonPath_t::Step_t::Wildcard || Step.mSelector == JsonPath_t::Step_t::Filter );
+	std::vector<NodeIndex_t> Selected;
+	for ( auto Node : Nodes )
+	{
+		if ( CanSplit && mMap.GetNode(Node).GetChildCount() >= MinChildrenPerThread*2 )
+		{
+			//	whatever was selected before this node goes first, to keep the order
+			Evaluate( StepIndex+1, Selected, Output, ThreadCount );
+			Selected.clear();
+			EvaluateParallel( StepIndex, Node, Output, ThreadCount );
+			continue;
+		}
+
+		if ( !Step.mDescendants )
+		{
+			Select( Step, Node, Selected );
+			continue;
+		}
+		//	descendants are the nodes directly after this one; the selector applies to each container of them
+		auto& ParentNode = mMap.GetNode(Node);
+		auto Last = Node + ParentNode.GetDescendantCount();
+		for ( auto Descendant=Node;	Descendant<=Last;	Descendant++ )
+		{
+			auto Type = mMap.GetNode(Descendant).GetType();
+			if ( Type == ValueType_t::Object || Type == ValueType_t::Array )
+				Select( Step, Descendant, Selected );
+		}
+	}
+	Evaluate( StepIndex+1, Selected, Output, ThreadCount );
+}
+
+void Evaluator_t::EvaluateParallel(size_t StepIndex,NodeIndex_t Parent,std::vector<NodeIndex_t>& Output,size_t ThreadCount) const
+{
+	std::vector<NodeIndex_t> Children;
+	Children.reserve( mMap.GetNode(Parent).GetChildCount() );
+	for ( auto Child = mMap.GetFirstChild(Parent);	Child != InvalidNodeIndex;	Child = mMap.GetNextSibling(Child) )
+		Children.push_back( Child );
+	ThreadCount = std::min( ThreadCount, Children.size() / MinChildrenPerThread );
+
+	auto& Step = mSteps[StepIndex];
+	std::vector<std::vector<NodeIndex_t>> Outputs( ThreadCount );
+	std::vector<std::exception_ptr> Errors( ThreadCount );
+	auto EvaluatePart = [&](size_t Part)
+	{
+		try
+		{
+			auto First = Children.size() * Part / ThreadCount;
+			auto End = Children.size() * (Part+1) / ThreadCount;
+			std::span<const NodeIndex_t> PartChildren( Children.data() + First, End - First );
+			if ( Step.mSelector == JsonPath_t::Step_t::Wildcard )
+			{
+				Evaluate( StepIndex+1, PartChildren, Outputs[Part], 1 );
+				return;
+			}
+			std::vector<NodeIndex_t> Selected;
+			for ( auto Child : PartChildren )
+				if ( IsMatch( Step.mFilter, Child ) )
+					Selected.push_back( Child );
+			Evaluate( StepIndex+1, Selected, Outputs[Part], 1 );
+		}
+		catch(...)
+		{
+			Errors[Part] = std::current_exception();
+		}
+	};
+	std::vector<std::thread> Threads;
+	for ( size_t Part=1;	Part<ThreadCount;	Part++ )
+		Threads.emplace_back( EvaluatePart, Part );
+	EvaluatePart( 0 );
+	for ( auto& Thread : Threads )
+		Thread.join();
+
+	for ( auto& Error : Errors )
+		if ( Error )
+			std::rethrow_exception( Error );
+	for ( auto& PartOutput : Outputs )
+		Output.insert( Output.end(), PartOutput.begin(), PartOutput.end() );
+}
+
+NodeIndex_t Evaluator_t::FindIndex(NodeIndex_t Parent,int64_t Index) const
+{
+	auto& ParentNode = mMap.GetNode(Parent);
+	if ( ParentNode.GetType() != ValueType_t::Array )
+		return InvalidNodeIndex;
+	if ( Index < 0 )
+		Index += ParentNode.GetChildCount();
+	if ( Index < 0 )
+		return InvalidNodeIndex;
+	return mMap.FindChild( Parent, static_cast<size_t>(Index) );
+}
+
+void Evaluator_t::Select(const JsonPath_t::Step_t& Step,NodeIndex_t Parent,std::vector<NodeIndex_t>& Selected) const
+{
+	switch ( Step.mSelector )
+	{
+		case JsonPath_t::Step_t::Name:
+		{
+			if ( mMap.GetNode(Parent).GetType() != ValueType_t::Object )
+				return;
+			auto Child = mMap.FindChild( Parent, Step.mKey, mJson );
+			if ( Child != InvalidNodeIndex )
+				Selected.push_back( Child );
+			return;
+		}
+
+		case JsonPath_t::Step_t::Index:
+		{
+			auto Child = FindIndex( Parent, Step.mIndex );
+			if ( Child != InvalidNodeIndex )
+				Selected.push_back( Child );
+			return;
+		}
+
+		case JsonPath_t::Step_t::Slice:
+			SelectSlice( Step, Parent, Selected );
+			return;
+
+		case JsonPath_t::Step_t::Wildcard:
+		case JsonPath_t::Step_t::Filter:
+			SelectChildren( Step, Parent, Selected );
+			return;
+	}
+}
+
+void Evaluator_t::SelectChildren(const JsonPath_t::Step_t& Step,NodeIndex_t Parent,std::vector<NodeIndex_t>& Selected) const
+{
+	bool IsFilter = Step.mSelector == JsonPath_t::Step_t::Filter;
+	for ( auto Child = mMap.GetFirstChild(Parent);	Child != InvalidNodeIndex;	Child = mMap.GetNextSibling(Child) )
+		if ( !IsFilter || IsMatch( Step.mFilter, Child ) )
+			Selected.push_back( Child );
+}
+
+void Evaluator_t::SelectSlice(const JsonPath_t::Step_t& Step,NodeIndex_t Parent,std::vector<NodeIndex_t>& Selected) const
+{
+	auto& ParentNode = mMap.GetNode(Parent);
+	if ( ParentNode.GetType() != ValueType_t::Array || Step.mSliceStep == 0 )
+		return;
+
+	//	bounds as in RFC 9535; negative values are from the end, then clamped
+	int64_t Length = ParentNode.GetChildCount();
+	auto Normalise = [&](int64_t Index)	{	return Index < 0 ? Index + Length : Index;	};
+	auto StepSize = Step.mSliceStep;
+	int64_t Start, End;
+	if ( StepSize > 0 )
+	{
+		Start = std::clamp<int64_t>( Normalise( Step.mSliceStart.value_or(0) ), 0, Length );
+		End = std::clamp<int64_t>( Normalise( Step.mSliceEnd.value_or(Length) ), 0, Length );
+	}
+	else
+	{
+		Start = Step.mSliceStart ? std::clamp<int64_t>( Normalise( *Step.mSliceStart ), -1, Length-1 ) : Length-1;
+		End = Step.mSliceEnd ? std::clamp<int64_t>( Normalise( *Step.mSliceEnd ), -1, Length-1 ) : -1;
+	}
+
+	if ( StepSize > 0 )
+	{
+		int64_t Index = 0;
+		for ( auto Child = mMap.GetFirstChild(Parent);	Child != InvalidNodeIndex && Index < End;	Child = mMap.GetNextSibling(Child), Index++ )
+			if ( Index >= Start && ( Index - Start ) % StepSize == 0 )
+				Selected.push_back( Child );
+		return;
+	}
+
+	//	backwards; children can only be walked forwards, so they're found first
+	std::vector<NodeIndex_t> Children;
+	for ( auto Child = mMap.GetFirstChild(Parent);	Child != InvalidNodeIndex;	Child = mMap.GetNextSibling(Child) )
+		Children.push_back( Child );
+	for ( auto Index=Start;	Index>End;	Index+=StepSize )
+		Selected.push_back( Children[Index] );
+}
+
+bool Evaluator_t::IsMatch(const JsonPath_t::Filter_t& Filter,NodeIndex_t Node) const
+{
+	for ( auto& Token : Filter.mPath )
+	{
+		if ( Token.mIsIndex )
+			Node = FindIndex( Node, Token.mIndex );
+		else if ( mMap.GetNode(Node).GetType() == ValueType_t::Object )
+			Node = mMap.FindChild( Node, Token.mKey, mJson );
+		else
+			Node = InvalidNodeIndex;
+		if ( Node == InvalidNodeIndex )
+			return false;
+	}
+	if ( Filter.mOperator == JsonPath_t::Filter_t::Exists )
+		return true;
+
+	//	-1, 0, 1, or nothing when the types can't be compared
+	SliceReadOnly_t Value( mMap, mJson, Node );
+	auto Type = Value.GetType();
+	std::optional<int> Order;
+	if ( Filter.mLiteralType == ValueType_t::NumberDouble )
+	{
+		auto Number = Value.TryGetDouble();
+		if ( Number )
+			Order = *Number < Filter.mNumber ? -1 : *Number > Filter.mNumber ? 1 : 0;
+	}
+	else if ( Filter.mLiteralType == ValueType_t::String )
+	{
+		if ( Type == ValueType_t::String )
+		{
+			//	escaped strings are compared unescaped
+			auto Raw = Value.GetRawValue();
+			std::string Unescaped;
+			if ( Raw.find('\\') != std::string_view::npos )
+			{
+				Unescaped = Value.TryGetString().Value();
+				Raw = Unescaped;
+			}
+			auto Compare = Raw.compare( Filter.mString );
+			Order = Compare < 0 ? -1 : Compare > 0 ? 1 : 0;
+		}
+	}
+	else if ( Type == Filter.mLiteralType )
+	{
+		Order = 0;
+	}
+
+	switch ( Filter.mOperator )
+	{
+		case JsonPath_t::Filter_t::Equal:			return Order == 0;
+		case JsonPath_t::Filter_t::NotEqual:		return Order != 0;
+		case JsonPath_t::Filter_t::Less:			return Order && *Order < 0;
+		case JsonPath_t::Filter_t::LessOrEqual:		return Order && *Order <= 0;
+		case JsonPath_t::Filter_t::Greater:			return Order && *Order > 0;
+		case JsonPath_t::Filter_t::GreaterOrEqual:	return Order && *Order >= 0;
+		default:									return true;
+	}
+}
+
+
+PopJson::JsonPath_t::JsonPath_t(std::string_view Path) :
+	mSteps	( PathParser_t( Path ).Parse() )
+{
+}
+
+void PopJson::JsonPath_t::Evaluate(const Map_t& Map,std::string_view Json,std::vector<NodeIndex_t>& Nodes,size_t ThreadCount) const
+{
+	Nodes.clear();
+	if ( Map.GetNodeCount() == 0 )
+		return;
+	NodeIndex_t Root = 0;
+	Evaluator_t( mSteps, Map, Json ).Evaluate( 0, std::span<const NodeIndex_t>( &Root, 1 ), Nodes, ThreadCount );
+}
+
+std::vector<PopJson::SliceReadOnly_t> PopJson::JsonPath_t::Evaluate(const Map_t& Map,std::string_view Json,size_t ThreadCount) const
+{
+	std::vector<NodeIndex_t> Nodes;
+	Evaluate( Map, Json, Nodes, ThreadCount );
+	std::vector<SliceReadOnly_t> Slices;
+	Slices.reserve( Nodes.size() );
+	for ( auto Node : Nodes )
+		Slices.emplace_back( Map, Json, Node );
+	return Slices;
+}
@@ -0,0 +1,95 @@
+/*
+	JSONPath queries (a subset of RFC 9535) evaluated over a parsed Map_t.
+
+	A query is compiled once into steps; each step's selector is applied to every node the
+	previous step selected. Selectors are member names (.name or ['name']), wildcards (.* or [*]),
+	array indexes ([0], [-1] from the end), slices ([start:end:step]) and filters, which compare
+	a path relative to each child with a literal ([?(@.level=='error')], with == != < <= > >=) or
+	just check it exists ([?(@.price)]). After .. a selector applies to the node and all of its
+	descendants; eg. $.items[*].price, $..id, $.events[?(@.level=='error')].message
+
+	Results are node indexes (or slices) of the map, so nothing is copied or re-parsed. Children
+	are found by skipping their siblings' descendants, and a node's descendants are the nodes
+	directly after it, so recursive descent is a linear walk.
+
+	Wildcard and filter steps over a container with many children split the children (and the
+	rest of the query for them) across threads. The results are in the same order as one thread's.
+*/
+#pragma once
+
+#include "PopJson.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace PopJson
+{
+	class JsonPath_t;
+}
+
+
+class PopJson::JsonPath_t
+{
+public:
+	JsonPath_t(std::string_view Path);		//	throws on a syntax error
+
+	//	every node selected, in order. Json is the data the map was parsed from
+	void							Evaluate(const Map_t& Map,std::string_view Json,std::vector<NodeIndex_t>& Nodes,size_t ThreadCount=1) const;
+	std::vector<SliceReadOnly_t>	Evaluate(const Map_t& Map,std::string_view Json,size_t ThreadCount=1) const;
+
+public:
+	//	a member name or array index, from a filter's relative path
+	class Token_t
+	{
+	public:
+		bool			mIsIndex = false;
+		std::string		mKey;			//	escaped, as it's matched against the json
+		int64_t			mIndex = 0;
+	};
+
+	class Filter_t
+	{
+	public:
+		enum Operator_t
+		{
+			Exists,
+			Equal,
+			NotEqual,
+			Less,
+			LessOrEqual,
+			Greater,
+			GreaterOrEqual,
+		};
+
+		std::vector<Token_t>	mPath;		//	relative to the child being filtered (@)
+		Operator_t				mOperator = Exists;
+		ValueType_t::Type		mLiteralType = ValueType_t::Null;
+		std::string				mString;	//	unescaped
+		double					mNumber = 0;
+	};
+
+	class Step_t
+	{
+	public:
+		enum Selector_t
+		{
+			Name,
+			Wildcard,
+			Index,
+			Slice,
+			Filter,
+		};
+
+		Selector_t				mSelector = Wildcard;
+		bool					mDescendants = false;	//	after ..
+		std::string				mKey;					//	Name; escaped
+		int64_t					mIndex = 0;				//	Index
+		std::optional<int64_t>	mSliceStart;
+		std::optional<int64_t>	mSliceEnd;
+		int64_t					mSliceStep = 1;
+		Filter_t				mFilter;
+	};
+
+private:
+	std::vector<Step_t>		mSteps;
+};
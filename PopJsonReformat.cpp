@@ -0,0 +1,245 @@
+#include "PopJsonReformat.hpp"
+#include "PopJsonScan.hpp"
+#include <cstring>
+#include <stdexcept>
+
+
+std::string PopJson::Minify(std::string_view Json)
+{
+	std::string Output;
+	Output.reserve( Json.size() );
+	Reformat_t Reformat;
+	Reformat.Write( Json, Output );
+	Reformat.Finish();
+	return Output;
+}
+
+std::string PopJson::PrettyPrint(std::string_view Json,size_t Indent,char IndentChar)
+{
+	if ( Indent == 0 )
+		throw std::runtime_error("PrettyPrint indent must be at least 1");
+	std::string Output;
+	Output.reserve( Json.size() * 2 );
+	Reformat_t Reformat( Indent, IndentChar );
+	Reformat.Write( Json, Output );
+	Reformat.Finish();
+	return Output;
+}
+
+
+void PopJson::Reformat_t::Write(std::string_view Chunk,std::string& Output)
+{
+	if ( mIndent == 0 )
+		WriteMinified( Chunk, Output );
+	else
+		WritePretty( Chunk, Output );
+}
+
+void PopJson::Reformat_t::Finish()
+{
+	if ( mInString )
+		throw std::runtime_error("Json ended inside a string");
+	if ( mDepth != 0 )
+		throw std::runtime_error("Json ended with " + std::to_string(mDepth) + " unclosed containers");
+}
+
+size_t PopJson::Reformat_t::WriteString(std::string_view Chunk,size_t i,std::string& Output)
+{
+	while ( i < Chunk.size() )
+	{
+		//	whatever follows a \ is copied, including the first char of a \u; the hex digits are plain
+		if ( mEscaped )
+		{
+			Output.push_back( Chunk[i++] );
+			mEscaped = false;
+			continue;
+		}
+
+		auto Run = Scan::FindStringSpecial( Chunk.data()+i, Chunk.size()-i );
+		Output.append( Chunk.data()+i, Run );
+		i += Run;
+		if ( i == Chunk.size() )
+			break;
+
+		//	control chars are invalid json, but this isn't a validator; copy them
+		auto Char = Chunk[i++];
+		Output.push_back( Char );
+		if ( Char == '"' )
+		{
+			mInString = false;
+			break;
+		}
+		if ( Char == '\\' )
+			mEscaped = true;
+	}
+	return i;
+}
+
+void PopJson::Reformat_t::WriteMinified(std::string_view Chunk,std::string& Output)
+{
+	auto i = WriteMinifiedBlocks( Chunk, Output );
+
+	//	remaining partial block
+	while ( i < Chunk.size() )
+	{
+		if ( mInString )
+		{
+			i = WriteString( Chunk, i, Output );
+			continue;
+		}
+
+		//	structure, numbers & literals are copied as-is, up to whitespace or the next string
+		auto Run = Scan::FindWhitespaceOrQuote( Chunk.data()+i, Chunk.size()-i );
+		Output.append( Chunk.data()+i, Run );
+		i += Run;
+		if ( i == Chunk.size() )
+			break;
+
+		if ( Chunk[i] == '"' )
+		{
+			Output.push_back('"');
+			mInString = true;
+			i++;
+			continue;
+		}
+		i += Scan::SkipWhitespace( Chunk.data()+i, Chunk.size()-i );
+	}
+}
+
+size_t PopJson::Reformat_t::WriteMinifiedBlocks(std::string_view Chunk,std::string& Output)
+{
+	auto BlockBytes = Chunk.size() & ~size_t(63);
+	if ( BlockBytes == 0 )
+		return 0;
+
+	//	output is never longer than the input, so write through a pointer and trim afterwards.
+	//	runs are copied in 16 byte pieces, so allow them to overrun
+	constexpr size_t CopySize = 16;
+	auto OutputStart = Output.size();
+	Output.resize( OutputStart + BlockBytes + CopySize );
+	auto* Out = Output.data() + OutputStart;
+
+	uint64_t InString = mInString ? ~0ull : 0;
+	uint64_t Escaped = mEscaped ? 1 : 0;
+	for ( size_t i=0;	i<BlockBytes;	i+=64 )
+	{
+		auto* Block = Chunk.data() + i;
+		auto Masks = Scan::ClassifyBlock( Block );
+		auto Quotes = Masks.mQuote & ~Scan::GetEscaped( Masks.mBackslash, Escaped );
+		auto StringMask = Scan::PrefixXor( Quotes ) ^ InString;
+		InString = static_cast<uint64_t>( static_cast<int64_t>(StringMask) >> 63 );
+
+		//	copy each run of bytes which aren't whitespace outside of a string
+		auto Keep = ~( Masks.mWhitespace & ~StringMask );
+		if ( Keep == ~0ull )
+		{
+			std::memcpy( Out, Block, 64 );
+			Out += 64;
+			continue;
+		}
+		//	most runs are short; copy fixed size pieces from a padded copy of the block, rather
+		//	than a variable length memcpy per run
+		char Padded[64+CopySize];
+		std::memcpy( Padded, Block, 64 );
+		while ( Keep )
+		{
+			auto Start = Scan::CountTrailingZeros( Keep );
+			auto Length = Scan::CountTrailingZeros( ~(Keep >> Start) );
+			for ( int c=0;	c<Length;	c+=CopySize )
+				std::memcpy( Out+c, Padded+Start+c, CopySize );
+			Out += Length;
+			auto End = Start + Length;
+			Keep = End >= 64 ? 0 : Keep & (~0ull << End);
+		}
+	}
+	mInString = InString != 0;
+	mEscaped = Escaped != 0;
+	Output.resize( Out - Output.data() );
+	return BlockBytes;
+}
+
+void PopJson::Reformat_t::WriteNewLine(std::string& Output,size_t Depth)
+{
+	Output.push_back('\n');
+	Output.append( Depth * mIndent, mIndentChar );
+}
+
+void PopJson::Reformat_t::WritePretty(std::string_view Chunk,std::string& Output)
+{
+	size_t i = 0;
+	while ( i < Chunk.size() )
+	{
+		if ( mInString )
+		{
+			i = WriteString( Chunk, i, Output );
+			continue;
+		}
+
+		auto Char = Chunk[i];
+		if ( Scan::IsWhitespace(Char) )
+		{
+			i += Scan::SkipWhitespace( Chunk.data()+i, Chunk.size()-i );
+			continue;
+		}
+
+		bool IsClose = Char == '}' || Char == ']';
+		if ( mPendingOpen )
+		{
+			mPendingOpen = false;
+			if ( !IsClose )
+				WriteNewLine( Output, mDepth );
+		}
+		else if ( IsClose )
+		{
+			if ( mDepth == 0 )
+				throw std::runtime_error(std::string("Unexpected ") + Char + " at depth 0");
+			WriteNewLine( Output, mDepth-1 );
+		}
+
+		switch ( Char )
+		{
+			case '{':
+			case '[':
+				Output.push_back( Char );
+				mDepth++;
+				mPendingOpen = true;
+				i++;
+				break;
+
+			case '}':
+			case ']':
+				if ( mDepth == 0 )
+					throw std::runtime_error(std::string("Unexpected ") + Char + " at depth 0");
+				Output.push_back( Char );
+				mDepth--;
+				i++;
+				break;
+
+			case ',':
+				Output.push_back(',');
+				WriteNewLine( Output, mDepth );
+				i++;
+				break;
+
+			case ':':
+				Output.append(": ");
+				i++;
+				break;
+
+			case '"':
+				Output.push_back('"');
+				mInString = true;
+				i++;
+				break;
+
+			default:
+			{
+				//	number or literal
+				auto Run = Scan::FindTokenEnd( Chunk.data()+i, Chunk.size()-i );
+				Output.append( Chunk.data()+i, Run );
+				i += Run;
+				break;
+			}
+		}
+	}
+}
@@ -0,0 +1,58 @@
+/*
+	Streaming whitespace transform; minify, or pretty-print with a configurable indent.
+
+	This is a lexical pass, not a parse. Strings are tracked (so their contents are never
+	touched) but nothing else is validated, no map is built and nothing is unescaped or
+	re-escaped (input is assumed to be valid json); runs of input are found with the Scan kernels
+	and copied straight to the output.
+	The only state is a few flags and the current depth, so memory is bounded regardless of
+	document size, and input can be split into chunks anywhere (mid-string, mid-escape, mid-number).
+*/
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace PopJson
+{
+	class Reformat_t;
+
+	std::string		Minify(std::string_view Json);
+	std::string		PrettyPrint(std::string_view Json,size_t Indent=1,char IndentChar='\t');
+}
+
+
+class PopJson::Reformat_t
+{
+public:
+	//	an Indent of 0 minifies
+	Reformat_t(size_t Indent=0,char IndentChar='\t') :
+		mIndent		( Indent ),
+		mIndentChar	( IndentChar )
+	{
+	}
+
+	//	reformatted output for this chunk is appended to Output
+	void			Write(std::string_view Chunk,std::string& Output);
+	//	throws if the input ended inside a string (or, when pretty printing, a container)
+	void			Finish();
+
+private:
+	void			WriteMinified(std::string_view Chunk,std::string& Output);
+	//	whole 64 byte blocks are classified with bitmasks rather than scanned token by token.
+	//	returns bytes consumed
+	size_t			WriteMinifiedBlocks(std::string_view Chunk,std::string& Output);
+	void			WritePretty(std::string_view Chunk,std::string& Output);
+	//	returns position after the string's contents that were in Chunk
+	size_t			WriteString(std::string_view Chunk,size_t Position,std::string& Output);
+	void			WriteNewLine(std::string& Output,size_t Depth);
+
+private:
+	size_t			mIndent = 0;
+	char			mIndentChar = '\t';
+
+	bool			mInString = false;
+	bool			mEscaped = false;		//	last char of the previous chunk was a \ in a string
+	size_t			mDepth = 0;				//	only tracked when pretty printing
+	bool			mPendingOpen = false;	//	newline after { or [ is deferred so empty containers stay as {} and []
+};
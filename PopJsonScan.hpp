@@ -0,0 +1,524 @@
+/*
+	Byte scanning kernels shared by the parser and the streaming transforms.
+
+	Each finds the first "interesting" byte in a run, 16 bytes at a time with SSE2 where
+	available, otherwise 8 bytes at a time in a 64bit register (SWAR). Each returns the index
+	of the first match, or Length if there is none.
+*/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define POPJSON_SCAN_SSE2
+#endif
+
+//	the utf-8 validator's nibble lookups need pshufb. Baseline x86-64 builds compile that kernel
+//	for ssse3 anyway (gcc/clang) and pick it at runtime
+#if defined(POPJSON_SCAN_SSE2) && ( defined(__SSSE3__) || defined(__AVX__) )
+#include <tmmintrin.h>
+#define POPJSON_SCAN_SSSE3
+#define POPJSON_SCAN_SSSE3_TARGET
+#elif defined(POPJSON_SCAN_SSE2) && defined(__GNUC__)
+#include <tmmintrin.h>
+#define POPJSON_SCAN_SSSE3
+#define POPJSON_SCAN_SSSE3_DISPATCH
+#define POPJSON_SCAN_SSSE3_TARGET	__attribute__((target("ssse3")))
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace PopJson::Scan
+{
+	//	first '"', '\\' or control character (<0x20); ie. where a plain run in a string ends
+	inline size_t	FindStringSpecial(const char* Data,size_t Length);
+	//	first whitespace or '"'; ie. where a run of structural/number/literal characters ends
+	inline size_t	FindWhitespaceOrQuote(const char* Data,size_t Length);
+	//	first whitespace, '"' or structural character ({}[],:)
+	inline size_t	FindTokenEnd(const char* Data,size_t Length);
+	//	first '"' or bracket; ie. the next byte which can change a container's depth
+	inline size_t	FindQuoteOrBracket(const char* Data,size_t Length);
+	//	first non-whitespace
+	inline size_t	SkipWhitespace(const char* Data,size_t Length);
+	//	first byte of the first invalid utf-8 sequence (overlong, surrogate, > U+10FFFF, stray
+	//	continuation, or truncated, including by the end of Data)
+	inline size_t	FindInvalidUtf8(const char* Data,size_t Length);
+
+	//	compare the first Length (<=16) bytes of Data and Key, reading 16 bytes from both; the
+	//	caller must make sure that much of Data is readable. Key is usually padded
+	inline bool		IsEqualShort(const char* Data,const char* Key16,size_t Length);
+
+	//	bitmasks of a 64 byte block, bit N is byte N
+	class BlockMasks_t
+	{
+	public:
+		uint64_t	mWhitespace = 0;
+		uint64_t	mQuote = 0;
+		uint64_t	mBackslash = 0;
+	};
+	inline BlockMasks_t	ClassifyBlock(const char* Data64);
+	//	characters escaped by a backslash. PreviousEscaped carries an odd backslash run over the block boundary (0 or 1)
+	inline uint64_t	GetEscaped(uint64_t Backslash,uint64_t& PreviousEscaped);
+	//	bit N is the xor of bits 0..N; turns unescaped quotes into an in-string mask (including the opening quote)
+	inline uint64_t	PrefixXor(uint64_t Bits);
+
+	inline bool		IsWhitespace(char Char)		{	return Char == ' ' || Char == '\n' || Char == '\r' || Char == '\t';	}
+	inline bool		IsStructural(char Char)		{	return Char == '{' || Char == '}' || Char == '[' || Char == ']' || Char == ',' || Char == ':';	}
+
+	inline int		CountTrailingZeros(uint64_t Value)
+	{
+#if defined(_MSC_VER)
+		unsigned long Index;
+		_BitScanForward64( &Index, Value );
+		return static_cast<int>(Index);
+#else
+		return __builtin_ctzll(Value);
+#endif
+	}
+}
+
+
+namespace PopJson::Scan::Private
+{
+#if defined(POPJSON_SCAN_SSE2)
+	//	calls GetMask(16 bytes) -> 16bit movemask of matches
+	template<typename GETMASK,typename ISMATCH>
+	inline size_t	Find(const char* Data,size_t Length,GETMASK GetMask,ISMATCH IsMatch)
+	{
+		size_t i = 0;
+		for ( ;	i+16<=Length;	i+=16 )
+		{
+			auto Chunk = _mm_loadu_si128( reinterpret_cast<const __m128i*>(Data+i) );
+			uint32_t Mask = GetMask( Chunk );
+			if ( Mask )
+				return i + CountTrailingZeros(Mask);
+		}
+		for ( ;	i<Length;	i++ )
+			if ( IsMatch(Data[i]) )
+				return i;
+		return Length;
+	}
+
+	inline __m128i	Equal(__m128i Chunk,char Char)	{	return _mm_cmpeq_epi8( Chunk, _mm_set1_epi8(Char) );	}
+	inline __m128i	GetWhitespace(__m128i Chunk)
+	{
+		auto SpaceOrNewLine = _mm_or_si128( Equal(Chunk,' '), Equal(Chunk,'\n') );
+		return _mm_or_si128( SpaceOrNewLine, _mm_or_si128( Equal(Chunk,'\r'), Equal(Chunk,'\t') ) );
+	}
+#else
+	constexpr uint64_t	Ones = 0x0101010101010101ull;
+	constexpr uint64_t	Highs = 0x8080808080808080ull;
+
+	//	high bit set in each byte which is zero. Only the lowest flagged byte is exact (borrows
+	//	can flag bytes above it), which is all Find needs
+	inline uint64_t	GetZeroBytes(uint64_t Word)				{	return (Word - Ones) & ~Word & Highs;	}
+	inline uint64_t	GetEqualBytes(uint64_t Word,char Char)	{	return GetZeroBytes( Word ^ (Ones * static_cast<uint8_t>(Char)) );	}
+	inline uint64_t	GetLessThanBytes(uint64_t Word,uint8_t Limit)	{	return (Word - Ones*Limit) & ~Word & Highs;	}
+
+	//	calls GetMask(8 bytes, little endian) -> byte high bits of matches
+	template<typename GETMASK,typename ISMATCH>
+	inline size_t	Find(const char* Data,size_t Length,GETMASK GetMask,ISMATCH IsMatch)
+	{
+		size_t i = 0;
+		for ( ;	i+8<=Length;	i+=8 )
+		{
+			uint64_t Word;
+			std::memcpy( &Word, Data+i, sizeof(Word) );
+			if ( GetMask( Word ) )
+				break;
+		}
+		//	matching word (or tail) is resolved a byte at a time
+		for ( ;	i<Length;	i++ )
+			if ( IsMatch(Data[i]) )
+				return i;
+		return Length;
+	}
+
+	inline uint64_t	GetWhitespace(uint64_t Word)
+	{
+		return GetEqualBytes(Word,' ') | GetEqualBytes(Word,'\n') | GetEqualBytes(Word,'\r') | GetEqualBytes(Word,'\t');
+	}
+#endif
+
+	//	decodes a sequence at a time from Start, which must be the start of a sequence, skipping ascii runs a word at a time
+	inline size_t	FindInvalidUtf8Scalar(const uint8_t* Data,size_t Start,size_t Length)
+	{
+		size_t i = Start;
+		while ( i < Length )
+		{
+			for ( ;	i+8<=Length;	i+=8 )
+			{
+				uint64_t Word;
+				std::memcpy( &Word, Data+i, sizeof(Word) );
+				if ( Word & 0x8080808080808080ull )
+					break;
+			}
+			if ( i == Length )
+				break;
+
+			auto Lead = Data[i];
+			if ( Lead < 0x80 )
+			{
+				i++;
+				continue;
+			}
+
+			//	the second byte's range excludes overlongs, surrogates and > U+10FFFF
+			size_t Size;
+			uint8_t Min = 0x80;
+			uint8_t Max = 0xbf;
+			if ( Lead >= 0xc2 && Lead <= 0xdf )
+			{
+				Size = 2;
+			}
+			else if ( Lead >= 0xe0 && Lead <= 0xef )
+			{
+				Size = 3;
+				Min = Lead == 0xe0 ? 0xa0 : Min;
+				Max = Lead == 0xed ? 0x9f : Max;
+			}
+			else if ( Lead >= 0xf0 && Lead <= 0xf4 )
+			{
+				Size = 4;
+				Min = Lead == 0xf0 ? 0x90 : Min;
+				Max = Lead == 0xf4 ? 0x8f : Max;
+			}
+			else
+			{
+				return i;
+			}
+
+			if ( Size > Length - i )
+				return i;
+			if ( Data[i+1] < Min || Data[i+1] > Max )
+				return i;
+			for ( size_t c=2;	c<Size;	c++ )
+				if ( (Data[i+c] & 0xc0) != 0x80 )
+					return i;
+			i += Size;
+		}
+		return Length;
+	}
+
+	//	Position follows a validated prefix, but a sequence may have been left open over it (by up to 3
+	//	bytes); step back to its lead byte so the scalar decoder sees the whole sequence
+	inline size_t	GetUtf8SequenceStart(const uint8_t* Data,size_t Position)
+	{
+		for ( size_t Back=1;	Back<=3 && Back<=Position;	Back++ )
+		{
+			auto Byte = Data[Position-Back];
+			if ( Byte >= 0xc0 )
+				return Position - Back;
+			if ( Byte < 0x80 )
+				break;
+		}
+		return Position;
+	}
+
+#if defined(POPJSON_SCAN_SSSE3)
+	POPJSON_SCAN_SSSE3_TARGET inline __m128i	GetHighNibbles(__m128i Chunk)	{	return _mm_and_si128( _mm_srli_epi16( Chunk, 4 ), _mm_set1_epi8(0x0f) );	}
+
+	//	Keiser & Lemire, "Validating UTF-8 In Less Than One Instruction Per Byte". Each byte and the
+	//	one before it index three 16 entry tables (by nibble) of the errors that pair could be; the
+	//	errors all three agree on are real. Lanes are non-zero where there is an error
+	POPJSON_SCAN_SSSE3_TARGET inline __m128i	GetUtf8Errors(__m128i Input,__m128i Previous)
+	{
+		constexpr char TooShort = 1<<0;			//	lead byte followed by a lead or ascii
+		constexpr char TooLong = 1<<1;			//	ascii followed by a continuation
+		constexpr char Overlong3 = 1<<2;
+		constexpr char TooLarge = 1<<3;
+		constexpr char Surrogate = 1<<4;
+		constexpr char Overlong2 = 1<<5;
+		constexpr char TooLarge1000 = 1<<6;
+		constexpr char Overlong4 = 1<<6;
+		constexpr char TwoContinuations = static_cast<char>(1<<7);
+		constexpr char Carry = TooShort | TooLong | TwoContinuations;
+
+		auto Previous1 = _mm_alignr_epi8( Input, Previous, 16-1 );
+		auto Byte1High = _mm_shuffle_epi8( _mm_setr_epi8(
+			//	0___ ascii
+			TooLong, TooLong, TooLong, TooLong, TooLong, TooLong, TooLong, TooLong,
+			//	10__ continuation
+			TwoContinuations, TwoContinuations, TwoContinuations, TwoContinuations,
+			//	1100, 1101 two byte lead
+			TooShort | Overlong2,
+			TooShort,
+			//	1110 three byte lead
+			TooShort | Overlong3 | Surrogate,
+			//	1111 four byte lead
+			TooShort | TooLarge | TooLarge1000 | Overlong4
+		), GetHighNibbles(Previous1) );
+
+		auto Byte1Low = _mm_shuffle_epi8( _mm_setr_epi8(
+			Carry | Overlong3 | Overlong2 | Overlong4,	//	____0000
+			Carry | Overlong2,							//	____0001
+			Carry,										//	____001_
+			Carry,
+			Carry | TooLarge,							//	____0100
+			Carry | TooLarge | TooLarge1000,			//	____0101 and up
+			Carry | TooLarge | TooLarge1000,
+			Carry | TooLarge | TooLarge1000,
+			Carry | TooLarge | TooLarge1000,
+			Carry | TooLarge | TooLarge1000,
+			Carry | TooLarge | TooLarge1000,
+			Carry | TooLarge | TooLarge1000,
+			Carry | TooLarge | TooLarge1000,
+			Carry | TooLarge | TooLarge1000 | Surrogate,	//	____1101
+			Carry | TooLarge | TooLarge1000,
+			Carry | TooLarge | TooLarge1000
+		), _mm_and_si128( Previous1, _mm_set1_epi8(0x0f) ) );
+
+		auto Byte2High = _mm_shuffle_epi8( _mm_setr_epi8(
+			//	0___ ascii
+			TooShort, TooShort, TooShort, TooShort, TooShort, TooShort, TooShort, TooShort,
+			//	1000
+			TooLong | Overlong2 | TwoContinuations | Overlong3 | TooLarge1000 | Overlong4,
+			//	1001
+			TooLong | Overlong2 | TwoContinuations | Overlong3 | TooLarge,
+			//	101_
+			TooLong | Overlong2 | TwoContinuations | Surrogate | TooLarge,
+			TooLong | Overlong2 | TwoContinuations | Surrogate | TooLarge,
+			//	11__ lead
+			TooShort, TooShort, TooShort, TooShort
+		), GetHighNibbles(Input) );
+
+		auto Special = _mm_and_si128( _mm_and_si128( Byte1High, Byte1Low ), Byte2High );
+
+		//	bytes 2 or 3 after a three/four byte lead must be continuations; the tables flag those as
+		//	TwoContinuations, so xor cancels the expected ones and leaves the missing/extra ones
+		auto Previous2 = _mm_alignr_epi8( Input, Previous, 16-2 );
+		auto Previous3 = _mm_alignr_epi8( Input, Previous, 16-3 );
+		auto IsThirdByte = _mm_subs_epu8( Previous2, _mm_set1_epi8( static_cast<char>(0xe0-0x80) ) );
+		auto IsFourthByte = _mm_subs_epu8( Previous3, _mm_set1_epi8( static_cast<char>(0xf0-0x80) ) );
+		auto Must23 = _mm_and_si128( _mm_or_si128( IsThirdByte, IsFourthByte ), _mm_set1_epi8( static_cast<char>(0x80) ) );
+		return _mm_xor_si128( Must23, Special );
+	}
+
+	//	non-zero if the chunk ends with a lead byte whose sequence continues into the next chunk
+	POPJSON_SCAN_SSSE3_TARGET inline __m128i	GetUtf8Incomplete(__m128i Input)
+	{
+		auto Max = _mm_setr_epi8( -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+			static_cast<char>(0xf0-1), static_cast<char>(0xe0-1), static_cast<char>(0xc0-1) );
+		return _mm_subs_epu8( Input, Max );
+	}
+
+	//	chunks are only checked for errors; the exact offset comes from a scalar decode starting
+	//	at the sequence which was open when the erroring chunk began
+	POPJSON_SCAN_SSSE3_TARGET inline size_t	FindInvalidUtf8Ssse3(const uint8_t* Data,size_t Length)
+	{
+		auto Previous = _mm_setzero_si128();
+		auto PreviousIncomplete = _mm_setzero_si128();
+		size_t i = 0;
+		for ( ;	i+16<=Length;	i+=16 )
+		{
+			auto Input = _mm_loadu_si128( reinterpret_cast<const __m128i*>(Data+i) );
+			__m128i Errors;
+			if ( _mm_movemask_epi8(Input) == 0 )
+			{
+				//	ascii; the only possible error is a sequence left open by the previous chunk
+				Errors = PreviousIncomplete;
+				PreviousIncomplete = _mm_setzero_si128();
+			}
+			else
+			{
+				Errors = GetUtf8Errors( Input, Previous );
+				PreviousIncomplete = GetUtf8Incomplete( Input );
+			}
+			if ( _mm_movemask_epi8( _mm_cmpeq_epi8( Errors, _mm_setzero_si128() ) ) != 0xffff )
+				break;
+			Previous = Input;
+		}
+		//	erroring chunk, or the remaining tail (which may finish a sequence started in the last chunk)
+		return FindInvalidUtf8Scalar( Data, GetUtf8SequenceStart( Data, i ), Length );
+	}
+#endif
+}
+
+
+inline size_t PopJson::Scan::FindStringSpecial(const char* Data,size_t Length)
+{
+	using namespace Private;
+	auto IsMatch = [](char Char)	{	return Char == '"' || Char == '\\' || static_cast<uint8_t>(Char) < 0x20;	};
+#if defined(POPJSON_SCAN_SSE2)
+	auto GetMask = [](__m128i Chunk)
+	{
+		//	unsigned Char <= 0x1f is min(Char,0x1f)==Char
+		auto Control = _mm_cmpeq_epi8( _mm_min_epu8( Chunk, _mm_set1_epi8(0x1f) ), Chunk );
+		auto Special = _mm_or_si128( _mm_or_si128( Equal(Chunk,'"'), Equal(Chunk,'\\') ), Control );
+		return static_cast<uint32_t>( _mm_movemask_epi8(Special) );
+	};
+#else
+	auto GetMask = [](uint64_t Word)	{	return GetEqualBytes(Word,'"') | GetEqualBytes(Word,'\\') | GetLessThanBytes(Word,0x20);	};
+#endif
+	return Find( Data, Length, GetMask, IsMatch );
+}
+
+inline size_t PopJson::Scan::FindWhitespaceOrQuote(const char* Data,size_t Length)
+{
+	using namespace Private;
+	auto IsMatch = [](char Char)	{	return Char == '"' || IsWhitespace(Char);	};
+#if defined(POPJSON_SCAN_SSE2)
+	auto GetMask = [](__m128i Chunk)	{	return static_cast<uint32_t>( _mm_movemask_epi8( _mm_or_si128( GetWhitespace(Chunk), Equal(Chunk,'"') ) ) );	};
+#else
+	auto GetMask = [](uint64_t Word)	{	return GetWhitespace(Word) | GetEqualBytes(Word,'"');	};
+#endif
+	return Find( Data, Length, GetMask, IsMatch );
+}
+
+inline size_t PopJson::Scan::FindTokenEnd(const char* Data,size_t Length)
+{
+	using namespace Private;
+	auto IsMatch = [](char Char)	{	return Char == '"' || IsWhitespace(Char) || IsStructural(Char);	};
+#if defined(POPJSON_SCAN_SSE2)
+	auto GetMask = [](__m128i Chunk)
+	{
+		//	{ and [ (and } and ]) differ only by bit 0x20, so clear it and compare against [ and ]
+		auto Folded = _mm_and_si128( Chunk, _mm_set1_epi8( static_cast<char>(0xdf) ) );	//	'{'->'[' '}'->']'
+		auto Brackets = _mm_or_si128( Equal(Folded,'['), Equal(Folded,']') );
+		auto Separators = _mm_or_si128( Equal(Chunk,','), Equal(Chunk,':') );
+		auto Any = _mm_or_si128( _mm_or_si128( Brackets, Separators ), _mm_or_si128( GetWhitespace(Chunk), Equal(Chunk,'"') ) );
+		return static_cast<uint32_t>( _mm_movemask_epi8(Any) );
+	};
+#else
+	auto GetMask = [](uint64_t Word)
+	{
+		auto Brackets = GetEqualBytes(Word,'{') | GetEqualBytes(Word,'}') | GetEqualBytes(Word,'[') | GetEqualBytes(Word,']');
+		return Brackets | GetEqualBytes(Word,',') | GetEqualBytes(Word,':') | GetWhitespace(Word) | GetEqualBytes(Word,'"');
+	};
+#endif
+	return Find( Data, Length, GetMask, IsMatch );
+}
+
+inline size_t PopJson::Scan::FindQuoteOrBracket(const char* Data,size_t Length)
+{
+	using namespace Private;
+	auto IsMatch = [](char Char)	{	return Char == '"' || Char == '{' || Char == '}' || Char == '[' || Char == ']';	};
+#if defined(POPJSON_SCAN_SSE2)
+	auto GetMask = [](__m128i Chunk)
+	{
+		auto Folded = _mm_and_si128( Chunk, _mm_set1_epi8( static_cast<char>(0xdf) ) );	//	'{'->'[' '}'->']'
+		auto Brackets = _mm_or_si128( Equal(Folded,'['), Equal(Folded,']') );
+		return static_cast<uint32_t>( _mm_movemask_epi8( _mm_or_si128( Brackets, Equal(Chunk,'"') ) ) );
+	};
+#else
+	auto GetMask = [](uint64_t Word)
+	{
+		return GetEqualBytes(Word,'{') | GetEqualBytes(Word,'}') | GetEqualBytes(Word,'[') | GetEqualBytes(Word,']') | GetEqualBytes(Word,'"');
+	};
+#endif
+	return Find( Data, Length, GetMask, IsMatch );
+}
+
+inline size_t PopJson::Scan::SkipWhitespace(const char* Data,size_t Length)
+{
+	using namespace Private;
+	auto IsMatch = [](char Char)	{	return !IsWhitespace(Char);	};
+#if defined(POPJSON_SCAN_SSE2)
+	auto GetMask = [](__m128i Chunk)	{	return static_cast<uint32_t>( ~_mm_movemask_epi8( GetWhitespace(Chunk) ) & 0xffff );	};
+#else
+	//	"none of 4 chars" has no cheap SWAR form, so test the word's bytes; the match is rescanned anyway
+	auto GetMask = [](uint64_t Word)
+	{
+		for ( int b=0;	b<8;	b++ )
+			if ( !IsWhitespace( static_cast<char>( Word >> (b*8) ) ) )
+				return 1ull;
+		return 0ull;
+	};
+#endif
+	return Find( Data, Length, GetMask, IsMatch );
+}
+
+inline PopJson::Scan::BlockMasks_t PopJson::Scan::ClassifyBlock(const char* Data)
+{
+	BlockMasks_t Masks;
+#if defined(POPJSON_SCAN_SSE2)
+	using namespace Private;
+	for ( int i=0;	i<64;	i+=16 )
+	{
+		auto Chunk = _mm_loadu_si128( reinterpret_cast<const __m128i*>(Data+i) );
+		Masks.mWhitespace |= static_cast<uint64_t>( static_cast<uint16_t>( _mm_movemask_epi8( GetWhitespace(Chunk) ) ) ) << i;
+		Masks.mQuote |= static_cast<uint64_t>( static_cast<uint16_t>( _mm_movemask_epi8( Equal(Chunk,'"') ) ) ) << i;
+		Masks.mBackslash |= static_cast<uint64_t>( static_cast<uint16_t>( _mm_movemask_epi8( Equal(Chunk,'\\') ) ) ) << i;
+	}
+#else
+	for ( int i=0;	i<64;	i++ )
+	{
+		uint64_t Bit = 1ull << i;
+		Masks.mWhitespace |= IsWhitespace(Data[i]) ? Bit : 0;
+		Masks.mQuote |= Data[i] == '"' ? Bit : 0;
+		Masks.mBackslash |= Data[i] == '\\' ? Bit : 0;
+	}
+#endif
+	return Masks;
+}
+
+inline bool PopJson::Scan::IsEqualShort(const char* Data,const char* Key,size_t Length)
+{
+#if defined(POPJSON_SCAN_SSE2)
+	auto a = _mm_loadu_si128( reinterpret_cast<const __m128i*>(Data) );
+	auto b = _mm_loadu_si128( reinterpret_cast<const __m128i*>(Key) );
+	uint32_t Equal = static_cast<uint32_t>( _mm_movemask_epi8( _mm_cmpeq_epi8( a, b ) ) );
+	//	bytes past Length are allowed to differ
+	uint32_t Ignore = 0xffffu << Length;
+	return ( (Equal | Ignore) & 0xffffu ) == 0xffffu;
+#else
+	return std::memcmp( Data, Key, Length ) == 0;
+#endif
+}
+
+inline uint64_t PopJson::Scan::GetEscaped(uint64_t Backslash,uint64_t& PreviousEscaped)
+{
+	//	branchless odd-length backslash run detection, as in simdjson
+	constexpr uint64_t EvenBits = 0x5555555555555555ull;
+	//	an escaped first char can't start a new escape
+	Backslash &= ~PreviousEscaped;
+	uint64_t FollowsEscape = (Backslash << 1) | PreviousEscaped;
+	//	runs starting on odd bits; adding them to the backslashes carries through each run to its end
+	uint64_t OddSequenceStarts = Backslash & ~EvenBits & ~FollowsEscape;
+	uint64_t SequencesStartingOnEvenBits = OddSequenceStarts + Backslash;
+	//	carry out of the top means a run continues into the next block
+	PreviousEscaped = SequencesStartingOnEvenBits < OddSequenceStarts ? 1 : 0;
+	uint64_t InvertMask = SequencesStartingOnEvenBits << 1;
+	return (EvenBits ^ InvertMask) & FollowsEscape;
+}
+
+inline uint64_t PopJson::Scan::PrefixXor(uint64_t Bits)
+{
+	Bits ^= Bits << 1;
+	Bits ^= Bits << 2;
+	Bits ^= Bits << 4;
+	Bits ^= Bits << 8;
+	Bits ^= Bits << 16;
+	Bits ^= Bits << 32;
+	return Bits;
+}
+
+inline size_t PopJson::Scan::FindInvalidUtf8(const char* Chars,size_t Length)
+{
+	using namespace Private;
+	auto* Data = reinterpret_cast<const uint8_t*>(Chars);
+#if defined(POPJSON_SCAN_SSSE3_DISPATCH)
+	static const bool HasSsse3 = __builtin_cpu_supports("ssse3");
+	if ( HasSsse3 )
+		return FindInvalidUtf8Ssse3( Data, Length );
+#elif defined(POPJSON_SCAN_SSSE3)
+	return FindInvalidUtf8Ssse3( Data, Length );
+#endif
+
+	size_t i = 0;
+#if defined(POPJSON_SCAN_SSE2)
+	//	ascii fast path only; the scalar decoder takes over at the first chunk with a high bit set
+	for ( ;	i+16<=Length;	i+=16 )
+	{
+		auto Input = _mm_loadu_si128( reinterpret_cast<const __m128i*>(Data+i) );
+		if ( _mm_movemask_epi8(Input) != 0 )
+			break;
+	}
+#endif
+	return FindInvalidUtf8Scalar( Data, GetUtf8SequenceStart( Data, i ), Length );
+}
@@ -0,0 +1,194 @@
+#include "PopJsonShape.hpp"
+#include "PopJsonScan.hpp"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+
+namespace
+{
+	//	the lengths are mixed in so "ab","c" isn't the same shape as "a","bc"
+	uint64_t	AddKeyHash(uint64_t Hash,std::string_view Key)
+	{
+		return PopJson::Hash64( Key.data(), Key.size(), Hash + Key.size() + 1 );
+	}
+}
+
+
+template<typename FOREACHKEY>
+PopJson::Shape_t::Shape_t(uint64_t Hash,size_t MemberCount,FOREACHKEY ForEachKey) :
+	mHash	( Hash )
+{
+	mKeys.reserve( MemberCount );
+	ForEachKey( [&](std::string_view Key)
+	{
+		Key_t Entry;
+		Entry.mOffset = static_cast<uint32_t>( mKeyData.size() );
+		Entry.mLength = static_cast<uint32_t>( Key.size() );
+		mKeyData.insert( mKeyData.end(), Key.begin(), Key.end() );
+		mKeyData.resize( mKeyData.size() + std::max<size_t>( 16, Key.size() ) - Key.size(), 0 );
+		mKeys.push_back( Entry );
+		return true;
+	});
+
+	//	members grouped by key length, in member order within each length, so the first of duplicates is found first
+	size_t MaxLength = 0;
+	for ( auto& Key : mKeys )
+		MaxLength = std::max<size_t>( MaxLength, Key.mLength );
+	mFirstOfLength.assign( MaxLength+2, 0 );
+	for ( auto& Key : mKeys )
+		mFirstOfLength[Key.mLength+1]++;
+	for ( size_t Length=1;	Length<mFirstOfLength.size();	Length++ )
+		mFirstOfLength[Length] += mFirstOfLength[Length-1];
+	mByLength.resize( mKeys.size() );
+	auto Next = mFirstOfLength;
+	for ( size_t Child=0;	Child<mKeys.size();	Child++ )
+		mByLength[Next[mKeys[Child].mLength]++] = static_cast<uint32_t>( Child );
+}
+
+std::string_view PopJson::Shape_t::GetKey(size_t ChildIndex) const
+{
+	auto& Key = mKeys[ChildIndex];
+	return std::string_view( mKeyData.data() + Key.mOffset, Key.mLength );
+}
+
+template<typename FOREACHKEY>
+bool PopJson::Shape_t::IsShapeOf(size_t MemberCount,FOREACHKEY ForEachKey,const char* BufferEnd) const
+{
+	if ( MemberCount != mKeys.size() )
+		return false;
+
+	size_t Child = 0;
+	return ForEachKey( [&](std::string_view Key)
+	{
+		auto& ShapeKey = mKeys[Child++];
+		if ( Key.size() != ShapeKey.mLength )
+			return false;
+		auto* ShapeKeyData = mKeyData.data() + ShapeKey.mOffset;
+		if ( Key.size() <= 16 && BufferEnd - Key.data() >= 16 )
+			return Scan::IsEqualShort( Key.data(), ShapeKeyData, Key.size() );
+		return std::memcmp( Key.data(), ShapeKeyData, Key.size() ) == 0;
+	});
+}
+
+size_t PopJson::Shape_t::FindMember(std::string_view Key) const
+{
+	auto Length = Key.size();
+	if ( Length+1 >= mFirstOfLength.size() )
+		return InvalidChildIndex;
+	for ( auto i=mFirstOfLength[Length];	i<mFirstOfLength[Length+1];	i++ )
+	{
+		auto Child = mByLength[i];
+		if ( std::memcmp( mKeyData.data() + mKeys[Child].mOffset, Key.data(), Length ) == 0 )
+			return Child;
+	}
+	return InvalidChildIndex;
+}
+
+void PopJson::Shape_t::FindMembers(const KeySet_t& Keys,std::span<size_t> ChildIndexes) const
+{
+	if ( ChildIndexes.size() < Keys.size() )
+		throw std::runtime_error("FindMembers output has " + std::to_string(ChildIndexes.size()) + " entries for " + std::to_string(Keys.size()) + " keys");
+	for ( size_t k=0;	k<Keys.size();	k++ )
+		ChildIndexes[k] = FindMember( Keys.GetEscapedKey(k) );
+}
+
+PopJson::Result_t<PopJson::Value_t> PopJson::Shape_t::TryGetValue(Value_t& Object,std::string_view Key,std::string_view JsonData) const
+{
+	auto Child = FindMember( Key );
+	if ( Child == InvalidChildIndex )
+		return Error_t::MissingKey;
+	if ( Child >= Object.mNodes.size() )
+		throw std::runtime_error("Object doesn't have the shape it's being read with");
+	return Object.mNodes[Child].GetValue( JsonData );
+}
+
+PopJson::NodeIndex_t PopJson::Shape_t::FindChild(const Map_t& Map,NodeIndex_t Object,std::string_view Key) const
+{
+	auto Child = FindMember( Key );
+	if ( Child == InvalidChildIndex )
+		return InvalidNodeIndex;
+	//	siblings are skipped by their descendant counts, no keys are compared
+	return Map.FindChild( Object, Child );
+}
+
+
+const PopJson::Shape_t* PopJson::ShapeCache_t::GetShape(Value_t& Object,std::string_view JsonData,const Shape_t* Predicted)
+{
+	if ( Object.GetType() != ValueType_t::Object )
+		return nullptr;
+
+	auto ForEachKey = [&](auto OnKey)
+	{
+		for ( auto& Child : Object.mNodes )
+			if ( !OnKey( Child.GetKey(JsonData) ) )
+				return false;
+		return true;
+	};
+	return GetShape( Object.mNodes.size(), ForEachKey, JsonData.data() + JsonData.size(), Predicted );
+}
+
+const PopJson::Shape_t* PopJson::ShapeCache_t::GetShape(const Map_t& Map,NodeIndex_t Object,std::string_view Storage,const Shape_t* Predicted)
+{
+	auto& ObjectNode = Map.GetNode( Object );
+	if ( ObjectNode.GetType() != ValueType_t::Object )
+		return nullptr;
+
+	auto ForEachKey = [&](auto OnKey)
+	{
+		for ( auto Child = Map.GetFirstChild(Object);	Child != InvalidNodeIndex;	Child = Map.GetNextSibling(Child) )
+			if ( !OnKey( Map.GetNode(Child).GetKey(Storage) ) )
+				return false;
+		return true;
+	};
+	return GetShape( ObjectNode.GetChildCount(), ForEachKey, Storage.data() + Storage.size(), Predicted );
+}
+
+template<typename FOREACHKEY>
+const PopJson::Shape_t* PopJson::ShapeCache_t::GetShape(size_t MemberCount,FOREACHKEY ForEachKey,const char* BufferEnd,const Shape_t* Predicted)
+{
+	if ( Predicted && Predicted->IsShapeOf( MemberCount, ForEachKey, BufferEnd ) )
+		return Predicted;
+
+	uint64_t Hash = MemberCount;
+	ForEachKey( [&](std::string_view Key)
+	{
+		Hash = AddKeyHash( Hash, Key );
+		return true;
+	});
+
+	auto FindCached = [&]() -> const Shape_t*
+	{
+		auto Range = mShapes.equal_range( Hash );
+		for ( auto it=Range.first;	it!=Range.second;	it++ )
+			if ( it->second->IsShapeOf( MemberCount, ForEachKey, BufferEnd ) )
+				return it->second.get();
+		return nullptr;
+	};
+
+	{
+		std::shared_lock Lock( mShapesLock );
+		if ( auto* Shape = FindCached() )
+			return Shape;
+		if ( mShapes.size() >= mMaxShapes )
+			return nullptr;
+	}
+
+	//	build outside the lock, another thread may add the same shape meanwhile
+	std::unique_ptr<Shape_t> NewShape( new Shape_t( Hash, MemberCount, ForEachKey ) );
+	std::unique_lock Lock( mShapesLock );
+	if ( auto* Shape = FindCached() )
+		return Shape;
+	if ( mShapes.size() >= mMaxShapes )
+		return nullptr;
+	auto* Shape = NewShape.get();
+	mShapes.emplace( Hash, std::move(NewShape) );
+	return Shape;
+}
+
+size_t PopJson::ShapeCache_t::GetShapeCount()
+{
+	std::shared_lock Lock( mShapesLock );
+	return mShapes.size();
+}
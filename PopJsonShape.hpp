@@ -0,0 +1,99 @@
+/*
+	Shapes (hidden classes) of objects.
+
+	A shape is the sequence of an object's member keys. Records in NDJSON, or an array of objects,
+	usually share a handful of shapes, so rather than comparing key strings for every lookup in
+	every record, a record's shape is found once (usually the same as the previous record's) and
+	lookups go to the shape; it only compares keys of the same length (usually just one) and
+	gives a child index, which is read from the record directly.
+
+	A record matches a shape when it has the same number of members and each key has the same
+	length and bytes; a predicted shape (the last one seen) is checked that way first, without
+	hashing or locking. Otherwise the keys are hashed to find the shape in the cache, and it's
+	added if new. Shapes are never removed or modified once added, so they can be used from any
+	thread while the cache exists.
+*/
+#pragma once
+
+#include "PopJson.hpp"
+#include <memory>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace PopJson
+{
+	class Shape_t;
+	class ShapeCache_t;
+}
+
+
+class PopJson::Shape_t
+{
+	friend class ShapeCache_t;
+public:
+	static constexpr size_t	InvalidChildIndex = static_cast<size_t>(-1);
+
+public:
+	size_t				GetMemberCount() const	{	return mKeys.size();	}
+	std::string_view	GetKey(size_t ChildIndex) const;		//	as it appears in the json (escaped)
+	uint64_t			GetHash() const			{	return mHash;	}
+
+	//	child index of the (first) member with this escaped key, or InvalidChildIndex
+	size_t				FindMember(std::string_view Key) const;
+	//	ChildIndexes[KeyIndex] for each key of the set. A reader of a stream resolves its fields
+	//	when the shape changes, then reads Object.mNodes[ChildIndex] for each record of that shape
+	void				FindMembers(const KeySet_t& Keys,std::span<size_t> ChildIndexes) const;
+
+	//	lookups in an object of this shape (ie. the one given to ShapeCache_t::GetShape)
+	Result_t<Value_t>	TryGetValue(Value_t& Object,std::string_view Key,std::string_view JsonData) const;
+	NodeIndex_t			FindChild(const Map_t& Map,NodeIndex_t Object,std::string_view Key) const;	//	InvalidNodeIndex if missing
+
+private:
+	template<typename FOREACHKEY>
+	Shape_t(uint64_t Hash,size_t MemberCount,FOREACHKEY ForEachKey);
+
+	//	same member count, key lengths and key bytes. BufferEnd is the end of the json the keys are in
+	template<typename FOREACHKEY>
+	bool				IsShapeOf(size_t MemberCount,FOREACHKEY ForEachKey,const char* BufferEnd) const;
+
+private:
+	class Key_t
+	{
+	public:
+		uint32_t	mOffset = 0;	//	in mKeyData
+		uint32_t	mLength = 0;
+	};
+	uint64_t				mHash = 0;
+	std::vector<char>		mKeyData;		//	each key is zero padded to at least 16 bytes
+	std::vector<Key_t>		mKeys;			//	in member order
+	std::vector<uint32_t>	mByLength;		//	child indexes, by key length
+	std::vector<uint32_t>	mFirstOfLength;	//	children with keys of length L are mByLength[mFirstOfLength[L]...mFirstOfLength[L+1]]
+};
+
+
+class PopJson::ShapeCache_t
+{
+public:
+	//	records with more distinct shapes than this are not cached (GetShape returns null), so
+	//	a stream without a common layout can't grow the cache without limit
+	ShapeCache_t(size_t MaxShapes=1024) :
+		mMaxShapes	( MaxShapes )
+	{
+	}
+
+	//	shape of an object, Predicted (eg. the previous record's shape) is checked first.
+	//	null if Object isn't an object, or it's a new shape and the cache is full
+	const Shape_t*	GetShape(Value_t& Object,std::string_view JsonData,const Shape_t* Predicted=nullptr);
+	const Shape_t*	GetShape(const Map_t& Map,NodeIndex_t Object,std::string_view Storage,const Shape_t* Predicted=nullptr);
+
+	size_t			GetShapeCount();
+
+private:
+	template<typename FOREACHKEY>
+	const Shape_t*	GetShape(size_t MemberCount,FOREACHKEY ForEachKey,const char* BufferEnd,const Shape_t* Predicted);
+
+private:
+	size_t			mMaxShapes = 0;
+	std::shared_mutex	mShapesLock;
+	std::unordered_multimap<uint64_t,std::unique_ptr<Shape_t>>	mShapes;	//	by hash of the key sequence
+};
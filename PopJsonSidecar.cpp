@@ -0,0 +1,260 @@
+#include "PopJsonSidecar.hpp"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <type_traits>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+static_assert( std::is_trivially_copyable_v<PopJson::MapNode_t>, "MapNode_t is written/mapped as raw bytes" );
+
+namespace
+{
+	const char			Magic[8] = { 'P','o','p','J','s','I','d','x' };
+	constexpr uint32_t	EndianMarker = 0x01020304;
+	constexpr size_t	SectionAlignment = 64;
+
+	class Header_t
+	{
+	public:
+		char		mMagic[8];
+		uint32_t	mVersion;
+		uint32_t	mHeaderSize;
+		uint32_t	mNodeSize;			//	sizeof(MapNode_t), guards against layout changes
+		uint32_t	mEndianMarker;
+		uint64_t	mSourceSize;
+		uint64_t	mSourceHash;
+		uint64_t	mNodeCount;
+		uint64_t	mNodesOffset;
+		uint64_t	mKeyIndexCount;
+		uint64_t	mKeyIndexOffset;
+		uint64_t	mKeyIndexMinChildren;
+		uint64_t	mPayloadChecksum;	//	nodes & key index
+		uint64_t	mHeaderChecksum;	//	this header with this field as 0
+	};
+
+	size_t Align(size_t Offset)
+	{
+		return (Offset + SectionAlignment-1) & ~(SectionAlignment-1);
+	}
+
+	uint64_t GetHeaderChecksum(Header_t Header)
+	{
+		Header.mHeaderChecksum = 0;
+		return PopJson::Hash64( &Header, sizeof(Header) );
+	}
+
+	uint64_t GetPayloadChecksum(std::span<const PopJson::MapNode_t> Nodes,std::span<const PopJson::NodeIndex_t> KeyIndex)
+	{
+		auto Checksum = PopJson::Hash64( Nodes.data(), Nodes.size_bytes() );
+		return PopJson::Hash64( KeyIndex.data(), KeyIndex.size_bytes(), Checksum );
+	}
+}
+
+
+PopJson::Sidecar::MappedFile_t::MappedFile_t(const std::string& Filename)
+{
+#if defined(_WIN32)
+	auto File = CreateFileA( Filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+	if ( File == INVALID_HANDLE_VALUE )
+		throw std::runtime_error("Failed to open " + Filename);
+	mFileHandle = File;
+
+	LARGE_INTEGER Size;
+	if ( !GetFileSizeEx( File, &Size ) )
+	{
+		CloseHandle( File );
+		throw std::runtime_error("Failed to get size of " + Filename);
+	}
+	mSize = static_cast<size_t>( Size.QuadPart );
+	if ( mSize == 0 )
+		return;
+
+	mMappingHandle = CreateFileMappingA( File, nullptr, PAGE_READONLY, 0, 0, nullptr );
+	if ( !mMappingHandle )
+	{
+		CloseHandle( File );
+		throw std::runtime_error("Failed to map " + Filename);
+	}
+	mData = MapViewOfFile( mMappingHandle, FILE_MAP_READ, 0, 0, 0 );
+	if ( !mData )
+	{
+		CloseHandle( mMappingHandle );
+		CloseHandle( File );
+		throw std::runtime_error("Failed to map view of " + Filename);
+	}
+#else
+	auto File = open( Filename.c_str(), O_RDONLY );
+	if ( File < 0 )
+		throw std::runtime_error("Failed to open " + Filename);
+
+	struct stat Stat;
+	if ( fstat( File, &Stat ) != 0 )
+	{
+		close( File );
+		throw std::runtime_error("Failed to stat " + Filename);
+	}
+	mSize = static_cast<size_t>( Stat.st_size );
+	if ( mSize > 0 )
+	{
+		auto* Data = mmap( nullptr, mSize, PROT_READ, MAP_PRIVATE, File, 0 );
+		if ( Data == MAP_FAILED )
+		{
+			close( File );
+			throw std::runtime_error("Failed to mmap " + Filename);
+		}
+		mData = Data;
+	}
+	//	mapping stays valid after the descriptor is closed
+	close( File );
+#endif
+}
+
+PopJson::Sidecar::MappedFile_t::~MappedFile_t()
+{
+#if defined(_WIN32)
+	if ( mData )
+		UnmapViewOfFile( mData );
+	if ( mMappingHandle )
+		CloseHandle( mMappingHandle );
+	if ( mFileHandle )
+		CloseHandle( mFileHandle );
+#else
+	if ( mData )
+		munmap( const_cast<void*>(mData), mSize );
+#endif
+}
+
+
+void PopJson::Sidecar::Write(const Map_t& Map,std::string_view Json,const std::string& Filename)
+{
+	auto Nodes = Map.GetNodes();
+	auto KeyIndex = Map.GetKeyIndex();
+
+	Header_t Header = {};
+	std::memcpy( Header.mMagic, Magic, sizeof(Magic) );
+	Header.mVersion = Version;
+	Header.mHeaderSize = sizeof(Header_t);
+	Header.mNodeSize = sizeof(MapNode_t);
+	Header.mEndianMarker = EndianMarker;
+	Header.mSourceSize = Json.size();
+	Header.mSourceHash = Hash64( Json.data(), Json.size() );
+	Header.mNodeCount = Nodes.size();
+	Header.mNodesOffset = Align( sizeof(Header_t) );
+	Header.mKeyIndexCount = KeyIndex.size();
+	Header.mKeyIndexOffset = Align( Header.mNodesOffset + Nodes.size_bytes() );
+	Header.mKeyIndexMinChildren = Map.GetKeyIndexMinChildren();
+	Header.mPayloadChecksum = GetPayloadChecksum( Nodes, KeyIndex );
+	Header.mHeaderChecksum = GetHeaderChecksum( Header );
+
+	//	write to a temp file and rename, so a reader never maps a half written sidecar
+	auto TempFilename = Filename + ".tmp";
+	{
+		std::ofstream File( TempFilename, std::ios::binary | std::ios::trunc );
+		if ( !File )
+			throw std::runtime_error("Failed to open " + TempFilename + " for writing");
+
+		const char Padding[SectionAlignment] = {};
+		auto WriteAt = [&](size_t Offset,const void* Data,size_t Size)
+		{
+			size_t Position = File.tellp();
+			File.write( Padding, Offset - Position );
+			File.write( static_cast<const char*>(Data), Size );
+		};
+		WriteAt( 0, &Header, sizeof(Header) );
+		WriteAt( Header.mNodesOffset, Nodes.data(), Nodes.size_bytes() );
+		WriteAt( Header.mKeyIndexOffset, KeyIndex.data(), KeyIndex.size_bytes() );
+		if ( !File )
+			throw std::runtime_error("Failed to write " + TempFilename);
+	}
+	std::filesystem::rename( TempFilename, Filename );
+}
+
+
+PopJson::Map_t PopJson::Sidecar::Open(const std::string& Filename,std::string_view Json,Validate_t::Type Validation)
+{
+	auto File = std::make_shared<MappedFile_t>( Filename );
+	auto Contents = File->GetContents();
+
+	if ( Contents.size() < sizeof(Header_t) )
+		throw std::runtime_error("Sidecar " + Filename + " too small");
+	Header_t Header;
+	std::memcpy( &Header, Contents.data(), sizeof(Header) );
+
+	if ( std::memcmp( Header.mMagic, Magic, sizeof(Magic) ) != 0 )
+		throw std::runtime_error("Sidecar " + Filename + " is not a PopJson sidecar");
+	if ( GetHeaderChecksum( Header ) != Header.mHeaderChecksum )
+		throw std::runtime_error("Sidecar " + Filename + " header is corrupt");
+	if ( Header.mVersion != Version || Header.mHeaderSize != sizeof(Header_t) )
+		throw std::runtime_error("Sidecar " + Filename + " is version " + std::to_string(Header.mVersion) + ", expected " + std::to_string(Version) );
+	if ( Header.mNodeSize != sizeof(MapNode_t) || Header.mEndianMarker != EndianMarker )
+		throw std::runtime_error("Sidecar " + Filename + " was written with a different node layout");
+	if ( Header.mSourceSize != Json.size() )
+		throw std::runtime_error("Sidecar " + Filename + " is stale; source size changed");
+
+	//	counts are checked against the bytes after the offset, so a corrupt count can't overflow
+	auto IsInFile = [&](uint64_t Offset,uint64_t Count,size_t ElementSize)
+	{
+		return Offset <= Contents.size() && Count <= ( Contents.size() - Offset ) / ElementSize;
+	};
+	if ( !IsInFile( Header.mNodesOffset, Header.mNodeCount, sizeof(MapNode_t) ) || !IsInFile( Header.mKeyIndexOffset, Header.mKeyIndexCount, sizeof(NodeIndex_t) ) )
+		throw std::runtime_error("Sidecar " + Filename + " is truncated");
+	if ( Header.mNodesOffset % alignof(MapNode_t) != 0 || Header.mKeyIndexOffset % alignof(NodeIndex_t) != 0 )
+		throw std::runtime_error("Sidecar " + Filename + " has misaligned data");
+	if ( Header.mNodeCount == 0 )
+		throw std::runtime_error("Sidecar " + Filename + " has no nodes");
+
+	auto* NodesData = reinterpret_cast<const MapNode_t*>( Contents.data() + Header.mNodesOffset );
+	auto* KeyIndexData = reinterpret_cast<const NodeIndex_t*>( Contents.data() + Header.mKeyIndexOffset );
+	std::span<const MapNode_t> Nodes( NodesData, Header.mNodeCount );
+	std::span<const NodeIndex_t> KeyIndex( KeyIndexData, Header.mKeyIndexCount );
+
+	if ( Validation >= Validate_t::Checksum )
+	{
+		if ( GetPayloadChecksum( Nodes, KeyIndex ) != Header.mPayloadChecksum )
+			throw std::runtime_error("Sidecar " + Filename + " is corrupt");
+	}
+	if ( Validation >= Validate_t::Full )
+	{
+		if ( Hash64( Json.data(), Json.size() ) != Header.mSourceHash )
+			throw std::runtime_error("Sidecar " + Filename + " is stale; source hash changed");
+	}
+
+	Map_t Map;
+	Map.SetExternalData( File, Nodes, KeyIndex, Header.mKeyIndexMinChildren );
+	return Map;
+}
+
+
+std::shared_ptr<PopJson::Sidecar::Document_t> PopJson::Sidecar::OpenDocument(const std::string& JsonFilename,const std::string& SidecarFilename,Validate_t::Type Validation,bool Rebuild)
+{
+	auto JsonFile = std::make_shared<MappedFile_t>( JsonFilename );
+	auto Json = JsonFile->GetContents();
+
+	try
+	{
+		auto Map = std::make_shared<Map_t>( Open( SidecarFilename, Json, Validation ) );
+		return std::make_shared<Document_t>( JsonFile, Map );
+	}
+	catch(std::exception&)
+	{
+		if ( !Rebuild )
+			throw;
+	}
+
+	auto Map = std::make_shared<Map_t>( Parse( Json ) );
+	Map->BuildKeyIndex( Json );
+	Write( *Map, Json, SidecarFilename );
+	auto Document = std::make_shared<Document_t>( JsonFile, Map );
+	Document->mRebuilt = true;
+	return Document;
+}
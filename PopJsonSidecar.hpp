@@ -0,0 +1,87 @@
+/*
+	Persisted binary index ("sidecar") for a json file.
+
+	The parsed Map_t (node array, key/value locations, types and the optional key hash index)
+	is written next to the json, versioned & checksummed. On reload the sidecar is memory
+	mapped and the map points straight at it, so a View_t over the (also mapped) json is
+	queryable without tokenizing anything.
+
+	The sidecar stores MapNode_t as-is, so it is only valid for builds with the same node
+	layout & endianness; the header records both and Open() rejects a mismatch (caller
+	should re-parse and re-write, which OpenDocument() does).
+*/
+#pragma once
+
+#include "PopJson.hpp"
+#include <memory>
+#include <string>
+
+namespace PopJson::Sidecar
+{
+	namespace Validate_t
+	{
+		enum Type
+		{
+			Header,		//	layout, version & source size; O(1), microseconds
+			Checksum,	//	+ checksum of the sidecar's nodes & key index
+			Full,		//	+ hash of the json source, catches same-size edits
+		};
+	}
+
+	class MappedFile_t;
+	class Document_t;
+
+	constexpr uint32_t	Version = 1;
+
+	void		Write(const Map_t& Map,std::string_view Json,const std::string& Filename);
+	//	throws if the sidecar is corrupt, from another layout/version, or doesn't match Json
+	Map_t		Open(const std::string& Filename,std::string_view Json,Validate_t::Type Validation=Validate_t::Full);
+
+	//	map a json file and its sidecar. If the sidecar is missing or stale and Rebuild is true,
+	//	the json is parsed (with a key index) and a new sidecar written
+	std::shared_ptr<Document_t>	OpenDocument(const std::string& JsonFilename,const std::string& SidecarFilename,Validate_t::Type Validation=Validate_t::Full,bool Rebuild=true);
+}
+
+
+//	read-only memory mapped file
+class PopJson::Sidecar::MappedFile_t
+{
+public:
+	MappedFile_t(const std::string& Filename);
+	MappedFile_t(const MappedFile_t&)=delete;
+	~MappedFile_t();
+
+	std::string_view	GetContents() const	{	return std::string_view( static_cast<const char*>(mData), mSize );	}
+
+private:
+	const void*		mData = nullptr;
+	size_t			mSize = 0;
+#if defined(_WIN32)
+	void*			mFileHandle = nullptr;
+	void*			mMappingHandle = nullptr;
+#endif
+};
+
+
+//	mapped json + its map. Views given out point into the mapped json, so keep this alive while using them
+class PopJson::Sidecar::Document_t
+{
+public:
+	Document_t(std::shared_ptr<MappedFile_t> Json,std::shared_ptr<const Map_t> Map) :
+		mJsonFile	( Json ),
+		mMap		( Map )
+	{
+	}
+
+	std::string_view				GetJson() const	{	return mJsonFile->GetContents();	}
+	std::shared_ptr<const Map_t>	GetMap() const	{	return mMap;	}
+	View_t							GetView() const	{	return View_t( mMap, 0, GetJson() );	}
+	bool							WasRebuilt() const	{	return mRebuilt;	}
+
+public:
+	bool							mRebuilt = false;
+
+private:
+	std::shared_ptr<MappedFile_t>	mJsonFile;
+	std::shared_ptr<const Map_t>	mMap;
+};
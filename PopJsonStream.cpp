@@ -0,0 +1,512 @@
+#include "PopJsonStream.hpp"
+#include "PopJsonScan.hpp"
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <stdexcept>
+#include <vector>
+
+#if defined(POPJSON_ZLIB)
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <zlib.h>
+#endif
+
+
+namespace
+{
+	//	blocks of input, from the start of the record being read
+	class Input_t
+	{
+	public:
+		Input_t(PopJson::Stream::Reader_t& Reader,size_t BlockSize) :
+			mReader		( Reader ),
+			mBlockSize	( BlockSize )
+		{
+			if ( BlockSize == 0 )
+				throw std::runtime_error("Stream block size must be at least 1");
+		}
+
+		//	false at the end of the input
+		bool				HasMore()	{	return mPosition < mBuffer.size() || Fill();	}
+		char				Peek() const	{	return mBuffer[mPosition];	}
+		void				Skip()			{	mPosition++;	}
+		//	anything before here is dropped when the next block is read
+		void				Keep()			{	mKeep = mPosition;	}
+		std::string_view	GetKept() const	{	return std::string_view( mBuffer.data() + mKeep, mPosition - mKeep );	}
+
+		//	false if the input ends first
+		bool				SkipWhitespace();
+		//	from the first byte of a value to the byte after it
+		void				SkipValue();
+		//	from the byte after an opening quote to the byte after the closing quote
+		void				SkipString();
+		void				Expect(char Char);
+
+	private:
+		bool				Fill();
+		void				SkipContainer();
+
+	private:
+		PopJson::Stream::Reader_t&	mReader;
+		size_t				mBlockSize = 0;
+		bool				mEnded = false;
+		std::vector<char>	mBuffer;
+		size_t				mPosition = 0;
+		size_t				mKeep = 0;
+	};
+}
+
+bool Input_t::Fill()
+{
+	if ( mEnded )
+		return false;
+
+	//	drop what's been used, so the buffer is only ever the current record plus a block
+	if ( mKeep > 0 )
+	{
+		mBuffer.erase( mBuffer.begin(), mBuffer.begin() + mKeep );
+		mPosition -= mKeep;
+		mKeep = 0;
+	}
+
+	auto OldSize = mBuffer.size();
+	mBuffer.resize( OldSize + mBlockSize );
+	auto Read = mReader( std::span( mBuffer.data() + OldSize, mBlockSize ) );
+	if ( Read > mBlockSize )
+		throw std::runtime_error("Stream reader returned more than its buffer size");
+	mBuffer.resize( OldSize + Read );
+	if ( Read == 0 )
+		mEnded = true;
+	return Read > 0;
+}
+
+bool Input_t::SkipWhitespace()
+{
+	while ( HasMore() )
+	{
+		mPosition += PopJson::Scan::SkipWhitespace( mBuffer.data() + mPosition, mBuffer.size() - mPosition );
+		if ( mPosition < mBuffer.size() )
+			return true;
+	}
+	return false;
+}
+
+void Input_t::Expect(char Char)
+{
+	if ( !SkipWhitespace() )
+		throw std::runtime_error(std::string("Json ended, expected ") + Char);
+	if ( Peek() != Char )
+		throw std::runtime_error(std::string("Unexpected ") + Peek() + ", expected " + Char);
+	Skip();
+}
+
+void Input_t::SkipString()
+{
+	while ( true )
+	{
+		if ( !HasMore() )
+			throw std::runtime_error("Json ended inside a string");
+		mPosition += PopJson::Scan::FindStringSpecial( mBuffer.data() + mPosition, mBuffer.size() - mPosition );
+		if ( mPosition == mBuffer.size() )
+			continue;
+
+		//	control chars are left for the parser to reject
+		auto Char = mBuffer[mPosition++];
+		if ( Char == '"' )
+			return;
+		if ( Char == '\\' )
+		{
+			if ( !HasMore() )
+				throw std::runtime_error("Json ended inside a string");
+			mPosition++;
+		}
+	}
+}
+
+void Input_t::SkipContainer()
+{
+	size_t Depth = 0;
+	while ( true )
+	{
+		if ( !HasMore() )
+			throw std::runtime_error("Json ended with " + std::to_string(Depth) + " unclosed containers");
+		mPosition += PopJson::Scan::FindQuoteOrBracket( mBuffer.data() + mPosition, mBuffer.size() - mPosition );
+		if ( mPosition == mBuffer.size() )
+			continue;
+
+		//	mismatched brackets are left for the parser to reject
+		auto Char = mBuffer[mPosition++];
+		if ( Char == '"' )
+			SkipString();
+		else if ( Char == '{' || Char == '[' )
+			Depth++;
+		else if ( --Depth == 0 )
+			return;
+	}
+}
+
+void Input_t::SkipValue()
+{
+	auto Char = Peek();
+	if ( Char == '"' )
+	{
+		Skip();
+		SkipString();
+		return;
+	}
+	if ( Char == '{' || Char == '[' )
+	{
+		SkipContainer();
+		return;
+	}
+
+	//	number or literal. Reading more input moves positions, so count the length instead
+	size_t Length = 0;
+	do
+	{
+		auto Run = PopJson::Scan::FindTokenEnd( mBuffer.data() + mPosition, mBuffer.size() - mPosition );
+		mPosition += Run;
+		Length += Run;
+	}
+	while ( mPosition == mBuffer.size() && Fill() );
+	if ( Length == 0 )
+		throw std::runtime_error(std::string("Unexpected ") + Char + " at start of value");
+}
+
+
+#if defined(POPJSON_ZLIB)
+namespace
+{
+	//	producer thread inflating into a ring of blocks, consumed by Read()
+	class Inflater_t
+	{
+	public:
+		Inflater_t(PopJson::Stream::Reader_t Compressed,size_t BlockSize,size_t BlockCount);
+		~Inflater_t();
+
+		size_t		Read(std::span<char> Buffer);
+
+	private:
+		void		Thread();
+		void		Inflate();
+		//	next free block, or null when stopping
+		std::vector<char>*	WaitForFreeBlock();
+
+	private:
+		PopJson::Stream::Reader_t	mCompressed;
+		size_t						mBlockSize = 0;
+
+		std::mutex					mLock;
+		std::condition_variable		mChanged;
+		std::vector<std::vector<char>>	mBlocks;
+		uint64_t					mWritten = 0;		//	blocks filled; the next is mBlocks[mWritten % size]
+		uint64_t					mRead = 0;			//	blocks fully consumed
+		bool						mEnded = false;
+		bool						mStop = false;
+		std::exception_ptr			mException;
+
+		size_t						mReadOffset = 0;	//	in mBlocks[mRead % size], only touched by the consumer
+		std::thread					mThread;
+	};
+}
+
+Inflater_t::Inflater_t(PopJson::Stream::Reader_t Compressed,size_t BlockSize,size_t BlockCount) :
+	mCompressed	( std::move(Compressed) ),
+	mBlockSize	( BlockSize ),
+	mBlocks		( BlockCount )
+{
+	if ( BlockSize == 0 || BlockCount == 0 )
+		throw std::runtime_error("Inflate block size & count must be at least 1");
+	mThread = std::thread( [this]()	{	Thread();	} );
+}
+
+Inflater_t::~Inflater_t()
+{
+	{
+		std::lock_guard Lock( mLock );
+		mStop = true;
+	}
+	mChanged.notify_all();
+	mThread.join();
+}
+
+void Inflater_t::Thread()
+{
+	try
+	{
+		Inflate();
+	}
+	catch(...)
+	{
+		std::lock_guard Lock( mLock );
+		mException = std::current_exception();
+	}
+	{
+		std::lock_guard Lock( mLock );
+		mEnded = true;
+	}
+	mChanged.notify_all();
+}
+
+std::vector<char>* Inflater_t::WaitForFreeBlock()
+{
+	std::unique_lock Lock( mLock );
+	mChanged.wait( Lock, [&]()	{	return mStop || mWritten - mRead < mBlocks.size();	} );
+	if ( mStop )
+		return nullptr;
+	return &mBlocks[mWritten % mBlocks.size()];
+}
+
+void Inflater_t::Inflate()
+{
+	z_stream Stream = {};
+	//	+32; detect gzip or zlib header
+	if ( inflateInit2( &Stream, 15+32 ) != Z_OK )
+		throw std::runtime_error("Failed to initialise zlib inflate");
+	std::unique_ptr<z_stream,decltype(&inflateEnd)> StreamCleanup( &Stream, &inflateEnd );
+
+	std::vector<char> Input( mBlockSize );
+	bool InputEnded = false;
+	bool AtStreamEnd = false;
+	while ( true )
+	{
+		auto* Block = WaitForFreeBlock();
+		if ( !Block )
+			return;
+
+		Block->resize( mBlockSize );
+		Stream.next_out = reinterpret_cast<Bytef*>( Block->data() );
+		Stream.avail_out = static_cast<uInt>( mBlockSize );
+		while ( Stream.avail_out > 0 )
+		{
+			if ( Stream.avail_in == 0 && !InputEnded )
+			{
+				auto Read = mCompressed( std::span( Input.data(), Input.size() ) );
+				InputEnded = Read == 0;
+				Stream.next_in = reinterpret_cast<Bytef*>( Input.data() );
+				Stream.avail_in = static_cast<uInt>( Read );
+			}
+			if ( Stream.avail_in == 0 )
+			{
+				if ( !AtStreamEnd )
+					throw std::runtime_error("Compressed input is truncated");
+				break;
+			}
+
+			//	another gzip member follows
+			if ( AtStreamEnd )
+			{
+				inflateReset( &Stream );
+				AtStreamEnd = false;
+			}
+			auto Result = inflate( &Stream, Z_NO_FLUSH );
+			if ( Result == Z_STREAM_END )
+				AtStreamEnd = true;
+			else if ( Result != Z_OK && Result != Z_BUF_ERROR )
+				throw std::runtime_error(std::string("Inflate failed; ") + ( Stream.msg ? Stream.msg : std::to_string(Result) ));
+		}
+
+		auto Inflated = mBlockSize - Stream.avail_out;
+		Block->resize( Inflated );
+		bool Finished = Stream.avail_out > 0;
+		{
+			std::lock_guard Lock( mLock );
+			if ( Inflated > 0 )
+				mWritten++;
+		}
+		mChanged.notify_all();
+		if ( Finished )
+			return;
+	}
+}
+
+size_t Inflater_t::Read(std::span<char> Buffer)
+{
+	std::vector<char>* Block = nullptr;
+	{
+		std::unique_lock Lock( mLock );
+		mChanged.wait( Lock, [&]()	{	return mWritten > mRead || mEnded;	} );
+		if ( mException )
+			std::rethrow_exception( mException );
+		if ( mWritten == mRead )
+			return 0;
+		Block = &mBlocks[mRead % mBlocks.size()];
+	}
+
+	//	the producer doesn't touch this block until it's released
+	auto Read = std::min( Buffer.size(), Block->size() - mReadOffset );
+	std::memcpy( Buffer.data(), Block->data() + mReadOffset, Read );
+	mReadOffset += Read;
+	if ( mReadOffset == Block->size() )
+	{
+		{
+			std::lock_guard Lock( mLock );
+			mRead++;
+		}
+		mReadOffset = 0;
+		mChanged.notify_all();
+	}
+	return Read;
+}
+#endif
+
+PopJson::Stream::Reader_t PopJson::Stream::GetInflateReader(Reader_t Compressed,size_t BlockSize,size_t BlockCount)
+{
+#if defined(POPJSON_ZLIB)
+	//	readers are copyable; the last copy stops the thread
+	auto Inflater = std::make_shared<Inflater_t>( std::move(Compressed), BlockSize, BlockCount );
+	return [Inflater](std::span<char> Buffer)
+	{
+		return Inflater->Read( Buffer );
+	};
+#else
+	throw std::runtime_error("PopJson was built without zlib (POPJSON_ZLIB)");
+#endif
+}
+
+std::string PopJson::Stream::ReadAll(Reader_t Reader,size_t BlockSize)
+{
+	std::string Output;
+	while ( true )
+	{
+		auto OldSize = Output.size();
+		Output.resize( OldSize + BlockSize );
+		auto Read = Reader( std::span( Output.data() + OldSize, BlockSize ) );
+		Output.resize( OldSize + Read );
+		if ( Read == 0 )
+			return Output;
+	}
+}
+
+PopJson::Stream::Reader_t PopJson::Stream::GetReader(std::istream& Input)
+{
+	return [&Input](std::span<char> Buffer)
+	{
+		Input.read( Buffer.data(), static_cast<std::streamsize>(Buffer.size()) );
+		return static_cast<size_t>( Input.gcount() );
+	};
+}
+
+PopJson::Stream::Generator_t<PopJson::View_t> PopJson::Stream::ReadValues(Reader_t Reader,size_t BlockSize)
+{
+	Input_t Input( Reader, BlockSize );
+	while ( true )
+	{
+		Input.Keep();
+		if ( !Input.SkipWhitespace() )
+			co_return;
+		Input.Keep();
+		Input.SkipValue();
+		View_t Record( Input.GetKept() );
+		co_yield Record;
+	}
+}
+
+PopJson::Stream::Generator_t<PopJson::View_t> PopJson::Stream::ReadElements(Reader_t Reader,std::string Pointer,size_t BlockSize)
+{
+	//	pointer tokens as they would appear in the json
+	std::vector<std::string> Tokens;
+	if ( !Pointer.empty() && Pointer[0] != '/' )
+		throw std::runtime_error("Json pointer " + Pointer + " doesn't start with /");
+	for ( size_t Start=1;	Start<=Pointer.size();	)
+	{
+		auto End = std::min( Pointer.find( '/', Start ), Pointer.size() );
+		std::string Token;
+		for ( auto i=Start;	i<End;	i++ )
+		{
+			if ( Pointer[i] == '~' && i+1 < End && ( Pointer[i+1] == '0' || Pointer[i+1] == '1' ) )
+				Token += Pointer[++i] == '0' ? '~' : '/';
+			else
+				Token += Pointer[i];
+		}
+		std::vector<char> Escaped;
+		AppendEscapedString( Escaped, Token );
+		Tokens.push_back( std::string( Escaped.begin(), Escaped.end() ) );
+		Start = End + 1;
+	}
+
+	Input_t Input( Reader, BlockSize );
+	auto IsClose = [](char Char)	{	return Char == '}' || Char == ']';	};
+
+	//	walk down to the container, skipping everything else
+	for ( auto& Token : Tokens )
+	{
+		if ( !Input.SkipWhitespace() || ( Input.Peek() != '{' && Input.Peek() != '[' ) )
+			throw std::runtime_error("Json pointer " + Pointer + " doesn't lead to a container");
+		bool IsObject = Input.Peek() == '{';
+		Input.Skip();
+
+		bool Found = false;
+		for ( size_t Index=0;	!Found;	Index++ )
+		{
+			Input.Keep();
+			if ( !Input.SkipWhitespace() )
+				throw std::runtime_error("Json ended looking for " + Pointer);
+			if ( Index == 0 && IsClose( Input.Peek() ) )
+				break;
+			if ( IsObject )
+			{
+				Input.Expect('"');
+				Input.Keep();
+				Input.SkipString();
+				auto Key = Input.GetKept();
+				Found = Key.substr( 0, Key.size()-1 ) == Token;
+				Input.Expect(':');
+			}
+			else
+			{
+				Found = Token == std::to_string(Index);
+			}
+			if ( Found )
+				break;
+
+			Input.Keep();
+			if ( !Input.SkipWhitespace() )
+				throw std::runtime_error("Json ended looking for " + Pointer);
+			Input.SkipValue();
+			if ( !Input.SkipWhitespace() )
+				throw std::runtime_error("Json ended looking for " + Pointer);
+			if ( IsClose( Input.Peek() ) )
+				break;
+			Input.Expect(',');
+		}
+		if ( !Found )
+			throw std::runtime_error("Json pointer " + Pointer + " not found");
+	}
+
+	if ( !Input.SkipWhitespace() || ( Input.Peek() != '{' && Input.Peek() != '[' ) )
+		throw std::runtime_error("Json pointer " + Pointer + " doesn't lead to a container");
+	bool IsObject = Input.Peek() == '{';
+	Input.Skip();
+
+	for ( size_t Index=0;	true;	Index++ )
+	{
+		Input.Keep();
+		if ( !Input.SkipWhitespace() )
+			throw std::runtime_error("Json ended inside " + Pointer);
+		if ( Index == 0 && IsClose( Input.Peek() ) )
+			co_return;
+		if ( IsObject )
+		{
+			Input.Expect('"');
+			Input.SkipString();
+			Input.Expect(':');
+			if ( !Input.SkipWhitespace() )
+				throw std::runtime_error("Json ended inside " + Pointer);
+		}
+
+		Input.Keep();
+		Input.SkipValue();
+		View_t Record( Input.GetKept() );
+		co_yield Record;
+
+		if ( !Input.SkipWhitespace() )
+			throw std::runtime_error("Json ended inside " + Pointer);
+		if ( IsClose( Input.Peek() ) )
+			co_return;
+		Input.Expect(',');
+	}
+}
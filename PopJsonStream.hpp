@@ -0,0 +1,128 @@
+/*
+	Record-at-a-time parsing of json which is too big to hold; NDJSON (or any whitespace
+	separated values), or the elements of one big array, read from a file, pipe or socket.
+
+	Input is pulled from a reader callback in fixed size blocks (from a stream, or inflated from
+	compressed input while parsing). Each record's extent is found
+	lexically (strings and depth are tracked, with the Scan kernels), then the record alone is
+	parsed and yielded as a View_t from a coroutine generator. Only the current record and the
+	block being read are held, so memory is bounded by the largest record rather than the input.
+
+	Yielded views point into the generator's buffer, so (like the values of std::generator) they
+	are only valid until the loop moves on; keep a Json_t copy of anything needed for longer.
+*/
+#pragma once
+
+#include "PopJson.hpp"
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <iosfwd>
+#include <span>
+#include <string>
+#include <utility>
+
+namespace PopJson::Stream
+{
+	template<typename TYPE>
+	class Generator_t;		//	input range of yielded values, like c++23's std::generator
+
+	//	fill Buffer with up to Buffer.size() bytes of input and return how many were written;
+	//	0 marks the end of the input
+	using Reader_t = std::function<size_t(std::span<char> Buffer)>;
+	Reader_t	GetReader(std::istream& Input);
+
+	constexpr size_t	DefaultBlockSize = 64*1024;
+
+	//	gzip or zlib compressed input (concatenated gzip members too) is inflated on another thread
+	//	into a ring of BlockCount blocks, which the returned reader hands out; so decompression
+	//	overlaps with parsing, and only a few blocks of either are held at once. Compressed is
+	//	called from that thread. Throws if built without zlib (POPJSON_ZLIB)
+	Reader_t	GetInflateReader(Reader_t Compressed,size_t BlockSize=DefaultBlockSize,size_t BlockCount=4);
+
+	//	the rest of the input, for when a whole document is needed (eg. to parse a Map_t)
+	std::string	ReadAll(Reader_t Reader,size_t BlockSize=DefaultBlockSize);
+
+	//	each top-level value of a sequence of json values (eg. NDJSON)
+	Generator_t<View_t>	ReadValues(Reader_t Reader,size_t BlockSize=DefaultBlockSize);
+
+	//	each element of the array (or member value of the object) at Pointer (RFC 6901) in one json
+	//	document; "" for the elements of a root array. Throws if Pointer doesn't lead to a container.
+	//	Reading stops at the end of the container
+	Generator_t<View_t>	ReadElements(Reader_t Reader,std::string Pointer="",size_t BlockSize=DefaultBlockSize);
+}
+
+
+template<typename TYPE>
+class PopJson::Stream::Generator_t
+{
+public:
+	class promise_type
+	{
+	public:
+		Generator_t				get_return_object()				{	return Generator_t( std::coroutine_handle<promise_type>::from_promise(*this) );	}
+		std::suspend_always		initial_suspend() noexcept		{	return {};	}
+		std::suspend_always		final_suspend() noexcept		{	return {};	}
+		std::suspend_always		yield_value(TYPE& Value) noexcept	{	mValue = &Value;	return {};	}
+		void					return_void()					{}
+		void					unhandled_exception()			{	mException = std::current_exception();	}
+
+		TYPE*				mValue = nullptr;
+		std::exception_ptr	mException;
+	};
+	using Handle_t = std::coroutine_handle<promise_type>;
+
+	class Iterator_t
+	{
+	public:
+		using value_type = TYPE;
+		using difference_type = std::ptrdiff_t;
+
+		Iterator_t(){}
+		Iterator_t(Handle_t Coroutine) :
+			mCoroutine	( Coroutine )
+		{
+		}
+
+		TYPE&		operator*() const		{	return *mCoroutine.promise().mValue;	}
+		Iterator_t&	operator++()			{	Resume( mCoroutine );	return *this;	}
+		void		operator++(int)			{	++*this;	}
+		bool		operator==(std::default_sentinel_t) const	{	return !mCoroutine || mCoroutine.done();	}
+
+	private:
+		Handle_t	mCoroutine;
+	};
+
+public:
+	Generator_t(Generator_t&& Move) noexcept :
+		mCoroutine	( std::exchange( Move.mCoroutine, {} ) )
+	{
+	}
+	Generator_t(const Generator_t&)=delete;
+	~Generator_t()
+	{
+		if ( mCoroutine )
+			mCoroutine.destroy();
+	}
+
+	//	runs to the first yield, so reading (and any error) starts here
+	Iterator_t					begin()		{	Resume( mCoroutine );	return Iterator_t( mCoroutine );	}
+	std::default_sentinel_t		end()		{	return {};	}
+
+private:
+	explicit Generator_t(Handle_t Coroutine) :
+		mCoroutine	( Coroutine )
+	{
+	}
+
+	//	errors thrown in the coroutine are re-thrown to the reader of the generator
+	static void		Resume(Handle_t Coroutine)
+	{
+		Coroutine.resume();
+		if ( auto Exception = std::exchange( Coroutine.promise().mException, nullptr ) )
+			std::rethrow_exception( Exception );
+	}
+
+private:
+	Handle_t	mCoroutine;
+};
@@ -0,0 +1,611 @@
+#include "PopJsonTranscode.hpp"
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+
+void UnescapeString(std::string_view EscapedString,std::string& Output);
+
+
+namespace
+{
+	void AppendBigEndian(std::vector<uint8_t>& Output,uint64_t Value,int Bytes)
+	{
+		for ( int b=Bytes-1;	b>=0;	b-- )
+			Output.push_back( static_cast<uint8_t>( Value >> (b*8) ) );
+	}
+
+	uint64_t GetDoubleBits(double Value)
+	{
+		uint64_t Bits;
+		std::memcpy( &Bits, &Value, sizeof(Bits) );
+		return Bits;
+	}
+
+	class MessagePackWriter_t
+	{
+	public:
+		static void	WriteNull(std::vector<uint8_t>& Output)				{	Output.push_back(0xc0);	}
+		static void	WriteBool(std::vector<uint8_t>& Output,bool Value)	{	Output.push_back( Value ? 0xc3 : 0xc2 );	}
+		static void	WriteDouble(std::vector<uint8_t>& Output,double Value)
+		{
+			Output.push_back(0xcb);
+			AppendBigEndian( Output, GetDoubleBits(Value), 8 );
+		}
+		static void	WriteUnsigned(std::vector<uint8_t>& Output,uint64_t Value)
+		{
+			if ( Value <= 0x7f )
+				Output.push_back( static_cast<uint8_t>(Value) );
+			else if ( Value <= 0xff )
+				WriteTyped( Output, 0xcc, Value, 1 );
+			else if ( Value <= 0xffff )
+				WriteTyped( Output, 0xcd, Value, 2 );
+			else if ( Value <= 0xffffffff )
+				WriteTyped( Output, 0xce, Value, 4 );
+			else
+				WriteTyped( Output, 0xcf, Value, 8 );
+		}
+		static void	WriteNegative(std::vector<uint8_t>& Output,int64_t Value)
+		{
+			if ( Value >= -32 )
+				Output.push_back( static_cast<uint8_t>(Value) );
+			else if ( Value >= std::numeric_limits<int8_t>::min() )
+				WriteTyped( Output, 0xd0, static_cast<uint64_t>(Value), 1 );
+			else if ( Value >= std::numeric_limits<int16_t>::min() )
+				WriteTyped( Output, 0xd1, static_cast<uint64_t>(Value), 2 );
+			else if ( Value >= std::numeric_limits<int32_t>::min() )
+				WriteTyped( Output, 0xd2, static_cast<uint64_t>(Value), 4 );
+			else
+				WriteTyped( Output, 0xd3, static_cast<uint64_t>(Value), 8 );
+		}
+		static void	WriteStringHeader(std::vector<uint8_t>& Output,size_t Length)
+		{
+			if ( Length < 32 )
+				Output.push_back( static_cast<uint8_t>(0xa0 | Length) );
+			else if ( Length <= 0xff )
+				WriteTyped( Output, 0xd9, Length, 1 );
+			else if ( Length <= 0xffff )
+				WriteTyped( Output, 0xda, Length, 2 );
+			else
+				WriteTyped( Output, 0xdb, GetLength32(Length), 4 );
+		}
+		static void	WriteArrayHeader(std::vector<uint8_t>& Output,size_t Count)	{	WriteContainerHeader( Output, Count, 0x90, 0xdc );	}
+		static void	WriteMapHeader(std::vector<uint8_t>& Output,size_t Count)		{	WriteContainerHeader( Output, Count, 0x80, 0xde );	}
+
+	private:
+		static void	WriteTyped(std::vector<uint8_t>& Output,uint8_t Type,uint64_t Value,int Bytes)
+		{
+			Output.push_back( Type );
+			AppendBigEndian( Output, Value, Bytes );
+		}
+		//	fixed is the 4bit-length type, Type16 is followed by Type32
+		static void	WriteContainerHeader(std::vector<uint8_t>& Output,size_t Count,uint8_t FixedType,uint8_t Type16)
+		{
+			if ( Count < 16 )
+				Output.push_back( static_cast<uint8_t>(FixedType | Count) );
+			else if ( Count <= 0xffff )
+				WriteTyped( Output, Type16, Count, 2 );
+			else
+				WriteTyped( Output, Type16+1, GetLength32(Count), 4 );
+		}
+		static uint64_t	GetLength32(size_t Length)
+		{
+			if ( Length > 0xffffffff )
+				throw std::runtime_error("Length too large for MessagePack");
+			return Length;
+		}
+	};
+
+	class CborWriter_t
+	{
+	public:
+		static void	WriteNull(std::vector<uint8_t>& Output)				{	Output.push_back(0xf6);	}
+		static void	WriteBool(std::vector<uint8_t>& Output,bool Value)	{	Output.push_back( Value ? 0xf5 : 0xf4 );	}
+		static void	WriteDouble(std::vector<uint8_t>& Output,double Value)
+		{
+			Output.push_back(0xfb);
+			AppendBigEndian( Output, GetDoubleBits(Value), 8 );
+		}
+		static void	WriteUnsigned(std::vector<uint8_t>& Output,uint64_t Value)		{	WriteHead( Output, 0, Value );	}
+		//	major type 1 stores -1-Value
+		static void	WriteNegative(std::vector<uint8_t>& Output,int64_t Value)		{	WriteHead( Output, 1, ~static_cast<uint64_t>(Value) );	}
+		static void	WriteStringHeader(std::vector<uint8_t>& Output,size_t Length)	{	WriteHead( Output, 3, Length );	}
+		static void	WriteArrayHeader(std::vector<uint8_t>& Output,size_t Count)		{	WriteHead( Output, 4, Count );	}
+		static void	WriteMapHeader(std::vector<uint8_t>& Output,size_t Count)		{	WriteHead( Output, 5, Count );	}
+
+	private:
+		static void	WriteHead(std::vector<uint8_t>& Output,uint8_t Major,uint64_t Argument)
+		{
+			Major <<= 5;
+			if ( Argument < 24 )
+			{
+				Output.push_back( static_cast<uint8_t>(Major | Argument) );
+			}
+			else if ( Argument <= 0xff )
+			{
+				Output.push_back( Major | 24 );
+				AppendBigEndian( Output, Argument, 1 );
+			}
+			else if ( Argument <= 0xffff )
+			{
+				Output.push_back( Major | 25 );
+				AppendBigEndian( Output, Argument, 2 );
+			}
+			else if ( Argument <= 0xffffffff )
+			{
+				Output.push_back( Major | 26 );
+				AppendBigEndian( Output, Argument, 4 );
+			}
+			else
+			{
+				Output.push_back( Major | 27 );
+				AppendBigEndian( Output, Argument, 8 );
+			}
+		}
+	};
+
+
+	//	Buffer is reused for strings which need unescaping, so they don't allocate per string
+	template<typename WRITER>
+	void WriteString(std::vector<uint8_t>& Output,std::string_view Escaped,std::string& Buffer)
+	{
+		//	most strings have no escapes and are copied as-is
+		if ( Escaped.find('\\') == std::string_view::npos )
+		{
+			WRITER::WriteStringHeader( Output, Escaped.size() );
+			Output.insert( Output.end(), Escaped.begin(), Escaped.end() );
+			return;
+		}
+		Buffer.clear();
+		UnescapeString( Escaped, Buffer );
+		WRITER::WriteStringHeader( Output, Buffer.size() );
+		Output.insert( Output.end(), Buffer.begin(), Buffer.end() );
+	}
+
+	template<typename WRITER>
+	void WriteNumber(std::vector<uint8_t>& Output,std::string_view Raw,PopJson::ValueType_t::Type Type)
+	{
+		auto* Start = Raw.data();
+		auto* End = Raw.data() + Raw.size();
+		//	the parser types long integers as doubles, so check the text for a fraction/exponent.
+		//	integers that don't fit in 64 bits fall through to a double, as most json readers would do
+		bool IsInteger = Type == PopJson::ValueType_t::NumberInteger || Raw.find_first_of(".eE") == std::string_view::npos;
+		if ( IsInteger )
+		{
+			int64_t Signed = 0;
+			auto Result = std::from_chars( Start, End, Signed );
+			if ( Result.ec == std::errc() && Result.ptr == End )
+			{
+				if ( Signed < 0 )
+					WRITER::WriteNegative( Output, Signed );
+				else
+					WRITER::WriteUnsigned( Output, static_cast<uint64_t>(Signed) );
+				return;
+			}
+			uint64_t Unsigned = 0;
+			Result = std::from_chars( Start, End, Unsigned );
+			if ( Result.ec == std::errc() && Result.ptr == End )
+			{
+				WRITER::WriteUnsigned( Output, Unsigned );
+				return;
+			}
+		}
+
+		double Value = 0;
+		auto Result = std::from_chars( Start, End, Value );
+		if ( Result.ec != std::errc() || Result.ptr != End )
+			throw std::runtime_error("Failed to convert " + std::string(Raw) + " to a number");
+		WRITER::WriteDouble( Output, Value );
+	}
+
+	template<typename WRITER>
+	void WriteMap(const PopJson::Map_t& Map,std::string_view Json,std::vector<uint8_t>& Output,PopJson::NodeIndex_t Root)
+	{
+		using namespace PopJson;
+		auto Nodes = Map.GetNodes();
+		auto End = Root + 1 + Nodes[Root].GetDescendantCount();
+		std::string Buffer;
+
+		//	depth-first order is exactly the order binary formats with length-prefixed containers want
+		for ( auto Index=Root;	Index<End;	Index++ )
+		{
+			auto& Node = Nodes[Index];
+			//	check the parent, not HasKey(), as "" is a valid key
+			if ( Index != Root && Nodes[Node.GetParentIndex()].GetType() == ValueType_t::Object )
+				WriteString<WRITER>( Output, Node.GetKey(Json), Buffer );
+
+			switch ( Node.GetType() )
+			{
+				case ValueType_t::Null:			WRITER::WriteNull( Output );	break;
+				case ValueType_t::BooleanTrue:	WRITER::WriteBool( Output, true );	break;
+				case ValueType_t::BooleanFalse:	WRITER::WriteBool( Output, false );	break;
+				case ValueType_t::String:		WriteString<WRITER>( Output, Node.GetValuePosition().GetContents(Json), Buffer );	break;
+				case ValueType_t::Array:		WRITER::WriteArrayHeader( Output, Node.GetChildCount() );	break;
+				case ValueType_t::Object:		WRITER::WriteMapHeader( Output, Node.GetChildCount() );	break;
+				case ValueType_t::NumberInteger:
+				case ValueType_t::NumberDouble:
+					WriteNumber<WRITER>( Output, Node.GetValuePosition().GetContents(Json), Node.GetType() );
+					break;
+			}
+		}
+	}
+
+
+	//	writes minified json as values are decoded, tracking separators & closing containers
+	class JsonTextWriter_t
+	{
+	public:
+		JsonTextWriter_t(std::vector<char>& Json) :
+			mJson	( Json )
+		{
+		}
+
+		bool	IsComplete() const	{	return mStarted && mStack.empty();	}
+		bool	IsKeyExpected() const	{	return !mStack.empty() && mStack.back().mObject && (mStack.back().mWritten % 2) == 0;	}
+
+		void	WriteLiteral(std::string_view Literal)
+		{
+			if ( IsKeyExpected() )
+				throw std::runtime_error("Object keys must be strings or numbers");
+			BeginValue();
+			Append( Literal );
+			EndValue();
+		}
+		void	WriteUnsigned(uint64_t Value)	{	WriteNumber( Value );	}
+		void	WriteSigned(int64_t Value)		{	WriteNumber( Value );	}
+		//	CBOR negatives can be below INT64_MIN; -1-Value is written as text
+		void	WriteNegative(uint64_t MinusOneMinusValue)
+		{
+			if ( MinusOneMinusValue <= static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) )
+				return WriteSigned( -1 - static_cast<int64_t>(MinusOneMinusValue) );
+			if ( MinusOneMinusValue == std::numeric_limits<uint64_t>::max() )
+				return WriteNumberText("-18446744073709551616");
+			char Buffer[32] = { '-' };
+			auto Result = std::to_chars( Buffer+1, Buffer+sizeof(Buffer), MinusOneMinusValue+1 );
+			WriteNumberText( std::string_view( Buffer, Result.ptr-Buffer ) );
+		}
+		template<typename FLOAT>
+		void	WriteFloat(FLOAT Value)
+		{
+			if ( !std::isfinite(Value) )
+				throw std::runtime_error("Cannot write nan or infinite number to json");
+			//	format at the decoded precision, so float32 0.1 is written as 0.1
+			WriteNumber( Value );
+		}
+
+		void	BeginString()
+		{
+			BeginValue();
+			mJson.push_back('"');
+		}
+		void	AppendString(std::string_view Value)	{	PopJson::AppendEscapedString( mJson, Value );	}
+		void	EndString()
+		{
+			mJson.push_back('"');
+			EndValue();
+		}
+		void	WriteString(std::string_view Value)
+		{
+			BeginString();
+			AppendString( Value );
+			EndString();
+		}
+
+		//	Indefinite containers are closed with Break()
+		void	BeginContainer(bool Object,uint64_t Count,bool Indefinite)
+		{
+			if ( IsKeyExpected() )
+				throw std::runtime_error("Object keys must be strings or numbers");
+			BeginValue();
+			mJson.push_back( Object ? '{' : '[' );
+			mStack.push_back( Container_t{ Object, Indefinite, Object ? Count*2 : Count, 0 } );
+			if ( !Indefinite && Count == 0 )
+				EndContainer();
+		}
+		void	Break()
+		{
+			if ( mStack.empty() || !mStack.back().mIndefinite )
+				throw std::runtime_error("Unexpected break");
+			if ( IsKeyExpected() == false && mStack.back().mObject )
+				throw std::runtime_error("Break after object key with no value");
+			EndContainer();
+		}
+
+	private:
+		class Container_t
+		{
+		public:
+			bool		mObject;
+			bool		mIndefinite;
+			uint64_t	mTotal;		//	items (keys & values) expected, if not indefinite
+			uint64_t	mWritten;
+		};
+
+		void	Append(std::string_view Text)	{	mJson.insert( mJson.end(), Text.begin(), Text.end() );	}
+
+		template<typename NUMBER>
+		void	WriteNumber(NUMBER Value)
+		{
+			char Buffer[32];
+			auto Result = std::to_chars( Buffer, Buffer+sizeof(Buffer), Value );
+			WriteNumberText( std::string_view( Buffer, Result.ptr-Buffer ) );
+		}
+		void	WriteNumberText(std::string_view Number)
+		{
+			//	json keys must be strings, so numeric keys are quoted
+			if ( IsKeyExpected() )
+				return WriteString( Number );
+			BeginValue();
+			Append( Number );
+			EndValue();
+		}
+
+		void	BeginValue()
+		{
+			if ( IsComplete() )
+				throw std::runtime_error("Value after end of document");
+			mStarted = true;
+			if ( mStack.empty() )
+				return;
+			auto& Top = mStack.back();
+			if ( Top.mWritten > 0 )
+				mJson.push_back( (Top.mObject && (Top.mWritten % 2) == 1) ? ':' : ',' );
+			Top.mWritten++;
+		}
+		void	EndValue()
+		{
+			if ( mStack.empty() )
+				return;
+			auto& Top = mStack.back();
+			if ( !Top.mIndefinite && Top.mWritten == Top.mTotal )
+				EndContainer();
+		}
+		void	EndContainer()
+		{
+			mJson.push_back( mStack.back().mObject ? '}' : ']' );
+			mStack.pop_back();
+			EndValue();
+		}
+
+	private:
+		std::vector<char>&		mJson;
+		std::vector<Container_t>	mStack;
+		bool					mStarted = false;
+	};
+
+
+	class BinaryReader_t
+	{
+	public:
+		BinaryReader_t(std::span<const uint8_t> Data) :
+			mData	( Data )
+		{
+		}
+
+		size_t		GetPosition() const	{	return mPosition;	}
+		uint8_t		ReadByte()			{	return static_cast<uint8_t>( ReadBigEndian(1) );	}
+		uint64_t	ReadBigEndian(int Bytes)
+		{
+			Require( Bytes );
+			uint64_t Value = 0;
+			for ( int b=0;	b<Bytes;	b++ )
+				Value = (Value << 8) | mData[mPosition++];
+			return Value;
+		}
+		std::string_view	ReadString(uint64_t Length)
+		{
+			Require( Length );
+			auto* Start = reinterpret_cast<const char*>( mData.data() + mPosition );
+			mPosition += Length;
+			return std::string_view( Start, Length );
+		}
+
+	private:
+		void		Require(uint64_t Bytes)
+		{
+			if ( Bytes > mData.size() - mPosition )
+				throw std::runtime_error("Unexpected end of binary data at " + std::to_string(mPosition));
+		}
+
+	private:
+		std::span<const uint8_t>	mData;
+		size_t						mPosition = 0;
+	};
+
+	double GetFloatFromBits(uint32_t Bits)
+	{
+		float Value;
+		std::memcpy( &Value, &Bits, sizeof(Value) );
+		return Value;
+	}
+
+	double GetDoubleFromBits(uint64_t Bits)
+	{
+		double Value;
+		std::memcpy( &Value, &Bits, sizeof(Value) );
+		return Value;
+	}
+
+	float GetHalfFromBits(uint16_t Bits)
+	{
+		int Exponent = (Bits >> 10) & 0x1f;
+		int Mantissa = Bits & 0x3ff;
+		float Value;
+		if ( Exponent == 0 )
+			Value = std::ldexp( static_cast<float>(Mantissa), -24 );
+		else if ( Exponent != 31 )
+			Value = std::ldexp( static_cast<float>(Mantissa + 1024), Exponent - 25 );
+		else
+			Value = Mantissa == 0 ? std::numeric_limits<float>::infinity() : std::numeric_limits<float>::quiet_NaN();
+		return (Bits & 0x8000) ? -Value : Value;
+	}
+
+	void ReadMessagePack(BinaryReader_t& Reader,JsonTextWriter_t& Writer)
+	{
+		do
+		{
+			auto Type = Reader.ReadByte();
+			if ( Type <= 0x7f )
+				Writer.WriteUnsigned( Type );
+			else if ( Type <= 0x8f )
+				Writer.BeginContainer( true, Type & 0x0f, false );
+			else if ( Type <= 0x9f )
+				Writer.BeginContainer( false, Type & 0x0f, false );
+			else if ( Type <= 0xbf )
+				Writer.WriteString( Reader.ReadString( Type & 0x1f ) );
+			else if ( Type >= 0xe0 )
+				Writer.WriteSigned( static_cast<int8_t>(Type) );
+			else
+			{
+				switch ( Type )
+				{
+					case 0xc0:	Writer.WriteLiteral("null");	break;
+					case 0xc2:	Writer.WriteLiteral("false");	break;
+					case 0xc3:	Writer.WriteLiteral("true");	break;
+					case 0xca:	Writer.WriteFloat( static_cast<float>( GetFloatFromBits( static_cast<uint32_t>(Reader.ReadBigEndian(4)) ) ) );	break;
+					case 0xcb:	Writer.WriteFloat( GetDoubleFromBits( Reader.ReadBigEndian(8) ) );	break;
+					case 0xcc:	Writer.WriteUnsigned( Reader.ReadBigEndian(1) );	break;
+					case 0xcd:	Writer.WriteUnsigned( Reader.ReadBigEndian(2) );	break;
+					case 0xce:	Writer.WriteUnsigned( Reader.ReadBigEndian(4) );	break;
+					case 0xcf:	Writer.WriteUnsigned( Reader.ReadBigEndian(8) );	break;
+					case 0xd0:	Writer.WriteSigned( static_cast<int8_t>( Reader.ReadBigEndian(1) ) );	break;
+					case 0xd1:	Writer.WriteSigned( static_cast<int16_t>( Reader.ReadBigEndian(2) ) );	break;
+					case 0xd2:	Writer.WriteSigned( static_cast<int32_t>( Reader.ReadBigEndian(4) ) );	break;
+					case 0xd3:	Writer.WriteSigned( static_cast<int64_t>( Reader.ReadBigEndian(8) ) );	break;
+					case 0xd9:	Writer.WriteString( Reader.ReadString( Reader.ReadBigEndian(1) ) );	break;
+					case 0xda:	Writer.WriteString( Reader.ReadString( Reader.ReadBigEndian(2) ) );	break;
+					case 0xdb:	Writer.WriteString( Reader.ReadString( Reader.ReadBigEndian(4) ) );	break;
+					case 0xdc:	Writer.BeginContainer( false, Reader.ReadBigEndian(2), false );	break;
+					case 0xdd:	Writer.BeginContainer( false, Reader.ReadBigEndian(4), false );	break;
+					case 0xde:	Writer.BeginContainer( true, Reader.ReadBigEndian(2), false );	break;
+					case 0xdf:	Writer.BeginContainer( true, Reader.ReadBigEndian(4), false );	break;
+					default:
+						throw std::runtime_error("MessagePack type " + std::to_string(Type) + " (binary/extension) has no json equivalent");
+				}
+			}
+		}
+		while ( !Writer.IsComplete() );
+	}
+
+	void ReadCbor(BinaryReader_t& Reader,JsonTextWriter_t& Writer)
+	{
+		//	Info 31 is an indefinite length; can't use a sentinel value as all 64bit arguments are valid
+		auto ReadArgument = [&](uint8_t Info) -> uint64_t
+		{
+			if ( Info < 24 )
+				return Info;
+			if ( Info <= 27 )
+				return Reader.ReadBigEndian( 1 << (Info-24) );
+			throw std::runtime_error("Invalid CBOR additional info " + std::to_string(Info));
+		};
+
+		do
+		{
+			auto Initial = Reader.ReadByte();
+			auto Major = Initial >> 5;
+			uint8_t Info = Initial & 0x1f;
+
+			if ( Major == 7 )
+			{
+				switch ( Info )
+				{
+					case 20:	Writer.WriteLiteral("false");	break;
+					case 21:	Writer.WriteLiteral("true");	break;
+					case 22:
+					case 23:	Writer.WriteLiteral("null");	break;	//	undefined
+					case 25:	Writer.WriteFloat( GetHalfFromBits( static_cast<uint16_t>(Reader.ReadBigEndian(2)) ) );	break;
+					case 26:	Writer.WriteFloat( static_cast<float>( GetFloatFromBits( static_cast<uint32_t>(Reader.ReadBigEndian(4)) ) ) );	break;
+					case 27:	Writer.WriteFloat( GetDoubleFromBits( Reader.ReadBigEndian(8) ) );	break;
+					case 31:	Writer.Break();	break;
+					default:
+						throw std::runtime_error("CBOR simple value " + std::to_string(Info) + " has no json equivalent");
+				}
+				continue;
+			}
+
+			bool Indefinite = Info == 31;
+			if ( Indefinite && (Major == 0 || Major == 1 || Major == 6) )
+				throw std::runtime_error("Invalid indefinite length CBOR integer/tag");
+			auto Argument = Indefinite ? 0 : ReadArgument( Info );
+
+			switch ( Major )
+			{
+				case 0:	Writer.WriteUnsigned( Argument );	break;
+				case 1:	Writer.WriteNegative( Argument );	break;
+				case 2:	throw std::runtime_error("CBOR byte strings have no json equivalent");
+				case 3:
+					if ( !Indefinite )
+					{
+						Writer.WriteString( Reader.ReadString( Argument ) );
+						break;
+					}
+					//	indefinite strings are a series of definite text chunks
+					Writer.BeginString();
+					while ( true )
+					{
+						auto Chunk = Reader.ReadByte();
+						if ( Chunk == 0xff )
+							break;
+						if ( (Chunk >> 5) != 3 || (Chunk & 0x1f) == 31 )
+							throw std::runtime_error("Invalid chunk in indefinite CBOR string");
+						Writer.AppendString( Reader.ReadString( ReadArgument( Chunk & 0x1f ) ) );
+					}
+					Writer.EndString();
+					break;
+				case 4:	Writer.BeginContainer( false, Argument, Indefinite );	break;
+				case 5:	Writer.BeginContainer( true, Argument, Indefinite );	break;
+				case 6:	break;	//	tags (dates, bignums etc) are dropped and the tagged item written as-is
+			}
+		}
+		while ( !Writer.IsComplete() );
+	}
+}
+
+
+void PopJson::Transcode::Write(Format_t::Type Format,const Map_t& Map,std::string_view Json,std::vector<uint8_t>& Output,NodeIndex_t Node)
+{
+	if ( Node >= Map.GetNodeCount() )
+		throw std::runtime_error("Transcode node " + std::to_string(Node) + " out of range");
+
+	switch ( Format )
+	{
+		case Format_t::MessagePack:	return WriteMap<MessagePackWriter_t>( Map, Json, Output, Node );
+		case Format_t::Cbor:		return WriteMap<CborWriter_t>( Map, Json, Output, Node );
+	}
+	throw std::runtime_error("Unknown transcode format");
+}
+
+std::vector<uint8_t> PopJson::Transcode::Write(Format_t::Type Format,std::string_view Json)
+{
+	auto Map = Parse( Json );
+	std::vector<uint8_t> Output;
+	//	binary is rarely bigger than the json
+	Output.reserve( Json.size() );
+	Write( Format, Map, Json, Output );
+	return Output;
+}
+
+size_t PopJson::Transcode::ReadToJson(Format_t::Type Format,std::span<const uint8_t> Data,std::vector<char>& Json)
+{
+	BinaryReader_t Reader( Data );
+	JsonTextWriter_t Writer( Json );
+	switch ( Format )
+	{
+		case Format_t::MessagePack:	ReadMessagePack( Reader, Writer );	break;
+		case Format_t::Cbor:		ReadCbor( Reader, Writer );	break;
+		default:
+			throw std::runtime_error("Unknown transcode format");
+	}
+	return Reader.GetPosition();
+}
+
+PopJson::Json_t PopJson::Transcode::Read(Format_t::Type Format,std::span<const uint8_t> Data)
+{
+	std::vector<char> Json;
+	Json.reserve( Data.size() * 2 );
+	auto Used = ReadToJson( Format, Data, Json );
+	if ( Used != Data.size() )
+		throw std::runtime_error("Trailing data after binary document; " + std::to_string(Data.size()-Used) + " bytes");
+	return Json_t( std::string_view( Json.data(), Json.size() ) );
+}
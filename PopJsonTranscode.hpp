@@ -0,0 +1,38 @@
+/*
+	Transcoding between json and the binary MessagePack & CBOR formats.
+
+	Writers walk a parsed Map_t rather than a DOM. Nodes are depth-first and know their
+	child counts, so every container length is known before its children are written and a
+	single linear pass over the subtree emits the whole document. Numbers are converted from
+	their raw json text and strings without escapes are copied straight to the output.
+
+	Readers decode to json text, which a Json_t can then own. Binary-only types (byte strings,
+	extensions) have no json equivalent and throw.
+*/
+#pragma once
+
+#include "PopJson.hpp"
+#include <span>
+#include <vector>
+
+namespace PopJson::Transcode
+{
+	namespace Format_t
+	{
+		enum Type
+		{
+			MessagePack,
+			Cbor,
+		};
+	}
+
+	//	append Node (and its subtree) of a map over Json to Output
+	void					Write(Format_t::Type Format,const Map_t& Map,std::string_view Json,std::vector<uint8_t>& Output,NodeIndex_t Node=0);
+	std::vector<uint8_t>	Write(Format_t::Type Format,std::string_view Json);
+
+	//	decode one value from the start of Data and append it to Json as (minified) json text.
+	//	returns the number of bytes consumed
+	size_t					ReadToJson(Format_t::Type Format,std::span<const uint8_t> Data,std::vector<char>& Json);
+	//	decode a whole binary document; throws if there are trailing bytes
+	Json_t					Read(Format_t::Type Format,std::span<const uint8_t> Data);
+}
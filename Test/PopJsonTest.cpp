@@ -0,0 +1,119 @@
+/*
+	PopJson test runner; runs PopJson::UnitTest(), plus the checks which need every heap
+	allocation counted (a global operator new, which the library itself can't install).
+
+	PopJsonTest
+*/
+#include "PopJson.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+
+namespace
+{
+	std::atomic<uint64_t>	gAllocationCount(0);
+
+	void*	CountedAlloc(std::size_t Size)
+	{
+		gAllocationCount.fetch_add( 1, std::memory_order_relaxed );
+		if ( auto* Pointer = std::malloc( Size ? Size : 1 ) )
+			return Pointer;
+		throw std::bad_alloc();
+	}
+
+	void	CountedFree(void* Pointer)
+	{
+		std::free( Pointer );
+	}
+
+	//	throws if Function allocates
+	template<typename FUNCTION>
+	void	ExpectNoAllocations(const char* Name,FUNCTION Function)
+	{
+		auto Before = gAllocationCount.load();
+		Function();
+		auto Allocations = gAllocationCount.load() - Before;
+		if ( Allocations != 0 )
+			throw std::runtime_error( std::string(Name) + " made " + std::to_string(Allocations) + " allocations" );
+	}
+
+	//	once reserved, typed writes don't allocate, and moves hand over buffers
+	void	AllocationTest()
+	{
+		using namespace PopJson;
+		Json_t Json;
+		Json.Reserve( 1024, 64 );
+		Json.Set("First", "Value");
+		//	Set() adds a member each time (existing keys aren't replaced), so 61 children
+		ExpectNoAllocations( "Reserved typed Set()", [&]
+		{
+			for ( int i=0;	i<15;	i++ )
+			{
+				Json.Set("Double", i * 1.5 );
+				Json.Set("Integer", i );
+				Json.Set("Bool", i % 2 == 0 );
+				Json.Set("String", "text" );
+			}
+		});
+
+		Json_t Array;
+		Array.Reserve( 1024, 64 );
+		ExpectNoAllocations( "Reserved typed PushBack()", [&]
+		{
+			for ( int i=0;	i<20;	i++ )
+			{
+				Array.PushBack( i * 0.25 );
+				Array.PushBack( i );
+				Array.PushBack( true );
+			}
+		});
+
+		std::optional<Json_t> Moved;
+		ExpectNoAllocations( "Json_t move construction", [&]	{	Moved.emplace( std::move(Json) );	} );
+		Json_t MoveAssigned;
+		ExpectNoAllocations( "Json_t move assignment", [&]	{	MoveAssigned = std::move(*Moved);	} );
+
+		std::string Buffer;
+		if ( MoveAssigned.GetChildCount() != 61 || MoveAssigned.GetValue("First").GetString(Buffer) != "Value" )
+			throw std::runtime_error("Moved Json_t wrote " + MoveAssigned.GetJsonString() );
+		if ( Array.GetChildCount() != 60 )
+			throw std::runtime_error("Reserved PushBack() wrote " + Array.GetJsonString() );
+	}
+}
+
+void* operator new(std::size_t Size)
+{
+	return CountedAlloc( Size );
+}
+
+void operator delete(void* Pointer) noexcept
+{
+	CountedFree( Pointer );
+}
+
+void operator delete(void* Pointer,std::size_t) noexcept
+{
+	CountedFree( Pointer );
+}
+
+
+int main()
+{
+	try
+	{
+		AllocationTest();
+		PopJson::UnitTest();
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << "PopJson test failed; " << e.what() << std::endl;
+		return 1;
+	}
+	std::cout << "PopJson tests passed" << std::endl;
+	return 0;
+}